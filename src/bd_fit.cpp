@@ -1,6 +1,7 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <sstream>
 #include <cmath>
 #include <numeric>
 #include <algorithm>
@@ -9,11 +10,7 @@
 #include "bd_fit.h"
 #include "tree.h"
 #include "node.h"
-#include "tree_utils.h"
-
-
-// hrm a debugging thing i gather
-int counter = 0;
+#include "utils.h"
 
 
 typedef struct {
@@ -22,24 +19,49 @@ typedef struct {
 } analysis_data;
 
 
+static const char * stat_names[] = {"ntips", "nspeciation", "treelength", "rootheight",
+    "likelihood", "aic", "aicc", "b", "d", "r", "e"};
+static const int num_stats = 11;
+
+
 BDFit::BDFit (Tree * intree, const std::string& modelflavour):model_(modelflavour),
     lambda_bd_(0.0), lambda_yule_(0.0), mu_(0.0), r_(0.0), epsilon_(0.0), likelihood_bd_(0.0),
-    likelihood_yule_(0.0), aic_bd_(0.0), aicc_bd_(0.0), aic_yule_(0.0), aicc_yule_(0.0) {
-    tree_ = intree;
+    likelihood_yule_(0.0), aic_bd_(0.0), aicc_bd_(0.0), aic_yule_(0.0), aicc_yule_(0.0),
+    best_(false) {
+    collect_tree_data(intree);
     fit_model();
 }
 
 
-void BDFit::fit_model () {
-    treelength_ = get_tree_length(tree_);
-    nintnodes_ = tree_->getInternalNodeCount();
+// everything the fits need, in one pass over the nodes (heights must already
+// be set, e.g. by is_ultrametric_paths). the tree is not needed after this
+void BDFit::collect_tree_data (Tree * tree) {
+    treelength_ = 0.0;
+    ntips_ = 0.0;
+    branching_times_.clear();
+    for (int i = 0; i < tree->getNodeCount(); i++) {
+        Node * nd = tree->getNode(i);
+        treelength_ += nd->getBL();
+        if (nd->isInternal()) {
+            branching_times_.push_back(nd->getHeight());
+        } else {
+            ntips_ += 1.0;
+        }
+    }
+    nintnodes_ = (double)branching_times_.size();
     nspeciation_ = nintnodes_ - 1.0;
-    ntips_ = tree_->getExternalNodeCount();
-    rootheight_ = tree_->getRoot()->getHeight();
-    // model flavour is checked 
+    rootheight_ = tree->getRoot()->getHeight();
+    // sort in descending order
+    std::sort(branching_times_.begin(), branching_times_.end(), std::greater<double>());
+}
+
+
+void BDFit::fit_model () {
+    // model flavour is checked
     if (model_ == "yule") {
         fit_yule();
     } else if (model_ == "bd") {
+        fit_yule(); // starting values
         fit_bd();
     } else if (model_ == "best") {
         get_best_model();
@@ -49,23 +71,10 @@ void BDFit::fit_model () {
 
 // find the best model between yule and bd using aic
 void BDFit::get_best_model () {
-    treelength_ = get_tree_length(tree_);
-    nintnodes_ = tree_->getInternalNodeCount();
-    nspeciation_ = nintnodes_ - 1.0;
-    ntips_ = tree_->getExternalNodeCount();
-    rootheight_ = tree_->getRoot()->getHeight();
     fit_yule();
     fit_bd();
-    if (aicc_yule_ < aicc_bd_) {
-        std::cout << "yule model fits better by " << aicc_bd_ - aicc_yule_
-                << " AICc units" << std::endl;
-        model_ = "yule";
-    } else {
-        std::cout << "bd model fits better by " << aicc_yule_ - aicc_bd_
-                << " AICc units" << std::endl;
-        model_ = "bd";
-    }
-    
+    best_ = true;
+    model_ = (aicc_yule_ < aicc_bd_) ? "yule" : "bd";
 }
 
 
@@ -85,51 +94,49 @@ void BDFit::fit_yule () {
     lambda_yule_ = nspeciation_ / treelength_;
     likelihood_yule_ = nspeciation_ * log(lambda_yule_) - lambda_yule_ * treelength_
         + std::lgamma(nintnodes_ + 1.0);
-    get_aic (likelihood_yule_, aic_yule_, aicc_yule_);
+    get_aic (likelihood_yule_, 1.0, aic_yule_, aicc_yule_);
 }
 
 
+/*
+the bd likelihood (below) with e = 0 is maximized at r = (N-2) / treelength,
+i.e. the yule estimate, so that is where the search starts. with analytic
+gradients a quasi-newton method (L-BFGS) converges in a handful of iterations,
+where the old derivative-free search started from a fixed (0.05, 0.5)
+*/
 void BDFit::fit_bd() {
-    branching_times_.resize(nintnodes_);
-    for (int i=0; i < nintnodes_; i++) {
-        branching_times_[i] = tree_->getInternalNode(i)->getHeight();
-    }
-    
-    // sort in descending order
-    sort(branching_times_.begin(), branching_times_.end(), std::greater<double>());
-    
     analysis_data a;
     a.N = ntips_;
     a.bt = branching_times_;
     
-    // explore different algorithms here
-    // the following give error: nlopt roundoff-limited
-    //nlopt::opt opt(nlopt::LN_COBYLA, 2);
-    //nlopt::opt opt(nlopt::LN_BOBYQA, 2);
-    
-    nlopt::opt opt(nlopt::LN_PRAXIS, 2); // example: variable iterations, most smaller
-    //nlopt::opt opt(nlopt::LN_NELDERMEAD, 2); // example: 223 iterations
-    //nlopt::opt opt(nlopt::LN_SBPLX, 2); // example: 316 iterations
-    
+    nlopt::opt opt(nlopt::LD_LBFGS, 2);
     opt.set_min_objective(nlopt_bd_log_lik, &a);
     
     // parameters: r, epsilon
-    std::vector<double> x(2);
-    // starting values. maybe use intelligent starting values
-    x[0] = 0.05; x[1] = 0.5; // lambda = 0.1, mu = 0.05
-    
-    // ML vals for example tree
-    //x[0] = 0.7383142; x[1] = 0.3018887;
-    
-    // lower bounds: 0 for both r, epsilon
-    opt.set_lower_bounds(0.0);
+    // lower bounds: (effectively) 0 for both r, epsilon
     // upper bounds: none for r, 1 for epsilon
+    std::vector<double> lb(2);
+    lb[0] = 1e-10; lb[1] = 0.0;
     std::vector<double> ub(2);
-    ub[0] = 50; ub[1] = 1;
+    ub[0] = 50; ub[1] = 1.0 - 1e-10;
+    opt.set_lower_bounds(lb);
     opt.set_upper_bounds(ub);
+    opt.set_xtol_rel(1e-10);
+    opt.set_ftol_rel(1e-14);
+    opt.set_maxeval(10000);
     
-    double minf;
-    opt.optimize(x, minf);
+    std::vector<double> x(2);
+    x[0] = std::min(std::max(lambda_yule_, lb[0]), ub[0]);
+    x[1] = 0.0;
+    
+    double minf = 0.0;
+    try {
+        opt.optimize(x, minf);
+    } catch (nlopt::roundoff_limited& e) {
+        // converged as far as floating point allows; x holds the best point
+        std::vector<double> nograd;
+        minf = nlopt_bd_log_lik(x, nograd, &a);
+    }
     
     r_ = x[0];
     epsilon_ = x[1];
@@ -137,50 +144,65 @@ void BDFit::fit_bd() {
     mu_ = lambda_bd_ - r_;
     
     likelihood_bd_ = -minf;
-    get_aic (likelihood_bd_, aic_bd_, aicc_bd_);
-    //std::cout << "found minimum after " << counter << " evaluations." << std::endl;
+    get_aic (likelihood_bd_, 2.0, aic_bd_, aicc_bd_);
 }
 
 
+// log(e^(bt r) - e) is computed as bt r + log(1 - e e^(-bt r)), which does not
+// overflow for old trees / fast rates
 double nlopt_bd_log_lik (const std::vector<double>& x, std::vector<double>& grad,
     void *data) {
-    // count iterations for optimization of algorithm
-    counter++;
-    
     analysis_data * d = (analysis_data *) data;
     
     int N = d->N;
-    std::vector<double> bt = d->bt;
+    const std::vector<double>& bt = d->bt;
+    double r = x[0];
+    double e = x[1];
     
-    double lik = std::lgamma(N) + (N - 2) * log(x[0]) + N * log(1 - x[1]);
+    double lik = std::lgamma(N) + (N - 2) * log(r) + N * log(1 - e);
     
-    lik += (x[0] * std::accumulate(bt.begin()+1, bt.end(), 0.0));
+    lik += (r * std::accumulate(bt.begin()+1, bt.end(), 0.0));
     
     double tempsum = 0.0;
+    double dr = 0.0;
+    double de = 0.0;
     for (unsigned int i = 0; i < bt.size(); i++) {
-        tempsum += log(exp(bt[i] * x[0]) - x[1]);
+        double z = e * exp(-bt[i] * r);
+        tempsum += bt[i] * r + log1p(-z);
+        dr += bt[i] / (1.0 - z);
+        de += exp(-bt[i] * r) / (1.0 - z);
     }
     
     lik += tempsum * (-2);
     
+    if (!grad.empty()) {
+        grad[0] = -((N - 2) / r + std::accumulate(bt.begin()+1, bt.end(), 0.0) - 2.0 * dr);
+        grad[1] = -(-N / (1 - e) + 2.0 * de);
+    }
     return -lik;
 }
 
 
 // calculate model-specific raw and small-sample-corrected AIC
 // 'n' here (number of data points) is taken as the number of terminals
-void BDFit::get_aic (const double& lik, double& aic, double& aicc) {
-    double K = 1.0;
+// K is the number of parameters of the model
+void BDFit::get_aic (const double& lik, const double& K, double& aic, double& aicc) {
     double n = ntips_;
-    if (model_ == "bd") {
-        K = 2.0;
-    }
     aic = (-2.0 * lik) + (2.0 * K);
     aicc = aic + (2.0 * K * (K + 1.0)) / (n - K - 1.0);
 }
 
 
 void BDFit::get_pars (std::ostream* poos) {
+    if (best_) {
+        if (model_ == "yule") {
+            (*poos) << "yule model fits better by " << aicc_bd_ - aicc_yule_
+                << " AICc units" << std::endl;
+        } else {
+            (*poos) << "bd model fits better by " << aicc_yule_ - aicc_bd_
+                << " AICc units" << std::endl;
+        }
+    }
     (*poos) << "ntips: " << ntips_ << std::endl;
     (*poos) << "nspeciation: " << nspeciation_ << std::endl;
     (*poos) << "treelength: " << treelength_ << std::endl;
@@ -201,3 +223,57 @@ void BDFit::get_pars (std::ostream* poos) {
         (*poos) << "e (d/b): " << epsilon_ << std::endl;
     }
 }
+
+
+std::string BDFit::get_table_header () {
+    std::string header = "tree\tmodel";
+    for (int i = 0; i < num_stats; i++) {
+        header += "\t";
+        header += stat_names[i];
+    }
+    return header + "\n";
+}
+
+
+// one tab-separated line: the values of get_pars (d, r, e are NA for yule)
+void BDFit::get_table_row (const long& index, std::string& out) const {
+    std::vector<double> vals;
+    std::vector<bool> na;
+    get_values(vals, na);
+    std::ostringstream row;
+    row << index << "\t" << model_;
+    for (int i = 0; i < num_stats; i++) {
+        row << "\t";
+        if (na[i]) {
+            row << "NA";
+        } else {
+            row << vals[i];
+        }
+    }
+    row << "\n";
+    out += row.str();
+}
+
+
+void BDFit::get_values (std::vector<double>& vals, std::vector<bool>& na) const {
+    bool yule = (model_ == "yule");
+    vals.resize(num_stats);
+    na.assign(num_stats, false);
+    vals[0] = ntips_;
+    vals[1] = nspeciation_;
+    vals[2] = treelength_;
+    vals[3] = rootheight_;
+    vals[4] = yule ? likelihood_yule_ : likelihood_bd_;
+    vals[5] = yule ? aic_yule_ : aic_bd_;
+    vals[6] = yule ? aicc_yule_ : aicc_bd_;
+    vals[7] = yule ? lambda_yule_ : lambda_bd_;
+    vals[8] = mu_;
+    vals[9] = r_;
+    vals[10] = epsilon_;
+    na[8] = na[9] = na[10] = yule;
+}
+
+
+std::vector<std::string> BDFit::get_stat_names () {
+    return std::vector<std::string>(stat_names, stat_names + num_stats);
+}
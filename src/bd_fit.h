@@ -24,8 +24,8 @@ private:
     double aicc_bd_;
     double aic_yule_;
     double aicc_yule_;
+    bool best_; // model_ was chosen by AICc
     
-    Tree* tree_;
     double treelength_;
     double nintnodes_;
     double nspeciation_;
@@ -33,18 +33,24 @@ private:
     std::vector<double> branching_times_;
     double rootheight_;
     
+    void collect_tree_data (Tree * tree);
     void fit_model();
     void get_best_model();
     void fit_yule();
     void fit_bd();
-    void get_aic(const double& lik, double& aic, double& aicc);
+    void get_aic(const double& lik, const double& K, double& aic, double& aicc);
 
 public:
     BDFit(Tree * intree, const std::string& modelflavour);
     void get_pars(std::ostream* poos);
+    static std::string get_table_header ();
+    static std::vector<std::string> get_stat_names ();
+    void get_table_row (const long& index, std::string& out) const;
+    void get_values (std::vector<double>& vals, std::vector<bool>& na) const;
 };
 
 // non-member function, as nlopt is weird with pointers...
+// also fills in the analytic gradient when the optimizer asks for it
 double nlopt_bd_log_lik (const std::vector<double>& x, std::vector<double>& grad,
     void *data);
 
@@ -1,66 +1,84 @@
 #include <string>
 #include <vector>
-#include <map>
 #include <iostream>
 #include <cmath>
 #include <cstdlib>
-#include <algorithm>
-#include <ctime>
 #include <random>
 
 #include "bd_sim.h"
-#include "tree.h"
-#include "node.h"
+#include "tree_writer.h"
 #include "utils.h"
+#include "profile.h"
 
 
 BirthDeathSimulator::BirthDeathSimulator (const double& estop, const double& tstop,
-    const double& brate, const double& drate, const int& seed):failures_(0), maxfailures_(1000), birthrate_(brate),
-    deathrate_(drate), sumrate_(brate+drate), relative_birth_rate_(brate/(brate+drate)),
-    extantstop_(estop), timestop_(tstop), numofchanges_(0), currenttime_(0.0),
-    extantnodes_(std::vector<Node*>()), BIRTHTIME_(std::map<Node*, double>()),
-    DEATHTIME_(std::map<Node*, double>()) {
-    if (seed == -1) {
-        generator_ =  std::mt19937(get_clock_seed());
+    const double& brate, const double& drate, const bool& reconstructed):maxfailures_(1000),
+    birthrate_(brate), deathrate_(drate), sumrate_(brate+drate),
+    relative_birth_rate_(brate/(brate+drate)), extantstop_(estop), timestop_(tstop),
+    reconstructed_(reconstructed), currenttime_(0.0) {
+    uniformDistrib_ =  std::uniform_real_distribution<double>(0.0, 1.0);
+}
+
+
+// each replicate gets its own stream, so results do not depend on how
+// replicates are spread across threads
+void BirthDeathSimulator::set_seed (const unsigned int& seed, const unsigned int& rep) {
+    std::seed_seq seq{seed, rep};
+    generator_.seed(seq);
+}
+
+
+// false (and nothing appended) if the process died out maxfailures_ times in
+// a row. the caller reports it: this may run on a worker thread
+bool BirthDeathSimulator::append_tree (std::string& out, const bool& show_dead) {
+    PX_PROFILE_PHASE("simulate tree");
+    if (reconstructed_) {
+        append_reconstructed_tree(out);
     } else {
-        generator_ =  std::mt19937(seed);
+        if (!simulate()) {
+            return false;
+        }
+        append_simulated_tree(out, show_dead);
     }
-    uniformDistrib_ =  std::uniform_real_distribution<double>(0.0, 1.0);
+    return true;
 }
 
 
-// not currently used
-BirthDeathSimulator::BirthDeathSimulator ():failures_(0), maxfailures_(1000),
-    birthrate_(0.1), deathrate_(0.05), sumrate_(0.1+0.05),
-    relative_birth_rate_(0.1/(0.1+0.05)), extantstop_(10), timestop_(0), numofchanges_(0),
-    currenttime_(0.0), extantnodes_(std::vector<Node*>()), BIRTHTIME_(std::map<Node*, double>()),
-    DEATHTIME_(std::map<Node*, double>()) {
-        generator_ =  std::mt19937(get_clock_seed());
-        uniformDistrib_ =  std::uniform_real_distribution<double>(0.0, 1.0);
+int BirthDeathSimulator::get_max_failures () const {
+    return maxfailures_;
 }
 
 
+// arrays keep their capacity from replicate to replicate
 void BirthDeathSimulator::setup_parameters () {
-    numofchanges_ = 0;
     currenttime_ = 0.0;
-    extantnodes_ = std::vector<Node*>();
-    dead_nodes_ = std::vector<Node*>();
-    BIRTHTIME_ = std::map<Node*, double>();
-    DEATHTIME_ = std::map<Node*, double>();
+    parent_.clear();
+    left_.clear();
+    right_.clear();
+    birthtime_.clear();
+    deathtime_.clear();
+    extant_.clear();
+}
+
+
+int BirthDeathSimulator::add_node (const int& parent) {
+    int nd = (int)parent_.size();
+    parent_.push_back(parent);
+    left_.push_back(-1);
+    right_.push_back(-1);
+    birthtime_.push_back(currenttime_);
+    deathtime_.push_back(currenttime_);
+    return nd;
 }
 
 
-Tree * BirthDeathSimulator::make_tree (const bool& show_dead) {
+bool BirthDeathSimulator::simulate () {
+    int failures = 0; // don't want to accumulate errors across replicates
     setup_parameters();
-    root_ = new Node();
-    BIRTHTIME_[root_] = currenttime_;
-    extantnodes_.push_back(root_);
-    
+    extant_.push_back(add_node(-1));
     // actually want to start with 2 lineages
-    node_birth(extantnodes_[0]);
+    node_birth(0);
     
-    // reset failures to zero. don't want to accumulate errors across replicates
-    failures_ = 0;
     bool going = true;
     while (going) {
         double dt = time_to_next_event();
@@ -68,58 +86,28 @@ Tree * BirthDeathSimulator::make_tree (const bool& show_dead) {
         going = check_stop_conditions();
         if (going) {
             event();
-            if (extantnodes_.size() < 1) {
-                failures_ += 1;
-                //std::cout << "failed!" << std::endl;
-                if (failures_ >= maxfailures_) {
-                    std::cout << "Reached maximum number of failures (" << failures_
-                        << "). Quitting." << std::endl;
-                    exit(0);
+            if (extant_.empty()) {
+                failures += 1;
+                if (failures >= maxfailures_) {
+                    return false;
                 }
                 setup_parameters();
-                root_ = new Node();//need to clean
-                BIRTHTIME_[root_] = currenttime_;//need to clean
-                extantnodes_.push_back(root_);//empty
+                extant_.push_back(add_node(-1));
+                node_birth(0);
             }
         }
     }
-    
-    std::vector<Node*> temp_extant_nodes(extantnodes_);
-    for (unsigned int i=0; i < temp_extant_nodes.size(); i++) {
-        try {
-            DEATHTIME_[temp_extant_nodes[i]];
-            node_death(temp_extant_nodes[i]);
-        } catch( char * str ) {
-            std::cout << "catch" << std::endl;
-            node_death(temp_extant_nodes[i]);
-            //temp_extant_nodes[i]->istip = 1
-        }
-    }
-
-    root_->setBL(0);
-    double totallength = 0;
-    int count = 1;
-    tree_ = new Tree(root_);
-    tree_->processRoot();
-    if (show_dead == false) {
-        delete_dead_nodes();
-    }
-
-    for (int i=0; i < tree_->getExternalNodeCount(); i++) {
-        totallength += tree_->getExternalNode(i)->getBL();
-        std::stringstream out;
-        out << count;
-        tree_->getExternalNode(i)->setName("taxon_"+out.str());
-        count += 1;
+    for (unsigned int i = 0; i < extant_.size(); i++) {
+        deathtime_[extant_[i]] = currenttime_;
     }
-    return tree_;
+    return true;
 }
 
 
 bool BirthDeathSimulator::check_stop_conditions () {
     bool keepgoing = true;
     if (extantstop_ > 0) {
-        if ((int)extantnodes_.size() >= extantstop_) {
+        if ((int)extant_.size() >= extantstop_) {
             // this ensures tips do not have 0 edge lengths
             currenttime_ += time_to_next_event();
             keepgoing = false;
@@ -138,120 +126,229 @@ bool BirthDeathSimulator::check_stop_conditions () {
 
 // time until next event (rate = sum of birth + death)
 double BirthDeathSimulator::time_to_next_event () {
-    //double num = rand() / double(RAND_MAX);
     double num = uniformDistrib_(generator_);
-    return (-log(num))/ ( (extantnodes_.size()) * sumrate_);
+    return (-log(num))/ ( (extant_.size()) * sumrate_);
 }
 
 
 void BirthDeathSimulator::event () {
-    std::uniform_int_distribution<int> intDistrib(0, (extantnodes_.size()-1));
-    int random_integer = intDistrib(generator_);
-    //std::cout << "extantnodes.size() = " << extantnodes.size() << "; random_integer = "
-    //    << random_integer << std::endl;
-    Node * extant = extantnodes_[random_integer];
+    std::uniform_int_distribution<int> intDistrib(0, (extant_.size()-1));
+    int slot = intDistrib(generator_);
     if (event_is_birth()) {
-        node_birth(extant); // real speciation
+        node_birth(slot); // real speciation
     } else {
-        node_death(extant);
-        dead_nodes_.push_back(extant);
+        node_death(slot);
     }
 }
 
 
-void BirthDeathSimulator::node_death (Node *innode) {
-    DEATHTIME_[innode] = currenttime_;
-    double bl = DEATHTIME_[innode] - BIRTHTIME_[innode];
-    innode->setBL(bl);
-    extantnodes_.erase(find(extantnodes_.begin(), extantnodes_.end(), innode));
+// swap-remove the lineage in extant_[slot]
+void BirthDeathSimulator::node_death (const int& slot) {
+    deathtime_[extant_[slot]] = currenttime_;
+    extant_[slot] = extant_.back();
+    extant_.pop_back();
 }
 
 
-void BirthDeathSimulator::node_birth (Node *innode) {
-    Node * left = new Node();
-    Node * right = new Node();
-    innode->addChild(*left);
-    innode->addChild(*right);
-    BIRTHTIME_[left] = currenttime_;
-    BIRTHTIME_[right] = currenttime_;
-    node_death(innode);
-    extantnodes_.push_back(left);
-    extantnodes_.push_back(right);
+// the left daughter takes over the parent's slot
+void BirthDeathSimulator::node_birth (const int& slot) {
+    int nd = extant_[slot];
+    deathtime_[nd] = currenttime_;
+    int left = add_node(nd);
+    int right = add_node(nd);
+    left_[nd] = left;
+    right_[nd] = right;
+    extant_[slot] = left;
+    extant_.push_back(right);
 }
 
 
-void BirthDeathSimulator::delete_dead_nodes () {
-    for (unsigned int i=0; i < dead_nodes_.size(); i++) {
-        delete_a_node(dead_nodes_[i]);
+bool BirthDeathSimulator::event_is_birth () {
+    double x = uniformDistrib_(generator_);
+    if (x < relative_birth_rate_) {
+        return true;
+    } else {
+        return false;
     }
 }
 
 
-void BirthDeathSimulator::set_distance_to_tip () {
-    for (int i=0; i < tree_->getExternalNodeCount(); i++) {
-        double curh = 0.0;
-        tree_->getExternalNode(i)->setHeight(curh);
-        Node * tnode = tree_->getExternalNode(i);
-        while (tnode->hasParent()) {
-            curh += tnode->getBL();
-            if (tnode->getHeight() < curh) {
-                tnode->setHeight(curh);
+// follow a chain of nodes with a single kept child (i.e., whose sister lineage
+// went extinct) down from nd, summing edge lengths into bl. returns the node
+// at the bottom of the chain
+int BirthDeathSimulator::get_newick_child (int nd, double& bl) const {
+    bl = deathtime_[nd] - birthtime_[nd];
+    while (left_[nd] != -1 && (keep_[left_[nd]] + keep_[right_[nd]]) == 1) {
+        nd = (keep_[left_[nd]]) ? left_[nd] : right_[nd];
+        bl += deathtime_[nd] - birthtime_[nd];
+    }
+    return nd;
+}
+
+
+// tips are labelled taxon_1, taxon_2, ... in the order they are written.
+// without show_dead, extinct lineages are pruned and the resulting knees
+// collapsed on the fly
+void BirthDeathSimulator::append_simulated_tree (std::string& out, const bool& show_dead) {
+    int nnodes = (int)parent_.size();
+    keep_.assign(nnodes, (char)show_dead);
+    for (unsigned int i = 0; i < extant_.size(); i++) {
+        keep_[extant_[i]] = 1;
+    }
+    for (int i = nnodes - 1; i > 0; i--) {
+        if (keep_[i]) {
+            keep_[parent_[i]] = 1;
+        }
+    }
+    
+    double bl = 0.0;
+    int root = get_newick_child(0, bl);
+    size_t start = out.size();
+    int ntips = 0;
+    std::vector<double> bls(1, 0.0);
+    stack_.clear();
+    stack_.push_back(std::make_pair(root, 0));
+    while (!stack_.empty()) {
+        int cur = stack_.back().first;
+        int next = stack_.back().second;
+        int kids[2];
+        int nkids = 0;
+        if (left_[cur] != -1) {
+            if (keep_[left_[cur]]) {
+                kids[nkids++] = left_[cur];
+            }
+            if (keep_[right_[cur]]) {
+                kids[nkids++] = right_[cur];
             }
-            tnode = tnode->getParent();
         }
-        curh += tnode->getBL();
-        if (tnode->getHeight()<curh) {
-            tnode->setHeight(curh);
+        if (next < nkids) {
+            if (next == 0) {
+                out += '(';
+            }
+            stack_.back().second++;
+            stack_.push_back(std::make_pair(get_newick_child(kids[next], bl), 0));
+            bls.push_back(bl);
+            continue;
+        }
+        if (nkids == 0) {
+            ntips++;
+            out += "taxon_" + std::to_string(ntips);
         }
+        stack_.pop_back();
+        if (stack_.empty()) {
+            break;
+        }
+        out += ':';
+        append_double(out, bls.back());
+        bls.pop_back();
+        int par = stack_.back().first;
+        int nparkids = (left_[par] == -1) ? 0 : keep_[left_[par]] + keep_[right_[par]];
+        out += (stack_.back().second == nparkids) ? ')' : ',';
+    }
+    if (ntips == 1) {
+        out.insert(start, "(");
+        out += ")";
     }
+    out += ";\n";
 }
 
 
-void BirthDeathSimulator::delete_a_node (Node * innode) {
-    Node * tparent = innode->getParent();
-    if (tparent != root_) {
-        Node * child = NULL;
-        for (int i=0; i < tparent->getChildCount(); i++)
-            if (tparent->getChild(i) != innode) {
-                child = tparent->getChild(i);
-            }
-        Node * pparent = tparent->getParent();
-        tparent->removeChild(*innode);
-        tparent->removeChild(*child);
-        pparent->removeChild(*tparent);
-        pparent->addChild(*child);
-        child->setParent(*pparent);
-        child->setBL(child->getBL()+tparent->getBL());
-    } else {
-        Node * child = NULL;
-        for (int i=0; i < tparent->getChildCount(); i++)
-            if (tparent->getChild(i) != innode) {
-                child = tparent->getChild(i);
-            }
-        tparent->removeChild(*innode);
-        tree_->setRoot(child);
-        root_ = child;
+// the inverse of the probability that a node depth in the coalescent point
+// process exceeds t: 1 + b/r (e^rt - 1), r = b - d (1 + bt when b == d).
+// also the expected number of tips of a lineage of age t given it survives
+double BirthDeathSimulator::get_inverse_scale (const double& t) const {
+    double r = birthrate_ - deathrate_;
+    if (std::fabs(r) < 1e-12 * birthrate_) {
+        return 1.0 + birthrate_ * t;
     }
+    return 1.0 + (birthrate_ / r) * (std::exp(r * t) - 1.0);
 }
 
 
-bool BirthDeathSimulator::event_is_birth () {
-    double x = uniformDistrib_(generator_);
-    if (x < relative_birth_rate_) {
-        return true;
-    } else {
-        return false;
+// node depths of the reconstructed tree of a lineage of age t, conditioned on
+// it surviving: depths are iid, and the first one that exceeds t ends the
+// sequence (so the number of tips is geometric). the ones kept are drawn
+// from the distribution truncated at t by inverting its cdf
+void BirthDeathSimulator::sample_node_depths (const double& t) {
+    double q = 1.0 / get_inverse_scale(t);
+    double r = birthrate_ - deathrate_;
+    bool critical = std::fabs(r) < 1e-12 * birthrate_;
+    while (uniformDistrib_(generator_) >= q) {
+        double u = uniformDistrib_(generator_);
+        double y = 1.0 / (1.0 - u * (1.0 - q)); // inverse scale at the depth
+        double h = (critical) ? (y - 1.0) / birthrate_
+            : std::log(1.0 + (y - 1.0) * r / birthrate_) / r;
+        depths_.push_back(h);
     }
 }
 
 
-double BirthDeathSimulator::get_distance_from_tip (Node *innode) {
-    Node * cur = innode;
-    double curh = 0.0;
-    while (cur->hasParent()) {
-        curh += cur->getBL();
-        cur = cur->getParent();
+// the 2 lineages at the root each survive to the present with probability
+// p = e^rt / F(t). conditioned on at least 1 surviving, both do with
+// probability p / (2 - p), and their point processes are joined by the root
+// (depth t). the tree is the max cartesian tree of the depths: the node
+// between tips k and k+1 has depth depths_[k]
+void BirthDeathSimulator::append_reconstructed_tree (std::string& out) {
+    double t = timestop_;
+    double p = std::exp((birthrate_ - deathrate_) * t) / get_inverse_scale(t);
+    depths_.clear();
+    sample_node_depths(t);
+    if (uniformDistrib_(generator_) < p / (2.0 - p)) {
+        depths_.push_back(t);
+        sample_node_depths(t);
+    }
+    int nint = (int)depths_.size();
+    if (nint == 0) {
+        out += "(taxon_1);\n";
+        return;
+    }
+    
+    // children: internal nodes are >= 0, tip i is -(i + 1)
+    left_.resize(nint);
+    right_.resize(nint);
+    extant_.clear(); // used as the stack for building the tree
+    for (int k = 0; k < nint; k++) {
+        left_[k] = -(k + 1);
+        right_[k] = -(k + 2);
+        int last = -1;
+        while (!extant_.empty() && depths_[extant_.back()] < depths_[k]) {
+            last = extant_.back();
+            extant_.pop_back();
+        }
+        if (last != -1) {
+            left_[k] = last;
+        }
+        if (!extant_.empty()) {
+            right_[extant_.back()] = k;
+        }
+        extant_.push_back(k);
+    }
+    int root = extant_[0];
+    
+    stack_.clear();
+    stack_.push_back(std::make_pair(root, 0));
+    while (!stack_.empty()) {
+        int cur = stack_.back().first;
+        int next = stack_.back().second;
+        if (cur >= 0 && next < 2) {
+            if (next == 0) {
+                out += '(';
+            }
+            stack_.back().second++;
+            stack_.push_back(std::make_pair((next == 0) ? left_[cur] : right_[cur], 0));
+            continue;
+        }
+        if (cur < 0) {
+            out += "taxon_" + std::to_string(-cur);
+        }
+        stack_.pop_back();
+        if (stack_.empty()) {
+            break;
+        }
+        int par = stack_.back().first;
+        out += ':';
+        append_double(out, depths_[par] - ((cur >= 0) ? depths_[cur] : 0.0));
+        out += (stack_.back().second == 2) ? ')' : ',';
     }
-    curh += cur->getBL();
-    return curh;
+    out += ";\n";
 }
@@ -1,15 +1,22 @@
 #ifndef _BD_SIM_H_
 #define _BD_SIM_H_
 
+#include <string>
 #include <vector>
+#include <utility>
 #include <random>
 
-class Tree; // forward declaration
-class Node; // forward declaration
-
+/*
+ * constant rate birth-death simulator. nodes are indices into flat arrays
+ * (children are always created after their parent, so reverse index order is
+ * a post-order traversal) and the lineages alive at the current time are kept
+ * in an array with swap-remove. trees are written straight to newick.
+ * alternatively, trees of extant lineages only with a fixed root age can be
+ * drawn from the reconstructed process directly as a coalescent point process
+ * (Lambert & Stadler 2013), which never simulates extinct lineages
+ */
 class BirthDeathSimulator {
 private:
-    int failures_;
     int maxfailures_;
     double birthrate_;
     double deathrate_;
@@ -17,36 +24,43 @@ private:
     double relative_birth_rate_;
     int extantstop_;
     double timestop_;
-    int numofchanges_;
+    bool reconstructed_;
     double currenttime_;
-    std::vector<Node*> extantnodes_;
-    std::vector<Node*> dead_nodes_;
-    std::map<Node*, double> BIRTHTIME_;
-    std::map<Node*, double> DEATHTIME_;
-    Node* root_;
-    Tree* tree_;
+    
+    std::vector<int> parent_;
+    std::vector<int> left_;
+    std::vector<int> right_;
+    std::vector<double> birthtime_;
+    std::vector<double> deathtime_;
+    std::vector<int> extant_;
+    std::vector<char> keep_; // scratch: node has an extant descendant
+    std::vector<double> depths_; // scratch: coalescent point process node depths
+    std::vector<std::pair<int, int> > stack_;
     
     std::mt19937 generator_;
     std::uniform_real_distribution<double> uniformDistrib_;
-
+    
+    void setup_parameters ();
     bool check_stop_conditions ();
     double time_to_next_event ();
     void event ();
-    void node_death (Node *);
-    void node_birth (Node *);
-    void delete_dead_nodes ();
-    void setup_parameters ();
     bool event_is_birth ();
-    void delete_a_node (Node *);
-    double get_distance_from_tip (Node *innode);
-    void set_distance_to_tip ();
+    int add_node (const int& parent);
+    void node_death (const int& slot);
+    void node_birth (const int& slot);
+    bool simulate ();
+    int get_newick_child (int nd, double& bl) const;
+    void append_simulated_tree (std::string& out, const bool& show_dead);
+    double get_inverse_scale (const double& t) const;
+    void sample_node_depths (const double& t);
+    void append_reconstructed_tree (std::string& out);
 
 public:
-    BirthDeathSimulator ();
     BirthDeathSimulator (const double& estop, const double& tstop, const double& brate,
-        const double& drate, const int& seed);
-    Tree * make_tree (const bool& show_dead);
-    //~BirthDeathSimulator();
+        const double& drate, const bool& reconstructed);
+    void set_seed (const unsigned int& seed, const unsigned int& rep);
+    bool append_tree (std::string& out, const bool& show_dead);
+    int get_max_failures () const;
 };
 
 #endif /* _BD_SIM_H_ */
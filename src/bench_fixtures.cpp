@@ -0,0 +1,127 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <random>
+#include <cmath>
+
+#include "bench_fixtures.h"
+#include "bd_sim.h"
+#include "tree.h"
+#include "node.h"
+#include "tree_reader.h"
+#include "tree_utils.h"
+#include "sequence.h"
+
+#ifdef PHYX_BENCH_ARMA
+#include "seq_gen.h"
+#endif
+
+// the simulated trees are ~log(ntax) deep (birth rate 1); edges are scaled so
+// that sequences do not saturate
+static const double edge_scale = 0.02;
+
+
+const std::string& get_bench_newick (const int& ntax, const unsigned int& seed) {
+    static std::map<std::pair<int, unsigned int>, std::string> cache;
+    std::string& newick = cache[std::make_pair(ntax, seed)];
+    if (newick.empty()) {
+        BirthDeathSimulator bd(ntax, 0.0, 1.0, 0.0, false);
+        bd.set_seed(seed, 0);
+        bd.append_tree(newick, false);
+    }
+    return newick;
+}
+
+
+// one tree a line, each from its own replicate of the same simulator
+const std::string& get_bench_trees (const int& ntax, const int& ntrees, const unsigned int& seed) {
+    static std::map<std::tuple<int, int, unsigned int>, std::string> cache;
+    std::string& trees = cache[std::make_tuple(ntax, ntrees, seed)];
+    if (trees.empty()) {
+        BirthDeathSimulator bd(ntax, 0.0, 1.0, 0.0, false);
+        for (int i = 0; i < ntrees; i++) {
+            bd.set_seed(seed, (unsigned int)i);
+            bd.append_tree(trees, false);
+        }
+    }
+    return trees;
+}
+
+
+#ifndef PHYX_BENCH_ARMA
+// JC69 down the tree: each site of a child differs from its parent with
+// probability 3/4 (1 - exp(-4/3 t)), and then takes one of the other 3 states
+static void evolve_jc (Node * nd, const std::string& parent, std::mt19937& gen,
+        std::vector<Sequence>& seqs) {
+    static const char bases[] = "ACGT";
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+    std::uniform_int_distribution<int> other(1, 3);
+    double pdiff = 0.75 * (1.0 - std::exp(-4.0 / 3.0 * nd->getBL()));
+    std::string seq = parent;
+    for (unsigned int i = 0; i < seq.size(); i++) {
+        if (unif(gen) < pdiff) {
+            int s = (int)(std::string(bases).find(seq[i]));
+            seq[i] = bases[(s + other(gen)) % 4];
+        }
+    }
+    if (nd->isExternal()) {
+        seqs.push_back(Sequence(nd->getName(), seq, true));
+        return;
+    }
+    for (int i = 0; i < nd->getChildCount(); i++) {
+        evolve_jc(nd->getChild(i), seq, gen, seqs);
+    }
+}
+#endif
+
+
+const std::vector<Sequence>& get_bench_alignment (const int& ntax, const int& nchar,
+        const unsigned int& seed) {
+    static std::map<std::tuple<int, int, unsigned int>, std::vector<Sequence> > cache;
+    std::vector<Sequence>& seqs = cache[std::make_tuple(ntax, nchar, seed)];
+    if (!seqs.empty()) {
+        return seqs;
+    }
+    Tree * tree = read_tree_string(get_bench_newick(ntax, seed));
+    rescale_tree(tree, edge_scale);
+#ifdef PHYX_BENCH_ARMA
+    // as the pxseqgen defaults
+    std::vector<double> basefreq(4, 0.25);
+    std::vector< std::vector<double> > rmatrix(4, std::vector<double>(4, 0.33));
+    for (unsigned int i = 0; i < rmatrix.size(); i++) {
+        rmatrix[i][i] = -0.99;
+    }
+    std::vector<double> multirates;
+    std::vector<double> aabasefreq(20, 0.05);
+    SequenceGenerator gen(nchar, basefreq, rmatrix, tree, false, 1, (int)seed, -1.0, 0.0,
+        "", false, multirates, aabasefreq, true);
+    seqs = gen.get_sequences();
+#else
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> base(0, 3);
+    std::string root(nchar, 'A');
+    for (int i = 0; i < nchar; i++) {
+        root[i] = "ACGT"[base(gen)];
+    }
+    Node * rt = tree->getRoot();
+    for (int i = 0; i < rt->getChildCount(); i++) {
+        evolve_jc(rt->getChild(i), root, gen, seqs);
+    }
+#endif
+    delete tree;
+    return seqs;
+}
+
+
+const std::string& get_bench_fasta (const int& ntax, const int& nchar, const unsigned int& seed) {
+    static std::map<std::tuple<int, int, unsigned int>, std::string> cache;
+    std::string& fasta = cache[std::make_tuple(ntax, nchar, seed)];
+    if (fasta.empty()) {
+        const std::vector<Sequence>& seqs = get_bench_alignment(ntax, nchar, seed);
+        for (unsigned int i = 0; i < seqs.size(); i++) {
+            fasta += ">" + seqs[i].get_id() + "\n" + seqs[i].get_sequence() + "\n";
+        }
+    }
+    return fasta;
+}
@@ -0,0 +1,25 @@
+#ifndef _BENCH_FIXTURES_H_
+#define _BENCH_FIXTURES_H_
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "sequence.h"
+
+/*
+ * deterministic inputs for the benchmarks (`make bench`). trees are pure-birth
+ * trees from BirthDeathSimulator, and alignments are simulated on them by
+ * SequenceGenerator (JC69) when phyx is built with armadillo, or otherwise by
+ * a plain JC69 simulation along the same tree. everything is seeded, so a
+ * given size always gives the same data, and is cached, so repeated runs of
+ * a benchmark do not regenerate it
+ */
+
+const std::string& get_bench_newick (const int& ntax, const unsigned int& seed);
+const std::string& get_bench_trees (const int& ntax, const int& ntrees, const unsigned int& seed);
+const std::vector<Sequence>& get_bench_alignment (const int& ntax, const int& nchar,
+    const unsigned int& seed);
+const std::string& get_bench_fasta (const int& ntax, const int& nchar, const unsigned int& seed);
+
+#endif /* _BENCH_FIXTURES_H_ */
@@ -0,0 +1,136 @@
+/*
+ * macro benchmarks: whole tool paths (ingestion, pxbp counting, tree building
+ * from an alignment) on large generated inputs (see bench_fixtures.h). all
+ * input is read from memory, so disk speed does not enter into it
+ */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <sstream>
+#include <algorithm>
+#include <iterator>
+
+#include <benchmark/benchmark.h>
+
+#include "bench_fixtures.h"
+#include "tree.h"
+#include "node.h"
+#include "tree_reader.h"
+#include "tree_utils.h"
+#include "sequence.h"
+#include "seq_reader.h"
+#include "nj.h"
+#include "upgma.h"
+
+
+// the fasta loop of the seq tools. args: taxa, sites
+static void macro_seq_ingest (benchmark::State& state) {
+    const std::string& fasta = get_bench_fasta((int)state.range(0), (int)state.range(1), 9);
+    for (auto _ : state) {
+        std::istringstream pios(fasta);
+        std::vector<Sequence> seqs;
+        Sequence seq;
+        std::string retstring;
+        int ft = test_seq_filetype_stream(pios, retstring);
+        while (read_next_seq_from_stream(pios, ft, retstring, seq)) {
+            seqs.push_back(seq);
+        }
+        if (ft == 2) {
+            seqs.push_back(seq);
+        }
+        benchmark::DoNotOptimize(seqs.data());
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t)fasta.size());
+}
+BENCHMARK(macro_seq_ingest)->Args({1000, 10000})->Args({100000, 100})
+    ->Unit(benchmark::kMillisecond);
+
+
+// newick tree file reading, as the tree tools. args: taxa, trees
+static void macro_tree_ingest (benchmark::State& state) {
+    const std::string& trees = get_bench_trees((int)state.range(0), (int)state.range(1), 10);
+    for (auto _ : state) {
+        std::istringstream pios(trees);
+        std::string retstring;
+        test_tree_filetype_stream(pios, retstring);
+        bool going = true;
+        while (going) {
+            Tree * tree = read_next_tree_from_stream_newick(pios, retstring, &going);
+            if (going) {
+                delete tree;
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(1));
+    state.SetBytesProcessed(state.iterations() * (int64_t)trees.size());
+}
+BENCHMARK(macro_tree_ingest)->Args({100, 1000})->Unit(benchmark::kMillisecond);
+
+
+// pxbp (nodewise) on a set of trees on the same taxa. args: taxa, trees
+static void macro_bipartitions (benchmark::State& state) {
+    std::istringstream pios(get_bench_trees((int)state.range(0), (int)state.range(1), 11));
+    std::string retstring;
+    test_tree_filetype_stream(pios, retstring);
+    std::vector<Tree *> trees;
+    bool going = true;
+    while (going) {
+        Tree * tree = read_next_tree_from_stream_newick(pios, retstring, &going);
+        if (going) {
+            trees.push_back(tree);
+        }
+    }
+    // as pxbp
+    std::vector<std::string> names;
+    std::map<std::string, int> name_index;
+    for (unsigned int t = 0; t < trees.size(); t++) {
+        for (int i = 0; i < trees[t]->getExternalNodeCount(); i++) {
+            std::string tname = trees[t]->getExternalNode(i)->getName();
+            if (find(names.begin(), names.end(), tname) == names.end()) {
+                name_index[tname] = i;
+                names.push_back(tname);
+            }
+        }
+    }
+    std::set<std::string> names_s(names.begin(), names.end());
+    for (auto _ : state) {
+        std::vector<std::vector<int> > biparts;
+        std::vector<std::vector<int> > biparts2;
+        std::vector<std::vector<int> > not_included;
+        std::vector<double> bp_count;
+        count_bipartitions(trees, name_index, names_s, false, 0.0, false, biparts,
+            biparts2, not_included, bp_count);
+        benchmark::DoNotOptimize(bp_count.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(1));
+    for (unsigned int i = 0; i < trees.size(); i++) {
+        delete trees[i];
+    }
+}
+BENCHMARK(macro_bipartitions)->Args({50, 100})->Args({100, 200})->Unit(benchmark::kMillisecond);
+
+
+// pxnj and pxupgma from the alignment. args: taxa
+static void macro_nj (benchmark::State& state) {
+    const std::string& fasta = get_bench_fasta((int)state.range(0), 1000, 12);
+    int threads = 1;
+    for (auto _ : state) {
+        std::istringstream pios(fasta);
+        NJOI nj(&pios, threads, DIST_JC69);
+        benchmark::DoNotOptimize(nj.get_newick());
+    }
+}
+BENCHMARK(macro_nj)->Arg(200)->Unit(benchmark::kMillisecond);
+
+
+static void macro_upgma (benchmark::State& state) {
+    const std::string& fasta = get_bench_fasta((int)state.range(0), 1000, 12);
+    for (auto _ : state) {
+        std::istringstream pios(fasta);
+        UPGMA upgma(&pios, DIST_JC69);
+        benchmark::DoNotOptimize(upgma.get_newick());
+    }
+}
+BENCHMARK(macro_upgma)->Arg(200)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,217 @@
+/*
+ * micro benchmarks: single kernels on fixed inputs (see bench_fixtures.h).
+ * run with `make bench`, which also writes the results as JSON to bench.json.
+ * sizes are the benchmark arguments, e.g. micro_read_tree/10000 reads a tree
+ * of 10000 tips
+ */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <iostream>
+
+#include <benchmark/benchmark.h>
+
+#include "bench_fixtures.h"
+#include "tree.h"
+#include "node.h"
+#include "tree_reader.h"
+#include "tree_utils.h"
+#include "sequence.h"
+#include "utils.h"
+#include "seq_models.h"
+#include "pairwise_alignment.h"
+#include "dist_matrix.h"
+#include "nj.h"
+#include "upgma.h"
+
+#ifdef PHYX_BENCH_ARMA
+#include <armadillo>
+#include "seq_gen.h"
+#include "rate_model.h"
+#include "state_reconstructor.h"
+#endif
+
+
+static void micro_read_tree (benchmark::State& state) {
+    const std::string& newick = get_bench_newick((int)state.range(0), 1);
+    TreeReader tr;
+    for (auto _ : state) {
+        Tree * tree = tr.readTree(newick);
+        benchmark::DoNotOptimize(tree);
+        delete tree;
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * (int64_t)newick.size());
+}
+BENCHMARK(micro_read_tree)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+
+static void micro_newick_string (benchmark::State& state) {
+    Tree * tree = read_tree_string(get_bench_newick((int)state.range(0), 1));
+    for (auto _ : state) {
+        std::string newick = getNewickString(tree);
+        benchmark::DoNotOptimize(newick);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    delete tree;
+}
+BENCHMARK(micro_newick_string)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+
+static void micro_hamming (benchmark::State& state) {
+    const std::vector<Sequence>& seqs = get_bench_alignment(2, (int)state.range(0), 2);
+    const std::string& s1 = seqs[0].get_sequence_ref();
+    const std::string& s2 = seqs[1].get_sequence_ref();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(calc_hamming_dist(s1, s2));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(micro_hamming)->Arg(1000)->Arg(100000);
+
+
+// nw and sw with the default DNA scores (EDNAFULL), as pxnw and pxsw
+static void pairwise (benchmark::State& state, const bool& local) {
+    const std::vector<Sequence>& seqs = get_bench_alignment(2, (int)state.range(0), 3);
+    Sequence seq1 = seqs[0];
+    Sequence seq2 = seqs[1];
+    std::map<char, std::map<char, int> > sc_mat;
+    get_ednafull(sc_mat);
+    std::string aln1;
+    std::string aln2;
+    for (auto _ : state) {
+        double sc = local ? sw(seq1, seq2, sc_mat, 0, aln1, aln2)
+            : nw(seq1, seq2, sc_mat, 0, aln1, aln2);
+        benchmark::DoNotOptimize(sc);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * state.range(0));
+}
+
+
+static void micro_nw (benchmark::State& state) {
+    pairwise(state, false);
+}
+BENCHMARK(micro_nw)->Arg(500)->Arg(2000)->Unit(benchmark::kMillisecond);
+
+
+static void micro_sw (benchmark::State& state) {
+    pairwise(state, true);
+}
+BENCHMARK(micro_sw)->Arg(500)->Arg(2000)->Unit(benchmark::kMillisecond);
+
+
+// args: taxa, distance model
+static void micro_dist_matrix (benchmark::State& state) {
+    const std::vector<Sequence>& seqs = get_bench_alignment((int)state.range(0), 5000, 4);
+    distModel model = (distModel)state.range(1);
+    for (auto _ : state) {
+        DistanceMatrix dm(seqs, "DNA", model, false);
+        benchmark::DoNotOptimize(dm.get_matrix().data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * (state.range(0) - 1) / 2);
+}
+BENCHMARK(micro_dist_matrix)->Args({200, DIST_HAMMING})->Args({200, DIST_JC69})
+    ->Args({200, DIST_LOGDET})->Unit(benchmark::kMillisecond);
+
+
+// the neighbour-joining itself, from the distance matrix
+static void micro_nj_treemake (benchmark::State& state) {
+    std::istringstream fasta(get_bench_fasta((int)state.range(0), 1000, 5));
+    int threads = 1;
+    NJOI nj(&fasta, threads, DIST_JC69);
+    std::map<std::string, std::string> sequences;
+    const std::vector<Sequence>& seqs = get_bench_alignment((int)state.range(0), 1000, 5);
+    for (unsigned int i = 0; i < seqs.size(); i++) {
+        sequences[seqs[i].get_id()] = seqs[i].get_sequence();
+    }
+    // as NJOI sets them up: names in map order
+    std::vector<std::string> names;
+    std::map<int, std::string> name_key;
+    for (auto it = sequences.begin(); it != sequences.end(); it++) {
+        name_key[(int)names.size()] = it->first;
+        names.push_back(it->first);
+    }
+    std::vector< std::vector<double> > matrix = nj.BuildMatrix(sequences);
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::vector<std::string> tnames = names;
+        std::map<int, std::string> tkey = name_key;
+        std::vector< std::vector<double> > tmatrix = matrix;
+        state.ResumeTiming();
+        nj.TREEMAKE(tnames, tkey, tmatrix);
+    }
+}
+BENCHMARK(micro_nj_treemake)->Arg(100)->Arg(400)->Unit(benchmark::kMillisecond);
+
+
+// the clustering only; the distance matrix is built outside the timing
+static void micro_upgma (benchmark::State& state) {
+    const std::string& fasta = get_bench_fasta((int)state.range(0), 1000, 6);
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::istringstream pios(fasta);
+        UPGMA upgma(&pios, DIST_JC69);
+        state.ResumeTiming();
+        std::string newick = upgma.get_newick();
+        benchmark::DoNotOptimize(newick);
+    }
+}
+BENCHMARK(micro_upgma)->Arg(100)->Arg(400)->Unit(benchmark::kMillisecond);
+
+
+#ifdef PHYX_BENCH_ARMA
+// SequenceGenerator simulates in its constructor (simulate_sequence per edge)
+static void micro_simulate_sequence (benchmark::State& state) {
+    Tree * tree = read_tree_string(get_bench_newick(100, 7));
+    rescale_tree(tree, 0.02);
+    std::vector<double> basefreq(4, 0.25);
+    std::vector< std::vector<double> > rmatrix(4, std::vector<double>(4, 0.33));
+    for (unsigned int i = 0; i < rmatrix.size(); i++) {
+        rmatrix[i][i] = -0.99;
+    }
+    std::vector<double> multirates;
+    std::vector<double> aabasefreq(20, 0.05);
+    for (auto _ : state) {
+        SequenceGenerator gen((int)state.range(0), basefreq, rmatrix, tree, false, 1, 7,
+            -1.0, 0.0, "", false, multirates, aabasefreq, true);
+        benchmark::DoNotOptimize(gen.get_sequences().size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * tree->getNodeCount());
+    delete tree;
+}
+BENCHMARK(micro_simulate_sequence)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+
+// args: tips, states. tip states are assigned round-robin
+static void micro_eval_likelihood (benchmark::State& state) {
+    Tree * tree = read_tree_string(get_bench_newick((int)state.range(0), 8));
+    int nstates = (int)state.range(1);
+    std::vector<Sequence> data;
+    for (int i = 0; i < tree->getExternalNodeCount(); i++) {
+        std::string states(nstates, '0');
+        states[i % nstates] = '1';
+        data.push_back(Sequence(tree->getExternalNode(i)->getName(), states, true));
+    }
+    std::vector<RateModel> rms;
+    RateModel rm(nstates);
+    StateReconstructor sr(rm, rms);
+    rm.setup_P(0.1, false);
+    sr.set_store_p_matrices(false);
+    sr.set_log_stream(&std::cerr);
+    sr.set_tree(tree);
+    sr.set_tip_conditionals(data);
+    rm.neg_p = false;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sr.eval_likelihood());
+    }
+    state.SetItemsProcessed(state.iterations() * tree->getNodeCount());
+    delete tree;
+}
+BENCHMARK(micro_eval_likelihood)->Args({100, 4})->Args({1000, 4})->Args({1000, 20})
+    ->Unit(benchmark::kMillisecond);
+#endif
+
+
+BENCHMARK_MAIN();
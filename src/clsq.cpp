@@ -2,6 +2,8 @@
 #include <string>
 #include <vector>
 #include <iomanip>
+#include <algorithm>
+#include <cstring>
 
 #include "clsq.h"
 #include "sequence.h"
@@ -17,9 +19,6 @@ SequenceCleaner::SequenceCleaner (std::istream* pios, double& prop_required,
     count_only_(count_only), verbose_(verbose) {
     read_in_sequences(pios);
     count_missing();
-    if (!count_only_) {
-        generate_cleaned_sequences();
-    }
 }
 
 
@@ -64,11 +63,28 @@ void SequenceCleaner::set_bad_chars () {
         std::cerr << "Error: cannot determine alignment type. Exiting." << std::endl;
         exit(0);
     }
+    memset(missing_, 0, sizeof(missing_));
+    for (unsigned int i = 0; i < badChars_.size(); i++) {
+        missing_[(unsigned char)badChars_[i]] = 1;
+        missing_[(unsigned char)tolower(badChars_[i])] = 1;
+    }
 }
 
 
+// built on demand (write_seqs streams them instead)
 std::vector<Sequence> SequenceCleaner::get_cleaned_seqs () {
-    return cleaned_seqs_;
+    std::vector<Sequence> cleaned(num_taxa_);
+    std::string seq;
+    for (int i = 0; i < num_taxa_; i++) {
+        cleaned[i].set_id(seqs_[i].get_id());
+        if (num_retained_ > 0) {
+            get_cleaned_seq(seqs_[i].get_sequence_ref(), seq);
+            cleaned[i].set_sequence(seq);
+        } else {
+            cleaned[i].set_sequence("-"); // for when all sites are removed
+        }
+    }
+    return cleaned;
 }
 
 
@@ -81,19 +97,31 @@ void SequenceCleaner::write_seqs (std::ostream* poos) {
             }
         }
     } else {
-        for (int i = 0; i < num_taxa_; i++) {
-            std::string seq = cleaned_seqs_[i].get_sequence();
-            if (seq.find_first_not_of(badChars_) != std::string::npos) {
-                (*poos) << ">" << cleaned_seqs_[i].get_id() << std::endl;
-                (*poos) << cleaned_seqs_[i].get_sequence() << std::endl;
-            } else {
-                // rare case where removal of sites leaves only missing data for a taxon
-                if (verbose_) {
-                    std::cerr << "Taxon '" << cleaned_seqs_[i].get_id()
-                        << "' consists only of missing characters. Removing." << std::endl;
+        // cleaned sequences are gathered for a chunk of taxa at a time (in
+        // parallel) and written straight out, so only the original is held
+        const int chunk = 64;
+        std::vector<std::string> cleaned(chunk);
+        std::vector<char> keep(chunk);
+        for (int start = 0; start < num_taxa_; start += chunk) {
+            int n = std::min(chunk, num_taxa_ - start);
+            #pragma omp parallel for schedule(static)
+            for (int k = 0; k < n; k++) {
+                keep[k] = get_cleaned_seq(seqs_[start + k].get_sequence_ref(), cleaned[k]);
+            }
+            for (int k = 0; k < n; k++) {
+                if (keep[k]) {
+                    (*poos) << ">" << seqs_[start + k].get_id() << "\n";
+                    (*poos) << cleaned[k] << "\n";
+                } else {
+                    // rare case where removal of sites leaves only missing data for a taxon
+                    if (verbose_) {
+                        std::cerr << "Taxon '" << seqs_[start + k].get_id()
+                            << "' consists only of missing characters. Removing." << std::endl;
+                    }
                 }
             }
         }
+        poos->flush();
     }
 }
 
@@ -184,28 +212,12 @@ int SequenceCleaner::get_longest_taxon_label () {
 }
 
 
-// hrm should we create a new set of seqs, or just edit existing one?
-void SequenceCleaner::generate_cleaned_sequences () {
-    std::string name = "";
-    std::string seq_string = "";
-    Sequence orig_seq;
-    for (int i = 0; i < num_taxa_; i++) {
-        Sequence new_seq;
-        orig_seq = seqs_[i];
-        name = orig_seq.get_id();
-        if (num_retained_ > 0) {
-            seq_string = get_cleaned_seq(orig_seq.get_sequence());
-        } else {
-            seq_string = "-"; // for when all sites are removed
-        }
-        new_seq.set_id(name);
-        new_seq.set_sequence(seq_string);
-        cleaned_seqs_.push_back(new_seq);
-    } 
-}
-
-// counts both per-site and per-taxon missing characters
-// TODO: need to consider codon seqs
+// counts both per-site and per-taxon missing characters. bytes are classified
+// through the missing_ table. columns are processed in blocks (one block per
+// thread at a time): a block's site counts stay in cache while every taxon's
+// stretch of the block is scanned, and per-taxon counts are summed per thread
+// and merged at the end. codons are missing if any of their 3 characters is
+// (counts are still stored per site, not per codon)
 void SequenceCleaner::count_missing () {
     // initialize empty vectors
     missing_per_site_counts_ = std::vector<int>(num_char_, 0);
@@ -213,47 +225,58 @@ void SequenceCleaner::count_missing () {
     missing_per_taxon_ = std::vector<int>(num_taxa_, 0);
     missing_per_taxon_proportion_ = std::vector<double>(num_taxa_, 0.0);
     
-    std::string seq_string = "";
-    
-    if (!by_codon_) {
-        for (int i = 0; i < num_taxa_; i++) {
-            seq_string = string_to_upper(seqs_[i].get_sequence());
-            for (int j = 0; j < num_char_; j++) {
-                if (badChars_.find(seq_string[j]) != std::string::npos) {
-                    missing_per_site_counts_[j]++;
-                    missing_per_taxon_[i]++;
-                    //std::cout << "  BAD CHAR (" << seq_string[j] << ")!" << std::endl;
+    const int blocksize = 3 * 1024; // keeps codons within a block
+    const int nblocks = (num_char_ + blocksize - 1) / blocksize;
+    #pragma omp parallel
+    {
+        std::vector<int> taxon_counts(num_taxa_, 0);
+        #pragma omp for schedule(dynamic)
+        for (int b = 0; b < nblocks; b++) {
+            int start = b * blocksize;
+            int end = std::min(start + blocksize, num_char_);
+            int * site = &missing_per_site_counts_[0];
+            for (int i = 0; i < num_taxa_; i++) {
+                const unsigned char * seq =
+                    (const unsigned char *)seqs_[i].get_sequence_ref().data();
+                int count = 0;
+                if (!by_codon_) {
+                    for (int j = start; j < end; j++) {
+                        int m = missing_[seq[j]];
+                        site[j] += m;
+                        count += m;
+                    }
+                } else {
+                    for (int j = start; j < end; j += 3) {
+                        int m = missing_[seq[j]] | missing_[seq[j+1]] | missing_[seq[j+2]];
+                        site[j] += m;
+                        site[j+1] += m;
+                        site[j+2] += m;
+                        count += 3 * m;
+                    }
                 }
+                taxon_counts[i] += count;
             }
-            missing_per_taxon_proportion_[i] = (double)missing_per_taxon_[i] / (double)num_char_;
         }
-    } else {
-        std::string codon = "";
+        #pragma omp critical (clsq_taxon_counts)
         for (int i = 0; i < num_taxa_; i++) {
-            seq_string = string_to_upper(seqs_[i].get_sequence());
-            for (int j = 0; j < num_char_; j += 3) {
-                codon = seq_string.substr(j, 3);
-                if (codon.find_first_of(badChars_) != std::string::npos) {
-                    // if any char is bad, they all are
-                    // counts are still stored per site, not per codon
-                    missing_per_site_counts_[j]++;
-                    missing_per_site_counts_[j+1]++;
-                    missing_per_site_counts_[j+2]++;
-                    missing_per_taxon_[i] += 3;
-                    // std::cout << "  BAD CODON (" << codon << ")!" << std::endl;
-                }
-            }
-            missing_per_taxon_proportion_[i] = (double)missing_per_taxon_[i] / (double)num_char_;
+            missing_per_taxon_[i] += taxon_counts[i];
         }
     }
+    for (int i = 0; i < num_taxa_; i++) {
+        missing_per_taxon_proportion_[i] = (double)missing_per_taxon_[i] / (double)num_char_;
+    }
     
     // get proportions
     for (int i = 0; i < num_char_; i++) {
         missing_per_site_proportion_[i] = (double)missing_per_site_counts_[i] / (double)num_taxa_;
-        //std::cout << i << ". missing = " << missing_per_site_counts_[i] << "("
-        //        << missing_per_site_proportion_[i] << ")" << std::endl;
         if (missing_per_site_proportion_[i] <= missing_allowed_) {
             retained_sites_.push_back(i);
+            if (!retained_runs_.empty() && retained_runs_.back().first
+                    + retained_runs_.back().second == i) {
+                retained_runs_.back().second++;
+            } else {
+                retained_runs_.push_back(std::make_pair(i, 1));
+            }
         }
     }
     
@@ -261,12 +284,21 @@ void SequenceCleaner::count_missing () {
 }
 
 
-std::string SequenceCleaner::get_cleaned_seq (const std::string& origseq) {
-    std::string seq = "";
+// gather the retained columns (copied as runs of adjacent sites). returns
+// false if they hold only missing characters
+bool SequenceCleaner::get_cleaned_seq (const std::string& origseq, std::string& seq) const {
+    seq.resize(num_retained_);
+    size_t pos = 0;
+    for (unsigned int i = 0; i < retained_runs_.size(); i++) {
+        memcpy(&seq[pos], origseq.data() + retained_runs_[i].first, retained_runs_[i].second);
+        pos += retained_runs_[i].second;
+    }
     for (int i = 0; i < num_retained_; i++) {
-        seq += origseq[retained_sites_[i]];
+        if (!missing_[(unsigned char)seq[i]]) {
+            return true;
+        }
     }
-    return seq;
+    return false;
 }
 
 
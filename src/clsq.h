@@ -20,20 +20,20 @@ private:
     bool verbose_;
     
     std::string badChars_;
+    unsigned char missing_[256]; // 1 if a byte is a missing character (either case)
     std::string alpha_name_;
     
     // refactored version
     std::vector<Sequence> seqs_;
-    std::vector<Sequence> cleaned_seqs_;
     std::vector<int> missing_per_site_counts_;
     std::vector<double> missing_per_site_proportion_;
     std::vector<int> missing_per_taxon_;
     std::vector<double> missing_per_taxon_proportion_;
     std::vector<int> retained_sites_;
+    std::vector<std::pair<int, int> > retained_runs_; // (start, length)
     
     void count_missing ();
-    void generate_cleaned_sequences ();
-    std::string get_cleaned_seq (const std::string& origseq);
+    bool get_cleaned_seq (const std::string& origseq, std::string& seq) const;
     int get_longest_taxon_label ();
     void read_in_sequences (std::istream* pios);
     void set_bad_chars ();
@@ -85,15 +85,15 @@ void CompTest::read_in_alignment () {
     
     num_taxa_ = (int)seqs_.size();
     
-    // if datatype is multi, but alphabet not set, get from entire concatenated sequence
+    // byte counts of every seq. the alphabet (if needed) and the contingency
+    // table both come from these
+    get_byte_histograms(seqs_, byte_counts_);
+    
+    // if datatype is multi, but alphabet not set, get from the entire alignment
     if (is_multi_ && !alpha_set_) {
         // grab all unique characters from the input string
-        // here, seqs from all individuals are concatenated, so represents all sampled characters
-        std::string concatenated = "";
-        for (int i = 0; i < num_taxa_; i++) {
-            concatenated += seqs_[i].get_sequence();
-        }
-        seq_chars_ = get_alphabet_from_sequence(concatenated);
+        // here, counts from all individuals are pooled, so represents all sampled characters
+        seq_chars_ = get_alphabet_from_histograms(byte_counts_);
         // remove gap and missing (if present)
         seq_chars_.erase(std::remove(seq_chars_.begin(), seq_chars_.end(), gap_), seq_chars_.end());
         seq_chars_.erase(std::remove(seq_chars_.begin(), seq_chars_.end(), missing_), seq_chars_.end());
@@ -135,20 +135,20 @@ void CompTest::set_datatype () {
 }
 
 
-// get counts of all valid character states per taxon
+// get counts of all valid character states per taxon (case-insensitive)
 void CompTest::count_chars () {
     int sum = 0;
-    std::string seq = "";
     for (int i = 0; i < num_taxa_; i++) {
         sum = 0;
-        seq = string_to_upper(seqs_[i].get_sequence());
+        std::vector<int> counts = byte_counts_[i];
+        fold_byte_histogram(counts);
         std::vector<int> icounts(seq_chars_.length(), 0);
         
-        for (unsigned int i = 0; i < seq_chars_.length(); i++) {
-            int num = std::count(seq.begin(), seq.end(), seq_chars_[i]);
-            icounts[i] += num;
+        for (unsigned int j = 0; j < seq_chars_.length(); j++) {
+            int num = counts[(unsigned char)seq_chars_[j]];
+            icounts[j] += num;
             sum += num;
-            col_totals_[i] += num;
+            col_totals_[j] += num;
         }
         indiv_char_counts_.push_back(icounts);
         row_totals_.push_back(sum);
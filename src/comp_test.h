@@ -31,6 +31,7 @@ private:
     
     std::vector<Sequence> seqs_;
     std::vector<std::string> taxon_labels_;
+    std::vector< std::vector<int> > byte_counts_; // per seq, 256 bins (as read)
     std::vector< std::vector<int> > indiv_char_counts_;
     std::vector<int> row_totals_;
     std::vector<int> col_totals_;
@@ -0,0 +1,396 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "dist_matrix.h"
+#include "sequence.h"
+#include "seq_utils.h"
+#include "profile.h"
+
+// taxa per tile side, and 64-site words per chunk of sites
+static const int tile_size = 16;
+static const int chunk_words = 64;
+
+
+bool get_dist_model (const std::string& name, distModel& model) {
+    if (name == "hamming") {
+        model = DIST_HAMMING;
+    } else if (name == "p") {
+        model = DIST_P;
+    } else if (name == "jc69" || name == "jc") {
+        model = DIST_JC69;
+    } else if (name == "k2p" || name == "k80") {
+        model = DIST_K2P;
+    } else if (name == "logdet" || name == "paralinear") {
+        model = DIST_LOGDET;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+DistanceMatrix::DistanceMatrix (const std::vector<Sequence>& seqs,
+        const std::string& alpha_name, const distModel& model,
+        const bool& complete_deletion):seqs_(seqs), num_taxa_((int)seqs.size()),
+        num_char_(0), num_words_(0), model_(model), complete_deletion_(complete_deletion),
+        is_dna_(alpha_name == "DNA"), num_undefined_(0) {
+    if (!is_aligned(seqs_)) {
+        std::cerr << "Error: sequences are not aligned. Exiting." << std::endl;
+        exit(0);
+    }
+    if (num_taxa_ > 0) {
+        num_char_ = (int)seqs_[0].get_sequence_ref().size();
+    }
+    if (!is_dna_ && model_ != DIST_HAMMING && model_ != DIST_P) {
+        std::cerr << "Error: the jc69, k2p and logdet corrections require DNA, but '"
+            << alpha_name << "' detected. Exiting." << std::endl;
+        exit(0);
+    }
+    if (model_ != DIST_HAMMING) {
+        if (is_dna_) {
+            encode_dna();
+        } else {
+            set_invalid_chars();
+        }
+    }
+    fill_matrix();
+}
+
+
+// one bit per site in the plane of its base (either case). anything else
+// (gaps, missing, ambiguity codes) sets no bit, so drops out of every count
+void DistanceMatrix::encode_dna () {
+    num_words_ = (num_char_ + 63) / 64;
+    planes_.assign((size_t)num_taxa_ * 4 * num_words_, 0);
+    signed char code[256];
+    memset(code, -1, sizeof(code));
+    code['A'] = code['a'] = 0;
+    code['C'] = code['c'] = 1;
+    code['G'] = code['g'] = 2;
+    code['T'] = code['t'] = 3;
+    code['U'] = code['u'] = 3;
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < num_taxa_; i++) {
+        const unsigned char * seq = (const unsigned char *)seqs_[i].get_sequence_ref().data();
+        uint64_t * p = &planes_[(size_t)i * 4 * num_words_];
+        for (int s = 0; s < num_char_; s++) {
+            int c = code[seq[s]];
+            if (c >= 0) {
+                p[(size_t)c * num_words_ + s / 64] |= (uint64_t)1 << (s % 64);
+            }
+        }
+    }
+    if (complete_deletion_) {
+        std::vector<uint64_t> mask(num_words_, ~(uint64_t)0);
+        for (int i = 0; i < num_taxa_; i++) {
+            const uint64_t * p = &planes_[(size_t)i * 4 * num_words_];
+            for (int w = 0; w < num_words_; w++) {
+                mask[w] &= p[w] | p[num_words_ + w] | p[2 * num_words_ + w]
+                    | p[3 * num_words_ + w];
+            }
+        }
+        for (int i = 0; i < num_taxa_; i++) {
+            uint64_t * p = &planes_[(size_t)i * 4 * num_words_];
+            for (int k = 0; k < 4; k++) {
+                for (int w = 0; w < num_words_; w++) {
+                    p[(size_t)k * num_words_ + w] &= mask[w];
+                }
+            }
+        }
+    }
+}
+
+
+// non-DNA p-distances: gaps and missing/unknown characters are not compared
+void DistanceMatrix::set_invalid_chars () {
+    memset(invalid_, 0, sizeof(invalid_));
+    invalid_['-'] = invalid_['?'] = invalid_['X'] = invalid_['x'] = 1;
+    if (complete_deletion_) {
+        site_ok_.assign(num_char_, 1);
+        for (int i = 0; i < num_taxa_; i++) {
+            const unsigned char * seq = (const unsigned char *)seqs_[i].get_sequence_ref().data();
+            for (int s = 0; s < num_char_; s++) {
+                if (invalid_[seq[s]]) {
+                    site_ok_[s] = 0;
+                }
+            }
+        }
+    }
+}
+
+
+// counts[4 * x + y] += number of sites with base x in i and base y in j
+void DistanceMatrix::count_dna (const int& i, const int& j, const int& w0, const int& w1,
+        long * counts) const {
+    const uint64_t * a = &planes_[(size_t)i * 4 * num_words_];
+    const uint64_t * b = &planes_[(size_t)j * 4 * num_words_];
+    for (int x = 0; x < 4; x++) {
+        const uint64_t * ax = a + (size_t)x * num_words_;
+        for (int y = 0; y < 4; y++) {
+            const uint64_t * by = b + (size_t)y * num_words_;
+            long n = 0;
+            for (int w = w0; w < w1; w++) {
+                n += __builtin_popcountll(ax[w] & by[w]);
+            }
+            counts[4 * x + y] += n;
+        }
+    }
+}
+
+
+// hamming: counts[0] += differing bytes (8 at a time: a byte of a ^ b is
+// nonzero iff any of its bits is, which the shifts fold onto its low bit).
+// otherwise: counts[0] += comparable sites, counts[1] += differing ones
+void DistanceMatrix::count_bytes (const int& i, const int& j, const int& s0, const int& s1,
+        long * counts) const {
+    const unsigned char * a = (const unsigned char *)seqs_[i].get_sequence_ref().data();
+    const unsigned char * b = (const unsigned char *)seqs_[j].get_sequence_ref().data();
+    if (model_ == DIST_HAMMING) {
+        const uint64_t lowbits = 0x0101010101010101ULL;
+        long n = 0;
+        int s = s0;
+        for (; s + 8 <= s1; s += 8) {
+            uint64_t x;
+            uint64_t y;
+            memcpy(&x, a + s, 8);
+            memcpy(&y, b + s, 8);
+            x ^= y;
+            x |= x >> 4;
+            x |= x >> 2;
+            x |= x >> 1;
+            n += __builtin_popcountll(x & lowbits);
+        }
+        for (; s < s1; s++) {
+            n += (a[s] != b[s]);
+        }
+        counts[0] += n;
+        return;
+    }
+    long valid = 0;
+    long diff = 0;
+    for (int s = s0; s < s1; s++) {
+        if (invalid_[a[s]] || invalid_[b[s]] || (complete_deletion_ && !site_ok_[s])) {
+            continue;
+        }
+        valid++;
+        diff += (toupper(a[s]) != toupper(b[s]));
+    }
+    counts[0] += valid;
+    counts[1] += diff;
+}
+
+
+// determinant of a 4x4 matrix (gaussian elimination, partial pivoting)
+static double det4 (double m[4][4]) {
+    double det = 1.0;
+    for (int c = 0; c < 4; c++) {
+        int p = c;
+        for (int r = c + 1; r < 4; r++) {
+            if (std::fabs(m[r][c]) > std::fabs(m[p][c])) {
+                p = r;
+            }
+        }
+        if (m[p][c] == 0.0) {
+            return 0.0;
+        }
+        if (p != c) {
+            for (int k = 0; k < 4; k++) {
+                std::swap(m[p][k], m[c][k]);
+            }
+            det = -det;
+        }
+        det *= m[c][c];
+        for (int r = c + 1; r < 4; r++) {
+            double f = m[r][c] / m[c][c];
+            for (int k = c; k < 4; k++) {
+                m[r][k] -= f * m[c][k];
+            }
+        }
+    }
+    return det;
+}
+
+
+// distance from the pair's counts. defined is false if there are no
+// comparable sites or the correction is saturated (log of a value <= 0)
+double DistanceMatrix::get_distance (const long * counts, bool& defined) const {
+    defined = true;
+    if (model_ == DIST_HAMMING) {
+        return (double)counts[0];
+    }
+    if (!is_dna_) {
+        if (counts[0] == 0) {
+            defined = false;
+            return 0.0;
+        }
+        return (double)counts[1] / (double)counts[0];
+    }
+    long valid = 0;
+    for (int k = 0; k < 16; k++) {
+        valid += counts[k];
+    }
+    if (valid == 0) {
+        defined = false;
+        return 0.0;
+    }
+    double n = (double)valid;
+    long same = counts[0] + counts[5] + counts[10] + counts[15];
+    long ts = counts[2] + counts[8] + counts[7] + counts[13]; // A<->G, C<->T
+    double p = (double)(valid - same) / n;
+    switch (model_) {
+        case DIST_P:
+            return p;
+        case DIST_JC69: {
+            double x = 1.0 - 4.0 * p / 3.0;
+            if (x <= 0.0) {
+                defined = false;
+                return 0.0;
+            }
+            return -0.75 * std::log(x);
+        }
+        case DIST_K2P: {
+            double P = (double)ts / n;
+            double Q = (double)(valid - same - ts) / n;
+            double a = 1.0 - 2.0 * P - Q;
+            double b = 1.0 - 2.0 * Q;
+            if (a <= 0.0 || b <= 0.0) {
+                defined = false;
+                return 0.0;
+            }
+            return -0.5 * std::log(a) - 0.25 * std::log(b);
+        }
+        case DIST_LOGDET: {
+            // paralinear: -1/4 [ln det J - 1/2 (ln det diag(fx) + ln det diag(fy))]
+            double J[4][4];
+            double lnf = 0.0;
+            for (int x = 0; x < 4; x++) {
+                double fx = 0.0;
+                double fy = 0.0;
+                for (int y = 0; y < 4; y++) {
+                    J[x][y] = (double)counts[4 * x + y] / n;
+                    fx += J[x][y];
+                    fy += (double)counts[4 * y + x] / n;
+                }
+                if (fx <= 0.0 || fy <= 0.0) {
+                    defined = false;
+                    return 0.0;
+                }
+                lnf += std::log(fx) + std::log(fy);
+            }
+            double det = det4(J);
+            if (det <= 0.0) {
+                defined = false;
+                return 0.0;
+            }
+            return -0.25 * (std::log(det) - 0.5 * lnf);
+        }
+        default:
+            return p;
+    }
+}
+
+
+void DistanceMatrix::fill_matrix () {
+    PX_PROFILE_PHASE("distance matrix");
+    matrix_.assign(num_taxa_, std::vector<double>(num_taxa_, 0.0));
+    defined_.assign((size_t)num_taxa_ * num_taxa_, 1);
+    int ntiles = (num_taxa_ + tile_size - 1) / tile_size;
+    std::vector<std::pair<int, int> > tiles;
+    for (int bi = 0; bi < ntiles; bi++) {
+        for (int bj = bi; bj < ntiles; bj++) {
+            tiles.push_back(std::make_pair(bi, bj));
+        }
+    }
+    const bool use_planes = is_dna_ && model_ != DIST_HAMMING;
+    const int ncounts = use_planes ? 16 : 2;
+    
+    #pragma omp parallel for schedule(dynamic)
+    for (int t = 0; t < (int)tiles.size(); t++) {
+        int i0 = tiles[t].first * tile_size;
+        int i1 = std::min(i0 + tile_size, num_taxa_);
+        int j0 = tiles[t].second * tile_size;
+        int j1 = std::min(j0 + tile_size, num_taxa_);
+        std::vector<long> counts((size_t)tile_size * tile_size * ncounts, 0);
+        if (use_planes) {
+            for (int w0 = 0; w0 < num_words_; w0 += chunk_words) {
+                int w1 = std::min(w0 + chunk_words, num_words_);
+                for (int i = i0; i < i1; i++) {
+                    for (int j = std::max(j0, i + 1); j < j1; j++) {
+                        count_dna(i, j, w0, w1,
+                            &counts[((i - i0) * tile_size + (j - j0)) * ncounts]);
+                    }
+                }
+            }
+        } else {
+            const int chunk_sites = 64 * chunk_words;
+            for (int s0 = 0; s0 < num_char_; s0 += chunk_sites) {
+                int s1 = std::min(s0 + chunk_sites, num_char_);
+                for (int i = i0; i < i1; i++) {
+                    for (int j = std::max(j0, i + 1); j < j1; j++) {
+                        count_bytes(i, j, s0, s1,
+                            &counts[((i - i0) * tile_size + (j - j0)) * ncounts]);
+                    }
+                }
+            }
+        }
+        for (int i = i0; i < i1; i++) {
+            for (int j = std::max(j0, i + 1); j < j1; j++) {
+                bool defined = true;
+                double d = get_distance(&counts[((i - i0) * tile_size + (j - j0)) * ncounts],
+                    defined);
+                matrix_[i][j] = matrix_[j][i] = d;
+                defined_[(size_t)i * num_taxa_ + j] = defined_[(size_t)j * num_taxa_ + i] = defined;
+            }
+        }
+    }
+    num_undefined_ = 0;
+    for (int i = 0; i < num_taxa_; i++) {
+        for (int j = i + 1; j < num_taxa_; j++) {
+            if (!defined_[(size_t)i * num_taxa_ + j]) {
+                num_undefined_++;
+            }
+        }
+    }
+}
+
+
+bool DistanceMatrix::is_defined (const int& i, const int& j) const {
+    return defined_[(size_t)i * num_taxa_ + j] != 0;
+}
+
+
+// square matrix: ntax, then one row per taxon (label padded to the longest).
+// undefined distances are written as NA
+void DistanceMatrix::write_phylip (std::ostream* poos) const {
+    unsigned int longest = 0;
+    for (int i = 0; i < num_taxa_; i++) {
+        longest = std::max(longest, (unsigned int)seqs_[i].get_id().size());
+    }
+    (*poos) << num_taxa_ << std::endl;
+    std::ostringstream row;
+    for (int i = 0; i < num_taxa_; i++) {
+        row.str("");
+        const std::string& name = seqs_[i].get_id();
+        row << name << std::string(longest - name.size() + 1, ' ');
+        for (int j = 0; j < num_taxa_; j++) {
+            if (j > 0) {
+                row << " ";
+            }
+            if (!defined_[(size_t)i * num_taxa_ + j]) {
+                row << "NA";
+            } else if (model_ == DIST_HAMMING) {
+                row << (long)matrix_[i][j];
+            } else {
+                row << std::fixed << std::setprecision(6) << matrix_[i][j];
+            }
+        }
+        (*poos) << row.str() << "\n";
+    }
+    poos->flush();
+}
@@ -0,0 +1,65 @@
+#ifndef _DIST_MATRIX_H_
+#define _DIST_MATRIX_H_
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <stdint.h>
+
+#include "sequence.h"
+
+typedef enum {
+    DIST_HAMMING = 0, DIST_P = 1, DIST_JC69 = 2, DIST_K2P = 3, DIST_LOGDET = 4
+} distModel;
+
+bool get_dist_model (const std::string& name, distModel& model);
+
+/*
+ * pairwise distance matrix for an alignment:
+ * - hamming: raw count of differing bytes (as calc_hamming_dist)
+ * - p: proportion of differing sites
+ * - jc69, k2p, logdet (paralinear): corrected distances (DNA only)
+ * except for hamming, sites with a gap, missing or ambiguous character in
+ * either sequence are ignored (pairwise deletion), or, with complete deletion,
+ * sites with one in any sequence are. DNA is encoded once into 4 bit planes
+ * (A, C, G, T; 64 sites per word), so the 4x4 table of site patterns between
+ * two sequences is 16 AND + popcount per word. the matrix is filled in tiles
+ * of taxa, in parallel, and each tile walks the sites in chunks so the
+ * sequences of a tile stay in cache
+ */
+class DistanceMatrix {
+private:
+    const std::vector<Sequence>& seqs_;
+    int num_taxa_;
+    int num_char_;
+    int num_words_;
+    distModel model_;
+    bool complete_deletion_;
+    bool is_dna_;
+    int num_undefined_;
+    
+    std::vector<uint64_t> planes_; // [taxon][A,C,G,T][word]
+    unsigned char invalid_[256]; // bytes that are not a usable (non-DNA) state
+    std::vector<unsigned char> site_ok_; // complete deletion (non-DNA)
+    std::vector< std::vector<double> > matrix_;
+    std::vector<char> defined_;
+    
+    void encode_dna ();
+    void set_invalid_chars ();
+    void fill_matrix ();
+    void count_dna (const int& i, const int& j, const int& w0, const int& w1,
+        long * counts) const;
+    void count_bytes (const int& i, const int& j, const int& s0, const int& s1,
+        long * counts) const;
+    double get_distance (const long * counts, bool& defined) const;
+
+public:
+    DistanceMatrix (const std::vector<Sequence>& seqs, const std::string& alpha_name,
+        const distModel& model, const bool& complete_deletion);
+    const std::vector< std::vector<double> >& get_matrix () const { return matrix_; };
+    bool is_defined (const int& i, const int& j) const;
+    int get_num_undefined () const { return num_undefined_; };
+    void write_phylip (std::ostream* poos) const;
+};
+
+#endif /* _DIST_MATRIX_H_ */
@@ -1398,6 +1398,92 @@ static int transformSequences (const char* const queryOriginal, const int queryL
 }
 
 
+struct EdlibQueryProfile {
+    unsigned char letterIdx[256]; // letters absent from query map to the last symbol
+    int alphabetLength; // query letters + 1 (absent)
+    unsigned char* query;
+    int queryLength;
+    int maxNumBlocks;
+    int W;
+    Word* Peq;
+};
+
+
+EdlibQueryProfile* edlibBuildQueryProfile (const char* const query, const int queryLength) {
+    EdlibQueryProfile* profile = new EdlibQueryProfile;
+    bool inAlphabet[256];
+    for (int i = 0; i < 256; i++) inAlphabet[i] = false;
+    int alphabetLength = 0;
+    profile->query = new unsigned char[queryLength > 0 ? queryLength : 1];
+    for (int i = 0; i < queryLength; i++) {
+        unsigned char c = static_cast<unsigned char>(query[i]);
+        if (!inAlphabet[c]) {
+            inAlphabet[c] = true;
+            profile->letterIdx[c] = alphabetLength;
+            alphabetLength++;
+        }
+        profile->query[i] = profile->letterIdx[c];
+    }
+    // one extra symbol for everything not in query: matches nothing
+    for (int i = 0; i < 256; i++) {
+        if (!inAlphabet[i]) profile->letterIdx[i] = alphabetLength;
+    }
+    alphabetLength++;
+    profile->alphabetLength = alphabetLength;
+    profile->queryLength = queryLength;
+    profile->maxNumBlocks = ceilDiv(queryLength, WORD_SIZE);
+    profile->W = profile->maxNumBlocks * WORD_SIZE - queryLength;
+    profile->Peq = buildPeq(alphabetLength, profile->query, queryLength);
+    return profile;
+}
+
+
+int edlibProfileDistance (const EdlibQueryProfile* const profile, const char* const targetOriginal,
+                          const int targetLength, const int k_, const EdlibAlignMode mode) {
+    unsigned char* target = new unsigned char[targetLength > 0 ? targetLength : 1];
+    for (int i = 0; i < targetLength; i++) {
+        target[i] = profile->letterIdx[static_cast<unsigned char>(targetOriginal[i])];
+    }
+    int editDistance = -1;
+    bool dynamicK = false;
+    int k = k_;
+    if (k < 0) { // If valid k is not given, auto-adjust k until solution is found.
+        dynamicK = true;
+        k = WORD_SIZE;
+    }
+    do {
+        if (mode == EDLIB_MODE_HW || mode == EDLIB_MODE_SHW) {
+            int* positions = NULL;
+            int numPositions = 0;
+            myersCalcEditDistanceSemiGlobal(profile->Peq, profile->W, profile->maxNumBlocks,
+                                            profile->query, profile->queryLength, target, targetLength,
+                                            profile->alphabetLength, k, mode, &editDistance,
+                                            &positions, &numPositions);
+            if (positions) free(positions);
+        } else {
+            int positionNW;
+            AlignmentData* alignData = NULL;
+            myersCalcEditDistanceNW(profile->Peq, profile->W, profile->maxNumBlocks,
+                                    profile->query, profile->queryLength, target, targetLength,
+                                    profile->alphabetLength, k, &editDistance, &positionNW,
+                                    false, &alignData, -1);
+            if (alignData) delete alignData;
+        }
+        k *= 2;
+    } while (dynamicK && editDistance == -1);
+    delete[] target;
+    return editDistance;
+}
+
+
+void edlibFreeQueryProfile (EdlibQueryProfile* const profile) {
+    if (profile == NULL) return;
+    delete[] profile->Peq;
+    delete[] profile->query;
+    delete profile;
+}
+
+
 EdlibAlignConfig edlibNewAlignConfig (int k, EdlibAlignMode mode, EdlibAlignTask task) {
     EdlibAlignConfig config;
     config.k = k;
@@ -191,6 +191,30 @@ typedef enum {
                                 const char* target, int targetLength,
                                 const EdlibAlignConfig config);
 
+
+    /**
+     * Precomputed query profile (Peq table over the query's alphabet), so that a single
+     * query can be aligned against many targets without rebuilding it for every pair.
+     * Target letters absent from the query never match, exactly as in edlibAlign.
+     * A built profile is read-only, so it can be shared across threads.
+     */
+    typedef struct EdlibQueryProfile EdlibQueryProfile;
+
+    /**
+     * Builds profile for given query. Free it with edlibFreeQueryProfile().
+     */
+    EdlibQueryProfile* edlibBuildQueryProfile (const char* query, int queryLength);
+
+    /**
+     * Edit distance (EDLIB_TASK_DISTANCE only) of profiled query against target.
+     * Same meaning of k and mode as in EdlibAlignConfig.
+     * @return  Edit distance, or -1 if it is larger than k.
+     */
+    int edlibProfileDistance (const EdlibQueryProfile* profile, const char* target,
+                              int targetLength, int k, EdlibAlignMode mode);
+
+    void edlibFreeQueryProfile (EdlibQueryProfile* profile);
+
     
     /**
      * Builds cigar string from given alignment sequence.
@@ -0,0 +1,130 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cmath>
+
+#include "fq_filt.h"
+
+
+// fastq assumes a 33 offset for now (as does seq_reader)
+FastqFilter::FastqFilter (const double& min_mean, const int& min_qual, const int& window,
+    const double& max_ee):min_mean_(min_mean), min_qual_(min_qual), window_(window),
+    max_ee_(max_ee), offset_(33), num_reads_(0), num_passed_(0) {
+    // phred error probability for every possible quality byte
+    error_probs_.resize(256, 1.0);
+    for (int i = offset_; i < 256; i++) {
+        error_probs_[i] = std::pow(10.0, -(double)(i - offset_) / 10.0);
+    }
+}
+
+
+// all statistics come straight from the raw quality bytes (no per-base vector).
+// the loops are plain integer reductions so the compiler can vectorize them
+bool FastqFilter::passes (const std::string& qual) const {
+    const unsigned char * q = reinterpret_cast<const unsigned char *>(qual.data());
+    int n = (int)qual.size();
+    if (n == 0) {
+        return false;
+    }
+    
+    long sum = 0;
+    unsigned char minq = 255;
+    for (int i = 0; i < n; i++) {
+        sum += q[i];
+        minq = (q[i] < minq) ? q[i] : minq;
+    }
+    double mean = (double)(sum - (long)offset_ * n) / (double)n;
+    if (!(mean > min_mean_)) {
+        return false;
+    }
+    if (min_qual_ >= 0 && ((int)minq - offset_) < min_qual_) {
+        return false;
+    }
+    
+    // every window of window_ bases must also exceed the mean threshold
+    if (window_ > 0 && window_ < n) {
+        long wsum = 0;
+        for (int i = 0; i < window_; i++) {
+            wsum += q[i];
+        }
+        // compare sums rather than dividing for every window
+        double threshold = (min_mean_ + (double)offset_) * (double)window_;
+        if (!((double)wsum > threshold)) {
+            return false;
+        }
+        for (int i = window_; i < n; i++) {
+            wsum += (long)q[i] - (long)q[i - window_];
+            if (!((double)wsum > threshold)) {
+                return false;
+            }
+        }
+    }
+    
+    // expected number of errors: sum of per-base error probabilities
+    if (max_ee_ >= 0.0) {
+        double ee = 0.0;
+        for (int i = 0; i < n; i++) {
+            ee += error_probs_[q[i]];
+        }
+        if (ee > max_ee_) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// reads are processed in batches: read serially (reusing the same record strings,
+// so there is no per-read allocation once warmed up), tested in parallel, then
+// passing reads are written in input order. retstring is the first line of the
+// file (already consumed by the file type check)
+void FastqFilter::filter_stream (std::istream& pios, std::string& retstring, std::ostream* poos) {
+    const int batchsize = 16384;
+    std::vector<std::string> headers(batchsize);
+    std::vector<std::string> seqs(batchsize);
+    std::vector<std::string> quals(batchsize);
+    std::vector<char> keep(batchsize);
+    std::string plus;
+    std::string outbuf;
+    
+    bool done = false;
+    while (!done) {
+        int nreads = 0;
+        while (nreads < batchsize) {
+            if (retstring.size() > 0) {
+                headers[nreads].swap(retstring);
+                retstring.clear();
+            } else if (!getline(pios, headers[nreads])) {
+                done = true;
+                break;
+            }
+            if (!getline(pios, seqs[nreads]) || !getline(pios, plus)
+                    || !getline(pios, quals[nreads])) {
+                done = true;
+                break;
+            }
+            nreads++;
+        }
+        
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < nreads; i++) {
+            keep[i] = passes(quals[i]) ? 1 : 0;
+        }
+        
+        outbuf.clear();
+        for (int i = 0; i < nreads; i++) {
+            if (keep[i]) {
+                outbuf += '@';
+                outbuf.append(headers[i], 1, std::string::npos);
+                outbuf += '\n';
+                outbuf += seqs[i];
+                outbuf += "\n+\n";
+                outbuf += quals[i];
+                outbuf += '\n';
+                num_passed_++;
+            }
+        }
+        poos->write(outbuf.data(), outbuf.size());
+        num_reads_ += nreads;
+    }
+}
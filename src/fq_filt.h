@@ -0,0 +1,31 @@
+#ifndef _FQ_FILT_H_
+#define _FQ_FILT_H_
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+class FastqFilter {
+private:
+    double min_mean_;
+    int min_qual_; // -1: not used
+    int window_; // 0: not used
+    double max_ee_; // < 0: not used
+    int offset_;
+    
+    long num_reads_;
+    long num_passed_;
+    
+    std::vector<double> error_probs_; // indexed by raw quality byte
+    
+    bool passes (const std::string& qual) const;
+    
+public:
+    FastqFilter (const double& min_mean, const int& min_qual, const int& window,
+        const double& max_ee);
+    void filter_stream (std::istream& pios, std::string& retstring, std::ostream* poos);
+    long get_num_reads () const { return num_reads_; };
+    long get_num_passed () const { return num_passed_; };
+};
+
+#endif /* _FQ_FILT_H_ */
@@ -1,16 +1,113 @@
-#include <fstream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "log.h"
+#include "profile.h"
 
-void log_call (int argc, char * argv[]) {
-    std::ofstream phyxlog;
-    phyxlog.open ("phyx.logfile", std::ios::out | std::ios::app);
+/*
+ * the call is appended to the logfile named by the environment variable
+ * PHYX_LOGFILE, or to phyx.logfile if that is not set. setting it empty (or
+ * to "none") turns logging off. the line goes out in a single unbuffered
+ * O_APPEND write, so it costs one syscall and lines from concurrent runs do
+ * not interleave
+ */
+static void write_log (int argc, char * argv[]) {
+    const char * logname = getenv("PHYX_LOGFILE");
+    if (logname == NULL) {
+        logname = "phyx.logfile";
+    } else if (logname[0] == '\0' || strcmp(logname, "none") == 0) {
+        return;
+    }
+    std::string line;
     for (int i = 0; i < argc; i++) {
-        phyxlog << argv[i];
+        line += argv[i];
         if (i < (argc - 1)) {
-            phyxlog << " ";
+            line += " ";
+        }
+    }
+    line += "\n";
+    int fd = open(logname, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) {
+        return;
+    }
+    ssize_t res = write(fd, line.c_str(), line.size());
+    (void)res; // logging is best effort
+    close(fd);
+}
+
+
+// whether short option c takes its value from the next argument (when nothing
+// follows it in the same argument). optional ("::") values never do
+static bool short_takes_arg (const char& c, const char * shortopts) {
+    const char * pos = (c == ':') ? NULL : strchr(shortopts, c);
+    return (pos != NULL && pos[1] == ':' && pos[2] != ':');
+}
+
+
+// same for a long option (without the leading "--"), allowing unambiguous
+// abbreviations as getopt_long does. "--name=value" never takes the next argument
+static bool long_takes_arg (const char * name, const struct option * longopts) {
+    if (longopts == NULL || strchr(name, '=') != NULL) {
+        return false;
+    }
+    size_t len = strlen(name);
+    const struct option * match = NULL;
+    int nmatches = 0;
+    for (const struct option * o = longopts; o->name != NULL; o++) {
+        if (strncmp(o->name, name, len) == 0) {
+            if (strlen(o->name) == len) {
+                match = o; // exact
+                nmatches = 1;
+                break;
+            }
+            match = o;
+            nmatches++;
+        }
+    }
+    return (nmatches == 1 && match->has_arg == required_argument);
+}
+
+
+void log_call (int& argc, char * argv[], const char * shortopts,
+    const struct option * longopts) {
+    write_log(argc, argv);
+    // strip --profile[=json] so that the tools' getopt never sees it. option
+    // values (e.g. "-o --profile") and operands after "--" are left alone
+    int j = 1;
+    for (int i = 1; i < argc; i++) {
+        const char * arg = argv[i];
+        if (strcmp(arg, "--profile") == 0) {
+            profile_enable(argv[0], false);
+            continue;
+        } else if (strcmp(arg, "--profile=json") == 0) {
+            profile_enable(argv[0], true);
+            continue;
+        } else if (strcmp(arg, "--") == 0) {
+            while (i < argc) {
+                argv[j++] = argv[i++];
+            }
+            break;
+        }
+        argv[j++] = argv[i];
+        bool takes_next = false;
+        if (arg[0] == '-' && arg[1] == '-') {
+            takes_next = long_takes_arg(arg + 2, longopts);
+        } else if (arg[0] == '-') {
+            // possibly grouped flags (-ab); the first one with a value ends the group
+            for (int k = 1; arg[k] != '\0'; k++) {
+                if (short_takes_arg(arg[k], shortopts)) {
+                    takes_next = (arg[k + 1] == '\0');
+                    break;
+                }
+            }
+        }
+        if (takes_next && i + 1 < argc) {
+            argv[j++] = argv[++i];
         }
     }
-    phyxlog << std::endl;
-    phyxlog.close();
+    argc = j;
+    argv[argc] = NULL;
 }
@@ -1,6 +1,11 @@
 #ifndef _PHYXLOG_H_
 #define _PHYXLOG_H_
 
-void log_call (int argc, char * argv[]);
+#include <getopt.h>
+
+// records the call, and takes the common --profile flag out of argv. the tool's
+// own getopt options are needed so that an option value is never mistaken for it
+void log_call (int& argc, char * argv[], const char * shortopts,
+    const struct option * longopts);
 
 #endif /* _PHYXLOG_H_ */
@@ -3,6 +3,9 @@
 #include <iostream>
 #include <algorithm>
 #include <numeric>
+#include <cstring>
+#include <cctype>
+#include <cmath>
 
 #include "log_manip.h"
 #include "utils.h"
@@ -20,6 +23,8 @@ LogManipulator::LogManipulator (const std::string& logtype, const std::vector<st
     }
     logtype_ = logtype;
     poos_ = poos;
+    verbose_ = false;
+    indexed_ = false;
 }
 
 
@@ -30,6 +35,7 @@ LogManipulator::LogManipulator (const std::string& logtype, const std::vector<st
     logtype_ = logtype;
     poos_ = poos;
     verbose_ = verbose;
+    indexed_ = false;
 }
 
 
@@ -60,48 +66,11 @@ void LogManipulator::count () {
 void LogManipulator::count_parameter_samples () {
     num_cols_ = 0;
     if (!files_.empty()) {
-        for (int i=0; i < num_files_; i++) {
-            std::string curfile = files_[i];
-            infilestr_.open(curfile.c_str());
-            std::string line;
-            bool first_line = true;
-            int num_samps = 0;
-            while (getline(infilestr_, line)) {
-                if (line.empty() || check_comment_line(line)) {
-                    continue;
-                } else if (first_line) {
-                    std::vector<std::string> header = tokenize(line);
-                    int curpars = header.size();
-                    if (i == 0) { // first header
-                        num_cols_ = curpars;
-                        parm_columns_ = header;
-                    } else {
-                        // check that we've still got the same number of parameters i.e. files match
-                        if (curpars != num_cols_) {
-                            std::cerr << "Error: number of parameters in file " << (i + 1)
-                                << "(" << curpars << ") does not match that from first file ("
-                                << num_cols_ << "). Exiting." << std::endl;
-                            exit(0);
-                        } else if (header != parm_columns_) {
-                            // check that headers are identical
-                            std::cerr << "Error: header for file " << (i + 1)
-                                << "does not match that from first file. Exiting." << std::endl;
-                            exit(0);
-                        }
-                    }
-                    first_line = false;
-                    continue;
-                } else {
-                    num_samps++;
-                    continue;
-                }
-            }
-            indiv_sample_totals_.push_back(num_samps);
-            infilestr_.close();
+        index_files();
+        indiv_sample_totals_.clear();
+        for (int i = 0; i < num_files_; i++) {
+            indiv_sample_totals_.push_back(indices_[i].num_samples());
         }
-        //ntotal_samples_ = accumulate(indiv_totals_.begin(), indiv_totals_.end(), 0);
-        //(*poos_) << "Counted " << ntotal_samples_ << " total samples and " << (num_cols_ - 1)
-        //    << " variables across " << num_files_ << " files." << std::endl;
     } else {
         
         // stream stuff will go here (maybe)
@@ -113,29 +82,11 @@ void LogManipulator::count_parameter_samples () {
 
 void LogManipulator::count_tree_samples () {
     if (!files_.empty()) {
-        for (int i=0; i < num_files_; i++) {
-            std::string curfile = files_[i];
-            infilestr_.open(curfile.c_str());
-            std::string line;
-            int num_samps = 0;
-            while (getline(infilestr_, line)) {
-                if (line.empty() || check_comment_line(line)) {
-                    continue;
-                } else {
-                    std::vector<std::string> tokens = tokenize(line);
-                    std::string first = tokens[0];
-                    std::transform(first.begin(), first.end(), first.begin(), ::tolower);
-                    if (first == "tree") {
-                        num_samps++;
-                    }
-                }
-            }
-            indiv_sample_totals_.push_back(num_samps);
-            infilestr_.close();
+        index_files();
+        indiv_sample_totals_.clear();
+        for (int i = 0; i < num_files_; i++) {
+            indiv_sample_totals_.push_back(indices_[i].num_samples());
         }
-        //ntotal_samples_ = accumulate(indiv_totals_.begin(), indiv_totals_.end(), 0);
-        //(*poos_) << "Counted " << ntotal_samples_ << " total samples and " << (num_cols_ - 1)
-        //    << " variables across " << num_files_ << " files." << std::endl;
     } else {
         
         // stream stuff will go here (maybe)
@@ -145,6 +96,206 @@ void LogManipulator::count_tree_samples () {
 }
 
 
+// index every input file (concurrently when built with openmp). each file is
+// read exactly once; everything downstream works from the byte offsets
+void LogManipulator::index_files () {
+    if (indexed_) {
+        return;
+    }
+    indices_.assign(num_files_, LogFileIndex());
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < num_files_; i++) {
+        index_log_file(files_[i], indices_[i]);
+    }
+    for (int i = 0; i < num_files_; i++) {
+        if (!indices_[i].good_) {
+            std::cerr << "Error: could not read input file '" << files_[i] << "'. Exiting." << std::endl;
+            exit(0);
+        }
+    }
+    if (logtype_ == "parameter") {
+        check_parameter_headers();
+    }
+    indexed_ = true;
+}
+
+
+// true if first token (case-insensitive) is 'tree'. line has leading whitespace removed
+static bool is_tree_record (const char * line, const size_t& len) {
+    if (len < 4) {
+        return false;
+    }
+    if (::tolower(line[0]) != 't' || ::tolower(line[1]) != 'r' || ::tolower(line[2]) != 'e'
+            || ::tolower(line[3]) != 'e') {
+        return false;
+    }
+    return (len == 4 || ::isspace(line[4]));
+}
+
+
+// scan a file in large blocks, locating line ends with memchr (no getline, no
+// tokenizing). records the offset/length of every sample line. lines spanning
+// a block boundary are carried over into the next block
+void LogManipulator::index_log_file (const std::string& filename, LogFileIndex& idx) const {
+    std::ifstream infile(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!infile.good()) {
+        return;
+    }
+    const bool treelog = (logtype_ != "parameter");
+    bool first_line = true; // parameter logs: first non-comment line is the header
+    bool trees_encountered = false;
+    
+    auto process_line = [&] (const char * line, size_t len, const std::streamoff& offset) {
+        size_t first = 0;
+        while (first < len && (line[first] == ' ' || line[first] == '\t' || line[first] == '\r')) {
+            first++;
+        }
+        bool blank = (first == len);
+        bool comment = !blank && (line[first] == '#' || line[first] == '[');
+        if (treelog) {
+            if (!blank && !comment && is_tree_record(line + first, len - first)) {
+                trees_encountered = true;
+                idx.offsets_.push_back(offset);
+                idx.lengths_.push_back((unsigned int)len);
+            } else if (!trees_encountered) {
+                // keep header, likely includes translation table
+                idx.preamble_.append(line, len);
+                idx.preamble_ += '\n';
+            }
+        } else {
+            if (blank || comment) {
+                return;
+            } else if (first_line) {
+                idx.header_.assign(line, len);
+                first_line = false;
+            } else {
+                idx.offsets_.push_back(offset);
+                idx.lengths_.push_back((unsigned int)len);
+            }
+        }
+    };
+    
+    const std::streamsize blocksize = 1 << 22;
+    std::vector<char> buffer(blocksize);
+    std::string carry;
+    std::streamoff carry_start = 0;
+    std::streamoff block_start = 0;
+    while (infile) {
+        infile.read(&buffer[0], blocksize);
+        std::streamsize nread = infile.gcount();
+        if (nread <= 0) {
+            break;
+        }
+        const char * begin = &buffer[0];
+        const char * end = begin + nread;
+        const char * pos = begin;
+        while (pos < end) {
+            const char * nl = static_cast<const char *>(memchr(pos, '\n', end - pos));
+            if (nl == NULL) {
+                if (carry.empty()) {
+                    carry_start = block_start + (pos - begin);
+                }
+                carry.append(pos, end - pos);
+                break;
+            }
+            if (!carry.empty()) {
+                carry.append(pos, nl - pos);
+                process_line(carry.data(), carry.size(), carry_start);
+                carry.clear();
+            } else {
+                process_line(pos, nl - pos, block_start + (pos - begin));
+            }
+            pos = nl + 1;
+        }
+        block_start += nread;
+    }
+    if (!carry.empty()) {
+        process_line(carry.data(), carry.size(), carry_start);
+    }
+    idx.good_ = true;
+}
+
+
+// make sure number/name/order of columns is identical across files
+void LogManipulator::check_parameter_headers () {
+    for (int i = 0; i < num_files_; i++) {
+        std::vector<std::string> header = tokenize(indices_[i].header_);
+        int curpars = header.size();
+        if (i == 0) { // first header
+            num_cols_ = curpars;
+            parm_columns_ = header;
+        } else {
+            // check that we've still got the same number of parameters i.e. files match
+            if (curpars != num_cols_) {
+                std::cerr << "Error: number of parameters in file " << (i + 1)
+                    << "(" << curpars << ") does not match that from first file ("
+                    << num_cols_ << "). Exiting." << std::endl;
+                exit(0);
+            } else if (header != parm_columns_) {
+                // check that headers are identical
+                std::cerr << "Error: header for file " << (i + 1)
+                    << "does not match that from first file. Exiting." << std::endl;
+                exit(0);
+            }
+        }
+    }
+}
+
+
+// indices (per file) of the samples that survive burnin and thinning, and
+// optionally a random subsample (without replacement) of those pooled across files
+std::vector<std::vector<int> > LogManipulator::get_retained_samples () {
+    std::vector<std::vector<int> > retained(num_files_);
+    for (int i = 0; i < num_files_; i++) {
+        int nsamp = indices_[i].num_samples();
+        for (int j = burnin_; j < nsamp; j += nthin_) {
+            retained[i].push_back(j);
+        }
+    }
+    if (nrandom_ > 0) {
+        std::vector<int> starts(num_files_ + 1, 0);
+        for (int i = 0; i < num_files_; i++) {
+            starts[i+1] = starts[i] + (int)retained[i].size();
+        }
+        int npool = starts[num_files_];
+        if (nrandom_ > npool) {
+            std::cerr << "Error: cannot draw " << nrandom_ << " random samples from "
+                << npool << " available samples. Exiting." << std::endl;
+            exit(0);
+        }
+        if (seed_ == -1) {
+            srand(get_clock_seed());
+        } else {
+            srand(seed_);
+        }
+        std::vector<int> picks = sample_without_replacement(npool, nrandom_);
+        std::sort(picks.begin(), picks.end()); // preserve original sample order
+        std::vector<std::vector<int> > subsample(num_files_);
+        int curfile = 0;
+        for (unsigned int k = 0; k < picks.size(); k++) {
+            while (picks[k] >= starts[curfile+1]) {
+                curfile++;
+            }
+            subsample[curfile].push_back(retained[curfile][picks[k] - starts[curfile]]);
+        }
+        retained = subsample;
+    }
+    return retained;
+}
+
+
+// seek straight to an indexed sample
+std::string LogManipulator::read_sample (std::ifstream& infile, const LogFileIndex& idx,
+    const int& i) const {
+    std::string sample(idx.lengths_[i], '\0');
+    infile.seekg(idx.offsets_[i]);
+    if (!sample.empty()) {
+        infile.read(&sample[0], idx.lengths_[i]);
+    }
+    return sample;
+}
+
+
 void LogManipulator::get_sample_counts () {
     if (logtype_ == "parameter") {
         for (int i = 0; i < num_files_; i++) {
@@ -329,76 +480,27 @@ void LogManipulator::retain_columns (const std::vector<int>& col_ids) {
 }
 
 
-// not yet used?
 void LogManipulator::sample_parameters () {
     if (!files_.empty()) {
         ntotal_samples_ = 0;
-        for (int i=0; i < num_files_; i++) {
-            std::string curfile = files_[i];
-            infilestr_.open(curfile.c_str());
-            std::string line;
-            bool first_line = true;
-            int par_counter = 0; // this is the raw number of parameter lines in a file
-            int sample_counter = 0;
-            while (getline(infilestr_, line)) {
-                if (line.empty() || check_comment_line(line)) {
-                    continue;
-                } else if (first_line) {
-                    std::vector<std::string> header = tokenize(line);
-                    int curpars = header.size();
-                    if (i == 0) { // first header
-                        num_cols_ = curpars;
-                        parm_columns_ = header;
-                        for (int j=0; j < num_cols_; j++) {
-                            (*poos_) << parm_columns_[j];
-                            if (j < (num_cols_ - 1)) {
-                                (*poos_) << "\t";
-                            }
-                        }
-                        (*poos_) << std::endl;
-                    } else {
-                        // check that we've still got the same number of parameters i.e. files match
-                        if (curpars != num_cols_) {
-                            std::cerr << "Error: number of parameters in file " << (i + 1)
-                                << "(" << curpars << ") does not match that from first file ("
-                                << num_cols_ << "). Exiting." << std::endl;
-                            exit(0);
-                        } else if (header != parm_columns_) {
-                            // check that headers are identical
-                            std::cerr << "Error: header for file " << (i + 1)
-                                << "does not match that from first file. Exiting." << std::endl;
-                            exit(0);
-                        }
-                    }
-                    first_line = false;
-                    continue;
-                } else {
-                    if ((par_counter - burnin_) > 0 && (par_counter - burnin_) < nthin_) {
-                        // skip because does not match sampling parameters
-                        par_counter++;
-                        continue;
-                    } else if ((par_counter - burnin_) == 0) {
-                        // keep first post-burnin sample from a file
-                        par_counter++;
-                        write_reformatted_sample(line, ntotal_samples_);
-                        sample_counter++;
-                        ntotal_samples_++;
-                        continue;
-                    } else if ((par_counter - burnin_) > 0 && (par_counter - burnin_) % nthin_ == 0) {
-                        par_counter++;
-                        write_reformatted_sample(line, ntotal_samples_);
-                        sample_counter++;
-                        ntotal_samples_++;
-                        continue;
-                    } else {
-                        // skip because have not yet exceeded burnin
-                        par_counter++;
-                    }
-                }
+        index_files();
+        std::vector<std::vector<int> > retained = get_retained_samples();
+        for (int j = 0; j < num_cols_; j++) {
+            (*poos_) << parm_columns_[j];
+            if (j < (num_cols_ - 1)) {
+                (*poos_) << "\t";
             }
-            indiv_raw_counts_.push_back(par_counter);
-            indiv_sample_totals_.push_back(sample_counter);
-            infilestr_.close();
+        }
+        (*poos_) << std::endl;
+        for (int i = 0; i < num_files_; i++) {
+            std::ifstream infile(files_[i].c_str(), std::ios::in | std::ios::binary);
+            for (unsigned int j = 0; j < retained[i].size(); j++) {
+                std::string line = read_sample(infile, indices_[i], retained[i][j]);
+                write_reformatted_sample(line, ntotal_samples_);
+                ntotal_samples_++;
+            }
+            indiv_raw_counts_.push_back(indices_[i].num_samples());
+            indiv_sample_totals_.push_back((int)retained[i].size());
         }
         if (verbose_) {
             for (int i = 0; i < num_files_; i++) {
@@ -416,65 +518,25 @@ void LogManipulator::sample_parameters () {
 void LogManipulator::sample_trees () {
     if (!files_.empty()) {
         ntotal_samples_ = 0;
-        for (int i=0; i < num_files_; i++) {
-            std::string curfile = files_[i];
-            infilestr_.open(curfile.c_str());
-            std::string line;
-            int tree_counter = 0; // this is the raw number of tree lines in a file
-            int sample_counter = 0;
-            bool trees_encountered = false;
-            while (getline(infilestr_, line)) {
-                if (line.empty() || check_comment_line(line)) {
-                    if (i == 0) {
-                        // keep comment information from top of first file
-                        (*poos_) << line << std::endl;
-                    }
-                    continue;
-                } else {
-                    std::vector<std::string> tokens = tokenize(line);
-                    std::string first = tokens[0];
-                    std::transform(first.begin(), first.end(), first.begin(), ::tolower);
-                    if (first == "tree") {
-                        if (tree_counter == 0) {
-                            trees_encountered = true;
-                        }
-                        if (ntotal_samples_ == 0) {
-                            // grab tree naming scheme
-                            get_tree_name_prefix(line);
-                        }
-                        if ((tree_counter - burnin_) > 0 && (tree_counter - burnin_) < nthin_) {
-                            // skip because does not match sampling parameters
-                            tree_counter++;
-                            continue;
-                        } else if ((tree_counter - burnin_) == 0) {
-                            // keep first post-burnin sample from a file
-                            tree_counter++;
-                            write_reformatted_sample(line, ntotal_samples_);
-                            sample_counter++;
-                            ntotal_samples_++;
-                            continue;
-                        } else if ((tree_counter - burnin_) > 0 && (tree_counter - burnin_) % nthin_ == 0) {
-                            tree_counter++;
-                            write_reformatted_sample(line, ntotal_samples_);
-                            sample_counter++;
-                            ntotal_samples_++;
-                            continue;
-                        } else {
-                            // skip because have not yet exceeded burnin
-                            tree_counter++;
-                        }
-                    } else { // not a tree line. only care about first file here. don't want anything below trees
-                        // keep header from first file
-                        // likely includes translation table
-                        if (i == 0 && !trees_encountered) {
-                            (*poos_) << line << std::endl;
-                        }
-                    }
+        index_files();
+        std::vector<std::vector<int> > retained = get_retained_samples();
+        
+        // keep comments/header (translation table) from top of first file
+        (*poos_) << indices_[0].preamble_;
+        
+        for (int i = 0; i < num_files_; i++) {
+            std::ifstream infile(files_[i].c_str(), std::ios::in | std::ios::binary);
+            for (unsigned int j = 0; j < retained[i].size(); j++) {
+                std::string line = read_sample(infile, indices_[i], retained[i][j]);
+                if (ntotal_samples_ == 0) {
+                    // grab tree naming scheme
+                    get_tree_name_prefix(line);
                 }
+                write_reformatted_sample(line, ntotal_samples_);
+                ntotal_samples_++;
             }
-            indiv_raw_counts_.push_back(tree_counter);
-            indiv_sample_totals_.push_back(sample_counter);
-            infilestr_.close();
+            indiv_raw_counts_.push_back(indices_[i].num_samples());
+            indiv_sample_totals_.push_back((int)retained[i].size());
         }
         (*poos_) << "End;" << std::endl;
         
@@ -491,6 +553,166 @@ void LogManipulator::sample_trees () {
 }
 
 
+// columnar summary of a parameter log: each requested column is parsed in place
+// (no tokenizing) into a typed vector, one file per thread, after burnin/thinning.
+// col_ids are 1-indexed; empty means all variables (i.e., not the generation column)
+void LogManipulator::summarize (const int& burnin, const int& nthin, const int& nrandom,
+    const int& seed, const std::vector<int>& col_ids) {
+    burnin_ = burnin;
+    nthin_= nthin;
+    nrandom_ = nrandom;
+    seed_ = seed;
+    if (files_.empty()) {
+        return;
+    }
+    index_files();
+    
+    std::vector<int> cols;
+    if (col_ids.empty()) {
+        for (int i = 1; i < num_cols_; i++) {
+            cols.push_back(i);
+        }
+    } else {
+        if (col_ids.back() > num_cols_) {
+            std::cerr << "Warning: column numbers are 1-indexed. Exiting." << std::endl;
+            exit(0);
+        }
+        std::vector<bool> seen(num_cols_, false);
+        for (unsigned int i = 0; i < col_ids.size(); i++) {
+            if (seen[col_ids[i] - 1]) {
+                std::cerr << "Error: column " << col_ids[i] << " requested more than once. Exiting."
+                    << std::endl;
+                exit(0);
+            }
+            seen[col_ids[i] - 1] = true;
+            cols.push_back(col_ids[i] - 1);
+        }
+    }
+    if (cols.empty()) {
+        std::cerr << "Error: no parameter columns to summarize. Exiting." << std::endl;
+        exit(0);
+    }
+    int ncols = (int)cols.size();
+    
+    std::vector<std::vector<int> > retained = get_retained_samples();
+    std::vector<std::vector<std::vector<double> > > file_values(num_files_);
+    std::vector<int> parsed(num_files_, 1);
+    std::vector<int> skipped(num_files_, 0);
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < num_files_; i++) {
+        parsed[i] = parse_parameter_columns(i, retained[i], cols, file_values[i],
+            skipped[i]) ? 1 : 0;
+    }
+    for (int i = 0; i < num_files_; i++) {
+        if (parsed[i] == 0) {
+            std::cerr << "Error: malformed sample line (too few columns) in file '"
+                << files_[i] << "'. Exiting." << std::endl;
+            exit(0);
+        }
+        if (skipped[i] > 0) {
+            std::cerr << "Warning: skipped " << skipped[i] << " non-numeric value(s) in file '"
+                << files_[i] << "'." << std::endl;
+        }
+    }
+    
+    // stitch files together (in order) per column
+    std::vector<std::vector<double> > values(ncols);
+    for (int j = 0; j < ncols; j++) {
+        for (int i = 0; i < num_files_; i++) {
+            values[j].insert(values[j].end(), file_values[i][j].begin(), file_values[i][j].end());
+        }
+    }
+    file_values.clear();
+    
+    std::vector<std::vector<double> > stats(ncols, std::vector<double>(7, 0.0));
+    #pragma omp parallel for schedule(dynamic)
+    for (int j = 0; j < ncols; j++) {
+        std::vector<double>& vals = values[j];
+        if (vals.empty()) {
+            continue;
+        }
+        stats[j][0] = mean(vals);
+        stats[j][1] = (vals.size() > 1) ? std::sqrt(variance(vals) * (double)vals.size()
+            / (double)(vals.size() - 1)) : 0.0;
+        stats[j][2] = median(vals);
+        std::vector<double> hpd = calc_hpd_interval(vals, 0.95);
+        stats[j][3] = hpd[0];
+        stats[j][4] = hpd[1];
+        stats[j][5] = calc_ess_batch_means(vals);
+        stats[j][6] = (double)vals.size();
+    }
+    
+    (*poos_) << "Parameter\tN\tMean\tSD\tMedian\tHPD95_lower\tHPD95_upper\tESS" << std::endl;
+    for (int j = 0; j < ncols; j++) {
+        (*poos_) << parm_columns_[cols[j]] << "\t" << (int)stats[j][6];
+        for (int k = 0; k < 6; k++) {
+            (*poos_) << "\t" << stats[j][k];
+        }
+        (*poos_) << std::endl;
+    }
+    if (verbose_) {
+        int ntotal = 0;
+        for (int i = 0; i < num_files_; i++) {
+            ntotal += (int)retained[i].size();
+        }
+        std::cout << "Summarized " << ntotal << " samples for " << ncols
+            << " variables across " << num_files_ << " input files." << std::endl;
+    }
+}
+
+
+// parse the requested (0-indexed) columns of the retained rows of one file
+// directly from the line buffer with strtod. values is indexed [column][sample].
+// fields that are not finite numbers (including nan/inf) are left out and counted
+// in nskipped; this is checked on the text, as isnan is unreliable with -ffast-math
+bool LogManipulator::parse_parameter_columns (const int& filenum, const std::vector<int>& retained,
+    const std::vector<int>& cols, std::vector<std::vector<double> >& values,
+    int& nskipped) const {
+    int ncols = (int)cols.size();
+    int maxcol = *std::max_element(cols.begin(), cols.end());
+    // map from raw column to output slot(s); -1 means skip
+    std::vector<int> slot(maxcol + 1, -1);
+    for (int j = 0; j < ncols; j++) {
+        slot[cols[j]] = j;
+    }
+    values.assign(ncols, std::vector<double>());
+    for (int j = 0; j < ncols; j++) {
+        values[j].reserve(retained.size());
+    }
+    nskipped = 0;
+    
+    std::ifstream infile(files_[filenum].c_str(), std::ios::in | std::ios::binary);
+    for (unsigned int r = 0; r < retained.size(); r++) {
+        std::string line = read_sample(infile, indices_[filenum], retained[r]);
+        const char * pos = line.c_str();
+        for (int c = 0; c <= maxcol; c++) {
+            while (*pos == ' ' || *pos == '\t' || *pos == '\r') {
+                pos++;
+            }
+            if (*pos == '\0') {
+                return false;
+            }
+            if (slot[c] != -1) {
+                const char * digits = (*pos == '-' || *pos == '+') ? pos + 1 : pos;
+                char * endp = NULL;
+                double val = strtod(pos, &endp);
+                if (endp == pos || isalpha(*digits) || (*endp != '\0' && *endp != ' '
+                        && *endp != '\t' && *endp != '\r')) {
+                    nskipped++;
+                } else {
+                    values[slot[c]].push_back(val);
+                }
+            }
+            // skip to end of field
+            while (*pos != '\0' && *pos != ' ' && *pos != '\t' && *pos != '\r') {
+                pos++;
+            }
+        }
+    }
+    return true;
+}
+
+
 // gen.NNN from Mrbayes, STATE_NNN from BEAST
 // try to be general here, though: take whatever precedes the sample number
 void LogManipulator::get_tree_name_prefix (std::string& sample) {
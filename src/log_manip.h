@@ -6,6 +6,20 @@
 #include <iostream>
 #include <fstream>
 
+// compact index of a single log file: byte offset and length of every sample
+// record, plus whatever precedes the samples (column header or nexus preamble)
+class LogFileIndex {
+public:
+    std::vector<std::streamoff> offsets_;
+    std::vector<unsigned int> lengths_;
+    std::string header_; // parameter logs: the column header line
+    std::string preamble_; // tree logs: everything above the first tree
+    bool good_;
+    
+    LogFileIndex ():good_(false) {};
+    int num_samples () const { return (int)offsets_.size(); };
+};
+
 class LogManipulator {
 private:
     std::string logtype_; // "parameter" or "tree"
@@ -34,11 +48,21 @@ private:
     std::ostream* poos_;
     std::ifstream infilestr_;
     std::vector<std::string> parm_columns_;
+    std::vector<LogFileIndex> indices_;
+    bool indexed_;
     
+    void index_files ();
+    void index_log_file (const std::string& filename, LogFileIndex& idx) const;
+    void check_parameter_headers ();
+    std::vector<std::vector<int> > get_retained_samples ();
+    std::string read_sample (std::ifstream& infile, const LogFileIndex& idx, const int& i) const;
     void count_parameter_samples ();
     void count_tree_samples ();
     void sample_parameters ();
     void sample_trees ();
+    bool parse_parameter_columns (const int& filenum, const std::vector<int>& retained,
+        const std::vector<int>& cols, std::vector<std::vector<double> >& values,
+        int& nskipped) const;
     void write_reformatted_sample (std::string& sample, int& sample_num);
     void get_tree_name_prefix (std::string& sample);
     
@@ -53,6 +77,8 @@ public:
     void get_column_names ();
     void sample (const int& burnin, const int& nthin, const int& nrandom,
         const int& seed);
+    void summarize (const int& burnin, const int& nthin, const int& nrandom,
+        const int& seed, const std::vector<int>& col_ids);
     void delete_columns (const std::vector<int>& col_ids);
     void retain_columns (const std::vector<int>& col_ids);
 };
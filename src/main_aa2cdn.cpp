@@ -48,9 +48,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "a:o:n:rhVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool fileset = false;
     bool outfileset = false;
@@ -62,7 +64,7 @@ int main(int argc, char * argv[]) {
 
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "a:o:n:rhVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -7,12 +7,15 @@
 #include <algorithm>
 #include <cmath>
 #include <set>
+#include <sstream>
 
-#include "tree_reader.h"
+#include "tree_stream.h"
+#include "tree_writer.h"
 #include "tree.h"
 #include "tree_utils.h"
 #include "utils.h"
 #include "bd_fit.h"
+#include "stat_summary.h"
 #include "log.h"
 #include "constants.h"
 
@@ -20,14 +23,16 @@ extern std::string PHYX_CITATION;
 
 
 void print_help () {
-    std::cout << "Fit a lineage diversification model to a tree." << std::endl;
-    std::cout << "This will take a newick- or nexus-formatted tree from a file or STDIN." << std::endl;
+    std::cout << "Fit a lineage diversification model to a tree (or each of a set of trees)." << std::endl;
+    std::cout << "This will take newick- or nexus-formatted trees from a file or STDIN." << std::endl;
     std::cout << std::endl;
     std::cout << "Usage: pxbdfit [OPTIONS]..." << std::endl;
     std::cout << std::endl;
     std::cout << "Options:" << std::endl;
     std::cout << " -t, --treef=FILE    input treefile, STDIN otherwise" << std::endl;
     std::cout << " -m, --model=STRING  diversification model; either 'yule', 'bd' (default), or 'best'" << std::endl;
+    std::cout << " -T, --table         return the fitted values as a table (one row per tree)" << std::endl;
+    std::cout << " -s, --summary       return mean and quantiles of the fitted values across trees" << std::endl;
     std::cout << " -o, --outf=FILE     output file, STOUT otherwise" << std::endl;
     std::cout << " -h, --help          display this help and exit" << std::endl;
     std::cout << " -V, --version       display version and exit" << std::endl;
@@ -44,19 +49,24 @@ static struct option const long_options[] =
     {"treef", required_argument, NULL, 't'},
     {"model", required_argument, NULL, 'm'},
     {"outf", required_argument, NULL, 'o'},
-    {"showd", no_argument, NULL, 's'},
+    {"table", no_argument, NULL, 'T'},
+    {"summary", no_argument, NULL, 's'},
     {"help", no_argument, NULL, 'h'},
     {"version", no_argument, NULL, 'V'},
     {"citation", no_argument, NULL, 'C'},
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "t:m:Tso:hVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool outfileset = false;
     bool tfileset = false;
+    bool tableout = false;
+    bool summaryout = false;
     
     char * treef = NULL;
     char * outf = NULL;
@@ -66,7 +76,7 @@ int main(int argc, char * argv[]) {
     
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "t:m:o:x:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -85,6 +95,12 @@ int main(int argc, char * argv[]) {
                     exit(0);
                 }
                 break;
+            case 'T':
+                tableout = true;
+                break;
+            case 's':
+                summaryout = true;
+                break;
             case 'o':
                 outfileset = true;
                 outf = strdup(optarg);
@@ -130,51 +146,53 @@ int main(int argc, char * argv[]) {
         }
     }
     
-    std::string retstring;
-    int ft = test_tree_filetype_stream(*pios, retstring);
+    TreeWriter tw(poos);
+    
+    TreeStream trees(pios);
+    int ft = trees.get_filetype();
     if (ft != 0 && ft != 1) {
         std::cerr << "Error: this really only works with nexus or newick. Exiting." << std::endl;
         exit(0);
     }
     
-    bool going = true;
-    if (ft == 1) {
-        Tree * tree;
-        while (going) {
-            tree = read_next_tree_from_stream_newick (*pios, retstring, &going);
-            if (going) {
-                // in addition to checking ultramtericity, the following sets node heights
-                if (is_ultrametric_paths(tree)) {
-                    BDFit bd(tree, model);
-                    bd.get_pars(poos);
-                    delete tree;
-                } else {
-                    std::cerr << "Error: tree is not ultrametric. Exiting." << std::endl;
-                    exit(0);
-                }
-            }
-        }
+    // trees (branching times and fits) are processed in parallel; output keeps
+    // the input order. trees that are not ultrametric are reported and skipped
+    StatSummary summary(BDFit::get_stat_names());
+    if (tableout) {
+        tw.write(BDFit::get_table_header());
     }
-    if (ft == 0) {
-        std::map<std::string, std::string> translation_table;
-        bool ttexists;
-        ttexists = get_nexus_translation_table(*pios, &translation_table, &retstring);
-        Tree * tree;
-        while (going) {
-            tree = read_next_tree_from_stream_nexus(*pios, retstring, ttexists,
-                &translation_table, &going);
-            if (tree != NULL) {
-                // in addition to checking ultramtericity, the following sets node heights
-                if (is_ultrametric_paths(tree)) {
-                    BDFit bd(tree, model);
-                    bd.get_pars(poos);
-                    delete tree;
-                } else {
-                    std::cerr << "Error: tree is not ultrametric. Exiting." << std::endl;
-                    exit(0);
-                }
+    trees.process(tw, [&] (Tree *& tree, const long& index, std::string& out) {
+        // in addition to checking ultramtericity, the following sets node heights
+        if (!is_ultrametric_paths(tree)) {
+            #pragma omp critical (bdfit_warning)
+            std::cerr << "Warning: tree " << index << " is not ultrametric. Skipping."
+                << std::endl;
+            return true;
+        }
+        BDFit bd(tree, model);
+        if (tableout) {
+            bd.get_table_row(index, out);
+        }
+        if (summaryout) {
+            std::vector<double> vals;
+            std::vector<bool> na;
+            bd.get_values(vals, na);
+            #pragma omp critical (bdfit_summary)
+            summary.add(vals, na);
+        }
+        if (!tableout && !summaryout) {
+            std::ostringstream oss;
+            if (index > 0) {
+                oss << std::endl; // blank line between trees
             }
+            bd.get_pars(&oss);
+            out = oss.str();
         }
+        return true;
+    }, false);
+    tw.flush();
+    if (summaryout) {
+        summary.write(poos);
     }
     
     if (outfileset) {
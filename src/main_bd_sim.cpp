@@ -3,13 +3,10 @@
 #include <vector>
 #include <string>
 #include <cstring>
+#include <algorithm>
 #include <getopt.h>
 
-#include "node.h"
-#include "tree_reader.h"
-#include "string_node_object.h"
-#include "vector_node_object.h"
-#include "tree.h"
+#include "tree_writer.h"
 #include "utils.h"
 #include "bd_sim.h"
 #include "log.h"
@@ -31,7 +28,11 @@ void print_help () {
     std::cout << " -n, --nreps=INT     number of replicates, default=1" << std::endl;
     std::cout << " -o, --outf=FILE     output file, STOUT otherwise" << std::endl;
     std::cout << " -s, --showextinct   show lineages that went extinct, default=false" << std::endl;
+    std::cout << " -r, --reconstructed draw extant-only trees from the reconstructed process" << std::endl;
+    std::cout << "                     directly (faster with extinction; requires -t)" << std::endl;
     std::cout << " -x, --seed=INT      random number seed, clock otherwise" << std::endl;
+    std::cout << "                     (each replicate is seeded from the seed and its number," << std::endl;
+    std::cout << "                     so trees differ from pxbdsim 1.1 for the same seed)" << std::endl;
     std::cout << " -h, --help          display this help and exit" << std::endl;
     std::cout << " -V, --version       display version and exit" << std::endl;
     std::cout << " -C, --citation      display phyx citation and exit" << std::endl;
@@ -51,6 +52,7 @@ static struct option const long_options[] =
     {"nreps", required_argument, NULL, 'n'},
     {"outf", required_argument, NULL, 'o'},
     {"showextinct", no_argument, NULL, 's'},
+    {"reconstructed", no_argument, NULL, 'r'},
     {"seed", required_argument, NULL, 'x'},
     {"help", no_argument, NULL, 'h'},
     {"version", no_argument, NULL, 'V'},
@@ -58,9 +60,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "e:t:b:d:n:o:x:srhVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool outfileset = false;
     bool timeset = false;
@@ -72,11 +76,12 @@ int main(int argc, char * argv[]) {
     double birth = 1.0;
     double death = 0.0;
     bool showd = false;
+    bool reconstructed = false;
     
     int seed = -1;
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "e:t:b:d:n:o:x:shVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -116,6 +121,9 @@ int main(int argc, char * argv[]) {
             case 's':
                 showd = true;
                 break;
+            case 'r':
+                reconstructed = true;
+                break;
             case 'h':
                 print_help();
                 exit(0);
@@ -139,6 +147,10 @@ int main(int argc, char * argv[]) {
         std::cerr << "Error: set -e or -t, not both. Exiting." << std::endl;
         exit(0);
     }
+    if (reconstructed && (!timeset || showd)) {
+        std::cerr << "Error: -r requires -t, and cannot be used with -s. Exiting." << std::endl;
+        exit(0);
+    }
     
      std::ostream * poos = NULL;
      std::ofstream * ofstr = NULL;
@@ -149,16 +161,47 @@ int main(int argc, char * argv[]) {
     } else {
         poos = &std::cout;
     }
+    TreeWriter tw(poos);
     
-    BirthDeathSimulator bd(ext, time, birth, death, seed);
-    for (int i = 0; i < nreps; i++) {
-        Tree * bdtr = bd.make_tree(showd);
-        if (bdtr->getExtantNodeCount() > 1) {
-            (*poos) << bdtr->getRoot()->getNewick(true) << ";" << std::endl;
-        } else {
-            (*poos) << "(" << bdtr->getRoot()->getNewick(true) << ");" << std::endl;
+    if (seed == -1) {
+        seed = (int)get_clock_seed();
+    }
+    
+    // replicates are simulated in parallel in batches, and written in order.
+    // each is seeded from (seed, replicate number). if a replicate fails, the
+    // ones before it are still written before quitting
+    const int batchsize = 64;
+    std::vector<std::string> trees(batchsize);
+    int maxfailures = 0;
+    for (int b0 = 0; b0 < nreps; b0 += batchsize) {
+        int nb = std::min(batchsize, nreps - b0);
+        int failed = nb; // first failed replicate of the batch
+        #pragma omp parallel
+        {
+            BirthDeathSimulator bd(ext, time, birth, death, reconstructed);
+            #pragma omp single
+            maxfailures = bd.get_max_failures();
+            #pragma omp for schedule(dynamic)
+            for (int b = 0; b < nb; b++) {
+                trees[b].clear();
+                bd.set_seed((unsigned int)seed, (unsigned int)(b0 + b));
+                if (!bd.append_tree(trees[b], showd)) {
+                    #pragma omp critical (bdsim_failed)
+                    failed = std::min(failed, b);
+                }
+            }
+        }
+        for (int b = 0; b < failed; b++) {
+            tw.write(trees[b]);
+        }
+        if (failed < nb) {
+            tw.flush();
+            std::cerr << "Error: reached maximum number of failures (" << maxfailures
+                << ") in replicate " << (b0 + failed + 1) << ". Exiting." << std::endl;
+            exit(0);
         }
     }
+    tw.flush();
     if (outfileset) {
         ofstr->close();
         delete poos;
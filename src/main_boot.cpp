@@ -55,9 +55,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "s:o:p:f:x:hVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool outfileset = false;
     bool fileset = false;
@@ -69,7 +71,7 @@ int main(int argc, char * argv[]) {
     int seed = -1;
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "s:o:p:f:x:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
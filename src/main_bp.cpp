@@ -9,6 +9,7 @@
 
 #include "tree.h"
 #include "tree_reader.h"
+#include "tree_utils.h"
 #include "utils.h"
 #include "log.h"
 #include "constants.h"
@@ -62,9 +63,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "t:o:m:c:vseufhVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool fileset = false;
     bool outfileset = false;
@@ -81,7 +84,7 @@ int main(int argc, char * argv[]) {
     double cutnum = 0;
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "t:o:m:c:vseufhVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -269,126 +272,8 @@ int main(int argc, char * argv[]) {
     std::vector<std::vector<int> > biparts2; // second part of the bipart
     std::vector<std::vector<int> > not_included; // the names that aren't in the tree
     std::vector<double> bp_count;
-    for (int i=0; i < numtrees; i++) {
-        //get the biparts
-        bool unrooted = false;
-        int numch = trees[i]->getRoot()->getChildCount();
-        if (numch > 2) {
-            unrooted = true;
-        }
-        std::vector<std::string> rt_nms = trees[i]->getRoot()->get_leave_names();
-        std::set<std::string> rt_nms_set;
-        copy(rt_nms.begin(), rt_nms.end(), inserter(rt_nms_set, rt_nms_set.begin()));
-        //get the ones that aren't in the tree at all
-        std::vector<std::string> not_included_nms(rt_nms_set.size());
-        std::vector<int> not_included_i;
-        std::vector<std::string>::iterator it2;
-        it2 = std::set_difference(names_s.begin(), names_s.end(), rt_nms_set.begin(),
-                rt_nms_set.end(), not_included_nms.begin());
-        not_included_nms.resize(it2-not_included_nms.begin());
-        for (unsigned int j=0; j < not_included_nms.size(); j++) {
-            std::cerr << " not included: "  << not_included_nms[j]<< std::endl;
-            not_included_i.push_back(name_index[not_included_nms[j]]);
-        }
-        std::vector<int> bp_count_tree; // for edgewise to make sure we don't double count
-        for (int j=0; j < trees[i]->getInternalNodeCount(); j++) {
-            std::vector<std::string> nms = trees[i]->getInternalNode(j)->get_leave_names();
-            //skip the root
-            if (nms.size() == rt_nms.size()) {
-                continue;
-            }
-            //if we are using a cutoff, skip the edge that is below the num
-            if (cutoff == true) {
-                if (trees[i]->getInternalNode(j)->getName().length() < 1) {
-                    continue;
-                }
-                char* pEnd;
-                double td = strtod(trees[i]->getInternalNode(j)->getName().c_str(),&pEnd) ;
-                if (td < cutnum) {
-                    continue;
-                }
-            }
-            //end using cutoffs
-            std::vector<int> nms_i;
-            std::set<std::string> nms_s;
-            copy(nms.begin(), nms.end(), inserter(nms_s, nms_s.begin()));
-            for (unsigned int k=0; k < nms.size(); k++) {
-                nms_i.push_back(name_index[nms[k]]);
-            }
-            sort(nms_i.begin(), nms_i.end());
-            //get the other side of the bipart
-            std::vector<int> nms_i2;
-            std::vector<std::string> nms_s2(rt_nms.size());
-            std::vector<std::string>::iterator it;
-            it = std::set_difference(rt_nms_set.begin(), rt_nms_set.end(), nms_s.begin(),
-                nms_s.end(), nms_s2.begin());
-            nms_s2.resize(it-nms_s2.begin());
-            for (unsigned int k=0; k < nms_s2.size(); k++) {
-                nms_i2.push_back(name_index[nms_s2[k]]);
-            }
-            sort(nms_i2.begin(), nms_i2.end());
-            //check to see if the bipart is new
-            if (edgewisealltaxa == false) {
-                //this is nodewise and we dont' assume we have all the taxa
-                if ((int)std::count(biparts.begin(), biparts.end(), nms_i) == 0 && 
-                (int)std::count(biparts2.begin(), biparts2.end(), nms_i2) == 0) {
-                    biparts.push_back(nms_i);
-                    biparts2.push_back(nms_i2);
-                    not_included.push_back(not_included_i);
-                    bp_count.push_back(1);
-                } else {
-                    //get index 
-                    size_t index = find(biparts.begin(), biparts.end(), nms_i)-biparts.begin();
-                    bp_count[index] += 1;
-                }
-                /*
-                 * do the otherside for unrooted
-                 */
-                if (unrooted==true && trees[i]->getInternalNode(j)->getParent()==trees[i]->getRoot()) {
-                    if ((int)std::count(biparts.begin(), biparts.end(), nms_i2) == 0 && 
-                        (int)std::count(biparts2.begin(), biparts2.end(), nms_i) == 0) {
-                        biparts.push_back(nms_i2);
-                        biparts2.push_back(nms_i);
-                        not_included.push_back(not_included_i);
-                        bp_count.push_back(1);
-                    } else {
-                        size_t index = find(biparts.begin(), biparts.end(), nms_i2)-biparts.begin();
-                        bp_count[index] += 1;
-                    }
-                }
-            } else {
-                //this is edgewise and we assume all the taxa 
-                //this is for reporting a b | c d instead of a b and c d separately
-                
-                //first check to make sure that both sides at least have two taxa
-                if (nms_i.size() < 2 || nms_i2.size() < 2) {
-                    continue;
-                }
-                if ((int)std::count(biparts.begin(), biparts.end(), nms_i) == 0 && 
-                    (int)std::count(biparts.begin(), biparts.end(), nms_i2) == 0) {
-                    biparts.push_back(nms_i);
-                    biparts2.push_back(nms_i2);
-                    not_included.push_back(not_included_i);
-                    bp_count.push_back(1);
-                    bp_count_tree.push_back(bp_count.size()-1);
-                } else {
-                    //get index 
-                    size_t index;
-                    if ((int)std::count(biparts.begin(), biparts.end(), nms_i) == 1) {
-                        index = find(biparts.begin(), biparts.end(), nms_i)-biparts.begin();
-                    } else {
-                        index = find(biparts.begin(), biparts.end(), nms_i2)-biparts.begin();
-                    }
-                    //need to accommodate that it can be reflected in the edgewise case
-                    if ((int)std::count(bp_count_tree.begin(), bp_count_tree.end(), index) == 0) {
-                        bp_count[index] += 1;
-                        bp_count_tree.push_back(index);
-                    }
-                }
-
-            }
-        }
-    }
+    count_bipartitions(trees, name_index, names_s, cutoff, cutnum, edgewisealltaxa,
+        biparts, biparts2, not_included, bp_count);
     if (suppress == false) {
         (*poos) << numtrees << " trees " <<  std::endl;
         (*poos) << biparts.size() << " unique clades found" << std::endl;
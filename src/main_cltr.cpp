@@ -10,6 +10,7 @@
 #include "tree_reader.h"
 #include "tree.h"
 #include "tree_utils.h"
+#include "tree_writer.h"
 #include "utils.h"
 #include "clean_tree.h"
 #include "log.h"
@@ -56,9 +57,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "t:rlo:x:hVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool outfileset = false;
     bool tfileset = false;
@@ -73,7 +76,7 @@ int main(int argc, char * argv[]) {
     
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "t:rlo:x:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -130,6 +133,7 @@ int main(int argc, char * argv[]) {
     } else {
         poos = &std::cout;
     }
+    TreeWriter tw(poos);
     if (tfileset == true) {
         fstr = new std::ifstream(treef);
         pios = fstr;
@@ -155,7 +159,7 @@ int main(int argc, char * argv[]) {
             tree = read_next_tree_from_stream_newick(*pios, retstring, &going);
             if (tree != NULL) {
                 CleanTree ct(tree);
-                (*poos) << getNewickString(tree) << std::endl;
+                tw.write_tree(tree);
                 delete tree;
             }
         }
@@ -169,12 +173,13 @@ int main(int argc, char * argv[]) {
                 &translation_table, &going);
             if (tree != NULL) {
                 CleanTree ct(tree);
-                (*poos) << getNewickString(tree) << std::endl;
+                tw.write_tree(tree);
                 delete tree;
             }
         }
     }
     
+    tw.flush();
     if (outfileset) {
         ofstr->close();
         delete poos;
@@ -9,6 +9,8 @@
 #include "utils.h"
 #include "tree_reader.h"
 #include "tree_utils.h"
+#include "tree_writer.h"
+#include "tree_stream.h"
 #include "collapse_tree.h"
 #include "log.h"
 #include "constants.h"
@@ -51,9 +53,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "t:l:s:o:hVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool outfileset = false;
     bool tfileset = false;
@@ -67,7 +71,7 @@ int main(int argc, char * argv[]) {
     
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "t:l:s:o:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -132,6 +136,7 @@ int main(int argc, char * argv[]) {
     } else {
         poos = &std::cout;
     }
+    TreeWriter tw(poos);
     
     Collapser tc (threshold);
     
@@ -139,43 +144,20 @@ int main(int argc, char * argv[]) {
         tc.set_sup_string(supstring);
     }
     
-    std::string retstring;
-    int ft = test_tree_filetype_stream(*pios, retstring);
+    TreeStream trees(pios);
+    int ft = trees.get_filetype();
     if (ft != 0 && ft != 1) {
         std::cerr << "Error: this really only works with nexus or newick. Exiting." << std::endl;
         exit(0);
     }
-    bool going = true;
-    if (ft == 1) {
-        Tree * tree;
-        while (going) {
-            tree = read_next_tree_from_stream_newick(*pios, retstring, &going);
-            if (going) {
-                tc.collapse_edges(tree);
-                (*poos) << getNewickString(tree) << std::endl;
-                delete tree;
-            }
-        }
-    } else if (ft == 0) { // Nexus. need to worry about possible translation tables
-        std::map<std::string, std::string> translation_table;
-        bool ttexists;
-        ttexists = get_nexus_translation_table(*pios, &translation_table, &retstring);
-        Tree * tree;
-        while (going) {
-            tree = read_next_tree_from_stream_nexus(*pios, retstring, ttexists,
-                &translation_table, &going);
-            if (tree != NULL) {
-                /*
-                if (!tree->hasNodeAnnotations()) {
-                    std::cout << "Dude. No annotations found in this tree. What are you even _doing_?!?" << std::endl;
-                }
-                */
-                (*poos) << getNewickString(tree) << std::endl;
-                delete tree;
-            }
-        }
-    }
+    // ordered: the support scale is guessed from the first value encountered
+    trees.process(tw, [&] (Tree *& tree, const long&, std::string& out) {
+        tc.collapse_edges(tree);
+        append_tree(out, tree);
+        return true;
+    }, true);
     
+    tw.flush();
     if (outfileset) {
         ofstr->close();
         delete poos;
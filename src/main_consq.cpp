@@ -19,12 +19,16 @@ void print_help() {
     std::cout << "Compute a consensus sequence from an alignment." << std::endl;
     std::cout << "This will take fasta, phylip, and nexus formats from a file or STDIN." << std::endl;
     std::cout << "Results are written in fasta format." << std::endl;
+    std::cout << "By default the consensus at each site codes for every state present (union)." << std::endl;
     std::cout << std::endl;
     std::cout << "Usage: pxconsq [OPTIONS]..." << std::endl;
     std::cout << std::endl;
     std::cout << "Options:" << std::endl;
     std::cout << " -s, --seqf=FILE     input sequence file, STDIN otherwise" << std::endl;
     std::cout << " -o, --outf=FILE     output sequence file, STOUT otherwise" << std::endl;
+    std::cout << " -m, --majority      majority-rule consensus (most frequent state(s))" << std::endl;
+    std::cout << " -t, --threshold=NUM most frequent states that together reach" << std::endl;
+    std::cout << "                       frequency NUM (0 < NUM <= 1)" << std::endl;
     std::cout << " -h, --help          display this help and exit" << std::endl;
     std::cout << " -V, --version       display version and exit" << std::endl;
     std::cout << " -C, --citation      display phyx citation and exit" << std::endl;
@@ -39,23 +43,29 @@ static struct option const long_options[] =
 {
     {"seqf", required_argument, NULL, 's'},
     {"outf", required_argument, NULL, 'o'},
+    {"majority", no_argument, NULL, 'm'},
+    {"threshold", required_argument, NULL, 't'},
     {"help", no_argument, NULL, 'h'},
     {"version", no_argument, NULL, 'V'},
     {"citation", no_argument, NULL, 'C'},
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "s:o:mt:hVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool fileset = false;
     bool outfileset = false;
     char * seqf = NULL;
     char * outf = NULL;
+    consensusMode mode = CONS_UNION;
+    double threshold = 1.0;
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "s:o:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -69,6 +79,17 @@ int main(int argc, char * argv[]) {
                 outfileset = true;
                 outf = strdup(optarg);
                 break;
+            case 'm':
+                mode = CONS_MAJORITY;
+                break;
+            case 't':
+                mode = CONS_THRESHOLD;
+                threshold = string_to_float(optarg, "-t");
+                if (threshold <= 0.0 || threshold > 1.0) {
+                    std::cerr << "Error: threshold must be 0 < t <= 1. Exiting." << std::endl;
+                    exit(0);
+                }
+                break;
             case 'h':
                 print_help();
                 exit(0);
@@ -113,7 +134,7 @@ int main(int argc, char * argv[]) {
     std::string alphaName = "";
     std::vector<Sequence> seqs = ingest_alignment(pios, alphaName);
     
-    std::string rets = consensus_seq(seqs, alphaName);
+    std::string rets = consensus_seq(seqs, alphaName, mode, threshold);
 
     (*poos) << ">consensus" << std::endl;
     (*poos) << rets << std::endl;
@@ -53,9 +53,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "c:t:o:a:hVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool cfileset = false;
     bool tfileset = false;
@@ -67,7 +69,7 @@ int main(int argc, char * argv[]) {
     int analysis = 0;
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "c:t:o:a:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
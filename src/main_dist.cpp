@@ -0,0 +1,156 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <getopt.h>
+
+#include "dist_matrix.h"
+#include "utils.h"
+#include "sequence.h"
+#include "seq_reader.h"
+#include "log.h"
+#include "constants.h"
+
+extern std::string PHYX_CITATION;
+
+
+void print_help() {
+    std::cout << "Calculate pairwise distances between aligned sequences." << std::endl;
+    std::cout << "This will take fasta, fastq, phylip, and nexus formats from a file or STDIN." << std::endl;
+    std::cout << "Results are written as a square phylip distance matrix." << std::endl;
+    std::cout << std::endl;
+    std::cout << "Usage: pxdist [OPTIONS]..." << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << " -s, --seqf=FILE     input sequence file, STDIN otherwise" << std::endl;
+    std::cout << " -m, --model=STR     distance model, default=p. one of:" << std::endl;
+    std::cout << "                       - hamming: number of differing characters" << std::endl;
+    std::cout << "                       - p: proportion of differing sites" << std::endl;
+    std::cout << "                       - jc69, k2p, logdet: corrected distances (DNA only)" << std::endl;
+    std::cout << " -c, --complete      ignore sites with gaps/missing/ambiguous characters in any" << std::endl;
+    std::cout << "                       sequence (default: only in the pair being compared)" << std::endl;
+    std::cout << " -o, --outf=FILE     output matrix file, STOUT otherwise" << std::endl;
+    std::cout << " -h, --help          display this help and exit" << std::endl;
+    std::cout << " -V, --version       display version and exit" << std::endl;
+    std::cout << " -C, --citation      display phyx citation and exit" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Report bugs to: <https://github.com/FePhyFoFum/phyx/issues>" << std::endl;
+    std::cout << "phyx home page: <https://github.com/FePhyFoFum/phyx>" << std::endl;
+}
+
+std::string versionline("pxdist 1.1\nCopyright (C) 2020 FePhyFoFum\nLicense GPLv3\nWritten by FePhyFoFum");
+
+static struct option const long_options[] =
+{
+    {"seqf", required_argument, NULL, 's'},
+    {"model", required_argument, NULL, 'm'},
+    {"complete", no_argument, NULL, 'c'},
+    {"outf", required_argument, NULL, 'o'},
+    {"help", no_argument, NULL, 'h'},
+    {"version", no_argument, NULL, 'V'},
+    {"citation", no_argument, NULL, 'C'},
+    {NULL, 0, NULL, 0}
+};
+
+static const char * const short_options = "s:m:co:hVC";
+
+int main(int argc, char * argv[]) {
+    
+    log_call(argc, argv, short_options, long_options);
+    
+    bool fileset = false;
+    bool outfileset = false;
+    bool complete_deletion = false;
+    char * seqf = NULL;
+    char * outf = NULL;
+    distModel model = DIST_P;
+    
+    while (1) {
+        int oi = -1;
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
+        if (c == -1) {
+            break;
+        }
+        switch(c) {
+            case 's':
+                fileset = true;
+                seqf = strdup(optarg);
+                check_file_exists(seqf);
+                break;
+            case 'm':
+                if (!get_dist_model(optarg, model)) {
+                    std::cerr << "Error: distance model '" << optarg
+                        << "' not recognized. Exiting." << std::endl;
+                    exit(0);
+                }
+                break;
+            case 'c':
+                complete_deletion = true;
+                break;
+            case 'o':
+                outfileset = true;
+                outf = strdup(optarg);
+                break;
+            case 'h':
+                print_help();
+                exit(0);
+            case 'V':
+                std::cout << versionline << std::endl;
+                exit(0);
+            case 'C':
+                std::cout << PHYX_CITATION << std::endl;
+                exit(0);
+            default:
+                print_error(argv[0], (char)c);
+                exit(0);
+        }
+    }
+    
+    if (fileset && outfileset) {
+        check_inout_streams_identical(seqf, outf);
+    }
+    
+    std::ostream * poos = NULL;
+    std::ofstream * ofstr = NULL;
+    std::istream * pios = NULL;
+    std::ifstream * fstr = NULL;
+    
+    if (outfileset == true) {
+        ofstr = new std::ofstream(outf);
+        poos = ofstr;
+    } else {
+        poos = &std::cout;
+    }
+    if (fileset == true) {
+        fstr = new std::ifstream(seqf);
+        pios = fstr;
+    } else {
+        pios = &std::cin;
+        if (check_for_input_to_stream() == false) {
+            print_help();
+            exit(1);
+        }
+    }
+    
+    std::string alpha_name = "";
+    std::vector<Sequence> seqs = ingest_alignment(pios, alpha_name);
+    DistanceMatrix dm(seqs, alpha_name, model, complete_deletion);
+    if (dm.get_num_undefined() > 0) {
+        std::cerr << "Warning: " << dm.get_num_undefined() << " pairwise distance(s) are "
+            << "undefined under this model (saturated or no comparable sites). Written as NA."
+            << std::endl;
+    }
+    dm.write_phylip(poos);
+    
+    if (outfileset) {
+        ofstr->close();
+        delete poos;
+    }
+    if (fileset) {
+        fstr->close();
+        delete pios;
+    }
+    
+    return EXIT_SUCCESS;
+}
@@ -6,7 +6,7 @@
 
 #include "utils.h"
 #include "seq_reader.h"
-#include "sequence.h"
+#include "fq_filt.h"
 #include "log.h"
 #include "constants.h"
 
@@ -15,14 +15,20 @@ extern std::string PHYX_CITATION;
 
 void print_help() {
     std::cout << "Filter fastq files by mean quality." << std::endl;
+    std::cout << "Optionally also filter by minimum base quality, sliding window mean quality," << std::endl;
+    std::cout << "and/or maximum expected errors." << std::endl;
     std::cout << "Data can be read from a file or STDIN." << std::endl;
     std::cout << std::endl;
     std::cout << "Usage: pxfqfilt [OPTIONS]..." << std::endl;
     std::cout << std::endl;
     std::cout << "Options:" << std::endl;
     std::cout << " -m, --mean=VALUE    mean value under which seqs are filtered" << std::endl;
+    std::cout << " -q, --minqual=INT   minimum quality allowed at any base" << std::endl;
+    std::cout << " -w, --window=INT    size of sliding window; every window must exceed -m" << std::endl;
+    std::cout << " -e, --maxee=VALUE   maximum number of expected errors in a read" << std::endl;
     std::cout << " -s, --seqf=FILE     input sequence file, STDIN otherwise" << std::endl;
     std::cout << " -o, --outf=FILE     output sequence file, STOUT otherwise" << std::endl;
+    std::cout << " -v, --verbose       make the output more verbose" << std::endl;
     std::cout << " -h, --help          display this help and exit" << std::endl;
     std::cout << " -V, --version       display version and exit" << std::endl;
     std::cout << " -C, --citation      display phyx citation and exit" << std::endl;
@@ -36,26 +42,36 @@ std::string versionline("pxfqfilt 1.1\nCopyright (C) 2013-2020 FePhyFoFum\nLicen
 static struct option const long_options[] =
 {
     {"mean", required_argument, NULL, 'm'},
+    {"minqual", required_argument, NULL, 'q'},
+    {"window", required_argument, NULL, 'w'},
+    {"maxee", required_argument, NULL, 'e'},
     {"seqf", required_argument, NULL, 's'},
     {"outf", required_argument, NULL, 'o'},
+    {"verbose", no_argument, NULL, 'v'},
     {"help", no_argument, NULL, 'h'},
     {"version", no_argument, NULL, 'V'},
     {"citation", no_argument, NULL, 'C'},
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "m:q:w:e:s:o:vhVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     double meanfilt = 30;
+    int minqual = -1;
+    int window = 0;
+    double maxee = -1.0;
+    bool verbose = false;
     bool fileset = false;
     bool outfileset = false;
     char * seqf = NULL;
     char * outf = NULL;
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "m:s:o:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -63,6 +79,23 @@ int main(int argc, char * argv[]) {
             case 'm':
                 meanfilt = string_to_float(optarg, "-m");
                 break;
+            case 'q':
+                minqual = string_to_int(optarg, "-q");
+                break;
+            case 'w':
+                window = string_to_int(optarg, "-w");
+                if (window < 1) {
+                    std::cerr << "Error: window size must be >= 1. Exiting." << std::endl;
+                    exit(0);
+                }
+                break;
+            case 'e':
+                maxee = string_to_float(optarg, "-e");
+                if (maxee < 0.0) {
+                    std::cerr << "Error: maximum expected errors must be >= 0. Exiting." << std::endl;
+                    exit(0);
+                }
+                break;
             case 's':
                 fileset = true;
                 seqf = strdup(optarg);
@@ -72,6 +105,9 @@ int main(int argc, char * argv[]) {
                 outfileset = true;
                 outf = strdup(optarg);
                 break;
+            case 'v':
+                verbose = true;
+                break;
             case 'h':
                 print_help();
                 exit(0);
@@ -91,7 +127,6 @@ int main(int argc, char * argv[]) {
         check_inout_streams_identical(seqf, outf);
     }
     
-    Sequence seq;
     std::string retstring;
     
     std::istream * pios = NULL;
@@ -123,11 +158,11 @@ int main(int argc, char * argv[]) {
         exit(1);
     }
     
-    while (read_next_seq_from_stream(*pios, ft, retstring, seq)) {
-        double mean = seq.get_qualarr_mean();
-        if (mean > meanfilt) {
-            (*poos) << seq.get_fastq();
-        }
+    FastqFilter ff(meanfilt, minqual, window, maxee);
+    ff.filter_stream(*pios, retstring, poos);
+    if (verbose) {
+        std::cerr << "Retained " << ff.get_num_passed() << " of " << ff.get_num_reads()
+            << " reads." << std::endl;
     }
     
     if (fileset == true) {
@@ -30,9 +30,12 @@ void print_help() {
     std::cout << " -o, --outf=FILE     output file, STOUT otherwise" << std::endl;
     std::cout << " -b, --burnin=INT    number of samples to exclude at the beginning of a file" << std::endl;
     std::cout << " -n, --thin=INT      interval of resampling" << std::endl;
-    std::cout << " -r, --rand=INT      number of random samples (without replacement) not yet implemented!" << std::endl;
+    std::cout << " -r, --rand=INT      number of random samples (without replacement)" << std::endl;
     std::cout << " -i, --info          calculate log file attributes and exit" << std::endl;
     std::cout << " -c, --columns       print out column names (parameter logs only)" << std::endl;
+    std::cout << " -s, --summary       summarize (mean, sd, median, 95% HPD, ESS) each variable" << std::endl;
+    std::cout << "                     after burnin/thinning. combine with -k to restrict columns" << std::endl;
+    std::cout << "                     (parameter logs only)" << std::endl;
     std::cout << " -d, --delete=CSL    delete columns by 1-index sep by commas (NO SPACES!) (parameter logs only)" << std::endl;
     std::cout << " -k, --keep=CSL      keep only columns by 1-index sep by commas (NO SPACES!) (parameter logs only)" << std::endl;
     std::cout << " -x, --seed=INT      random number seed, clock otherwise" << std::endl;
@@ -57,6 +60,7 @@ static struct option const long_options[] =
     {"rand", required_argument, NULL, 'r'},
     {"info", no_argument, NULL, 'i'},
     {"columns", no_argument, NULL, 'c'},
+    {"summary", no_argument, NULL, 's'},
     {"delete", required_argument, NULL, 'd'},
     {"keep", required_argument, NULL, 'k'},
     {"seed", required_argument, NULL, 'x'},
@@ -67,9 +71,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "p:t:o:b:n:r:icsd:k:x:vhVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool outfileset = false;
     bool pfileset = false;
@@ -84,6 +90,7 @@ int main(int argc, char * argv[]) {
     bool verbose = false;
     bool count = false;
     bool get_columns = false;
+    bool summarize = false;
     bool delete_columns = false;
     bool keep_columns = false;
     std::string incolids;
@@ -94,7 +101,7 @@ int main(int argc, char * argv[]) {
     while (1) {
         int oi = -1;
         int curind = optind;
-        int c = getopt_long(argc, argv, "p:t:o:b:n:r:icd:k:x:vhVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -162,6 +169,9 @@ int main(int argc, char * argv[]) {
             case 'c':
                 get_columns = true;
                 break;
+            case 's':
+                summarize = true;
+                break;
             case 'd':
                 delete_columns = true;
                 incolids = strdup(optarg);
@@ -214,12 +224,22 @@ int main(int argc, char * argv[]) {
     
     // abort if invalid args
     if (tfileset) {
-        if (get_columns || delete_columns || keep_columns) {
+        if (get_columns || delete_columns || keep_columns || summarize) {
             std::cerr << "Error: column arguments are not applicable for tree files. Exiting." << std::endl;
             exit(0);
         }
     }
     
+    if (nthin < 1) {
+        std::cerr << "Error: thinning interval must be >= 1. Exiting." << std::endl;
+        exit(0);
+    }
+    
+    if (summarize && delete_columns) {
+        std::cerr << "Error: use -k (not -d) to select columns to summarize. Exiting." << std::endl;
+        exit(0);
+    }
+    
     // exit if not 1-indexed (just check first column
     if (delete_columns || keep_columns) {
         if (col_indices[0] < 1) {
@@ -241,6 +261,8 @@ int main(int argc, char * argv[]) {
     if (count) {
         lm.count();
         lm.get_sample_counts();
+    } else if (summarize) {
+        lm.summarize(burnin, nthin, nrandom, seed, col_indices);
     } else if (get_columns) {
         lm.get_column_names();
     } else if (delete_columns)  {
@@ -4,11 +4,15 @@
 #include <string>
 #include <map>
 #include <cstring>
+#include <sstream>
 #include <getopt.h>
 
 #include "tree_info.h"
+#include "stat_summary.h"
 #include "tree_reader.h"
 #include "tree.h"
+#include "tree_writer.h"
+#include "tree_stream.h"
 #include "utils.h"
 #include "log.h"
 #include "constants.h"
@@ -33,6 +37,8 @@ void print_help() {
     std::cout << " -l, --length        return the length of the tree" << std::endl;
     std::cout << " -i, --tiplabels     return all tip labels (one per line)" << std::endl;
     std::cout << " -v, --rtvar         return root-to-tip variance" << std::endl;
+    std::cout << " -T, --table         return all properties as a table (one row per tree)" << std::endl;
+    std::cout << " -s, --summary       return mean and quantiles of each property across trees" << std::endl;
     std::cout << " -o, --outf=FILE     output tree stats file, STOUT otherwise" << std::endl;
     std::cout << " -h, --help          display this help and exit" << std::endl;
     std::cout << " -V, --version       display version and exit" << std::endl;
@@ -55,6 +61,8 @@ static struct option const long_options[] =
     {"length", no_argument, NULL, 'l'},
     {"tiplabels", no_argument, NULL, 'i'},
     {"rtvar", no_argument, NULL, 'v'},
+    {"table", no_argument, NULL, 'T'},
+    {"summary", no_argument, NULL, 's'},
     {"outf", required_argument, NULL, 'o'},
     {"help", no_argument, NULL, 'h'},
     {"version", no_argument, NULL, 'V'},
@@ -62,9 +70,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "t:vranubliTso:x:hVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool outfileset = false;
     bool fileset = false;
@@ -77,12 +87,14 @@ int main(int argc, char * argv[]) {
     bool ntipcheck = false;
     bool namecheck = false;
     bool rtvarcheck = false;
+    bool tableout = false;
+    bool summaryout = false;
     char * outf = NULL;
     char * treef = NULL;
     
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "t:vranublio:x:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -124,6 +136,12 @@ int main(int argc, char * argv[]) {
                 rtvarcheck = true;
                 optionsset = true;
                 break;
+            case 'T':
+                tableout = true;
+                break;
+            case 's':
+                summaryout = true;
+                break;
             case 'o':
                 outfileset = true;
                 outf = strdup(optarg);
@@ -151,7 +169,11 @@ int main(int argc, char * argv[]) {
         std::cerr << "Error: specify 1 property only (or leave blank to show all properties). Exiting." << std::endl;
         exit(0);
     }
-
+    if (optionsset && (tableout || summaryout)) {
+        std::cerr << "Error: a single property cannot be combined with -T or -s. Exiting." << std::endl;
+        exit(0);
+    }
+    
     std::istream * pios = NULL;
     std::ostream * poos = NULL;
     std::ifstream * fstr = NULL;
@@ -175,56 +197,55 @@ int main(int argc, char * argv[]) {
         }
     }
 
-    std::string retstring;
-    int ft = test_tree_filetype_stream(*pios, retstring);
+    TreeWriter tw(poos);
+    
+    TreeStream trees(pios);
+    int ft = trees.get_filetype();
     if (ft != 0 && ft != 1) {
         std::cerr << "Error: this really only works with nexus or newick. Exiting." << std::endl;
         exit(0);
     }
     
-    int treeCounter = 0;
-    bool going = true;
-    if (ft == 1) {
-        Tree * tree;
-        while (going) {
-            tree = read_next_tree_from_stream_newick(*pios, retstring, &going);
-            if (tree != NULL) {
-                if (!optionsset) {
-                    (*poos) << "tree #: " << treeCounter << std::endl;
-                    TreeInfo ti(tree);
-                    ti.get_stats(poos);
-                    delete tree;
-                    treeCounter++;
-                } else {
-                    // only a single property
-                    TreeInfo ti(tree, ultracheck, binarycheck, agecheck, rootedcheck,
-                        ntipcheck, lengthcheck, namecheck, rtvarcheck, poos);
-                }
+    // trees are summarized in parallel; output keeps the input order
+    StatSummary summary(TreeInfo::get_stat_names());
+    if (tableout) {
+        tw.write(TreeInfo::get_table_header());
+    }
+    trees.process(tw, [&] (Tree *& tree, const long& index, std::string& out) {
+        std::ostringstream oss;
+        if (optionsset) {
+            // only a single property
+            TreeInfo ti(tree, ultracheck, binarycheck, agecheck, rootedcheck,
+                ntipcheck, lengthcheck, namecheck, rtvarcheck, &oss);
+        } else if (tableout || summaryout) {
+            TreeInfo ti(tree);
+            if (tableout) {
+                ti.get_table_row(index, out);
             }
-        }
-    } else if (ft == 0) { // Nexus. need to worry about possible translation tables
-        std::map<std::string, std::string> translation_table;
-        bool ttexists;
-        ttexists = get_nexus_translation_table(*pios, &translation_table, &retstring);
-        Tree * tree;
-        while (going) {
-            tree = read_next_tree_from_stream_nexus(*pios, retstring, ttexists,
-                &translation_table, &going);
-            if (tree != NULL) {
-                if (!optionsset) {
-                    (*poos) << "tree #: " << treeCounter << std::endl;
-                    TreeInfo ti(tree);
-                    ti.get_stats(poos);
-                    delete tree;
-                    treeCounter++;
-                } else {
-                    // only a single property
-                    TreeInfo ti(tree, ultracheck, binarycheck, agecheck, rootedcheck,
-                        ntipcheck, lengthcheck, namecheck, rtvarcheck, poos);
-                }
+            if (summaryout) {
+                std::vector<double> vals;
+                std::vector<bool> na;
+                ti.get_values(vals, na);
+                #pragma omp critical (lstr_summary)
+                summary.add(vals, na);
             }
+            return true;
+        } else {
+            oss << "tree #: " << index << std::endl;
+            TreeInfo ti(tree);
+            ti.get_stats(&oss);
         }
+        out = oss.str();
+        return true;
+    }, false);
+    tw.flush();
+    if (summaryout) {
+        summary.write(poos);
     }
     
+    if (outfileset) {
+        ofstr->close();
+        delete poos;
+    }
     return EXIT_SUCCESS;
 }
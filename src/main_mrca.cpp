@@ -10,6 +10,9 @@
 #include "string_node_object.h"
 #include "vector_node_object.h"
 #include "tree.h"
+#include "tree_writer.h"
+#include "tree_stream.h"
+#include "mrca_query.h"
 #include "utils.h"
 #include "log.h"
 #include "constants.h"
@@ -49,9 +52,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "t:o:m:hVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     char * outf = NULL;
     char * treef = NULL;
@@ -62,7 +67,7 @@ int main(int argc, char * argv[]) {
     
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "t:o:m:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -115,6 +120,7 @@ int main(int argc, char * argv[]) {
     } else {
         poos = &std::cout;
     }
+    TreeWriter tw(poos);
     if (fileset == true) {
         fstr = new std::ifstream(treef);
         pios = fstr;
@@ -126,69 +132,45 @@ int main(int argc, char * argv[]) {
         }
     }
     
-    std::ifstream inmrca(mrcaf);
-    std::string mrcaline;
-    std::map<std::string, std::vector<std::string> > mrcas;
-    while (getline(inmrca, mrcaline)) {
-        if (mrcaline.empty()) {
-            continue;
-        }
-        std::vector<std::string> searchtokens;
-        tokenize(mrcaline, searchtokens, "=");
-        std::string mrcaname = searchtokens[0];
-        trim_spaces(mrcaname);
-        searchtokens.erase(searchtokens.begin());
-        searchtokens = tokenize(searchtokens[0]);
-        mrcas[mrcaname] = searchtokens;
-    }
-    inmrca.close();
+    MRCAQuery query(mrcaf);
     
-    std::string retstring;
-    int ft = test_tree_filetype_stream(*pios, retstring);
+    TreeStream trees(pios);
+    int ft = trees.get_filetype();
     if (ft != 0 && ft != 1) {
         std::cerr << "Error: this really only works with nexus or newick. Exiting." << std::endl;
         exit(0);
     }
-    
-    bool going = true;
-    std::map<std::string, std::vector<std::string> >::iterator it;
-    
-    if (ft == 1) {
-        Tree * tree;
-        while (going) {
-            tree = read_next_tree_from_stream_newick(*pios, retstring, &going);
-            if (tree != NULL) {
-                for (it=mrcas.begin(); it != mrcas.end(); it++) {
-                    Node * nd = tree->getMRCA((*it).second);
-                    (*poos) << (*it).first << " " << nd->get_num_leaves() << " "
-                        << nd->getName() << std::endl;
-                }
-                delete tree;
+    long failed = -1;
+    std::string failed_taxa;
+    trees.process(tw, [&] (Tree *& tree, const long& index, std::string& out) {
+        std::vector<Node *> mrcas;
+        std::vector<int> nleaves;
+        std::string missing;
+        if (!query.find_mrcas(tree, mrcas, nleaves, missing)) {
+            // only the first failed tree is reported, once the stream has stopped
+            #pragma omp critical (mrca_missing)
+            if (failed < 0 || index < failed) {
+                failed = index;
+                failed_taxa = missing;
             }
+            return false;
         }
-    } else if (ft == 0) { // Nexus. need to worry about possible translation tables
-        std::map<std::string, std::string> translation_table;
-        bool ttexists;
-        ttexists = get_nexus_translation_table(*pios, &translation_table, &retstring);
-        Tree * tree;
-        while (going) {
-            tree = read_next_tree_from_stream_nexus(*pios, retstring, ttexists,
-                &translation_table, &going);
-            if (tree != NULL) {
-                for (it=mrcas.begin(); it != mrcas.end(); it++) {
-                    Node * nd = tree->getMRCA((*it).second);
-                    (*poos) << (*it).first << " " << nd->get_num_leaves() << " "
-                        << nd->getName() << std::endl;
-                }
-                delete tree;
-            }
+        for (int i = 0; i < query.get_num_clades(); i++) {
+            out += query.get_name(i) + " " + std::to_string(nleaves[i])
+                + " " + mrcas[i]->getName() + "\n";
         }
-    }
+        return true;
+    }, false);
     
     if (fileset) {
         fstr->close();
         delete pios;
     }
+    tw.flush();
+    if (trees.aborted()) {
+        std::cerr << failed_taxa << "Error: check mrca file for typos. Exiting." << std::endl;
+        exit(0);
+    }
     if (outfileset) {
         ofstr->close();
         delete poos;
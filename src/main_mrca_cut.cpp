@@ -12,6 +12,9 @@
 #include "tree.h"
 #include "utils.h"
 #include "tree_utils.h"
+#include "tree_writer.h"
+#include "tree_stream.h"
+#include "mrca_query.h"
 #include "log.h"
 #include "constants.h"
 
@@ -52,11 +55,12 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "t:o:m:hVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
-    TreeReader tr;
     char * outf = NULL;
     char * treef = NULL;
     char * mrcaf = NULL;
@@ -66,7 +70,7 @@ int main(int argc, char * argv[]) {
     
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "t:o:m:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -119,6 +123,7 @@ int main(int argc, char * argv[]) {
     } else {
         poos = &std::cout;
     }
+    TreeWriter tw(poos);
     if (fileset == true) {
         fstr = new std::ifstream(treef);
         pios = fstr;
@@ -135,64 +140,45 @@ int main(int argc, char * argv[]) {
        expecting (new) format:
        MRCANAME = tip1 tip2 ... 
     */
-    std::ifstream inmrca(mrcaf);
-    std::string mrcaline;
-    std::map<std::string, std::vector<std::string> > mrcas;
-    while (getline(inmrca, mrcaline)) {
-        if (mrcaline.empty()) {
-            continue;
-        }
-        std::vector<std::string> searchtokens;
-        tokenize(mrcaline, searchtokens, "=");
-        std::string mrcaname = searchtokens[0];
-        trim_spaces(mrcaname);
-        searchtokens.erase(searchtokens.begin());
-        searchtokens = tokenize(searchtokens[0]);
-        mrcas[mrcaname] = searchtokens;
-    }
-    inmrca.close();
-    
-    
-    
-    
-    // this does not use the conventional tree reader functions
-    // update this
-    
-    
-    
+    MRCAQuery query(mrcaf);
     
-    
-    
-    // collect tree(s)
-    std::vector<std::string> lines;
-    std::string line;
-    while (getline(*pios, line)) {
-        lines.push_back(line);
+    TreeStream trees(pios);
+    int ft = trees.get_filetype();
+    if (ft != 0 && ft != 1) {
+        std::cerr << "Error: this really only works with nexus or newick. Exiting." << std::endl;
+        exit(0);
     }
-    
-    for (unsigned int i = 0; i < lines.size(); i++) {
-        Tree * tree = tr.readTree(lines[i]);
-        //std::cout << tree->getExternalNodeCount() << std::endl;
-
-        std::map<std::string, std::vector<std::string> >::iterator it;
-        for (it = mrcas.begin(); it != mrcas.end(); it++) {
-            //std::cout << "Dealing with clade '" << (*it).first << "'" << std::endl;
-            if (!check_names_against_tree(tree, (*it).second)) {
-                // allow more flexibility here
-                std::cerr << "Error: check mrca file for typos. Exiting." << std::endl;
-                exit(0);
+    long failed = -1;
+    std::string failed_taxa;
+    trees.process(tw, [&] (Tree *& tree, const long& index, std::string& out) {
+        std::vector<Node *> mrcas;
+        std::string missing;
+        if (!query.find_mrcas(tree, mrcas, missing)) {
+            // only the first failed tree is reported, once the stream has stopped
+            #pragma omp critical (mrca_missing)
+            if (failed < 0 || index < failed) {
+                failed = index;
+                failed_taxa = missing;
             }
-            Node * nd = tree->getMRCA((*it).second);
-            bool bl = has_branchlengths(tree);
-            (*poos) << nd->getNewick(bl) << ";" << std::endl;
+            return false;
         }
-        delete tree;
-    }
+        bool bl = has_branchlengths(tree);
+        for (int i = 0; i < query.get_num_clades(); i++) {
+            append_newick(out, mrcas[i], bl);
+            out += ";\n";
+        }
+        return true;
+    }, false);
     
     if (fileset) {
         fstr->close();
         delete pios;
     }
+    tw.flush();
+    if (trees.aborted()) {
+        std::cerr << failed_taxa << "Error: check mrca file for typos. Exiting." << std::endl;
+        exit(0);
+    }
     if (outfileset) {
         ofstr->close();
         delete poos;
@@ -17,6 +17,9 @@
 #include "tree.h"
 #include "utils.h"
 #include "tree_utils.h"
+#include "tree_writer.h"
+#include "tree_stream.h"
+#include "mrca_query.h"
 #include "log.h"
 #include "constants.h"
 
@@ -58,10 +61,12 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "t:o:m:hVC";
+
 
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     //TreeReader tr;
     char * outf = NULL;
@@ -73,7 +78,7 @@ int main(int argc, char * argv[]) {
     
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "t:o:m:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -126,6 +131,7 @@ int main(int argc, char * argv[]) {
     } else {
         poos = &std::cout;
     }
+    TreeWriter tw(poos);
     if (fileset == true) {
         fstr = new std::ifstream(treef);
         pios = fstr;
@@ -137,106 +143,61 @@ int main(int argc, char * argv[]) {
         }
     }
     
-    /* 
-       collect clade names
-       expecting (new) format:
-       MRCANAME = tip1 tip2 ... 
-    */
-    std::map<std::string, std::vector<std::string> > mrcas;
+    MRCAQuery * query = NULL;
     if (mrcaset) {
-        std::ifstream inmrca(mrcaf);
-        std::string mrcaline;
-        while (getline(inmrca, mrcaline)) {
-            if (mrcaline.empty()) {
-                continue;
-            }
-            std::vector<std::string> searchtokens;
-            tokenize(mrcaline, searchtokens, "=");
-            std::string mrcaname = searchtokens[0];
-            trim_spaces(mrcaname);
-            searchtokens.erase(searchtokens.begin());
-            searchtokens = tokenize(searchtokens[0]);
-            mrcas[mrcaname] = searchtokens;
-        }
-        inmrca.close();
+        query = new MRCAQuery(mrcaf);
     }
     
-// collect tree(s)
-    std::string retstring;
-    int ft = test_tree_filetype_stream(*pios, retstring);
+    TreeStream trees(pios);
+    int ft = trees.get_filetype();
     if (ft != 0 && ft != 1) {
         std::cerr << "Error: this really only works with nexus or newick. Exiting." << std::endl;
         exit(0);
     }
-    
+    // the px labels are numbered across trees, so that mode runs in order
     int count = 0;
-    bool going = true;
-    if (ft == 1) {
-        Tree * tree;
-        while (going) {
-            tree = read_next_tree_from_stream_newick(*pios, retstring, &going);
-            if (going) {
-                if (mrcaset) {
-                    std::map<std::string, std::vector<std::string> >::iterator it;
-                    for (it = mrcas.begin(); it != mrcas.end(); it++) {
-                        //std::cout << "Dealing with clade '" << (*it).first << "'" << std::endl;
-                        if (!check_names_against_tree(tree, (*it).second)) {
-                            std::cerr << "Error: check mrca file for typos. Exiting." << std::endl;
-                            exit(0);
-                        }
-                        Node * nd = tree->getMRCA((*it).second);
-                        nd->setName((*it).first);
-                    }
-                } else {
-                    for (int i=0; i<tree->getInternalNodeCount();i++) {
-                        if (tree->getInternalNode(i)->getName().size() == 0) {
-                            tree->getInternalNode(i)->setName("px"+std::to_string(count));
-                            count ++;
-                        }
-                    }
+    long failed = -1;
+    std::string failed_taxa;
+    trees.process(tw, [&] (Tree *& tree, const long& index, std::string& out) {
+        if (mrcaset) {
+            std::vector<Node *> mrcas;
+            std::string missing;
+            if (!query->find_mrcas(tree, mrcas, missing)) {
+                // only the first failed tree is reported, once the stream has stopped
+                #pragma omp critical (mrca_missing)
+                if (failed < 0 || index < failed) {
+                    failed = index;
+                    failed_taxa = missing;
                 }
-                (*poos) << getNewickString(tree) << std::endl;
-                delete tree;
+                return false;
             }
-        }
-    } else {
-        std::map<std::string, std::string> translation_table;
-        bool ttexists;
-        ttexists = get_nexus_translation_table(*pios, &translation_table, &retstring);
-        Tree * tree;
-        while (going) {
-            tree = read_next_tree_from_stream_nexus(*pios, retstring, ttexists,
-                &translation_table, &going);
-            if (tree != NULL) {
-                if (mrcaset) {
-                    std::map<std::string, std::vector<std::string> >::iterator it;
-                    for (it = mrcas.begin(); it != mrcas.end(); it++) {
-                        //std::cout << "Dealing with clade '" << (*it).first << "'" << std::endl;
-                        if (!check_names_against_tree(tree, (*it).second)) {
-                            std::cerr << "Error: check mrca file for typos. Exiting." << std::endl;
-                            exit(0);
-                        }
-                        Node * nd = tree->getMRCA((*it).second);
-                        nd->setName((*it).first);
-                    }
-                } else {
-                    for (int i=0; i<tree->getInternalNodeCount();i++) {
-                        if (tree->getInternalNode(i)->getName().size() == 0) {
-                            tree->getInternalNode(i)->setName("px"+std::to_string(count));
-                            count ++;
-                        }
-                    }
+            for (int i = 0; i < query->get_num_clades(); i++) {
+                mrcas[i]->setName(query->get_name(i));
+            }
+        } else {
+            for (int i=0; i<tree->getInternalNodeCount();i++) {
+                if (tree->getInternalNode(i)->getName().size() == 0) {
+                    tree->getInternalNode(i)->setName("px"+std::to_string(count));
+                    count ++;
                 }
-                (*poos) << getNewickString(tree) << std::endl;
-                delete tree;
             }
         }
-    }
+        append_tree(out, tree);
+        return true;
+    }, !mrcaset);
     
+    if (mrcaset) {
+        delete query;
+    }
     if (fileset) {
         fstr->close();
         delete pios;
     }
+    tw.flush();
+    if (trees.aborted()) {
+        std::cerr << failed_taxa << "Error: check mrca file for typos. Exiting." << std::endl;
+        exit(0);
+    }
     if (outfileset) {
         ofstr->close();
         delete poos;
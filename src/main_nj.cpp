@@ -30,6 +30,8 @@ void print_help() {
     std::cout << "Options:" << std::endl;
     std::cout << " -s, --seqf=FILE     input sequence file, STDIN otherwise" << std::endl;
     std::cout << " -o, --outf=FILE     output newick file, STOUT otherwise" << std::endl;
+    std::cout << " -m, --model=STR     distance model: hamming, p, jc69, k2p or logdet (last 3 DNA only)" << std::endl;
+    std::cout << "                     default: hamming (number of differences, gaps included)" << std::endl;
     std::cout << " -n, --nthreads=INT  number of threads, default=1" << std::endl;
     std::cout << " -h, --help          display this help and exit" << std::endl;
     std::cout << " -V, --version       display version and exit" << std::endl;
@@ -45,6 +47,7 @@ static struct option const long_options[] =
 {
     {"seqf", required_argument, NULL, 's'},
     {"outf", required_argument, NULL, 'o'},
+    {"model", required_argument, NULL, 'm'},
     {"nthreads", required_argument, NULL, 'n'},
     {"help", no_argument, NULL, 'h'},
     {"version", no_argument, NULL, 'V'},
@@ -52,6 +55,8 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "s:o:m:n:hVC";
+
 // temp function to play around with multithreading
 void printInfo () {
     int foo = omp_get_num_procs();
@@ -61,17 +66,18 @@ void printInfo () {
 
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool fileset = false;
     bool outfileset = false;
     int threads = 1;
     char * seqf = NULL;
     char * outf = NULL;
+    distModel model = DIST_HAMMING;
 
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "s:o:n:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -85,6 +91,13 @@ int main(int argc, char * argv[]) {
                 outfileset = true;
                 outf = strdup(optarg);
                 break;
+            case 'm':
+                if (!get_dist_model(optarg, model)) {
+                    std::cerr << "Error: distance model '" << optarg
+                        << "' not recognized. Exiting." << std::endl;
+                    exit(0);
+                }
+                break;
             case 'n':
                 threads = string_to_int(optarg, "-n");
                 break;
@@ -130,7 +143,7 @@ int main(int argc, char * argv[]) {
         poos = &std::cout;
     }
     
-    NJOI nj(pios, threads);
+    NJOI nj(pios, threads, model);
     (*poos) << nj.get_newick() << std::endl;
     
     if (fileset) {
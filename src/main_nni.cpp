@@ -11,6 +11,8 @@
 #include "tree.h"
 #include "utils.h"
 #include "tree_utils.h"
+#include "tree_writer.h"
+#include "tree_stream.h"
 #include "log.h"
 #include "constants.h"
 
@@ -49,9 +51,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "t:o:x:hVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool outfileset = false;
     bool fileset = false;
@@ -61,7 +65,7 @@ int main(int argc, char * argv[]) {
     
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "t:o:x:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -108,6 +112,7 @@ int main(int argc, char * argv[]) {
     } else {
         poos = &std::cout;
     }
+    TreeWriter tw(poos);
     
     if (fileset == true) {
         fstr = new std::ifstream(seqf);
@@ -127,48 +132,20 @@ int main(int argc, char * argv[]) {
         srand(get_clock_seed());
     }
     
-    std::string retstring;
-    int ft = test_tree_filetype_stream(*pios, retstring);
+    TreeStream trees(pios);
+    int ft = trees.get_filetype();
     if (ft != 0 && ft != 1) {
         std::cerr << "Error: this really only works with nexus or newick. Exiting." << std::endl;
         exit(0);
     }
-    
-    int treeCounter = 0;
-    bool going = true;
-    if (ft == 1) { // newick. easy
-        Tree * tree;
-        while (going) {
-            tree = read_next_tree_from_stream_newick (*pios, retstring, &going);
-            if (tree != NULL) {
-                //std::cout << "Working on tree #" << treeCounter << std::endl;
-                std::map<Node*, std::vector<Node*> > tree_map;
-                create_tree_map_from_rootnode(tree, tree_map);
-                std::cout << std:: endl << "hey mutherfuker" << std::endl;
-                nni_from_tree_map(tree, tree_map);
-                (*poos) << getNewickString(tree) << std::endl;
-                delete tree;
-                treeCounter++;
-            }
-        }
-    } else if (ft == 0) { // Nexus. need to worry about possible translation tables
-        std::map<std::string, std::string> translation_table;
-        bool ttexists;
-        ttexists = get_nexus_translation_table(*pios, &translation_table, &retstring);
-        Tree * tree;
-        while (going) {
-            tree = read_next_tree_from_stream_nexus(*pios, retstring, ttexists,
-                &translation_table, &going);
-            if (tree != NULL) {
-                //std::cout << "Working on tree #" << treeCounter << std::endl;
-                std::map<Node*, std::vector<Node*> > tree_map;
-                create_tree_map_from_rootnode(tree, tree_map);
-                nni_from_tree_map(tree, tree_map);
-                (*poos) << getNewickString(tree) << std::endl;
-                delete tree;
-                treeCounter++;
-            }
-        }
-    }
+    // ordered: draws random numbers
+    trees.process(tw, [] (Tree *& tree, const long&, std::string& out) {
+        std::map<Node*, std::vector<Node*> > tree_map;
+        create_tree_map_from_rootnode(tree, tree_map);
+        nni_from_tree_map(tree, tree_map);
+        append_tree(out, tree);
+        return true;
+    }, true);
+    tw.flush();
     return EXIT_SUCCESS;
 }
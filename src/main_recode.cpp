@@ -62,9 +62,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "s:r:o:hVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool outfileset = false;
     bool fileset = false;
@@ -73,7 +75,7 @@ int main(int argc, char * argv[]) {
     char * seqf = NULL;
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "s:r:o:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
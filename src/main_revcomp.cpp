@@ -14,6 +14,7 @@
 #include "utils.h"
 #include "log.h"
 #include "edlib.h"
+#include "seq_orient.h"
 #include "constants.h"
 
 extern std::string PHYX_CITATION;
@@ -31,6 +32,8 @@ void print_help() {
     std::cout << " -i, --ids=IDS       a comma sep list of ids to flip (NO SPACES!)" << std::endl;
     std::cout << " -g, --guess         EXPERIMENTAL: guess whether there are seqs that need to be " << std::endl;
     std::cout << "                       rev comp. uses edlib library on first seq" << std::endl;
+    std::cout << " -r, --reffile=FILE  with -g, use first seq in FILE as reference instead" << std::endl;
+    std::cout << " -k, --kmer          with -g, use a kmer prefilter; edlib only for ambiguous seqs" << std::endl;
     std::cout << " -p, --pguess        EXPERIMENTAL: progressively guess " << std::endl;
     std::cout << " -m, --sguess        EXPERIMENTAL: sampled guess " << std::endl;
     std::cout << " -o, --outf=FILE     output sequence file, STOUT otherwise" << std::endl;
@@ -51,6 +54,8 @@ static struct option const long_options[] =
     {"guess", no_argument, NULL, 'g'},
     {"pguess", no_argument, NULL, 'p'},
     {"sguess", no_argument, NULL, 'm'},
+    {"reffile", required_argument, NULL, 'r'},
+    {"kmer", no_argument, NULL, 'k'},
     {"outf", required_argument, NULL, 'o'},
     {"help", no_argument, NULL, 'h'},
     {"version", no_argument, NULL, 'V'},
@@ -58,6 +63,8 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "s:i:o:mgpr:khVC";
+
 bool reverse_it_or_not(std::vector<Sequence>& seqs, Sequence comp_seq) {
     int best_distance = 10000000;
     int best_dis_rev = 100000000;
@@ -93,7 +100,7 @@ bool reverse_it_or_not(std::vector<Sequence>& seqs, Sequence comp_seq) {
 
 int main(int argc, char * argv[]) {
     srand (time(NULL));
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool fileset = false;
     bool outfileset = false;
@@ -104,12 +111,15 @@ int main(int argc, char * argv[]) {
     bool pguess = false;
     bool sguess = false;
     double sguess_samplenum = 0.2; // 10% of them will be used for revcomp
+    bool reffileset = false;
+    int kmer = 0;
+    char * reff = NULL;
     char * seqf = NULL;
     char * outf = NULL;
     char * idssc = NULL;
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "s:i:o:mgphVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -134,6 +144,14 @@ int main(int argc, char * argv[]) {
                 guess = true;
                 sguess = true;
                 break;
+            case 'r':
+                reffileset = true;
+                reff = strdup(optarg);
+                check_file_exists(reff);
+                break;
+            case 'k':
+                kmer = 8;
+                break;
             case 'o':
                 outfileset = true;
                 outf = strdup(optarg);
@@ -157,6 +175,11 @@ int main(int argc, char * argv[]) {
         check_inout_streams_identical(seqf, outf);
     }
     
+    if ((reffileset || kmer > 0) && (!guess || pguess || sguess)) {
+        std::cerr << "Error: -r and -k only apply to -g. Exiting." << std::endl;
+        exit(0);
+    }
+    
     if (idsset == true) {
         std::vector<std::string> tokens2;
         tokenize(idssc, tokens2, ",");
@@ -204,6 +227,47 @@ int main(int argc, char * argv[]) {
             }
             (*poos) << seq.get_fasta();
         }
+    } else if (!pguess && !sguess) {
+        // a single fixed reference: orient batches of sequences against it in parallel
+        SeqOrienter * orienter = NULL;
+        if (reffileset) {
+            std::ifstream reffstr(reff);
+            std::string refretstring;
+            Sequence refseq;
+            int rft = test_seq_filetype_stream(reffstr, refretstring);
+            read_next_seq_from_stream(reffstr, rft, refretstring, refseq);
+            orienter = new SeqOrienter(refseq.get_sequence(), kmer);
+        }
+        const unsigned int batchsize = 10000;
+        std::vector<Sequence> batch;
+        bool going = true;
+        while (going) {
+            going = read_next_seq_from_stream(*pios, ft, retstring, seq);
+            if (!going && ft != 2) {
+                break; // fasta: the last seq is still in seq
+            }
+            if (orienter == NULL) {
+                // first seq is the reference, written as is
+                orienter = new SeqOrienter(seq.get_sequence(), kmer);
+                (*poos) << seq.get_fasta();
+                continue;
+            }
+            batch.push_back(seq);
+            if (batch.size() == batchsize || !going) {
+                orienter->orient(batch);
+                for (unsigned int i = 0; i < batch.size(); i++) {
+                    (*poos) << batch[i].get_fasta();
+                }
+                batch.clear();
+            }
+        }
+        if (!batch.empty()) {
+            orienter->orient(batch);
+            for (unsigned int i = 0; i < batch.size(); i++) {
+                (*poos) << batch[i].get_fasta();
+            }
+        }
+        delete orienter;
     } else {
        bool first = true;
        std::vector<Sequence> done; //for pguess
@@ -2,7 +2,6 @@
 #include <fstream>
 #include <vector>
 #include <string>
-#include <set>
 #include <cstring>
 #include <getopt.h>
 
@@ -19,7 +18,8 @@ extern std::string PHYX_CITATION;
 void print_help() {
     std::cout << "Taxon relabelling for alignments." << std::endl;
     std::cout << "This will take fasta, phylip, and nexus formats from a file or STDIN." << std::endl;
-    std::cout << "Two ordered lists of taxa, -c (current) and -n (new) must be provided." << std::endl;
+    std::cout << "Two ordered lists of taxa, -c (current) and -n (new), and/or rules for" << std::endl;
+    std::cout << "labels not in the lists (-r, -p, -P) must be provided." << std::endl;
     std::cout << "Results are written in fasta format." << std::endl;
     std::cout << std::endl;
     std::cout << "Usage: pxrls [OPTIONS]... FILES" << std::endl;
@@ -28,6 +28,11 @@ void print_help() {
     std::cout << " -s, --seqf=FILE     input seq file, STDIN otherwise" << std::endl;
     std::cout << " -c, --cnames=FILE   file containing current taxon labels (one per line)" << std::endl;
     std::cout << " -n, --nnames=FILE   file containing new taxon labels (one per line)" << std::endl;
+    std::cout << " -r, --regex=STR     regular expression to replace in labels not in the lists" << std::endl;
+    std::cout << " -R, --replace=STR   replacement for -r matches (may use $1 etc.), empty otherwise" << std::endl;
+    std::cout << " -p, --prefix=STR    prefix to replace in labels not in the lists (after -r)" << std::endl;
+    std::cout << " -P, --newprefix=STR replacement for the -p prefix, empty otherwise. without" << std::endl;
+    std::cout << "                       -p it is added to the start of every such label" << std::endl;
     std::cout << " -o, --outf=FILE     output file, STOUT otherwise" << std::endl;
     std::cout << " -v, --verbose       make the output more verbose" << std::endl;
     std::cout << " -h, --help          display this help and exit" << std::endl;
@@ -45,6 +50,10 @@ static struct option const long_options[] =
     {"seqf", required_argument, NULL, 's'},
     {"cnames", required_argument, NULL, 'c'},
     {"nnames", required_argument, NULL, 'n'},
+    {"regex", required_argument, NULL, 'r'},
+    {"replace", required_argument, NULL, 'R'},
+    {"prefix", required_argument, NULL, 'p'},
+    {"newprefix", required_argument, NULL, 'P'},
     {"outf", required_argument, NULL, 'o'},
     {"verbose", no_argument, NULL, 'v'},
     {"help", no_argument, NULL, 'h'},
@@ -53,9 +62,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "s:c:n:r:R:p:P:o:vhVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool outfileset = false;
     bool sfileset = false;
@@ -66,10 +77,16 @@ int main(int argc, char * argv[]) {
     char * seqf = NULL;
     std::string cnamef = "";
     std::string nnamef = "";
+    bool regexset = false;
+    bool prefixset = false;
+    std::string regex = "";
+    std::string replacement = "";
+    std::string oldprefix = "";
+    std::string newprefix = "";
     
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "s:c:n:o:vhVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -89,6 +106,21 @@ int main(int argc, char * argv[]) {
                 nnamef = strdup(optarg);
                 check_file_exists(nnamef.c_str());
                 break;
+            case 'r':
+                regexset = true;
+                regex = optarg;
+                break;
+            case 'R':
+                replacement = optarg;
+                break;
+            case 'p':
+                prefixset = true;
+                oldprefix = optarg;
+                break;
+            case 'P':
+                prefixset = true;
+                newprefix = optarg;
+                break;
             case 'o':
                 outfileset = true;
                 outf = strdup(optarg);
@@ -120,8 +152,8 @@ int main(int argc, char * argv[]) {
     std::ifstream * fstr = NULL;
     std::ofstream * ofstr = NULL;
     
-    if (!nfileset | !cfileset) {
-        std::cerr << "Error: must supply both name files (-c for current, -n for new). Exiting." << std::endl;
+    if (nfileset != cfileset || (!cfileset && !regexset && !prefixset)) {
+        std::cerr << "Error: must supply both name files (-c for current, -n for new) and/or a rule (-r, -p, -P). Exiting." << std::endl;
         exit(0);
     }
     
@@ -143,95 +175,47 @@ int main(int argc, char * argv[]) {
     }
     
     Relabel rl (cnamef, nnamef, verbose);
+    if (regexset) {
+        rl.set_regex_rule(regex, replacement);
+    }
+    if (prefixset) {
+        rl.set_prefix_rule(oldprefix, newprefix);
+    }
     
-    std::set<std::string> orig = rl.get_names_to_replace();
-    
-    Sequence seq;
+    std::vector<char> found;
     std::string retstring;
-    bool success = false;
     int num_taxa, num_char; // not used, but required by some reader functions
     
     int ft = test_seq_filetype_stream(*pios, retstring);
     
     // extra stuff to deal with possible interleaved nexus
+    bool streamable = true;
+    std::vector<Sequence> seqs;
     if (ft == 0) {
         bool interleave = false;
         get_nexus_dimensions(*pios, num_taxa, num_char, interleave);
         retstring = ""; // need to do this to let seqreader know we are mid-file
-        if (!interleave) {
-            while (read_next_seq_from_stream(*pios, ft, retstring, seq)) {
-                std::string terp = seq.get_id();
-                success = rl.relabel_sequence(seq);
-                if (success) {
-                    orig.erase(terp);
-                }
-                (*poos) << ">" << seq.get_id() << std::endl;
-                (*poos) << seq.get_sequence() << std::endl;
-            }
-        } else {
-            std::vector<Sequence> seqs = read_interleaved_nexus(*pios, num_taxa, num_char);
-            for (unsigned int i = 0; i < seqs.size(); i++) {
-                seq = seqs[i];
-                std::string terp = seq.get_id();
-                success = rl.relabel_sequence(seq);
-                if (success) {
-                    orig.erase(terp);
-                }
-                (*poos) << ">" << seq.get_id() << std::endl;
-                (*poos) << seq.get_sequence() << std::endl;
-            }
+        if (interleave) {
+            streamable = false;
+            seqs = read_interleaved_nexus(*pios, num_taxa, num_char);
         }
-    } else {
-        bool complicated_phylip = false;
+    } else if (ft == 1) {
         // check if we are dealing with a complicated phylip format
-        if (ft == 1) {
-            get_phylip_dimensions(retstring, num_taxa, num_char);
-            complicated_phylip = is_complicated_phylip(*pios, num_char);
-        }
-        if (complicated_phylip) {
-            std::vector<Sequence> seqs = read_phylip(*pios, num_taxa, num_char);
-            for (unsigned int i = 0; i < seqs.size(); i++) {
-                seq = seqs[i];
-                std::string terp = seq.get_id();
-                success = rl.relabel_sequence(seq);
-                if (success) {
-                    orig.erase(terp);
-                }
-                (*poos) << ">" << seq.get_id() << std::endl;
-                (*poos) << seq.get_sequence() << std::endl;
-            }
-        } else {
-            // fasta, fastq, or simple phylip
-            while (read_next_seq_from_stream(*pios, ft, retstring, seq)) {
-                std::string terp = seq.get_id();
-                success = rl.relabel_sequence(seq);
-                if (success) {
-                    orig.erase(terp);
-                }
-                (*poos) << ">" << seq.get_id() << std::endl;
-                (*poos) << seq.get_sequence() << std::endl;
-            }
-            // fasta has a trailing one
-            if (ft == 2) {
-                std::string terp = seq.get_id();
-                success = rl.relabel_sequence(seq);
-                if (success) {
-                    orig.erase(terp);
-                }
-                (*poos) << ">" << seq.get_id() << std::endl;
-                (*poos) << seq.get_sequence() << std::endl;
-            }
+        get_phylip_dimensions(retstring, num_taxa, num_char);
+        if (is_complicated_phylip(*pios, num_char)) {
+            streamable = false;
+            seqs = read_phylip(*pios, num_taxa, num_char);
         }
     }
-    
-    if (orig.size() > 0) {
-        if (verbose) {
-            std::cerr << "The following names to match were not found in the alignment:" << std::endl;
-            for (auto elem : orig) {
-                std::cerr << elem << std::endl;
-            }
-        }
+    if (streamable) {
+        // fasta, fastq, simple phylip, or sequential nexus
+        rl.relabel_stream(*pios, ft, retstring, poos, found);
+    } else {
+        std::string out;
+        rl.relabel_sequences(seqs, (int)seqs.size(), out, found);
+        (*poos) << out << std::flush;
     }
+    rl.report_missing_sequences(found);
     
     if (sfileset) {
         fstr->close();
@@ -10,6 +10,8 @@
 #include "tree_reader.h"
 #include "relabel.h"
 #include "tree_utils.h"
+#include "tree_writer.h"
+#include "tree_stream.h"
 #include "log.h"
 #include "constants.h"
 
@@ -18,7 +20,8 @@ extern std::string PHYX_CITATION;
 
 void print_help() {
     std::cout << "Taxon relabelling for trees." << std::endl;
-    std::cout << "Two ordered lists of taxa, -c (current) and -n (new) must be provided." << std::endl;
+    std::cout << "Two ordered lists of taxa, -c (current) and -n (new), and/or rules for" << std::endl;
+    std::cout << "tip labels not in the lists (-r, -p, -P) must be provided." << std::endl;
     std::cout << "This will take a newick- or nexus-formatted tree from a file or STDIN." << std::endl;
     std::cout << "Output is written in newick format." << std::endl;
     std::cout << std::endl;
@@ -28,6 +31,11 @@ void print_help() {
     std::cout << " -t, --treef=FILE    input tree file, STDIN otherwise" << std::endl;
     std::cout << " -c, --cnames=FILE   file containing current taxon labels (one per line)" << std::endl;
     std::cout << " -n, --nnames=FILE   file containing new taxon labels (one per line)" << std::endl;
+    std::cout << " -r, --regex=STR     regular expression to replace in labels not in the lists" << std::endl;
+    std::cout << " -R, --replace=STR   replacement for -r matches (may use $1 etc.), empty otherwise" << std::endl;
+    std::cout << " -p, --prefix=STR    prefix to replace in labels not in the lists (after -r)" << std::endl;
+    std::cout << " -P, --newprefix=STR replacement for the -p prefix, empty otherwise. without" << std::endl;
+    std::cout << "                       -p it is added to the start of every such label" << std::endl;
     std::cout << " -o, --outf=FILE     output file, STOUT otherwise" << std::endl;
     std::cout << " -v, --verbose       make the output more verbose" << std::endl;
     std::cout << " -h, --help          display this help and exit" << std::endl;
@@ -45,6 +53,10 @@ static struct option const long_options[] =
     {"treef", required_argument, NULL, 't'},
     {"cnames", required_argument, NULL, 'c'},
     {"nnames", required_argument, NULL, 'n'},
+    {"regex", required_argument, NULL, 'r'},
+    {"replace", required_argument, NULL, 'R'},
+    {"prefix", required_argument, NULL, 'p'},
+    {"newprefix", required_argument, NULL, 'P'},
     {"outf", required_argument, NULL, 'o'},
     {"verbose", no_argument, NULL, 'v'},
     {"help", no_argument, NULL, 'h'},
@@ -53,9 +65,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "t:c:n:r:R:p:P:o:vhVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool outfileset = false;
     bool tfileset = false;
@@ -66,9 +80,15 @@ int main(int argc, char * argv[]) {
     char * treef = NULL;
     std::string cnamef = "";
     std::string nnamef = "";
+    bool regexset = false;
+    bool prefixset = false;
+    std::string regex = "";
+    std::string replacement = "";
+    std::string oldprefix = "";
+    std::string newprefix = "";
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "t:c:n:o:vhVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -88,6 +108,21 @@ int main(int argc, char * argv[]) {
                 nnamef = strdup(optarg);
                 check_file_exists(nnamef.c_str());
                 break;
+            case 'r':
+                regexset = true;
+                regex = optarg;
+                break;
+            case 'R':
+                replacement = optarg;
+                break;
+            case 'p':
+                prefixset = true;
+                oldprefix = optarg;
+                break;
+            case 'P':
+                prefixset = true;
+                newprefix = optarg;
+                break;
             case 'o':
                 outfileset = true;
                 outf = strdup(optarg);
@@ -119,8 +154,8 @@ int main(int argc, char * argv[]) {
     std::ifstream * fstr = NULL;
     std::ofstream * ofstr = NULL;
     
-    if (!nfileset | !cfileset) {
-        std::cerr << "Error: must supply both name files (-c for current, -n for new). Exiting." << std::endl;
+    if (nfileset != cfileset || (!cfileset && !regexset && !prefixset)) {
+        std::cerr << "Error: must supply both name files (-c for current, -n for new) and/or a rule (-r, -p, -P). Exiting." << std::endl;
         exit(0);
     }
     
@@ -140,42 +175,29 @@ int main(int argc, char * argv[]) {
     } else {
         poos = &std::cout;
     }
+    TreeWriter tw(poos);
     
     Relabel rl (cnamef, nnamef, verbose);
+    if (regexset) {
+        rl.set_regex_rule(regex, replacement);
+    }
+    if (prefixset) {
+        rl.set_prefix_rule(oldprefix, newprefix);
+    }
     
-    std::string retstring;
-    int ft = test_tree_filetype_stream(*pios, retstring);
+    TreeStream trees(pios);
+    int ft = trees.get_filetype();
     if (ft != 0 && ft != 1) {
         std::cerr << "Error: this really only works with nexus or newick. Exiting." << std::endl;
         exit(0);
     }
-    bool going = true;
-    if (ft == 1) {
-        Tree * tree;
-        while (going) {
-            tree = read_next_tree_from_stream_newick(*pios, retstring, &going);
-            if (going) {
-                rl.relabel_tree(tree);
-                (*poos) << getNewickString(tree) << std::endl;
-                delete tree;
-            }
-        }
-    } else if (ft == 0) { // Nexus. need to worry about possible translation tables
-        std::map<std::string, std::string> translation_table;
-        bool ttexists;
-        ttexists = get_nexus_translation_table(*pios, &translation_table, &retstring);
-        Tree * tree;
-        while (going) {
-            tree = read_next_tree_from_stream_nexus(*pios, retstring, ttexists,
-                &translation_table, &going);
-            if (tree != NULL) {
-                rl.relabel_tree(tree);
-                (*poos) << getNewickString(tree) << std::endl;
-                delete tree;
-            }
-        }
-    }
+    trees.process(tw, [&] (Tree *& tree, const long&, std::string& out) {
+        rl.relabel_tree(tree);
+        append_tree(out, tree);
+        return true;
+    }, false);
     
+    tw.flush();
     if (outfileset) {
         ofstr->close();
         delete poos;
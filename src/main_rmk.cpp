@@ -9,6 +9,7 @@
 #include "tree_reader.h"
 #include "tree.h"
 #include "tree_utils.h"
+#include "tree_writer.h"
 #include "utils.h"
 #include "node.h"
 #include "superdouble.h"
@@ -48,9 +49,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "t:vranublio:x:hVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool outfileset = false;
     bool fileset = false;
@@ -59,7 +62,7 @@ int main(int argc, char * argv[]) {
     
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "t:vranublio:x:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -103,6 +106,7 @@ int main(int argc, char * argv[]) {
     } else {
         poos = &std::cout;
     }
+    TreeWriter tw(poos);
     
     if (fileset == true) {
         fstr = new std::ifstream(treef);
@@ -129,7 +133,7 @@ int main(int argc, char * argv[]) {
             tree = read_next_tree_from_stream_newick(*pios, retstring, &going);
             if (tree != NULL) {
                 deknuckle_tree(tree);
-                (*poos) << getNewickString(tree) << std::endl;
+                tw.write_tree(tree);
                 delete tree;
             }
         }
@@ -143,11 +147,12 @@ int main(int argc, char * argv[]) {
                 &translation_table, &going);
             if (tree != NULL) {
                 deknuckle_tree(tree);
-                (*poos) << getNewickString(tree) << std::endl;
+                tw.write_tree(tree);
                 delete tree;
             }
         }
     }
     
+    tw.flush();
     return EXIT_SUCCESS;
 }
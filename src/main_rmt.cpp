@@ -11,6 +11,8 @@
 #include "tree_reader.h"
 #include "utils.h"
 #include "tree_utils.h"
+#include "tree_writer.h"
+#include "tree_stream.h"
 #include "log.h"
 #include "constants.h"
 
@@ -57,9 +59,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "t:n:f:r:co:shVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
       
     bool fileset = false;
     bool namesset = false;
@@ -77,7 +81,7 @@ int main(int argc, char * argv[]) {
     char * namesfc = NULL;
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "t:n:f:r:co:shVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -174,10 +178,10 @@ int main(int argc, char * argv[]) {
     } else {
         poos = &std::cout;
     }
+    TreeWriter tw(poos);
     
-    //read trees 
-    std::string retstring;
-    int ft = test_tree_filetype_stream(*pios, retstring);
+    TreeStream trees(pios);
+    int ft = trees.get_filetype();
     if (ft != 0 && ft != 1) {
         std::cerr << "Error: this really only works with nexus or newick. Exiting." << std::endl;
         exit(0);
@@ -187,106 +191,51 @@ int main(int argc, char * argv[]) {
     // this is demonstrated here: https://github.com/FePhyFoFum/phyx/issues/74
     int MAX_RMT = 50;
     
-    bool going = true;
-    int numLeaves;
-    int num_names = 0;
-    std::vector<std::string> toKeep; // if trace is used
-    std::vector<std::string> currNames; // keep original copy of names in case sampling differs across trees
-    
-    if (ft == 0) {
-        // nexus
-        std::map<std::string, std::string> translation_table;
-        bool ttexists;
-        ttexists = get_nexus_translation_table(*pios, &translation_table, &retstring);
-        Tree * tree;
-        while (going) {
-            tree = read_next_tree_from_stream_nexus(*pios, retstring, ttexists,
-                &translation_table, &going);
-            if (going == true) {
-                numLeaves = tree->getExternalNodeCount();
-                currNames = names; 
-                
-                if (regex) {
-                    currNames = get_names_in_tree_regex(tree, regex_pattern);
-                }
-                if (complement) {
-                    currNames = get_complement_tip_set(tree, currNames);
-                }
-                // check names against the tree (instead of just length of names, which might be bad)
-                if (!regex && !complement) {
-                    currNames = get_names_in_tree(tree, currNames);
-                }
-                
-                num_names = currNames.size();
-                
-                if (num_names == 0) {
-                    if (!silent) {
-                        std::cerr << "Error: no matching tip labels. Returning original tree." << std::endl;
-                    }
-                    (*poos) << getNewickString(tree) << std::endl;
-                } else if (numLeaves - num_names < 2) {
-                    std::cerr << "Error: pruning would produce a tree with "
-                        << (numLeaves - num_names) << " tips. No result is returned." << std::endl;
-                } else {
-                    if (num_names < MAX_RMT) {
-                        remove_tips(tree, currNames, silent);
-                    } else {
-                        toKeep = get_complement_tip_set(tree, currNames);
-                        tree = get_induced_tree(tree, toKeep, silent);
-                    }
-                    (*poos) << getNewickString(tree) << std::endl;
-                }
-                delete tree;
-            }
+    trees.process(tw, [&] (Tree *& tree, const long&, std::string& out) {
+        int numLeaves = tree->getExternalNodeCount();
+        // keep original copy of names in case sampling differs across trees
+        std::vector<std::string> currNames = names;
+        
+        if (regex) {
+            currNames = get_names_in_tree_regex(tree, regex_pattern);
         }
-    } else if (ft == 1) {
-        // newick
-        Tree * tree;
-        while (going) {
-            tree = read_next_tree_from_stream_newick(*pios, retstring, &going);
-            if (going == true) {
-                numLeaves = tree->getExternalNodeCount();
-                currNames = names; 
-                
-                if (regex) {
-                    currNames = get_names_in_tree_regex(tree, regex_pattern);
-                }
-                if (complement) {
-                    currNames = get_complement_tip_set(tree, currNames);
-                }
-                // check names against the tree (instead of just length of names, which might be bad)
-                if (!regex && !complement) {
-                    currNames = get_names_in_tree(tree, currNames);
-                }
-                
-                num_names = currNames.size();
-                
-                if (num_names == 0) {
-                    if (!silent) {
-                        std::cerr << "Error: no matching tip labels. Returning original tree." << std::endl;
-                    }
-                    (*poos) << getNewickString(tree) << std::endl;
-                } else if (numLeaves - num_names < 2) {
-                    std::cerr << "Error: pruning would produce a tree with "
-                        << (numLeaves - num_names) << " tips. No result is returned." << std::endl;
-                }  else {
-                    if (num_names < MAX_RMT) {
-                        remove_tips(tree, currNames, silent);
-                    } else {
-                        toKeep = get_complement_tip_set(tree, currNames);
-                        tree = get_induced_tree(tree, toKeep, silent);
-                    }
-                    (*poos) << getNewickString(tree) << std::endl;
-                }
+        if (complement) {
+            currNames = get_complement_tip_set(tree, currNames);
+        }
+        // check names against the tree (instead of just length of names, which might be bad)
+        if (!regex && !complement) {
+            currNames = get_names_in_tree(tree, currNames);
+        }
+        
+        int num_names = currNames.size();
+        
+        if (num_names == 0) {
+            if (!silent) {
+                std::cerr << "Error: no matching tip labels. Returning original tree." << std::endl;
+            }
+            append_tree(out, tree);
+        } else if (numLeaves - num_names < 2) {
+            std::cerr << "Error: pruning would produce a tree with "
+                << (numLeaves - num_names) << " tips. No result is returned." << std::endl;
+        } else {
+            if (num_names < MAX_RMT) {
+                remove_tips(tree, currNames, silent);
+            } else {
+                std::vector<std::string> toKeep = get_complement_tip_set(tree, currNames);
+                Tree * induced = get_induced_tree(tree, toKeep, silent);
                 delete tree;
+                tree = induced;
             }
+            append_tree(out, tree);
         }
-    }
+        return true;
+    }, false);
     
     if (fileset) {
         fstr->close();
         delete pios;
     }
+    tw.flush();
     if (outfileset) {
         ofstr->close();
         delete poos;
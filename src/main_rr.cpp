@@ -12,6 +12,8 @@
 #include "tree_reader.h"
 #include "utils.h"
 #include "tree_utils.h"
+#include "tree_writer.h"
+#include "tree_stream.h"
 #include "log.h"
 #include "constants.h"
 
@@ -56,9 +58,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "t:g:ruo:shVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool fileset = false;
     bool outgroupsset = false;
@@ -73,7 +77,7 @@ int main(int argc, char * argv[]) {
     char * outgroupsc = NULL;
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "t:g:ruo:shVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -153,121 +157,58 @@ int main(int argc, char * argv[]) {
     } else {
         poos = &std::cout;
     }
+    TreeWriter tw(poos);
     
-    //read trees 
-    std::string retstring;
-    int ft = test_tree_filetype_stream(*pios, retstring);
+    TreeStream trees(pios);
+    int ft = trees.get_filetype();
     if (ft != 0 && ft != 1) {
         std::cerr << "Error: this really only works with nexus or newick. Exiting." << std::endl;
         exit(0);
     }
-    bool going = true;
-    bool exists;
     if (!unroot) {
-        if (ft == 0) { // Nexus
-            std::map<std::string, std::string> translation_table;
-            bool ttexists;
-            ttexists = get_nexus_translation_table(*pios, &translation_table, &retstring);;
-            Tree * tree;
-            while (going) {
-                tree = read_next_tree_from_stream_nexus(*pios, retstring, ttexists,
-                    &translation_table, &going);
-                if (tree != NULL) {
-                    if (ranked) {
-                        // find first outgroup present in tree
-                        bool ogexists = false;
-                        for (unsigned int i=0; i < outgroups.size(); i++) {
-                            std::string name = outgroups[i];
-                            if (check_name_against_tree(tree, name)) {
-                                std::vector<std::string> og;
-                                og.push_back(name);
-                                exists = reroot(tree, og, silent);
-                                ogexists = true;
-                                break;
-                            }
-                        }
-                        // if no valid outgroups, let silent option figure out
-                        if (!ogexists) {
-                            exists = reroot(tree, outgroups, silent);
-                        }
-                    } else {
-                        exists = reroot(tree, outgroups, silent);
-                    }
-                    if (!exists) {
-                        std::cerr << "The outgroup taxa don't exist in this tree." << std::endl;
-                    } else {
-                        (*poos) << getNewickString(tree) << std::endl;
+        trees.process(tw, [&] (Tree *& tree, const long&, std::string& out) {
+            bool exists;
+            if (ranked) {
+                // find first outgroup present in tree
+                bool ogexists = false;
+                for (unsigned int i=0; i < outgroups.size(); i++) {
+                    std::string name = outgroups[i];
+                    if (check_name_against_tree(tree, name)) {
+                        std::vector<std::string> og;
+                        og.push_back(name);
+                        exists = reroot(tree, og, silent);
+                        ogexists = true;
+                        break;
                     }
-                    delete tree;
                 }
-            }
-        } else if (ft == 1) { // newick
-            Tree * tree;
-            while (going) {
-                tree = read_next_tree_from_stream_newick(*pios, retstring, &going);
-                if (going) {
-                    if (ranked) {
-                        // find first outgroup present in tree
-                        bool ogexists = false;
-                        for (unsigned int i=0; i < outgroups.size(); i++) {
-                            std::string name = outgroups[i];
-                            if (check_name_against_tree(tree, name)) {
-                                std::vector<std::string> og;
-                                og.push_back(name);
-                                exists = reroot(tree, og, silent);
-                                ogexists = true;
-                                break;
-                            }
-                        }
-                        // if no valid outgroups, let silent option figure out
-                        if (!ogexists) {
-                            exists = reroot(tree, outgroups, silent);
-                        }
-                    } else {
-                        exists = reroot(tree, outgroups, silent);
-                    }
-                    if (!exists) {
-                        std::cerr << "The outgroup taxa don't exist in this tree." << std::endl;
-                    } else {
-                        (*poos) << getNewickString(tree) << std::endl;
-                    }
-                    delete tree;
+                // if no valid outgroups, let silent option figure out
+                if (!ogexists) {
+                    exists = reroot(tree, outgroups, silent);
                 }
+            } else {
+                exists = reroot(tree, outgroups, silent);
             }
-        }
+            if (!exists) {
+                std::cerr << "The outgroup taxa don't exist in this tree." << std::endl;
+            } else {
+                append_tree(out, tree);
+            }
+            return true;
+        }, false);
     } else {
         // unroot trees
-        if (ft == 0) {
-            std::map<std::string, std::string> translation_table;
-            bool ttexists;
-            ttexists = get_nexus_translation_table(*pios, &translation_table, &retstring);;
-            Tree * tree;
-            while (going) {
-                tree = read_next_tree_from_stream_nexus(*pios, retstring, ttexists,
-                    &translation_table, &going);
-                if (tree != NULL) {
-                    tree->unRoot();
-                    (*poos) << getNewickString(tree) << std::endl;
-                    delete tree;
-                }
-            }
-        } else if (ft == 1) {
-            Tree * tree;
-            while (going) {
-                tree = read_next_tree_from_stream_newick(*pios, retstring, &going);
-                if (going) {
-                    tree->unRoot();
-                    (*poos) << getNewickString(tree) << std::endl;
-                    delete tree;
-                }
-            }
-        }
+        trees.process(tw, [] (Tree *& tree, const long&, std::string& out) {
+            tree->unRoot();
+            append_tree(out, tree);
+            return true;
+        }, false);
     }
     
     if (fileset) {
         fstr->close();
         delete pios;
     }
+    tw.flush();
     if (outfileset) {
         ofstr->close();
         delete poos;
@@ -8,6 +8,7 @@
 #include "utils.h"
 #include "seq_reader.h"
 #include "sequence.h"
+#include "seq_convert.h"
 #include "log.h"
 #include "constants.h"
 
@@ -45,9 +46,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "s:o:uhVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool fileset = false;
     bool outfileset = false;
@@ -56,7 +59,7 @@ int main(int argc, char * argv[]) {
     char * outf = NULL;
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "s:o:uhVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -148,15 +151,14 @@ int main(int argc, char * argv[]) {
             for (unsigned int i = 0; i < seqs.size(); i++) {
                 (*poos) << seqs[i].get_fasta(toupcase);
             }
+        } else if (ft == 2 || ft == 3) {
+            // fasta or fastq: copied through without Sequence objects
+            write_fasta_stream(*pios, ft, retstring, toupcase, poos);
         } else {
-            // fasta, fastq, or simple phylip
+            // simple phylip
             while (read_next_seq_from_stream(*pios, ft, retstring, seq)) {
                 (*poos) << seq.get_fasta(toupcase);
             }
-            // fasta has a trailing one
-            if (ft == 2) {
-                (*poos) << seq.get_fasta(toupcase);
-            }
         }
     }
     
@@ -9,6 +9,7 @@
 #include "seq_reader.h"
 #include "sequence.h"
 #include "seq_utils.h"
+#include "seq_convert.h"
 #include "log.h"
 #include "constants.h"
 
@@ -24,6 +25,7 @@ void print_help() {
     std::cout << " -s, --seqf=FILE     input sequence file, STDIN otherwise" << std::endl;
     std::cout << " -o, --outf=FILE     output sequence file, STOUT otherwise" << std::endl;
     std::cout << " -u, --uppercase     export characters in uppercase" << std::endl;
+    std::cout << " -i, --interleave=INT write interleaved blocks of INT characters" << std::endl;
     std::cout << " -h, --help          display this help and exit" << std::endl;
     std::cout << " -V, --version       display version and exit" << std::endl;
     std::cout << " -C, --citation      display phyx citation and exit" << std::endl;
@@ -39,24 +41,28 @@ static struct option const long_options[] =
     {"seqf", required_argument, NULL, 's'},
     {"outf", required_argument, NULL, 'o'},
     {"uppercase", no_argument, NULL, 'u'},
+    {"interleave", required_argument, NULL, 'i'},
     {"help", no_argument, NULL, 'h'},
     {"version", no_argument, NULL, 'V'},
     {"citation", no_argument, NULL, 'C'},
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "s:o:ui:hVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool fileset = false;
     bool outfileset = false;
     bool toupcase = false;
+    int width = 0;
     char * seqf = NULL;
     char * outf = NULL;
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "s:o:uhVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -73,6 +79,13 @@ int main(int argc, char * argv[]) {
             case 'u':
                 toupcase = true;
                 break;
+            case 'i':
+                width = string_to_int(optarg, "-i");
+                if (width < 1) {
+                    std::cerr << "Error: interleave width must be positive. Exiting." << std::endl;
+                    exit(0);
+                }
+                break;
             case 'h':
                 print_help();
                 exit(0);
@@ -121,43 +134,48 @@ int main(int argc, char * argv[]) {
     }
 
     int ft = test_seq_filetype_stream(*pios, retstring);
-    // extra stuff to deal with possible interleaved nexus
-    // yes, nexus to nexus conversion is silly. but could go from interleaved to non-interleaved
-    if (ft == 0) {
-        bool interleave = false;
-        get_nexus_dimensions(*pios, num_taxa, num_char, interleave);
-        retstring = ""; // need to do this to let seqreader know we are mid-file
-        if (!interleave) {
-            while (read_next_seq_from_stream(*pios, ft, retstring, seq)) {
-                seqs.push_back(seq);
-            }
-        } else {
-            seqs = read_interleaved_nexus(*pios, num_taxa, num_char);
-        }
+    if (fileset && SeqConverter::can_index(ft)) {
+        // fasta and fastq files are indexed and copied, not loaded
+        SeqConverter conv(seqf, ft, toupcase);
+        conv.write_nexus(poos, width);
     } else {
-        bool complicated_phylip = false;
-        // check if we are dealing with a complicated phylip format
-        if (ft == 1) {
-            get_phylip_dimensions(retstring, num_taxa, num_char);
-            complicated_phylip = is_complicated_phylip(*pios, num_char);
-        }
-        if (complicated_phylip) {
-            seqs = read_phylip(*pios, num_taxa, num_char);
+        // extra stuff to deal with possible interleaved nexus
+        // yes, nexus to nexus conversion is silly. but could go from interleaved to non-interleaved
+        if (ft == 0) {
+            bool interleave = false;
+            get_nexus_dimensions(*pios, num_taxa, num_char, interleave);
+            retstring = ""; // need to do this to let seqreader know we are mid-file
+            if (!interleave) {
+                while (read_next_seq_from_stream(*pios, ft, retstring, seq)) {
+                    seqs.push_back(seq);
+                }
+            } else {
+                seqs = read_interleaved_nexus(*pios, num_taxa, num_char);
+            }
         } else {
-            // fasta, fastq, or simple phylip
-            while (read_next_seq_from_stream(*pios, ft, retstring, seq)) {
-                seqs.push_back(seq);
+            bool complicated_phylip = false;
+            // check if we are dealing with a complicated phylip format
+            if (ft == 1) {
+                get_phylip_dimensions(retstring, num_taxa, num_char);
+                complicated_phylip = is_complicated_phylip(*pios, num_char);
             }
-            // fasta has a trailing one
-            if (ft == 2) {
-                seqs.push_back(seq);
+            if (complicated_phylip) {
+                seqs = read_phylip(*pios, num_taxa, num_char);
+            } else {
+                // fasta, fastq, or simple phylip
+                while (read_next_seq_from_stream(*pios, ft, retstring, seq)) {
+                    seqs.push_back(seq);
+                }
+                // fasta has a trailing one
+                if (ft == 2) {
+                    seqs.push_back(seq);
+                }
             }
         }
-        
+        SeqConverter conv(seqs, toupcase);
+        conv.write_nexus(poos, width);
     }
     
-    write_nexus_alignment(seqs, toupcase, poos);
-    
     if (fileset == true) {
         fstr->close();
         delete pios;
@@ -1,14 +1,15 @@
-#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <vector>
 #include <cstring>
+#include <cstdlib>
 #include <getopt.h>
 
 #include "seq_reader.h"
 #include "sequence.h"
 #include "seq_utils.h"
+#include "seq_sort.h"
 #include "utils.h"
 #include "log.h"
 #include "edlib.h"
@@ -19,7 +20,10 @@ extern std::string PHYX_CITATION;
 
 void print_help() {
     std::cout << "Sort sequences by id or length." << std::endl;
-    std::cout << "This will take fasta, phylip, and nexus formats from a file or STDIN." << std::endl;
+    std::cout << "This will take fasta, fastq, phylip, and nexus formats from a file or STDIN." << std::endl;
+    std::cout << "Inputs larger than the memory limit are sorted in runs which are spilled" << std::endl;
+    std::cout << "to temporary files and then merged." << std::endl;
+    std::cout << "Results are written in fasta format." << std::endl;
     std::cout << std::endl;
     std::cout << "Usage: pxssort [OPTIONS]..." << std::endl;
     std::cout << std::endl;
@@ -27,6 +31,10 @@ void print_help() {
     std::cout << " -s, --seqf=FILE     input sequence file, STDIN otherwise" << std::endl;
     std::cout << " -b, --sortby        what to sort by: 1:id (default) 2:id rev" << std::endl;
     std::cout << "                                      3:length (<)   4:length (>)" << std::endl;
+    std::cout << " -d, --dedup=STR     drop repeats, keeping the first: 'id' (same id) or" << std::endl;
+    std::cout << "                       'seq' (same sequence)" << std::endl;
+    std::cout << " -M, --memory=INT    memory for in-memory runs, in MB (default 1024)" << std::endl;
+    std::cout << " -T, --tmpdir=DIR    directory for temporary files, $TMPDIR or /tmp otherwise" << std::endl;
     std::cout << " -o, --outf=FILE     output sequence file, STOUT otherwise" << std::endl;
     std::cout << " -h, --help          display this help and exit" << std::endl;
     std::cout << " -V, --version       display version and exit" << std::endl;
@@ -42,6 +50,9 @@ static struct option const long_options[] =
 {
     {"seqf", required_argument, NULL, 's'},
     {"sortby", required_argument, NULL, 'b'},
+    {"dedup", required_argument, NULL, 'd'},
+    {"memory", required_argument, NULL, 'M'},
+    {"tmpdir", required_argument, NULL, 'T'},
     {"outf", required_argument, NULL, 'o'},
     {"help", no_argument, NULL, 'h'},
     {"version", no_argument, NULL, 'V'},
@@ -49,43 +60,27 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
-struct SequenceIDListCompare {
-    bool operator()(const Sequence& lhs, const Sequence& rhs) {
-      return lhs.get_id() < rhs.get_id();
-    }
-} SequenceIDListCompare;
-
-struct SequenceRevIDListCompare {
-    bool operator()(const Sequence& lhs, const Sequence& rhs) {
-      return lhs.get_id() > rhs.get_id();
-    }
-} SequenceRevIDListCompare;
-
-struct SequenceLengthListCompare {
-    bool operator()(const Sequence& lhs, const Sequence& rhs) {
-      return lhs.get_sequence().length() < rhs.get_sequence().length();
-  }
-} SequenceLengthListCompare;
-
-struct SequenceRevLengthListCompare {
-    bool operator()(const Sequence& lhs, const Sequence& rhs) {
-      return lhs.get_sequence().length() > rhs.get_sequence().length();
-  }
-} SequenceRevLengthListCompare;
+static const char * const short_options = "s:b:d:M:T:o:hgVC";
 
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool fileset = false;
     bool outfileset = false;
     int sortby = 1;
+    int dedup = 0;
+    long int memory = 1024;
+    std::string tmpdir = "/tmp";
+    if (getenv("TMPDIR") != NULL) {
+        tmpdir = getenv("TMPDIR");
+    }
     
     char * seqf = NULL;
     char * outf = NULL;
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "s:b:o:hgVC", long_options,&oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -97,6 +92,30 @@ int main(int argc, char * argv[]) {
                 break;
             case 'b':
                 sortby = string_to_int(optarg, "-b");
+                if (sortby < 1 || sortby > 4) {
+                    std::cerr << "Error: -b must be 1, 2, 3, or 4. Exiting." << std::endl;
+                    exit(0);
+                }
+                break;
+            case 'd':
+                if (strcmp(optarg, "id") == 0) {
+                    dedup = 1;
+                } else if (strcmp(optarg, "seq") == 0) {
+                    dedup = 2;
+                } else {
+                    std::cerr << "Error: -d must be 'id' or 'seq'. Exiting." << std::endl;
+                    exit(0);
+                }
+                break;
+            case 'M':
+                memory = string_to_long_int(optarg, "-M");
+                if (memory < 1) {
+                    std::cerr << "Error: -M must be at least 1 (MB). Exiting." << std::endl;
+                    exit(0);
+                }
+                break;
+            case 'T':
+                tmpdir = optarg;
                 break;
             case 'o':
                 outfileset = true;
@@ -143,22 +162,58 @@ int main(int argc, char * argv[]) {
         poos =&std::cout;
     }
     
-    std::string alphaName = "";
-    std::vector<Sequence> seqs = ingest_alignment(pios, alphaName);
+    SequenceSorter sorter(sortby, dedup, (size_t)memory << 20, tmpdir);
     
-    if (sortby == 1) {
-        sort(seqs.begin(), seqs.end(), SequenceIDListCompare);
-    } else if (sortby == 2) {
-        sort(seqs.begin(), seqs.end(), SequenceRevIDListCompare);
-    } else if (sortby == 3) {
-        sort(seqs.begin(), seqs.end(), SequenceLengthListCompare);
-    } else if (sortby == 4) {
-        sort(seqs.begin(), seqs.end(), SequenceRevLengthListCompare);
+    // fasta, fastq, simple phylip and sequential nexus are streamed into the
+    // sorter; interleaved nexus and complicated phylip have to be read whole
+    Sequence seq;
+    std::string retstring;
+    int num_taxa = 0;
+    int num_char = 0;
+    int ft = test_seq_filetype_stream(*pios, retstring);
+    bool streamable = true;
+    if (ft == 0) {
+        bool interleave = false;
+        get_nexus_dimensions(*pios, num_taxa, num_char, interleave);
+        retstring = ""; // need to do this to let seqreader know we are mid-file
+        if (interleave) {
+            streamable = false;
+            std::vector<Sequence> seqs = read_interleaved_nexus(*pios, num_taxa, num_char);
+            for (unsigned int i = 0; i < seqs.size(); i++) {
+                sorter.add(seqs[i]);
+            }
+        }
+    } else if (ft == 1) {
+        get_phylip_dimensions(retstring, num_taxa, num_char);
+        if (is_complicated_phylip(*pios, num_char)) {
+            streamable = false;
+            std::vector<Sequence> seqs = read_phylip(*pios, num_taxa, num_char);
+            for (unsigned int i = 0; i < seqs.size(); i++) {
+                sorter.add(seqs[i]);
+            }
+        }
+    } else if (ft != 2 && ft != 3) {
+        std::cerr << "Error: unrecognized sequence file format. Exiting." << std::endl;
+        exit(0);
+    }
+    if (streamable) {
+        while (read_next_seq_from_stream(*pios, ft, retstring, seq)) {
+            sorter.add(seq);
+        }
+        // fasta has a trailing one
+        if (ft == 2) {
+            sorter.add(seq);
+        }
     }
-    for (unsigned int i=0;i<seqs.size();i++) {
-        (*poos) << seqs[i].get_fasta();
+    // some simple error-checking (nothing is written yet)
+    if (num_taxa != 0 && (uint64_t)num_taxa != sorter.get_num_seqs()) {
+        std::cerr << "Error: number of taxa declared in the file (" << num_taxa
+            << ") does not match the number read (" << sorter.get_num_seqs()
+            << "). Exiting." << std::endl;
+        exit(1);
     }
-
+    sorter.write(poos);
+    
     if (fileset) {
         fstr->close();
         delete pios;
@@ -4,6 +4,9 @@
 #include <vector>
 #include <string>
 #include <set>
+#include <map>
+#include <sstream>
+#include <algorithm>
 
 #include "node.h"
 #include "tree_reader.h"
@@ -69,6 +72,8 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "d:t:c:o:n:m:a:l:p:hVwzC";
+
 bool checkdata(Tree * intree, std::vector<Sequence> runseqs);
 bool checkdata(Tree * intree, std::vector<Sequence> runseqs) {
     std::vector<std::string> ret;
@@ -96,9 +101,430 @@ bool checkdata(Tree * intree, std::vector<Sequence> runseqs) {
     return seqnames == treenames;
 }
 
+// configuration shared (read only) by all of the site x tree fits
+struct StrecSettings {
+    bool verbose;
+    bool estimate;
+    bool periodsset;
+    bool dataz;
+    int nstates;
+    std::string freeparams;
+    std::vector<std::vector<double> > ratematrix;
+    std::vector<double> period_times;
+    std::map<std::string, std::vector<std::string> > mrcas;
+    std::vector<std::string> ancstates;
+    std::vector<std::string> stochtime;
+    std::vector<std::string> stochnumber;
+    std::vector<std::string> stochnumber_any;
+};
+
+// a site in wide (one column per state) format, reduced to the states present
+struct StrecSite {
+    std::vector<Sequence> runseqs;
+    std::vector<int> existing_states;
+    int nstates;
+};
+
+// buffered output of a single fit
+struct StrecResult {
+    bool good;
+    std::string log;
+    std::string out;
+    std::string anc;
+    std::string stnum;
+    std::string sttime;
+    std::string stnumany;
+};
+
+// fit site n on tree i (the caller's private copy) and write the ancestral state
+// and stochastic mapping rows. returns false if a negative value was encountered
+bool fit_site_tree (const StrecSettings& settings, StrecSite& site, const int& n,
+    const int& i, Tree * tree, std::ostream * loos, std::ostream * poos,
+    std::ostream& ancout, std::ostream& stnumout, std::ostream& sttimeout,
+    std::ostream& sttnumout_any);
+bool fit_site_tree (const StrecSettings& settings, StrecSite& site, const int& n,
+    const int& i, Tree * tree, std::ostream * loos, std::ostream * poos,
+    std::ostream& ancout, std::ostream& stnumout, std::ostream& sttimeout,
+    std::ostream& sttnumout_any) {
+    const bool& verbose = settings.verbose;
+    const bool& estimate = settings.estimate;
+    const bool& periodsset = settings.periodsset;
+    const bool& dataz = settings.dataz;
+    const int& nstates = settings.nstates;
+    const std::string& freeparams = settings.freeparams;
+    const std::vector<std::vector<double> >& ratematrix = settings.ratematrix;
+    std::vector<double> period_times = settings.period_times;
+    const std::map<std::string, std::vector<std::string> >& mrcas = settings.mrcas;
+    const std::vector<std::string>& ancstates = settings.ancstates;
+    const std::vector<std::string>& stochtime = settings.stochtime;
+    const std::vector<std::string>& stochnumber = settings.stochnumber;
+    const std::vector<std::string>& stochnumber_any = settings.stochnumber_any;
+    std::vector<Sequence>& runseqs = site.runseqs;
+    const std::vector<int>& existing_states = site.existing_states;
+    const int& nstates_site_n = site.nstates;
+    
+    if (verbose) {
+        (*loos) << i << std::endl;
+    }
+    std::vector<RateModel> rms;
+    RateModel rm(nstates_site_n);
+    StateReconstructor sr(rm, rms);
+    rm.setup_P(0.1, false);
+    if (periodsset == true) {
+        rms.push_back(rm);
+        for (unsigned int p=1; p < period_times.size(); p++) {
+            RateModel rm2(nstates_site_n);
+            rm2.setup_P(0.1, false);
+            rms.push_back(rm2);
+        }
+        sr.set_periods(period_times, rms);
+    }
+    sr.set_store_p_matrices(false);
+    sr.set_log_stream(poos);
+    if (verbose) {
+        (*loos) << "tips: " << tree->getExternalNodeCount() << std::endl;
+    }
+    sr.set_tree(tree);
+    if (periodsset == true) {
+        sr.set_periods_model();
+    }
+    bool same;
+    if (dataz == false) {
+        same = sr.set_tip_conditionals(runseqs);
+    } else {
+        same = sr.set_tip_conditionals_already_given(runseqs);
+    }
+    if (same == true) {
+        (*loos) << "skipping calculation" << std::endl;
+        return true;
+    }
+    double finallike; Superdouble totlike_sd;
+    if (periodsset == false) {
+        mat free_var(nstates_site_n, nstates_site_n);
+        free_var.fill(0);
+        int ct = 0;
+        if (freeparams == "_one_") {
+            ct = 1;
+        } else if (freeparams == "_all_") {
+            ct = 0;
+            for (int k=0; k < nstates_site_n; k++) {
+                for (int j=0; j < nstates_site_n; j++) {
+                    if (k != j) {
+                        free_var(k, j) = ct;
+                        ct += 1;
+                    }
+                }
+            }
+        }
+        if (verbose) {
+            (*loos) << free_var << std::endl;
+            (*loos) << ct << std::endl;
+        }
+        rm.neg_p = false;
+        (*poos) << "likelihood: " << sr.eval_likelihood() << std::endl;
+        //estimating the optimal rates
+        if (estimate) {//optimize
+            optimize_sr_nlopt(&rm, &sr, &free_var, ct);
+        } else { // requires that the ratematrix is available
+            for (int i=0; i < nstates_site_n; i++) {
+                for (int j=0; j < nstates_site_n; j++) {
+                    free_var(i, j) = ratematrix[i][j];
+                }
+            }
+        }
+        //end estimating
+        if (verbose) {
+            (*loos) << free_var << std::endl;
+        }
+        rm.setup_Q(free_var);
+        sr.set_store_p_matrices(true);
+        finallike = sr.eval_likelihood();
+        if (verbose) {
+            (*loos) << "final_likelihood: " << finallike << std::endl;
+        }
+    } else { //optimize with periods
+        std::vector<mat> periods_free_var(period_times.size());
+        int ct = 0;
+        if (freeparams == "_one_") {
+            ct = 1;
+            for (unsigned int s=0; s < period_times.size(); s++) {
+                mat free_var(nstates_site_n, nstates_site_n);
+                free_var.fill(0);
+                periods_free_var[s] = free_var;
+            }
+        } else if (freeparams == "_all_") {
+            ct = 0;
+            for (unsigned int s=0; s < period_times.size(); s++) {
+                mat free_var(nstates_site_n, nstates_site_n);
+                free_var.fill(0);
+                for (int k=0; k < nstates_site_n; k++) {
+                    for (int j=0; j < nstates_site_n; j++) {
+                    if (k != j) {
+                        free_var(k, j) = ct;
+                        ct += 1;
+                    }
+                    }
+                }
+                periods_free_var[s] = free_var;
+            }
+        }
+        if (verbose) {
+            for (unsigned int s=0; s < period_times.size(); s++) {
+                (*loos) << periods_free_var[s] << std::endl;
+            }
+            (*loos) << ct << std::endl;
+        }
+        rm.neg_p = false;
+        (*poos) << "likelihood: " << sr.eval_likelihood() << std::endl;
+        optimize_sr_periods_nlopt(&rms, &sr, &periods_free_var, ct);
+        if (verbose) {
+            for (unsigned int s=0; s < period_times.size(); s++) {
+                (*loos) << periods_free_var[s] << std::endl;
+            }
+            (*loos) << ct << std::endl;
+            (*poos) << "////////////////////////" << std::endl;
+        }
+        for (unsigned int s=0; s < period_times.size(); s++) {
+            rms[s].setup_Q(periods_free_var[s]);
+        }
+        sr.set_store_p_matrices(true);
+        finallike = sr.eval_likelihood();
+        if (verbose) {
+            (*loos) << "final_likelihood: " << finallike << std::endl;
+        }
+        (*poos) << "period set and so no ancestral states just yet" << std::endl;
+        return true;
+    }
+    if (verbose) {
+        (*loos) << "ancestral states" << std::endl;
+    }
+    sr.prepare_ancstate_reverse();
+    for (unsigned int j=0; j < ancstates.size(); j++) {
+    if (ancstates[j] == "_all_") {
+        std::vector<Superdouble> lhoods;
+        for (int l=0; l < tree->getInternalNodeCount(); l++) {
+            lhoods = sr.calculate_ancstate_reverse_sd(*tree->getInternalNode(l));
+            totlike_sd = calculate_vector_Superdouble_sum(lhoods);
+
+            //bool neg = false; // not used
+            int excount = 0;
+            double highest = 0;
+            int high = 0;
+            for (int k=0; k < nstates; k++) {
+                if (existing_states[k] == 1) {
+                    if (double(lhoods[excount]/totlike_sd) > highest) {
+                        highest= double(lhoods[excount]/totlike_sd);
+                        high = k;
+                    }
+                    excount += 1;
+                }
+            }
+            std::string s;
+            std::stringstream out;
+            out << high;
+            tree->getInternalNode(l)->setName(out.str());
+        }
+        ancout << getNewickString(tree) << std::endl;
+    } else {
+        std::vector<Superdouble> lhoods;
+        if (verbose) {
+            (*loos) << "node: " << tree->getMRCA(mrcas.at(ancstates[j]))->getName() << "\tmrca: " << ancstates[j] <<  std::endl;
+        }
+        ancout << n+1 << "\t" << i+1 << "\t" << ancstates[j] << "\t" << finallike;
+        lhoods = sr.calculate_ancstate_reverse_sd(*tree->getMRCA(mrcas.at(ancstates[j])));
+        totlike_sd = calculate_vector_Superdouble_sum(lhoods);
+        bool neg = false;
+        int excount = 0;
+        for (int k=0; k < nstates; k++) {
+            if (existing_states[k] == 1) {
+                if (verbose) {
+                    (*loos) << double(lhoods[excount]/totlike_sd) << " ";//"(" << lhoods[excount] << ") ";
+                }
+                ancout << "\t" << double(lhoods[excount]/totlike_sd);
+                if (double(lhoods[excount]/totlike_sd) < 0)
+                neg = true;
+                excount += 1;
+            } else {
+                if (verbose) {
+                    (*loos) << "NA" << " ";
+                    ancout << "\t" << "NA";
+                }
+            }
+        }
+        if (neg == true) {
+            return false;
+        }
+        ancout << std::endl;
+        if (verbose) {
+            (*loos) << std::endl;
+        }
+    }
+    }
+    // every stochastic mapping query (all states/pairs, all mrcas) is answered
+    // from a single batch
+    std::map<std::string, int> stochindex;
+    std::vector<Node *> stochnodes;
+    std::vector<std::string> stochmrcas(stochtime);
+    stochmrcas.insert(stochmrcas.end(), stochnumber.begin(), stochnumber.end());
+    stochmrcas.insert(stochmrcas.end(), stochnumber_any.begin(), stochnumber_any.end());
+    for (unsigned int j=0; j < stochmrcas.size(); j++) {
+        if (stochindex.count(stochmrcas[j]) == 0) {
+            stochindex[stochmrcas[j]] = (int)stochnodes.size();
+            stochnodes.push_back(tree->getMRCA(mrcas.at(stochmrcas[j])));
+        }
+    }
+    std::vector<mat> stochnumbers;
+    std::vector<std::vector<double> > stochtimes;
+    std::vector<double> stochany;
+    if (stochnodes.size() > 0) {
+        sr.calculate_stochmap_batch(stochnodes, stochnumbers, stochtimes, stochany);
+    }
+    if (verbose) {
+        (*loos) << std::endl;
+        (*loos) << "stochastic time" << std::endl;
+    }
+
+    for (unsigned int j=0; j < stochtime.size(); j++) {
+    if (tree->getMRCA(mrcas.at(stochtime[j]))->isRoot() == false) {
+        std::vector<double> lhoods;
+        if (verbose) {
+            (*loos)  << "mrca: " << stochtime[j] <<  std::endl;
+        }
+        sttimeout << n+1 << "\t" << i+1 << "\t" << stochtime[j]<< "\t" << finallike;
+        bool neg = false;
+        int excount = 0;
+        for (int k=0; k < nstates; k++) {
+            if (existing_states[k]==1) {
+                double tnum = stochtimes[stochindex[stochtime[j]]][excount]/double(totlike_sd);
+                double bl = tree->getMRCA(mrcas.at(stochtime[j]))->getBL();
+                if (verbose) {
+                    (*loos) << tnum << " ";
+                }
+                sttimeout << "\t" << tnum/bl;
+                if (tnum < 0) {
+                    neg = true;
+                }
+                excount += 1;
+            } else {
+                if (verbose) {
+                    (*loos) << "NA" << " ";
+                }
+                sttimeout << "\t" << "NA";
+            }
+
+        }
+        sttimeout << std::endl;
+        if (verbose) {
+            (*loos) << std::endl;
+        }
+        if (neg == true) {
+            return false;
+        }
+    }
+    }
+    if (verbose) {
+        (*loos) << std::endl;
+        (*loos) << "stochastic number" << std::endl;
+    }
+    for (unsigned int j=0; j < stochnumber.size(); j++) {
+        if (tree->getMRCA(mrcas.at(stochnumber[j]))->isRoot() == false) {
+            std::vector<double> lhoods;
+            if (verbose) {
+                (*loos) << "mrca: " << stochnumber[j] <<  std::endl;
+            }
+            stnumout << n+1 << "\t" << i+1 << "\t" << stochnumber[j]<< "\t" << finallike;
+            bool neg = false;
+            int excount = 0;
+            for (int k=0; k < nstates; k++) {
+                if (existing_states[k]==1) {
+                    int excount2 = 0;
+                    for (int l=0; l < nstates; l++) {
+                        if (existing_states[l] == 1) {
+                            if (k == l) {
+                                if (verbose) {
+                                    (*loos) << " - ";
+                                }
+                            } else {
+                                double tnum = stochnumbers[stochindex[stochnumber[j]]](excount, excount2)/totlike_sd;
+                                if (verbose) {
+                                    (*loos) << tnum << " ";
+                                }
+                                stnumout << "\t" << tnum;
+                                if (tnum < 0) {
+                                    neg = true;
+                                }
+                            }
+                            excount2 += 1;
+                        } else {
+                            if (verbose) {
+                                (*loos) << "NA" << " ";
+                            }
+                            stnumout << "\t" << "NA";
+                        }
+                    }
+                    if (verbose) {
+                        (*loos) << std::endl;
+                    }
+                    excount += 1;
+                } else {
+                    for (int l=0; l < nstates; l++) {
+                        if (k == l) {
+                            if (verbose) {
+                                (*loos) << " - ";
+                            }
+                        } else {
+                            if (verbose) {
+                                (*loos) << "NA" << " ";
+                            }
+                            stnumout << "\t" << "NA";
+                        }
+                    }
+                    if (verbose) {
+                        (*loos) << std::endl;
+                    }
+                }
+            }
+            stnumout << std::endl;
+            if (verbose) {
+                (*loos) << std::endl;
+            }
+            if (neg == true) {
+                return false;
+            }
+        }
+    }
+    if (verbose) {
+        (*loos) << std::endl;
+    }
+    if (verbose) {
+        (*loos) << "stochastic number (any)" << std::endl;
+    }
+    for (unsigned int j=0; j < stochnumber_any.size(); j++) {
+        if (tree->getMRCA(mrcas.at(stochnumber_any[j]))->isRoot() == false) {
+            std::vector<double> lhoods;
+            if (verbose) {
+                (*loos) << "node: " << tree->getMRCA(mrcas.at(stochnumber_any[j]))->getName() << " mrca: " << stochnumber_any[j] <<  std::endl;
+            }
+            sttnumout_any << n+1 << "\t" << i+1 << "\t" << stochnumber_any[j]<< "\t" << finallike;
+            double tnum = stochany[stochindex[stochnumber_any[j]]]/totlike_sd;
+            //(*loos) << sum(stoch) << " " << totlike << std::endl;
+            if (verbose) {
+                (*loos) << tnum << " " ;
+            }
+            sttnumout_any << "\t" << tnum;
+            sttnumout_any << std::endl;
+            if (verbose) {
+                (*loos) << std::endl;
+            }
+        }
+    }
+
+    return true;
+}
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     //bool datafileset = false; // not used
     //bool treefileset = false; // not used
@@ -125,7 +551,7 @@ int main(int argc, char * argv[]) {
     
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "d:t:c:o:n:m:a:l:p:hVwzC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -322,7 +748,7 @@ int main(int argc, char * argv[]) {
      * read the tree file
      */
     TreeReader tr;
-    std::vector<Tree *> trees;
+    std::vector<std::string> treestrings; // each fit parses its own copy
     std::ifstream infile2(treef);
     if (!infile2) {
         std::cerr << "Error: could not open treefile. Exiting." << std::endl;
@@ -331,12 +757,18 @@ int main(int argc, char * argv[]) {
     line = "";
     while (getline(infile2, line)) {
         if (line.length() > 5) {
-            trees.push_back(tr.readTree(line));
+            //checking that the data and the tree have the same names
+            Tree * tree = tr.readTree(line);
+            if (checkdata(tree, seqs) == 0) {
+                exit(0);
+            }
+            delete tree;
+            treestrings.push_back(line);
         }
     }
     infile2.close();
     if (verbose) {
-        (*loos) << "trees: " << trees.size() << std::endl;
+        (*loos) << "trees: " << treestrings.size() << std::endl;
     }
     
     /**
@@ -428,17 +860,23 @@ int main(int argc, char * argv[]) {
         sttnumout_any << std::endl;
     }
     
+    // prepare every site up front. the (verbose) per-site messages are held back
+    // and written ahead of the site's first fit
+    std::vector<StrecSite> sites(nsites);
+    std::vector<std::string> site_logs(nsites);
     for (int n = 0; n < nsites; n++) {
-        (*loos) << "site: " << n+1 << std::endl;
+        std::ostringstream slog;
+        slog << "site: " << n+1 << std::endl;
         /*
          * this converts the data and is a little long to accomodate datasets
          * with sites that don't have all the states but the results can still
          * be printed to the same outfile for analysis after
          */
         //need to put the data into a wide view
-        std::vector<Sequence> runseqs;
-        int nstates_site_n;
-        std::vector<int> existing_states(nstates, 0);
+        std::vector<Sequence>& runseqs = sites[n].runseqs;
+        int& nstates_site_n = sites[n].nstates;
+        std::vector<int>& existing_states = sites[n].existing_states;
+        existing_states.resize(nstates, 0);
         if (datawide == false) {
             for (unsigned int se = 0;se<seqs.size();se++) {
                 std::vector<std::string> searchtokens;
@@ -495,363 +933,82 @@ int main(int argc, char * argv[]) {
         }
 
         if (verbose) {
-            (*loos) << "states: " << nstates_site_n << std::endl;
-            (*loos) << "trees: ";
+            slog << "states: " << nstates_site_n << std::endl;
+            slog << "trees: ";
         }
-        for (unsigned int i=0; i < trees.size(); i++) {
-            if (verbose) {
-                (*loos) << i << std::endl;
-            }
-            std::vector<RateModel> rms;
-            RateModel rm(nstates_site_n);
-            StateReconstructor sr(rm, rms);
-            rm.setup_P(0.1, false);
-            if (periodsset == true) {
-                rms.push_back(rm);
-                for (unsigned int p=1; p < period_times.size(); p++) {
-                    RateModel rm2(nstates_site_n);
-                    rm2.setup_P(0.1, false);
-                    rms.push_back(rm2);
-                }
-                sr.set_periods(period_times, rms);
-            }
-            sr.set_store_p_matrices(false);
-            Tree * tree = trees[i];
-            if (verbose) {
-                (*loos) << "tips: " << tree->getExternalNodeCount() << std::endl;
-            }
-            sr.set_tree(tree);
-            if (periodsset == true) {
-                sr.set_periods_model();
+        site_logs[n] = slog.str();
+    }
+    
+    // give every queried clade an entry (empty if not in the mrca file, as
+    // operator[] used to), so the fits' concurrent .at() lookups never insert
+    for (unsigned int j=0; j < ancstates.size(); j++) {
+        mrcas[ancstates[j]];
+    }
+    for (unsigned int j=0; j < stochtime.size(); j++) {
+        mrcas[stochtime[j]];
+    }
+    for (unsigned int j=0; j < stochnumber.size(); j++) {
+        mrcas[stochnumber[j]];
+    }
+    for (unsigned int j=0; j < stochnumber_any.size(); j++) {
+        mrcas[stochnumber_any[j]];
+    }
+    StrecSettings settings;
+    settings.verbose = verbose;
+    settings.estimate = estimate;
+    settings.periodsset = periodsset;
+    settings.dataz = dataz;
+    settings.nstates = nstates;
+    settings.freeparams = freeparams;
+    settings.ratematrix = ratematrix;
+    settings.period_times = period_times;
+    settings.mrcas = mrcas;
+    settings.ancstates = ancstates;
+    settings.stochtime = stochtime;
+    settings.stochnumber = stochnumber;
+    settings.stochnumber_any = stochnumber_any;
+    
+    const int ntrees = (int)treestrings.size();
+    const int njobs = nsites * ntrees;
+    const int batchsize = 256;
+    // every site x tree combination is an independent fit (with its own copy of
+    // the tree, rate model(s) and optimizer context), so these are run across
+    // threads. output is buffered per fit and written in site/tree order
+    for (int start = 0; start < njobs; start += batchsize) {
+        int stop = std::min(start + batchsize, njobs);
+        std::vector<StrecResult> results(stop - start);
+        #pragma omp parallel for schedule(dynamic)
+        for (int job = start; job < stop; job++) {
+            int n = job / ntrees;
+            int i = job % ntrees;
+            std::ostringstream los, oos, anc, stnum, sttime, stnumany;
+            if (i == 0) {
+                los << site_logs[n];
             }
-            //checking that the data and the tree have the same names
-            if (checkdata(tree, runseqs) == 0) {
+            TreeReader tr;
+            Tree * tree = tr.readTree(treestrings[i]);
+            StrecResult& res = results[job - start];
+            // without a log file, log and stdout are the same stream
+            res.good = fit_site_tree(settings, sites[n], n, i, tree, &los,
+                (logfileset ? &oos : &los), anc, stnum, sttime, stnumany);
+            delete tree;
+            res.log = los.str();
+            res.out = oos.str();
+            res.anc = anc.str();
+            res.stnum = stnum.str();
+            res.sttime = sttime.str();
+            res.stnumany = stnumany.str();
+        }
+        for (unsigned int k=0; k < results.size(); k++) {
+            (*loos) << results[k].log;
+            std::cout << results[k].out;
+            ancout << results[k].anc;
+            stnumout << results[k].stnum;
+            sttimeout << results[k].sttime;
+            sttnumout_any << results[k].stnumany;
+            if (!results[k].good) {
                 exit(0);
             }
-            bool same;
-            if (dataz == false) {
-                same = sr.set_tip_conditionals(runseqs);
-            } else {
-                same = sr.set_tip_conditionals_already_given(runseqs);
-            }
-            if (same == true) {
-                (*loos) << "skipping calculation" << std::endl;
-                continue;
-            }
-            double finallike; Superdouble totlike_sd;
-            if (periodsset == false) {
-                mat free_var(nstates_site_n, nstates_site_n);
-                free_var.fill(0);
-                int ct = 0;
-                if (freeparams == "_one_") {
-                    ct = 1;
-                } else if (freeparams == "_all_") {
-                    ct = 0;
-                    for (int k=0; k < nstates_site_n; k++) {
-                        for (int j=0; j < nstates_site_n; j++) {
-                            if (k != j) {
-                                free_var(k, j) = ct;
-                                ct += 1;
-                            }
-                        }
-                    }
-                }
-                if (verbose) {
-                    (*loos) << free_var << std::endl;
-                    (*loos) << ct << std::endl;
-                }
-                rm.neg_p = false;
-                std::cout << "likelihood: " << sr.eval_likelihood() << std::endl;
-                //estimating the optimal rates
-                if (estimate) {//optimize
-                    optimize_sr_nlopt(&rm, &sr, &free_var, ct);
-                } else { // requires that the ratematrix is available
-                    for (int i=0; i < nstates_site_n; i++) {
-                        for (int j=0; j < nstates_site_n; j++) {
-                            free_var(i, j) = ratematrix[i][j];
-                        }
-                    }
-                }
-                //end estimating
-                if (verbose) {
-                    (*loos) << free_var << std::endl;
-                }
-                rm.setup_Q(free_var);
-                sr.set_store_p_matrices(true);
-                finallike = sr.eval_likelihood();
-                if (verbose) {
-                    (*loos) << "final_likelihood: " << finallike << std::endl;
-                }
-            } else { //optimize with periods
-                std::vector<mat> periods_free_var(period_times.size());
-                int ct = 0;
-                if (freeparams == "_one_") {
-                    ct = 1;
-                    for (unsigned int s=0; s < period_times.size(); s++) {
-                        mat free_var(nstates_site_n, nstates_site_n);
-                        free_var.fill(0);
-                        periods_free_var[s] = free_var;
-                    }
-                } else if (freeparams == "_all_") {
-                    ct = 0;
-                    for (unsigned int s=0; s < period_times.size(); s++) {
-                        mat free_var(nstates_site_n, nstates_site_n);
-                        free_var.fill(0);
-                        for (int k=0; k < nstates_site_n; k++) {
-                            for (int j=0; j < nstates_site_n; j++) {
-                            if (k != j) {
-                                free_var(k, j) = ct;
-                                ct += 1;
-                            }
-                            }
-                        }
-                        periods_free_var[s] = free_var;
-                    }
-                }
-                if (verbose) {
-                    for (unsigned int s=0; s < period_times.size(); s++) {
-                        (*loos) << periods_free_var[s] << std::endl;
-                    }
-                    (*loos) << ct << std::endl;
-                }
-                rm.neg_p = false;
-                std::cout << "likelihood: " << sr.eval_likelihood() << std::endl;
-                optimize_sr_periods_nlopt(&rms, &sr, &periods_free_var, ct);
-                if (verbose) {
-                    for (unsigned int s=0; s < period_times.size(); s++) {
-                        (*loos) << periods_free_var[s] << std::endl;
-                    }
-                    (*loos) << ct << std::endl;
-                    std::cout << "////////////////////////" << std::endl;
-                }
-                for (unsigned int s=0; s < period_times.size(); s++) {
-                    rms[s].setup_Q(periods_free_var[s]);
-                }
-                sr.set_store_p_matrices(true);
-                finallike = sr.eval_likelihood();
-                if (verbose) {
-                    (*loos) << "final_likelihood: " << finallike << std::endl;
-                }
-                std::cout << "period set and so no ancestral states just yet" << std::endl;
-                continue;
-            }
-            if (verbose) {
-                (*loos) << "ancestral states" << std::endl;
-            }
-            sr.prepare_ancstate_reverse();
-            for (unsigned int j=0; j < ancstates.size(); j++) {
-            if (ancstates[j] == "_all_") {
-                std::vector<Superdouble> lhoods;
-                for (int l=0; l < tree->getInternalNodeCount(); l++) {
-                    lhoods = sr.calculate_ancstate_reverse_sd(*tree->getInternalNode(l));
-                    totlike_sd = calculate_vector_Superdouble_sum(lhoods);
-
-                    //bool neg = false; // not used
-                    int excount = 0;
-                    double highest = 0;
-                    int high = 0;
-                    for (int k=0; k < nstates; k++) {
-                        if (existing_states[k] == 1) {
-                            if (double(lhoods[excount]/totlike_sd) > highest) {
-                                highest= double(lhoods[excount]/totlike_sd);
-                                high = k;
-                            }
-                            excount += 1;
-                        }
-                    }
-                    std::string s;
-                    std::stringstream out;
-                    out << high;
-                    tree->getInternalNode(l)->setName(out.str());
-                }
-                ancout << getNewickString(tree) << std::endl;
-            } else {
-                std::vector<Superdouble> lhoods;
-                if (verbose) {
-                    (*loos) << "node: " << tree->getMRCA(mrcas[ancstates[j]])->getName() << "\tmrca: " << ancstates[j] <<  std::endl;
-                }
-                ancout << n+1 << "\t" << i+1 << "\t" << ancstates[j] << "\t" << finallike;
-                lhoods = sr.calculate_ancstate_reverse_sd(*tree->getMRCA(mrcas[ancstates[j]]));
-                totlike_sd = calculate_vector_Superdouble_sum(lhoods);
-                bool neg = false;
-                int excount = 0;
-                for (int k=0; k < nstates; k++) {
-                    if (existing_states[k] == 1) {
-                        if (verbose) {
-                            (*loos) << double(lhoods[excount]/totlike_sd) << " ";//"(" << lhoods[excount] << ") ";
-                        }
-                        ancout << "\t" << double(lhoods[excount]/totlike_sd);
-                        if (double(lhoods[excount]/totlike_sd) < 0)
-                        neg = true;
-                        excount += 1;
-                    } else {
-                        if (verbose) {
-                            (*loos) << "NA" << " ";
-                            ancout << "\t" << "NA";
-                        }
-                    }
-                }
-                if (neg == true) {
-                    exit(0);
-                }
-                ancout << std::endl;
-                if (verbose) {
-                    (*loos) << std::endl;
-                }
-            }
-            }
-            if (verbose) {
-                (*loos) << std::endl;
-                (*loos) << "stochastic time" << std::endl;
-            }
-
-            for (unsigned int j=0; j < stochtime.size(); j++) {
-            if (tree->getMRCA(mrcas[stochtime[j]])->isRoot() == false) {
-                std::vector<double> lhoods;
-                if (verbose) {
-                    (*loos)  << "mrca: " << stochtime[j] <<  std::endl;
-                }
-                sttimeout << n+1 << "\t" << i+1 << "\t" << stochtime[j]<< "\t" << finallike;
-                bool neg = false;
-                int excount = 0;
-                for (int k=0; k < nstates; k++) {
-                    if (existing_states[k]==1) {
-                        sr.prepare_stochmap_reverse_all_nodes(excount, excount);
-                        sr.prepare_ancstate_reverse();
-                        std::vector<double> stoch = sr.calculate_reverse_stochmap(*tree->getMRCA(mrcas[stochtime[j]]), true);
-                        double tnum = sum(stoch)/double(totlike_sd);
-                        double bl = tree->getMRCA(mrcas[stochtime[j]])->getBL();
-                        if (verbose) {
-                            (*loos) << tnum << " ";
-                        }
-                        sttimeout << "\t" << tnum/bl;
-                        if (tnum < 0) {
-                            neg = true;
-                        }
-                        excount += 1;
-                    } else {
-                        if (verbose) {
-                            (*loos) << "NA" << " ";
-                        }
-                        sttimeout << "\t" << "NA";
-                    }
-
-                }
-                sttimeout << std::endl;
-                if (verbose) {
-                    (*loos) << std::endl;
-                }
-                if (neg == true) {
-                    exit(0);
-                }
-            }
-            }
-            if (verbose) {
-                (*loos) << std::endl;
-                (*loos) << "stochastic number" << std::endl;
-            }
-            for (unsigned int j=0; j < stochnumber.size(); j++) {
-                if (tree->getMRCA(mrcas[stochnumber[j]])->isRoot() == false) {
-                    std::vector<double> lhoods;
-                    if (verbose) {
-                        (*loos) << "mrca: " << stochnumber[j] <<  std::endl;
-                    }
-                    stnumout << n+1 << "\t" << i+1 << "\t" << stochnumber[j]<< "\t" << finallike;
-                    bool neg = false;
-                    int excount = 0;
-                    for (int k=0; k < nstates; k++) {
-                        if (existing_states[k]==1) {
-                            int excount2 = 0;
-                            for (int l=0; l < nstates; l++) {
-                                if (existing_states[l] == 1) {
-                                    if (k == l) {
-                                        if (verbose) {
-                                            (*loos) << " - ";
-                                        }
-                                    } else {
-                                        sr.prepare_stochmap_reverse_all_nodes(excount, excount2);
-                                        sr.prepare_ancstate_reverse();
-                                        std::vector<double> stoch = sr.calculate_reverse_stochmap(*tree->getMRCA(mrcas[stochnumber[j]]), false);
-                                        double tnum = sum(stoch)/totlike_sd;
-                                        if (verbose) {
-                                            (*loos) << tnum << " ";
-                                        }
-                                        stnumout << "\t" << tnum;
-                                        if (tnum < 0) {
-                                            neg = true;
-                                        }
-                                    }
-                                    excount2 += 1;
-                                } else {
-                                    if (verbose) {
-                                        (*loos) << "NA" << " ";
-                                    }
-                                    stnumout << "\t" << "NA";
-                                }
-                            }
-                            if (verbose) {
-                                (*loos) << std::endl;
-                            }
-                            excount += 1;
-                        } else {
-                            for (int l=0; l < nstates; l++) {
-                                if (k == l) {
-                                    if (verbose) {
-                                        (*loos) << " - ";
-                                    }
-                                } else {
-                                    if (verbose) {
-                                        (*loos) << "NA" << " ";
-                                    }
-                                    stnumout << "\t" << "NA";
-                                }
-                            }
-                            if (verbose) {
-                                (*loos) << std::endl;
-                            }
-                        }
-                    }
-                    stnumout << std::endl;
-                    if (verbose) {
-                        (*loos) << std::endl;
-                    }
-                    if (neg == true) {
-                        exit(0);
-                    }
-                }
-            }
-            if (verbose) {
-                (*loos) << std::endl;
-            }
-            if (verbose) {
-                (*loos) << "stochastic number (any)" << std::endl;
-            }
-            if (stochnumber_any.size() > 0) {
-                sr.prepare_stochmap_reverse_all_nodes_all_matrices();
-                sr.prepare_ancstate_reverse();
-            }
-            for (unsigned int j=0; j < stochnumber_any.size(); j++) {
-                if (tree->getMRCA(mrcas[stochnumber_any[j]])->isRoot() == false) {
-                    std::vector<double> lhoods;
-                    if (verbose) {
-                        (*loos) << "node: " << tree->getMRCA(mrcas[stochnumber_any[j]])->getName() << " mrca: " << stochnumber_any[j] <<  std::endl;
-                    }
-                    sttnumout_any << n+1 << "\t" << i+1 << "\t" << stochnumber_any[j]<< "\t" << finallike;
-                    std::vector<double> stoch = sr.calculate_reverse_stochmap(*tree->getMRCA(mrcas[stochnumber_any[j]]), false);
-                    double tnum = sum(stoch)/totlike_sd;
-                    //(*loos) << sum(stoch) << " " << totlike << std::endl;
-                    if (verbose) {
-                        (*loos) << tnum << " " ;
-                    }
-                    sttnumout_any << "\t" << tnum;
-                    sttnumout_any << std::endl;
-                    if (verbose) {
-                        (*loos) << std::endl;
-                    }
-                }
-            }
-
-            //delete tree;
         }
     }
     if (ancstates.size() > 0  && outancfileset == true) {
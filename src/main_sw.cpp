@@ -61,9 +61,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "s:o:a:t:m:n:vhVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool fileset = false;
     bool outfileset = false;
@@ -78,7 +80,7 @@ int main(int argc, char * argv[]) {
     bool verbose = false;
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "s:o:a:t:m:n:vhVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
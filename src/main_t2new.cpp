@@ -10,6 +10,8 @@
 #include "tree_reader.h"
 #include "utils.h"
 #include "tree_utils.h"
+#include "tree_writer.h"
+#include "tree_stream.h"
 #include "log.h"
 #include "constants.h"
 
@@ -45,9 +47,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "t:o:hVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool fileset = false;
     bool outfileset = false;
@@ -55,7 +59,7 @@ int main(int argc, char * argv[]) {
     char * outf = NULL;
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "t:o:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -110,45 +114,25 @@ int main(int argc, char * argv[]) {
     } else {
         poos = &std::cout;
     }
+    TreeWriter tw(poos);
     
-    //read trees 
-    std::string retstring;
-    int ft = test_tree_filetype_stream(*pios, retstring);
-    
-    if (ft == 0) {
-        std::map<std::string, std::string> translation_table;
-        bool ttexists;
-        ttexists = get_nexus_translation_table(*pios, &translation_table, &retstring);
-        bool going = true;
-        Tree * tree;
-        while (going) {
-            tree = read_next_tree_from_stream_nexus(*pios, retstring, ttexists,
-                &translation_table, &going);
-            if (going == true) {
-                (*poos) << getNewickString(tree) << std::endl;
-                delete tree;
-            }
-        }
-    } else if (ft == 1) {
-        // newick. just return original tree
-        Tree * tree;
-        bool going = true;
-        while (going) {
-            tree = read_next_tree_from_stream_newick(*pios, retstring, &going);
-            if (going == true) {
-                (*poos) << getNewickString(tree) << std::endl;
-                delete tree;
-            }
-        }
-    } else {
+    TreeStream trees(pios);
+    int ft = trees.get_filetype();
+    if (ft != 0 && ft != 1) {
         std::cerr << "Error: tree format not recognized. Exiting." << std::endl;
         exit(1);
     }
+    // nexus or newick; just return the (translated) tree
+    trees.process(tw, [] (Tree *& tree, const long&, std::string& out) {
+        append_tree(out, tree);
+        return true;
+    }, false);
     
     if (fileset) {
         fstr->close();
         delete pios;
     }
+    tw.flush();
     if (outfileset) {
         ofstr->close();
         delete poos;
@@ -10,6 +10,8 @@
 #include "tree_reader.h"
 #include "utils.h"
 #include "tree_utils.h"
+#include "tree_writer.h"
+#include "tree_stream.h"
 #include "log.h"
 #include "constants.h"
 
@@ -45,9 +47,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "t:o:hVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool fileset = false;
     bool outfileset = false;
@@ -55,7 +59,7 @@ int main(int argc, char * argv[]) {
     char * outf = NULL;
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "t:o:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -110,65 +114,30 @@ int main(int argc, char * argv[]) {
     } else {
         poos = &std::cout;
     }
+    TreeWriter tw(poos);
     
-    //read trees 
-    std::string retstring;
-    int ft = test_tree_filetype_stream(*pios, retstring);
-    
-    int treeCounter = 0;
-    bool going = true;
-    
-    if (ft == 1) {
-        Tree * tree;
-        while (going) {
-            tree = read_next_tree_from_stream_newick(*pios, retstring, &going);
-            if (tree != NULL) {
-                if (treeCounter == 0) {
-                    (*poos) << "#NEXUS" << std::endl << "Begin trees;" << std::endl;
-                }
-                if (is_rooted(tree)) {
-                    (*poos) << "tree tree" << treeCounter << " = [&R] "
-                            << getNewickString(tree) << std::endl;
-                } else {
-                    (*poos) << "tree tree" << treeCounter << " = [&U] "
-                            << getNewickString(tree) << std::endl;
-                }
-                treeCounter++;
-            }
-        }
-        (*poos) << "end;" << std::endl;
-    } else if (ft == 0) { // Nexus. need to worry about possible translation tables
-        std::map<std::string, std::string> translation_table;
-        bool ttexists;
-        ttexists = get_nexus_translation_table(*pios, &translation_table, &retstring);
-        Tree * tree;
-        while (going) {
-            tree = read_next_tree_from_stream_nexus(*pios, retstring, ttexists,
-                &translation_table, &going);
-            if (tree != NULL) {
-                if (treeCounter == 0) {
-                    (*poos) << "#NEXUS" << std::endl << "Begin trees;" << std::endl;
-                }
-                if (is_rooted(tree)) {
-                    (*poos) << "tree tree" << treeCounter << " = [&R] "
-                            << getNewickString(tree) << std::endl;
-                } else {
-                    (*poos) << "tree tree" << treeCounter << " = [&U] "
-                            << getNewickString(tree) << std::endl;
-                }
-                treeCounter++;
-            }
-        }
-        (*poos) << "end;" << std::endl;
-    } else {
+    TreeStream trees(pios);
+    int ft = trees.get_filetype();
+    if (ft != 0 && ft != 1) {
         std::cerr << "Error: tree format not recognized. Exiting." << std::endl;
         exit(1);
     }
+    trees.process(tw, [] (Tree *& tree, const long& index, std::string& out) {
+        if (index == 0) {
+            out += "#NEXUS\nBegin trees;\n";
+        }
+        out += "tree tree" + std::to_string(index);
+        out += is_rooted(tree) ? " = [&R] " : " = [&U] ";
+        append_tree(out, tree);
+        return true;
+    }, false);
+    tw.write("end;\n");
     
     if (fileset) {
         fstr->close();
         delete pios;
     }
+    tw.flush();
     if (outfileset) {
         ofstr->close();
         delete poos;
@@ -9,6 +9,7 @@
 #include "utils.h"
 #include "tree_reader.h"
 #include "tree_utils.h"
+#include "tree_writer.h"
 #include "log.h"
 #include "constants.h"
 
@@ -49,9 +50,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "t:m:d:o:hVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool outfileset = false;
     bool tfileset = false;
@@ -65,7 +68,7 @@ int main(int argc, char * argv[]) {
     std::string nnamef = "";
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "t:m:d:o:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -127,6 +130,7 @@ int main(int argc, char * argv[]) {
     } else {
         poos = &std::cout;
     }
+    TreeWriter tw(poos);
     
     //for node ids
     std::map<std::string, std::string> nodeid_map;
@@ -156,8 +160,7 @@ int main(int argc, char * argv[]) {
     bool going = true;
     if (ft == 1) {
         Tree * tree;
-        (*poos) << "#NEXUS" << std::endl;
-        (*poos) << "begin trees;" << std::endl;
+        tw.write("#NEXUS\nbegin trees;\n");
         while (going) {
             tree = read_next_tree_from_stream_newick(*pios, retstring, &going);
             if (going) {
@@ -174,18 +177,18 @@ int main(int argc, char * argv[]) {
                     } 
                 }
                 // put annotations here
-                (*poos) << "tree tree = " << getNewickString(tree) << std::endl;
+                tw.write("tree tree = ");
+                tw.write_tree(tree);
                 delete tree;
             }
         }
-        (*poos) << "end;" << std::endl;
+        tw.write("end;\n");
     } else if (ft == 0) { // Nexus. need to worry about possible translation tables
         std::map<std::string, std::string> translation_table;
         bool ttexists;
         ttexists = get_nexus_translation_table(*pios, &translation_table, &retstring);
         Tree * tree;
-        (*poos) << "#NEXUS" << std::endl;
-        (*poos) << "begin trees;" << std::endl;
+        tw.write("#NEXUS\nbegin trees;\n");
         while (going) {
             tree = read_next_tree_from_stream_nexus(*pios, retstring, ttexists,
                 &translation_table, &going);
@@ -203,12 +206,14 @@ int main(int argc, char * argv[]) {
                     } 
                 }   
                 // put annotations here
-                (*poos) << "tree tree = " << getNewickString(tree) << std::endl;
+                tw.write("tree tree = ");
+                tw.write_tree(tree);
                 delete tree;
             }
         }
     }
     
+    tw.flush();
     if (outfileset) {
         ofstr->close();
         delete poos;
@@ -2,6 +2,7 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <map>
 #include <cstring>
 #include <getopt.h>
 #include <algorithm>
@@ -11,6 +12,9 @@
 #include "tree_reader.h"
 #include "tree.h"
 #include "tree_utils.h"
+#include "tree_writer.h"
+#include "tree_stream.h"
+#include "tcomb.h"
 #include "utils.h"
 #include "log.h"
 #include "constants.h"
@@ -18,15 +22,10 @@
 extern std::string PHYX_CITATION;
 
 
-/*
-Give two options:
-1. pass in 2 trees
-2. pass in 1 distribution of trees
-*/
-
 void print_help () {
     std::cout << "Combine a set of trees from one file into a tree from another." << std::endl;
-    std::cout << "Pass in 2 trees with `t` and `a`." << std::endl;
+    std::cout << "Each tree from `a` is grafted in turn onto the tree from `t`, replacing" << std::endl;
+    std::cout << "the clade spanned by their shared taxa. The combined tree is written." << std::endl;
     std::cout << std::endl;
     std::cout << "Usage: pxtcomb [OPTIONS]... FILE" << std::endl;
     std::cout << std::endl;
@@ -55,9 +54,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "t:a:o:x:hVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool outfileset = false;
     bool tfileset = false;
@@ -69,7 +70,7 @@ int main(int argc, char * argv[]) {
     
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "t:a:o:x:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -123,6 +124,7 @@ int main(int argc, char * argv[]) {
     } else {
         poos = &std::cout;
     }
+    TreeWriter tw(poos);
     
     if (addfileset == true) {
         afstr = new std::ifstream(addtreef);
@@ -143,120 +145,49 @@ int main(int argc, char * argv[]) {
         }
     }
     
+    // the reference (backbone) tree is the first tree in its file; the rest
+    // are not read
+    Tree * bigtree = NULL;
     std::string retstring;
+    bool going = true;
     int ft = test_tree_filetype_stream(*pios, retstring);
-    if (ft != 0 && ft != 1) {
+    if (ft == 0) {
+        std::map<std::string, std::string> translation_table;
+        bool ttexists = get_nexus_translation_table(*pios, &translation_table, &retstring);
+        bigtree = read_next_tree_from_stream_nexus(*pios, retstring, ttexists,
+            &translation_table, &going);
+    } else if (ft == 1) {
+        bigtree = read_next_tree_from_stream_newick(*pios, retstring, &going);
+    } else {
         std::cerr << "Error: this really only works with nexus or newick. Exiting." << std::endl;
         exit(0);
     }
-    
-    bool going = true;
-    Tree * bigtree = NULL;
-    while (going) {
-        if (retstring.size() > 1) {
-            bigtree = read_next_tree_from_stream_newick (*pios, retstring, &going);
-        } else {
-            going = false;
-        }
+    if (bigtree == NULL) {
+        std::cerr << "Error: no reference tree found. Exiting." << std::endl;
+        exit(0);
     }
-    std::set<std::string> btns = bigtree->getRoot()->get_leave_names_set();
-
-    ft = test_tree_filetype_stream(*apios, retstring);
+    
+    TreeGrafter grafter(bigtree);
+    TreeStream atrees(apios);
+    ft = atrees.get_filetype();
     if (ft != 0 && ft != 1) {
         std::cerr << "Error: this really only works with nexus or newick. Exiting." << std::endl;
         exit(0);
     }
-    
-    going = true;
-    while (going) {
-        if (retstring.size() > 1) {
-            Tree * addtree = read_next_tree_from_stream_newick (*apios, retstring, &going);
-            std::set<std::string> atns = addtree->getRoot()->get_leave_names_set();
-            std::vector<std::string> v(btns.size());
-            std::vector<std::string>::iterator it = set_difference(btns.begin(), btns.end(), atns.begin(), atns.end(), v.begin());
-            v.resize(it-v.begin());
-            std::map<std::string, Node *> diffnds;
-            std::vector<std::string> diffnms; 
-            for (int i = 0; i <bigtree->getExtantNodeCount(); i++) {
-                if (std::count(v.begin(), v.end(), bigtree->getExternalNode(i)->getName())==1) {
-                    diffnms.push_back(bigtree->getExternalNode(i)->getName());
-                }
-            } 
-            //get start node on big tree by getting the mrca
-            Node * connecthere = bigtree->getMRCA(diffnms);
-            std::vector<Node *> childs = connecthere->getChildren();
-            for (unsigned int i=0; i < childs.size(); i++) {
-                std::vector<std::string> v_int(diffnms.size());
-                std::vector<std::string>::iterator it;
-                std::set<std::string> lvsset = childs[i]->get_leave_names_set();
-                it = set_intersection(lvsset.begin(), lvsset.end(),
-                                atns.begin(), atns.end(), v_int.begin());
-                v_int.resize(it-v_int.begin());
-                if (v_int.size() > 0) {
-                    //need to add those missing not the overlapping
-                    std::vector<std::string> v2(lvsset.size());
-                    std::vector<std::string>::iterator it2 = set_difference(lvsset.begin(), lvsset.end(), atns.begin(), atns.end(), v2.begin());
-                    v2.resize(it2-v2.begin());
-                    for(unsigned int j=0;j<v2.size();j++) {
-                        std::cout << "to add " << v2[j]<< std::endl; 
-                        diffnds[v2[j]] = bigtree->getExternalNode(v2[j]);
-                    }
-                    connecthere->removeChild(*childs[i]);
-                }
-            }
-            Node * oldroot = addtree->getRoot();
-            oldroot->setParent(*connecthere);
-            connecthere->addChild(*oldroot);
-            addtree->setRoot(connecthere);
-            bool didit = false;
-            while (diffnds.size() > 0) {
-                std::cout << "diffnds.size() = " << diffnds.size() << std::endl;
-                for (std::map<std::string, Node*>::iterator it = diffnds.begin(); it != diffnds.end(); ++it) {
-                    std::cout << it->first << std::endl;
-                    Node * cn = it->second;
-                    bool goi = true;
-                    while (goi == true) {
-                        Node * prn = cn->getParent();
-                        std::set<std::string> cs = cn->get_leave_names_set();
-                        std::vector<std::string> v_int;
-                        set_intersection(cs.begin(), cs.end(), atns.begin(), atns.end(), back_inserter(v_int));
-                        if (v_int.size() > 0) {
-                            std::cout <<  "this is what we need to add " << prn->getNewick(false) << std::endl;
-                            //get nodes
-                            //get mrca
-                            Node * nd = addtree->getMRCA(v_int);
-                            std::cout << "would add to " <<  nd->getNewick(false) << std::endl;
-                            //START HERE
-                            std::cout << "v_int.size() = " << v_int.size() << std::endl;
-                            if (v_int.size() == 1) {
-                                
-                                // missing something?
-                                
-                            }
-                            std::vector<std::string> lvsnms = prn->get_leave_names();
-                            for(unsigned int i=0; i < lvsnms.size(); i++) {
-                                if (diffnds.count(lvsnms[i]) > 0) {
-                                    diffnds.erase(lvsnms[i]);
-                                }
-                            }
-                            going = false;
-                            didit = true;
-                            break;
-                        }
-                        cn = prn;
-                    }
-                    if (didit == true) {
-                        break;
-                    }
-                }
-            }
-            (*poos) << getNewickString(addtree) << std::endl;
-            delete addtree;
-        } else {
-            going = false;
+    // ordered: each graft works on the backbone left by the previous one
+    atrees.process(tw, [&] (Tree *& tree, const long& index, std::string&) {
+        if (!grafter.graft(tree)) {
+            std::cerr << "Warning: tree " << (index + 1)
+                << " shares no taxa with the reference tree. Skipping." << std::endl;
         }
-    }
-
+        return true;
+    }, true);
+    
+    bigtree = grafter.get_tree();
+    tw.write_tree(bigtree);
+    delete bigtree;
+    
+    tw.flush();
     if (outfileset) {
         ofstr->close();
         delete poos;
@@ -24,6 +24,7 @@ void print_help() {
     std::cout << " -n, --ntax=INT      number of taxa" << std::endl;
     std::cout << " -r, --rooted        whether generated trees are rooted (default: false)" << std::endl;
     std::cout << " -c, --count         give the number of possible trees for n taxa and exit" << std::endl;
+    std::cout << " -k, --rank=INT      only write the k-th topology (1-based, in output order)" << std::endl;
     std::cout << " -l, --label=STRING  prefix label for taxon names (default: 't')" << std::endl;
     std::cout << " -o, --outf=FILE     output file, STOUT otherwise" << std::endl;
 //    std::cout << " -x, --seed=INT      random number seed, clock otherwise" << std::endl;
@@ -41,7 +42,8 @@ static struct option const long_options[] =
 {
     {"ntax", required_argument, NULL, 'n'},
     {"rooted", no_argument, NULL, 'r'},
-    {"count", no_argument, NULL, 'r'},
+    {"count", no_argument, NULL, 'c'},
+    {"rank", required_argument, NULL, 'k'},
     {"label", required_argument, NULL, 'l'},
     {"outf", required_argument, NULL, 'o'},
 //    {"seed", required_argument, NULL, 'x'},
@@ -51,27 +53,26 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "n:rck:l:o:hVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     int num_taxa = 0;
     bool rooted = false;
     bool count = false;
+    long int rank = 0;
+    bool rankset = false;
     bool outfileset = false;
     std::string lprefix = "t";
     char * outf = NULL;
     
-    // limit on number of terminals supported (exhaustive)
-    int sim_limit_exh = 10;
-    // bc of the way trees are simulated, cannot be arbitrarily large
-    // hope to fix this soon
-    
 //    int seed = -1;
     
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "n:rcl:o:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -85,6 +86,10 @@ int main(int argc, char * argv[]) {
             case 'c':
                 count = true;
                 break;
+            case 'k':
+                rankset = true;
+                rank = string_to_long_int(optarg, "-k");
+                break;
             case 'l':
                 lprefix = strdup(optarg);
                 break;
@@ -112,6 +117,10 @@ int main(int argc, char * argv[]) {
     
     std::string rootstat = (rooted) ? "rooted" : "unrooted";
     
+    // limit on number of terminals supported: topologies are indexed by an
+    // unsigned long (64 bit), i.e. (2n-5)!! or (2n-3)!! must fit
+    int sim_limit_exh = (rooted) ? 18 : 19;
+    
     if (num_taxa == 0) {
         std::cerr << "Error: you have to set the number of taxa -n. Exiting." << std::endl;
         exit(0);
@@ -143,7 +152,16 @@ int main(int argc, char * argv[]) {
     }
     
     TopologyGenerator TG(num_taxa, rooted, lprefix);
-    TG.get_newicks(poos);
+    if (rankset) {
+        if (rank < 1 || (unsigned long int)rank > TG.get_num_topologies()) {
+            std::cerr << "Error: the rank -k must be between 1 and " << TG.get_num_topologies()
+                << ". Exiting." << std::endl;
+            exit(0);
+        }
+        (*poos) << TG.get_newick((unsigned long int)(rank - 1)) << std::endl;
+    } else {
+        TG.get_newicks(poos);
+    }
     
     if (outfileset) {
         ofstr->close();
@@ -11,6 +11,7 @@
 #include "tree_reader.h"
 #include "utils.h"
 #include "tree_utils.h"
+#include "tree_writer.h"
 #include "log.h"
 #include "constants.h"
 
@@ -53,9 +54,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "t:n:cf:o:shVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
       
     bool fileset = false;
     bool namesset = false;
@@ -71,7 +74,7 @@ int main(int argc, char * argv[]) {
     char * namesfc = NULL;
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "t:n:cf:o:shVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -162,6 +165,7 @@ int main(int argc, char * argv[]) {
     } else {
         poos = &std::cout;
     }
+    TreeWriter tw(poos);
     
     //read trees 
     std::string retstring;
@@ -183,7 +187,7 @@ int main(int argc, char * argv[]) {
                     &translation_table, &going);
                 if (going == true) {
                     tree = get_induced_tree(tree, names, silent);
-                    (*poos) << getNewickString(tree) << std::endl;
+                    tw.write_tree(tree);
                     delete tree;
                 }
             }
@@ -194,7 +198,7 @@ int main(int argc, char * argv[]) {
                 tree = read_next_tree_from_stream_newick(*pios, retstring, &going);
                 if (going == true) {
                     tree = get_induced_tree(tree, names, silent);
-                    (*poos) << getNewickString(tree) << std::endl;
+                    tw.write_tree(tree);
                     delete tree;
                 }
             }
@@ -214,7 +218,7 @@ int main(int argc, char * argv[]) {
                     toKeep = get_complement_tip_set(tree, names);
                     if (toKeep.size() > 1) {
                         tree = get_induced_tree(tree, toKeep, silent);
-                        (*poos) << getNewickString(tree) << std::endl;
+                        tw.write_tree(tree);
                     }
                     delete tree;
                 }
@@ -227,7 +231,7 @@ int main(int argc, char * argv[]) {
                     toKeep = get_complement_tip_set(tree, names);
                     if (toKeep.size() > 1) {
                         tree = get_induced_tree(tree, toKeep, silent);
-                        (*poos) << getNewickString(tree) << std::endl;
+                        tw.write_tree(tree);
                     }
                     delete tree;
                 }
@@ -239,6 +243,7 @@ int main(int argc, char * argv[]) {
         fstr->close();
         delete pios;
     }
+    tw.flush();
     if (outfileset) {
         ofstr->close();
         delete poos;
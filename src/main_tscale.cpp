@@ -9,6 +9,8 @@
 #include "tree_reader.h"
 #include "tscale.h"
 #include "tree_utils.h"
+#include "tree_writer.h"
+#include "tree_stream.h"
 #include "log.h"
 #include "constants.h"
 
@@ -49,9 +51,11 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "t:s:r:o:hVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool outfileset = false;
     bool tfileset = false;
@@ -65,7 +69,7 @@ int main(int argc, char * argv[]) {
     std::string nnamef = "";
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "t:s:r:o:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -132,6 +136,7 @@ int main(int argc, char * argv[]) {
     } else {
         poos = &std::cout;
     }
+    TreeWriter tw(poos);
     
     TScale ts;
     
@@ -141,55 +146,30 @@ int main(int argc, char * argv[]) {
         ts.set_scalef(scalef);
     }
     
-    std::string retstring;
-    int ft = test_tree_filetype_stream(*pios, retstring);
+    TreeStream trees(pios);
+    int ft = trees.get_filetype();
     if (ft != 0 && ft != 1) {
         std::cerr << "Error: this really only works with nexus or newick. Exiting." << std::endl;
         exit(0);
     }
-    bool going = true;
-    if (ft == 1) {
-        Tree * tree;
-        while (going) {
-            tree = read_next_tree_from_stream_newick(*pios, retstring, &going);
-            if (going) {
-                if (heightset) {
-                    // have to check ultrametricity
-                    bool isultra = is_ultrametric_paths(tree);
-                    if (!isultra) {
-                        std::cerr << "Error: setting root height only works for ultrametric trees. Exiting." << std::endl;
-                        exit(0);
-                    }
-                }
-                ts.rescale(tree);
-                (*poos) << getNewickString(tree) << std::endl;
-                delete tree;
-            }
-        }
-    } else if (ft == 0) { // Nexus. need to worry about possible translation tables
-        std::map<std::string, std::string> translation_table;
-        bool ttexists;
-        ttexists = get_nexus_translation_table(*pios, &translation_table, &retstring);
-        Tree * tree;
-        while (going) {
-            tree = read_next_tree_from_stream_nexus(*pios, retstring, ttexists,
-                &translation_table, &going);
-            if (tree != NULL) {
-                if (heightset) {
-                    // have to check ultrametricity
-                    bool isultra = is_ultrametric_paths(tree);
-                    if (!isultra) {
-                        std::cerr << "Error: setting root height only works for ultrametric trees. Exiting." << std::endl;
-                        exit(0);
-                    }
-                }
-                ts.rescale(tree);
-                (*poos) << getNewickString(tree) << std::endl;
-                delete tree;
+    trees.process(tw, [&] (Tree *& tree, const long&, std::string& out) {
+        if (heightset) {
+            // have to check ultrametricity
+            bool isultra = is_ultrametric_paths(tree);
+            if (!isultra) {
+                return false;
             }
         }
-    }
+        ts.rescale(tree);
+        append_tree(out, tree);
+        return true;
+    }, false);
     
+    tw.flush();
+    if (trees.aborted()) {
+        std::cerr << "Error: setting root height only works for ultrametric trees. Exiting." << std::endl;
+        exit(0);
+    }
     if (outfileset) {
         ofstr->close();
         delete poos;
@@ -5,6 +5,7 @@
 #include <getopt.h>
 
 #include "upgma.h"
+#include "dist_matrix.h"
 #include "utils.h"
 #include "sequence.h"
 #include "seq_reader.h"
@@ -16,13 +17,14 @@ extern std::string PHYX_CITATION;
 
 void print_help() {
     std::cout << "Bare bones UPGMA tree generator" << std::endl;
-    std::cout << "Currently only uses uncorrected p-distances." << std::endl;
+    std::cout << "Uses uncorrected p-distances (gaps count as differences) unless a model is given." << std::endl;
     std::cout << "This will take fasta, fastq, phylip, and nexus formats from a file or STDIN." << std::endl;
     std::cout << std::endl;
     std::cout << "Usage: pxupgma [OPTIONS]..." << std::endl;
     std::cout << std::endl;
     std::cout << "Options:" << std::endl;
     std::cout << " -s, --seqf=FILE     input sequence file, STDIN otherwise" << std::endl;
+    std::cout << " -m, --model=STR     distance model: hamming, p, jc69, k2p or logdet (last 3 DNA only)" << std::endl;
     std::cout << " -o, --outf=FILE     output newick file, STOUT otherwise" << std::endl;
     std::cout << " -h, --help          display this help and exit" << std::endl;
     std::cout << " -V,  --version      display version and exit" << std::endl;
@@ -37,6 +39,7 @@ std::string versionline("pxupgma 1.1\nCopyright (C) 2015-2020 FePhyFoFum\nLicens
 static struct option const long_options[] =
 {
     {"seqf", required_argument, NULL, 's'},
+    {"model", required_argument, NULL, 'm'},
     {"outf", required_argument, NULL, 'o'},
     {"help", no_argument, NULL, 'h'},
     {"version", no_argument, NULL, 'V'},
@@ -44,18 +47,21 @@ static struct option const long_options[] =
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "s:m:o:hVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool fileset = false;
     bool outfileset = false;
     char * seqf = NULL;
     char * outf = NULL;
+    distModel model = DIST_HAMMING;
     
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "s:o:hVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -65,6 +71,13 @@ int main(int argc, char * argv[]) {
                 seqf = strdup(optarg);
                 check_file_exists(seqf);
                 break;
+            case 'm':
+                if (!get_dist_model(optarg, model)) {
+                    std::cerr << "Error: distance model '" << optarg
+                        << "' not recognized. Exiting." << std::endl;
+                    exit(0);
+                }
+                break;
             case 'o':
                 outfileset = true;
                 outf = strdup(optarg);
@@ -110,7 +123,7 @@ int main(int argc, char * argv[]) {
         poos = &std::cout;
     }
     
-    UPGMA upgma(pios);
+    UPGMA upgma(pios, model);
     (*poos) << upgma.get_newick() << std::endl;
     
     if (fileset) {
@@ -16,7 +16,10 @@ extern std::string PHYX_CITATION;
 
 void print_help() {
     std::cout << "Convert vcf file to fasta." << std::endl;
-    std::cout << "Currently only handles haploid data; phased data will come soon." << std::endl;
+    std::cout << "Handles haploid and diploid (phased or unphased) genotypes." << std::endl;
+    std::cout << "Only SNP sites (single character REF/ALT) are retained; the number of" << std::endl;
+    std::cout << "skipped indel and MNP sites is reported on STDERR." << std::endl;
+    std::cout << "Diploid heterozygotes are coded with IUPAC ambiguity codes, missing as N." << std::endl;
     std::cout << "Data can be read from a file or STDIN." << std::endl;
     std::cout << std::endl;
     std::cout << "Usage: pxvcf2fa [OPTIONS]..." << std::endl;
@@ -25,6 +28,10 @@ void print_help() {
     std::cout << " -s, --seqf=FILE     input vcf file, STDIN otherwise" << std::endl;
     std::cout << " -o, --outf=FILE     output fasta sequence file, STOUT otherwise" << std::endl;
     std::cout << " -u, --uppercase     export characters in uppercase" << std::endl;
+    std::cout << " -b, --biallelic     retain only biallelic sites" << std::endl;
+    std::cout << " -m, --maxmiss=DBL   maximum proportion of missing genotypes at a site (default: 1)" << std::endl;
+    std::cout << " -f, --maf=DBL       minimum minor allele frequency at a site (default: 0)" << std::endl;
+    std::cout << " -v, --verbose       make the output more verbose" << std::endl;
     std::cout << " -h, --help          display this help and exit" << std::endl;
     std::cout << " -V, --version       display version and exit" << std::endl;
     std::cout << " -C, --citation      display phyx citation and exit" << std::endl;
@@ -40,24 +47,34 @@ static struct option const long_options[] =
     {"seqf", required_argument, NULL, 's'},
     {"outf", required_argument, NULL, 'o'},
     {"uppercase", no_argument, NULL, 'u'},
+    {"biallelic", no_argument, NULL, 'b'},
+    {"maxmiss", required_argument, NULL, 'm'},
+    {"maf", required_argument, NULL, 'f'},
+    {"verbose", no_argument, NULL, 'v'},
     {"help", no_argument, NULL, 'h'},
     {"version", no_argument, NULL, 'V'},
     {"citation", no_argument, NULL, 'C'},
     {NULL, 0, NULL, 0}
 };
 
+static const char * const short_options = "s:o:ubm:f:vhVC";
+
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, short_options, long_options);
     
     bool fileset = false;
     bool outfileset = false;
     bool toupcase = false;
+    bool biallelic = false;
+    bool verbose = false;
+    double maxmissing = 1.0;
+    double maf = 0.0;
     char * seqf = NULL;
     char * outf = NULL;
     while (1) {
         int oi = -1;
-        int c = getopt_long(argc, argv, "s:o:uhVC", long_options, &oi);
+        int c = getopt_long(argc, argv, short_options, long_options, &oi);
         if (c == -1) {
             break;
         }
@@ -74,6 +91,26 @@ int main(int argc, char * argv[]) {
             case 'u':
                 toupcase = true;
                 break;
+            case 'b':
+                biallelic = true;
+                break;
+            case 'm':
+                maxmissing = string_to_float(optarg, "-m");
+                if (maxmissing < 0.0 || maxmissing > 1.0) {
+                    std::cerr << "Error: maximum missing proportion must be in [0,1]. Exiting." << std::endl;
+                    exit(0);
+                }
+                break;
+            case 'f':
+                maf = string_to_float(optarg, "-f");
+                if (maf < 0.0 || maf > 0.5) {
+                    std::cerr << "Error: minor allele frequency must be in [0,0.5]. Exiting." << std::endl;
+                    exit(0);
+                }
+                break;
+            case 'v':
+                verbose = true;
+                break;
             case 'h':
                 print_help();
                 exit(0);
@@ -115,8 +152,16 @@ int main(int argc, char * argv[]) {
         poos = &std::cout;
     }
     
-    VcfReader vcf(pios);
+    VcfReader vcf(pios, biallelic, maxmissing, maf);
     vcf.write_seqs(toupcase, poos);
+    if (vcf.get_num_sites_not_snp() > 0) {
+        std::cerr << "Warning: skipped " << vcf.get_num_sites_not_snp()
+            << " site(s) that are not SNPs (indels or MNPs)." << std::endl;
+    }
+    if (verbose) {
+        std::cerr << "Retained " << vcf.get_num_sites_kept() << " of "
+            << vcf.get_num_sites_read() << " sites." << std::endl;
+    }
     
     if (fileset) {
         fstr->close();
@@ -0,0 +1,176 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+#include <fstream>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+#include "mrca_query.h"
+#include "tree.h"
+#include "node.h"
+#include "utils.h"
+
+
+// a later line with the same name replaces an earlier one
+MRCAQuery::MRCAQuery (const std::string& mrcaf):nwords_(0) {
+    check_file_exists(mrcaf);
+    std::ifstream inmrca(mrcaf);
+    std::string mrcaline;
+    std::map<std::string, std::vector<std::string> > mrcas;
+    while (getline(inmrca, mrcaline)) {
+        if (mrcaline.empty()) {
+            continue;
+        }
+        std::vector<std::string> searchtokens;
+        tokenize(mrcaline, searchtokens, "=");
+        if (searchtokens.size() < 2) {
+            std::cerr << "Error: MRCA line '" << mrcaline
+                << "' is not of the form 'MRCANAME = tip1 tip2 ...'. Exiting." << std::endl;
+            exit(0);
+        }
+        std::string mrcaname = searchtokens[0];
+        trim_spaces(mrcaname);
+        searchtokens = tokenize(searchtokens[1]);
+        if (searchtokens.empty()) {
+            std::cerr << "Error: MRCA '" << mrcaname << "' has no tips. Exiting." << std::endl;
+            exit(0);
+        }
+        mrcas[mrcaname] = searchtokens;
+    }
+    inmrca.close();
+    for (std::map<std::string, std::vector<std::string> >::iterator it = mrcas.begin();
+            it != mrcas.end(); it++) {
+        names_.push_back(it->first);
+        tips_.push_back(it->second);
+    }
+    compile();
+}
+
+
+// number the distinct taxa and set each clade's bits
+void MRCAQuery::compile () {
+    for (unsigned int i = 0; i < tips_.size(); i++) {
+        for (unsigned int j = 0; j < tips_[i].size(); j++) {
+            if (taxon_index_.find(tips_[i][j]) == taxon_index_.end()) {
+                int idx = (int)taxon_index_.size();
+                taxon_index_[tips_[i][j]] = idx;
+            }
+        }
+    }
+    nwords_ = ((int)taxon_index_.size() + 63) / 64;
+    bits_.assign(names_.size() * nwords_, 0);
+    for (unsigned int i = 0; i < tips_.size(); i++) {
+        uint64_t * cbits = &bits_[i * nwords_];
+        for (unsigned int j = 0; j < tips_[i].size(); j++) {
+            int idx = taxon_index_.find(tips_[i][j])->second;
+            cbits[idx / 64] |= (uint64_t)1 << (idx % 64);
+        }
+    }
+}
+
+
+// same messages as check_names_against_tree, one a line
+void MRCAQuery::report_missing (const int& clade, const std::vector<uint64_t>& present,
+        std::string& missing) const {
+    missing.clear();
+    for (unsigned int j = 0; j < tips_[clade].size(); j++) {
+        int idx = taxon_index_.find(tips_[clade][j])->second;
+        if (!(present[idx / 64] & ((uint64_t)1 << (idx % 64)))) {
+            missing += "Taxon '" + tips_[clade][j] + "' not found in tree.\n";
+        }
+    }
+}
+
+
+// fills mrcas with the MRCA node of each clade (a tip for single taxon clades)
+// and nleaves with the number of tips below it. the pass stops as soon as
+// every clade is placed, and the bitsets are only kept for the current
+// root-to-node path. if a taxon of some clade is not in the tree, the missing
+// taxa of the first such clade are listed in missing (for the tool to print)
+// and false is returned
+bool MRCAQuery::find_mrcas (Tree * tree, std::vector<Node *>& mrcas,
+        std::vector<int>& nleaves, std::string& missing) const {
+    int nclades = get_num_clades();
+    mrcas.assign(nclades, NULL);
+    nleaves.assign(nclades, 0);
+    std::vector<int> pending(nclades);
+    for (int i = 0; i < nclades; i++) {
+        pending[i] = i;
+    }
+    std::vector<uint64_t> present;
+    // (node, next child) per level, with nwords_ of bitset per level in acc
+    // and the number of tips per level in ntips
+    std::vector<std::pair<Node *, int> > stack;
+    std::vector<uint64_t> acc(nwords_, 0);
+    std::vector<int> ntips(1, 0);
+    stack.push_back(std::make_pair(tree->getRoot(), 0));
+    while (!stack.empty() && !pending.empty()) {
+        Node * cur = stack.back().first;
+        int next = stack.back().second;
+        if (next < cur->getChildCount()) {
+            stack.back().second++;
+            stack.push_back(std::make_pair(cur->getChild(next), 0));
+            acc.resize(stack.size() * nwords_, 0);
+            ntips.push_back(0);
+            continue;
+        }
+        uint64_t * nbits = &acc[(stack.size() - 1) * nwords_];
+        if (cur->getChildCount() == 0) {
+            ntips.back() = 1;
+            std::map<std::string, int>::const_iterator it = taxon_index_.find(cur->getName());
+            if (it != taxon_index_.end()) {
+                nbits[it->second / 64] |= (uint64_t)1 << (it->second % 64);
+            }
+        }
+        for (unsigned int i = 0; i < pending.size(); ) {
+            const uint64_t * cbits = &bits_[pending[i] * nwords_];
+            bool covered = true;
+            for (int w = 0; w < nwords_; w++) {
+                if ((nbits[w] & cbits[w]) != cbits[w]) {
+                    covered = false;
+                    break;
+                }
+            }
+            if (covered) {
+                mrcas[pending[i]] = cur;
+                nleaves[pending[i]] = ntips.back();
+                pending[i] = pending.back();
+                pending.pop_back();
+            } else {
+                i++;
+            }
+        }
+        stack.pop_back();
+        int nt = ntips.back();
+        ntips.pop_back();
+        if (stack.empty()) {
+            present.assign(nbits, nbits + nwords_);
+        } else {
+            uint64_t * pbits = &acc[(stack.size() - 1) * nwords_];
+            for (int w = 0; w < nwords_; w++) {
+                pbits[w] |= nbits[w];
+            }
+            acc.resize(stack.size() * nwords_);
+            ntips.back() += nt;
+        }
+    }
+    if (pending.empty()) {
+        return true;
+    }
+    int first = nclades;
+    for (unsigned int i = 0; i < pending.size(); i++) {
+        first = std::min(first, pending[i]);
+    }
+    report_missing(first, present, missing);
+    return false;
+}
+
+
+bool MRCAQuery::find_mrcas (Tree * tree, std::vector<Node *>& mrcas,
+        std::string& missing) const {
+    std::vector<int> nleaves;
+    return find_mrcas(tree, mrcas, nleaves, missing);
+}
@@ -0,0 +1,43 @@
+#ifndef _MRCA_QUERY_H_
+#define _MRCA_QUERY_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+#include "tree.h"
+#include "node.h"
+
+
+/*
+ * the clades of an MRCA file, with lines of the format:
+ * MRCANAME = tip1 tip2 ...
+ * compiled once into bitsets over the taxa they mention. the MRCA of every
+ * clade in a tree is then found in a single post-order pass: the taxa below
+ * each node are accumulated as a bitset, and a clade's MRCA is the first node
+ * whose bitset covers it. queries are read-only (nothing is printed), so
+ * trees can be handled in parallel. clades are in name order (as with the std::map the tools used)
+ */
+class MRCAQuery {
+private:
+    std::vector<std::string> names_;
+    std::vector<std::vector<std::string> > tips_;
+    std::map<std::string, int> taxon_index_; // taxon name -> bit
+    int nwords_;
+    std::vector<uint64_t> bits_; // nwords_ per clade
+    
+    void compile ();
+    void report_missing (const int& clade, const std::vector<uint64_t>& present,
+        std::string& missing) const;
+
+public:
+    MRCAQuery (const std::string& mrcaf);
+    int get_num_clades () const { return (int)names_.size(); };
+    const std::string& get_name (const int& clade) const { return names_[clade]; };
+    bool find_mrcas (Tree * tree, std::vector<Node *>& mrcas, std::string& missing) const;
+    bool find_mrcas (Tree * tree, std::vector<Node *>& mrcas, std::vector<int>& nleaves,
+        std::string& missing) const;
+};
+
+#endif /* _MRCA_QUERY_H_ */
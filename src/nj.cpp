@@ -8,6 +8,7 @@ using namespace std; // commenting this out changes the result?!? ***
 #include "utils.h"
 #include "sequence.h"
 #include "seq_reader.h"
+#include "profile.h"
 
 
 /*Calculates the Q matrix
@@ -135,6 +136,7 @@ void NJOI::Choose_Smallest (int& NumbOfSequences, const std::vector< std::vector
 //Main Tree Making Matrix
 void NJOI::TREEMAKE (std::vector<std::string>& names, std::map<int, std::string>& NumbKeys,
     std::vector< std::vector<double> >& Matrix) {
+    PX_PROFILE_PHASE("neighbour joining");
 
     int mini1 = 0, mini2 = 0;
     int NumbOfSequences = NumbKeys.size();
@@ -160,37 +162,26 @@ void NJOI::TREEMAKE (std::vector<std::string>& names, std::map<int, std::string>
 }
 
 
+// sequences are in name order (i.e., that of names_). hamming distances are
+// raw counts of differences, as before
 std::vector< std::vector<double> > NJOI::BuildMatrix (std::map<std::string, std::string>& sequences) {
-
-    std::vector<std::string> SequenceName;
-    std::map <std::string, std::string>::iterator iter, iter2;
-    std::string fasta, SeqName, MatchName;
-    int FirstCount = 0;
-    double MatchScore;
-
-    // an easier way to initialize a std::vector of std::vectors:
-    int ntax = sequences.size();
-    std::vector< std::vector<double> > Score(ntax, std::vector<double>(ntax, 0.0));
-
-    //compare all sequences to other sequences
+    std::vector<Sequence> seqs;
+    std::map<std::string, std::string>::iterator iter;
     for (iter = sequences.begin(); iter != sequences.end(); iter++) {
-        fasta = iter -> second;
-        SeqName = iter -> first;
-        SequenceName.push_back(SeqName);
-        int SecondCount = 0;
-        for (iter2 = sequences.begin(); iter2 != sequences.end(); iter2++) {
-            MatchScore = (double) calc_hamming_dist(fasta, iter2 -> second);
-            MatchName = SeqName + "," + iter2 -> first;
-            Score[FirstCount][SecondCount] = MatchScore;
-            SecondCount++;
-        }
-        FirstCount++;
+        seqs.push_back(Sequence(iter->first, iter->second));
+    }
+    DistanceMatrix dm(seqs, alpha_name_, model_, false);
+    if (dm.get_num_undefined() > 0) {
+        std::cerr << "Error: " << dm.get_num_undefined() << " pairwise distance(s) are "
+            << "undefined under this model (saturated or no comparable sites). Exiting." << std::endl;
+        exit(0);
     }
-    return Score;
+    return dm.get_matrix();
 }
 
 
-NJOI::NJOI (std::istream* pios, int & threads):num_taxa_(0), num_char_(0), nthreads_(threads) {
+NJOI::NJOI (std::istream* pios, int & threads, const distModel& model):num_taxa_(0),
+        num_char_(0), nthreads_(threads), alpha_name_(""), model_(model) {
     Sequence seq;
     std::string retstring;
     int ft = test_seq_filetype_stream(*pios, retstring);
@@ -209,6 +200,7 @@ NJOI::NJOI (std::istream* pios, int & threads):num_taxa_(0), num_char_(0), nthre
             }
         } else {
             num_char_ = seq.get_length();
+            alpha_name_ = seq.get_alpha_name();
             first = false;
         }
         seqcount++;
@@ -6,6 +6,8 @@
 #include <string>
 #include <iostream>
 
+#include "dist_matrix.h"
+
 class NJOI {
 private:
     std::map<std::string, std::string> sequences_;
@@ -19,6 +21,8 @@ private:
     int num_taxa_;
     int num_char_;
     int nthreads_; // not implemented yet
+    std::string alpha_name_;
+    distModel model_;
     std::map<int, std::string> name_key_;
     std::string newick_string_; // temporary
     
@@ -34,7 +38,7 @@ private:
         int& mini1, int& mini2);
     
 public:
-    NJOI (std::istream* pios, int& threads);
+    NJOI (std::istream* pios, int& threads, const distModel& model);
     std::map<std::string, std::string> FastaToOneLine (std::string& fasta);
     std::vector< std::vector<double> > BuildMatrix (std::map<std::string, std::string>& sequences);
     void TREEMAKE (std::vector<std::string>&, std::map<int, std::string>&,
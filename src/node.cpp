@@ -14,6 +14,7 @@
 #include "node_object.h"
 #include "string_node_object.h"
 #include "tree_utils.h"
+#include "tree_writer.h"
 
 
 Node::Node ():BL(0.0), height(0.0), number(0), name(""), parent(NULL),
@@ -184,6 +185,19 @@ bool Node::removeChild (Node& c) {
 }
 
 
+// swap in newc at oldc's position, so the order of the children is kept
+bool Node::replaceChild (Node& oldc, Node& newc) {
+    for (unsigned int i=0; i < children.size(); i++) {
+        if (children.at(i) == &oldc) {
+            children[i] = &newc;
+            newc.setParent(*this);
+            return true;
+        }
+    }
+    return false;
+}
+
+
 Node * Node::getChild (int c) {
     return children.at(c);
 }
@@ -209,29 +223,8 @@ void Node::setComment (std::string s) {
 
 
 std::string Node::getNewick (bool bl) {
-    std::string ret = "";
-    for (int i=0; i < this->getChildCount(); i++) {
-        if (i == 0) {
-            ret += "(";
-        }
-        ret = ret+this->getChild(i)->getNewick(bl);
-        if (bl == true) {
-            //std::ostringstream o;
-            ////20 is what you get from raxml
-            //o.setf(ios::fixed, std::ios::floatfield);
-            //o << std::setprecision(20) << this->getChild(i)->getBL();
-            //ret += ":" + o.str();
-            ret += ":" + double_to_str(this->getChild(i)->getBL());
-        }
-        if (i == this->getChildCount()-1) {
-            ret += ")";
-        } else {
-            ret += ",";
-        }
-    }
-    if (name.size() > 0) {
-        ret += name;
-    }
+    std::string ret;
+    append_newick(ret, this, bl);
     return ret;
 }
 
@@ -294,31 +287,8 @@ std::string Node::getPaintedNewick (bool bl) {
  * needs to be a string in setObject
  */
 std::string Node::getNewick (bool bl, std::string obj) {
-    std::string ret = "";
-    for (int i=0; i < this->getChildCount(); i++) {
-        if (i == 0) {
-            ret += "(";
-        }
-        ret = ret+this->getChild(i)->getNewick(bl, obj);
-        if (bl == true) {
-            std::ostringstream o;
-            o << this->getChild(i)->getBL();
-            ret += ":" + o.str();
-        }
-        if (i == this->getChildCount()-1) {
-            ret += ")";
-        } else {
-            ret += ",";
-        }
-    }
-    if (this->name.size() > 0) {
-        ret = ret + this->name;
-    }
-    if (this->getObject(obj) != NULL) {
-        std::ostringstream o;
-        o << (*((StringNodeObject*) (this->getObject(obj))));
-        ret += "[&"+obj+"="+o.str()+"]";
-    }
+    std::string ret;
+    append_newick(ret, this, bl, obj);
     return ret;
 }
 
@@ -55,6 +55,7 @@ public:
     bool hasChild (Node& test);
     bool addChild (Node& c);
     bool removeChild (Node& c);
+    bool replaceChild (Node& oldc, Node& newc);
     Node * getChild (int c);
     std::string getName ();
     std::string getComment ();
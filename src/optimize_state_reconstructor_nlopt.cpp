@@ -11,26 +11,26 @@
 using namespace arma;
 
 
-StateReconstructor * nloptsr;
-RateModel * nloptrm;
-mat * nloptfree_variables;
-
-
+// everything the objective needs is passed through nlopt's user data pointer
+// (no globals), so independent fits can run concurrently
 double nlopt_sr (unsigned n, const double *x, double *grad, void *my_func_data) {
-    for (unsigned int i=0; i < nloptfree_variables->n_rows; i++) {
-        for (unsigned int j=0; j < nloptfree_variables->n_cols; j++) {
+    SrNloptContext * ctx = static_cast<SrNloptContext *>(my_func_data);
+    RateModel * rm = ctx->rm;
+    mat * free_variables = ctx->free_variables;
+    for (unsigned int i=0; i < free_variables->n_rows; i++) {
+        for (unsigned int j=0; j < free_variables->n_cols; j++) {
             if (i != j) {
-                nloptrm->set_Q_cell(i, j,x[int((*nloptfree_variables)(i, j))]);
-                if (nloptrm->get_Q()(i, j) < 0 || nloptrm->get_Q()(i, j) >= 1000) {
+                rm->set_Q_cell(i, j,x[int((*free_variables)(i, j))]);
+                if (rm->get_Q()(i, j) < 0 || rm->get_Q()(i, j) >= 1000) {
                     return 1000000000000;
                 }
             }
         }
     }
     double like;
-    nloptrm->set_Q_diag();
-    like = nloptsr->eval_likelihood();
-    if (nloptrm->neg_p == true) {
+    rm->set_Q_diag();
+    like = ctx->sr->eval_likelihood();
+    if (rm->neg_p == true) {
         like = 10000000000000;
     }
     //std::cout << like << std::endl;
@@ -41,9 +41,10 @@ double nlopt_sr (unsigned n, const double *x, double *grad, void *my_func_data)
 }
 
 void optimize_sr_nlopt (RateModel * _rm,StateReconstructor * _sr, mat * _free_mask, int _nfree) {
-    nloptsr = _sr;
-    nloptrm = _rm;
-    nloptfree_variables = _free_mask;
+    SrNloptContext ctx;
+    ctx.sr = _sr;
+    ctx.rm = _rm;
+    ctx.free_variables = _free_mask;
 
     nlopt::opt opt(nlopt::LN_NELDERMEAD, _nfree);
     //nlopt::opt opt(nlopt::LN_BOBYQA, _nfree);
@@ -54,7 +55,7 @@ void optimize_sr_nlopt (RateModel * _rm,StateReconstructor * _sr, mat * _free_ma
 
     opt.set_lower_bounds(0.0000);
     opt.set_upper_bounds(100000);
-    opt.set_min_objective(nlopt_sr, NULL);
+    opt.set_min_objective(nlopt_sr, &ctx);
     opt.set_xtol_rel(0.001);
     opt.set_maxeval(5000);
 
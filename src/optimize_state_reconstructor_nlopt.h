@@ -9,6 +9,13 @@ class StateReconstructor; // forward declaration
 #include <armadillo>
 using namespace arma;
 
+// per-fit optimizer state, handed to the objective via nlopt's user data
+struct SrNloptContext {
+    StateReconstructor * sr;
+    RateModel * rm;
+    mat * free_variables;
+};
+
 void optimize_sr_nlopt(RateModel * _rm,StateReconstructor * _sr, mat * _free_mask, int _nfree);
 
 #endif /* _OPTIMIZE_STATE_RECONSTRUCTOR_NLOPT_H_ */
@@ -12,18 +12,17 @@
 using namespace arma;
 
 
-StateReconstructor * nloptsr_periods;
-std::vector<RateModel> * nloptrm_periods;
-std::vector<mat> * nloptfree_variables_periods;
-
-
+// as with optimize_sr_nlopt, state lives in a per-fit context (no globals)
 double nlopt_sr_periods (unsigned n, const double *x, double *grad, void *my_func_data) {
-    for (unsigned int k=0; k < nloptfree_variables_periods->size(); k++) {
-        for (unsigned int i=0; i < (*nloptfree_variables_periods)[k].n_rows; i++) {
-            for (unsigned int j=0; j < (*nloptfree_variables_periods)[k].n_cols; j++) {
+    SrPeriodsNloptContext * ctx = static_cast<SrPeriodsNloptContext *>(my_func_data);
+    std::vector<RateModel> * rms = ctx->rms;
+    std::vector<mat> * free_variables = ctx->free_variables;
+    for (unsigned int k=0; k < free_variables->size(); k++) {
+        for (unsigned int i=0; i < (*free_variables)[k].n_rows; i++) {
+            for (unsigned int j=0; j < (*free_variables)[k].n_cols; j++) {
                 if (i != j) {
-                    (*nloptrm_periods)[k].set_Q_cell(i,j,x[int(nloptfree_variables_periods->at(k)(i,j))]);
-                    if ((*nloptrm_periods)[k].get_Q()(i,j) < 0 || (*nloptrm_periods)[k].get_Q()(i,j) >= 1000) {
+                    (*rms)[k].set_Q_cell(i,j,x[int(free_variables->at(k)(i,j))]);
+                    if ((*rms)[k].get_Q()(i,j) < 0 || (*rms)[k].get_Q()(i,j) >= 1000) {
                         return 1000000000000;
                     }
                 }
@@ -31,12 +30,12 @@ double nlopt_sr_periods (unsigned n, const double *x, double *grad, void *my_fun
         }
     }
     double like;
-    for (unsigned int i=0; i < nloptrm_periods->size(); i++) {
-        nloptrm_periods->at(i).set_Q_diag();
+    for (unsigned int i=0; i < rms->size(); i++) {
+        rms->at(i).set_Q_diag();
     }
-    like = nloptsr_periods->eval_likelihood();
-    for (unsigned int i=0; i < nloptrm_periods->size(); i++) {
-        if (nloptrm_periods->at(i).neg_p == true) {
+    like = ctx->sr->eval_likelihood();
+    for (unsigned int i=0; i < rms->size(); i++) {
+        if (rms->at(i).neg_p == true) {
             like = 10000000000000;
             break;
         }
@@ -50,9 +49,10 @@ double nlopt_sr_periods (unsigned n, const double *x, double *grad, void *my_fun
 
 void optimize_sr_periods_nlopt (std::vector<RateModel> * _rm,StateReconstructor * _sr,
         std::vector<mat> * _free_mask, int _nfree) {
-    nloptsr_periods = _sr;
-    nloptrm_periods = _rm;
-    nloptfree_variables_periods = _free_mask;
+    SrPeriodsNloptContext ctx;
+    ctx.sr = _sr;
+    ctx.rms = _rm;
+    ctx.free_variables = _free_mask;
     
     nlopt::opt opt(nlopt::LN_NELDERMEAD, _nfree);
     //nlopt::opt opt(nlopt::LN_BOBYQA, _nfree);
@@ -63,7 +63,7 @@ void optimize_sr_periods_nlopt (std::vector<RateModel> * _rm,StateReconstructor
     
     opt.set_lower_bounds(0.0000);
     opt.set_upper_bounds(100000);
-    opt.set_min_objective(nlopt_sr_periods, NULL);
+    opt.set_min_objective(nlopt_sr_periods, &ctx);
     opt.set_xtol_rel(0.001);
     opt.set_maxeval(10000);
     
@@ -76,7 +76,7 @@ void optimize_sr_periods_nlopt (std::vector<RateModel> * _rm,StateReconstructor
                     //std::cout << x[int((*_free_mask)[k](i,j))] << " ";
                 }
             }
-            std::cout << std::endl;
+            //std::cout << std::endl;
         }
     }
     //double minf;
@@ -10,6 +10,13 @@ class StateReconstructor; // forward declaration
 #include <armadillo>
 using namespace arma;
 
+// per-fit optimizer state, handed to the objective via nlopt's user data
+struct SrPeriodsNloptContext {
+    StateReconstructor * sr;
+    std::vector<RateModel> * rms;
+    std::vector<mat> * free_variables;
+};
+
 void optimize_sr_periods_nlopt(std::vector<RateModel> * _rm,StateReconstructor * _sr,
     std::vector<mat> * _free_mask, int _nfree);
 
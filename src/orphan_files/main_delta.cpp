@@ -20,7 +20,7 @@
 
 int main(int argc, char * argv[]) {
     
-    log_call(argc, argv);
+    log_call(argc, argv, "", NULL); // no options
     
     TreeReader tr;
 
@@ -0,0 +1,187 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/resource.h>
+
+#include "profile.h"
+
+
+bool phyx_profiling = false;
+
+struct PhaseStat {
+    const char * name;
+    double seconds;
+    uint64_t calls;
+    long peak_rss_kb; // at the end of the phase
+};
+
+static std::vector<PhaseStat> prof_phases; // in order of first completion
+static uint64_t prof_counters[PROF_NUM_COUNTERS];
+
+
+static long get_peak_rss_kb () {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // bytes there
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+
+#ifndef PHYX_NO_PROFILE
+static std::string prof_program;
+static bool prof_json = false;
+static std::chrono::steady_clock::time_point prof_start;
+
+static const char * counter_names[PROF_NUM_COUNTERS] = {
+    "trees_parsed", "sequences_read", "pmatrices_computed", "pmatrix_cache_hits"
+};
+
+
+// bytes passed through read/write calls (rchar/wchar), where available
+static bool get_io_bytes (uint64_t& in, uint64_t& out) {
+    std::ifstream io("/proc/self/io");
+    if (!io) {
+        return false;
+    }
+    bool gotin = false;
+    bool gotout = false;
+    std::string key;
+    uint64_t val;
+    while (io >> key >> val) {
+        if (key == "rchar:") {
+            in = val;
+            gotin = true;
+        } else if (key == "wchar:") {
+            out = val;
+            gotout = true;
+        }
+    }
+    return gotin && gotout;
+}
+
+
+static std::string json_escape (const std::string& str) {
+    std::string res;
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            res += '\\';
+        }
+        res += c;
+    }
+    return res;
+}
+
+
+static void profile_report () {
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - prof_start;
+    long peak = get_peak_rss_kb();
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+    bool have_io = get_io_bytes(bytes_in, bytes_out);
+    std::ostringstream rep;
+    if (prof_json) {
+        rep << "{\"program\": \"" << json_escape(prof_program) << "\", \"wall_seconds\": "
+            << wall.count() << ", \"peak_rss_kb\": " << peak << ", \"phases\": [";
+        for (unsigned int i = 0; i < prof_phases.size(); i++) {
+            const PhaseStat& p = prof_phases[i];
+            rep << (i > 0 ? ", " : "") << "{\"name\": \"" << json_escape(p.name)
+                << "\", \"seconds\": " << p.seconds << ", \"calls\": " << p.calls
+                << ", \"peak_rss_kb\": " << p.peak_rss_kb << "}";
+        }
+        rep << "], \"counters\": {";
+        for (int i = 0; i < PROF_NUM_COUNTERS; i++) {
+            rep << (i > 0 ? ", " : "") << "\"" << counter_names[i] << "\": " << prof_counters[i];
+        }
+        if (have_io) {
+            rep << ", \"bytes_read\": " << bytes_in << ", \"bytes_written\": " << bytes_out;
+        }
+        rep << "}}" << std::endl;
+    } else {
+        char line[256];
+        rep << "profile: " << prof_program << std::endl;
+        snprintf(line, sizeof(line), "%-28s %12s %7s %10s %14s\n", "phase", "seconds", "%",
+            "calls", "peak RSS (MB)");
+        rep << line;
+        for (unsigned int i = 0; i < prof_phases.size(); i++) {
+            const PhaseStat& p = prof_phases[i];
+            snprintf(line, sizeof(line), "%-28s %12.6f %7.1f %10llu %14.1f\n", p.name, p.seconds,
+                (wall.count() > 0.0 ? 100.0 * p.seconds / wall.count() : 0.0),
+                (unsigned long long)p.calls, p.peak_rss_kb / 1024.0);
+            rep << line;
+        }
+        snprintf(line, sizeof(line), "%-28s %12.6f %7.1f %10d %14.1f\n", "total (wall)",
+            wall.count(), 100.0, 1, peak / 1024.0);
+        rep << line;
+        for (int i = 0; i < PROF_NUM_COUNTERS; i++) {
+            if (prof_counters[i] > 0) {
+                snprintf(line, sizeof(line), "%-28s %12llu\n", counter_names[i],
+                    (unsigned long long)prof_counters[i]);
+                rep << line;
+            }
+        }
+        if (have_io) {
+            snprintf(line, sizeof(line), "%-28s %12llu\n%-28s %12llu\n", "bytes_read",
+                (unsigned long long)bytes_in, "bytes_written", (unsigned long long)bytes_out);
+            rep << line;
+        }
+    }
+    std::cerr << rep.str() << std::flush;
+}
+#endif
+
+
+// the report is written at exit, as the tools leave through exit() in many places
+void profile_enable (const std::string& program, const bool& json) {
+#ifdef PHYX_NO_PROFILE
+    std::cerr << "Warning: this build of phyx has no profiling support (PHYX_NO_PROFILE). "
+        << "Ignoring --profile." << std::endl;
+#else
+    if (phyx_profiling) {
+        return;
+    }
+    size_t slash = program.find_last_of('/');
+    prof_program = (slash == std::string::npos) ? program : program.substr(slash + 1);
+    prof_json = json;
+    prof_start = std::chrono::steady_clock::now();
+    memset(prof_counters, 0, sizeof(prof_counters));
+    phyx_profiling = true;
+    atexit(profile_report);
+#endif
+}
+
+
+void profile_add_phase (const char * name, const double& seconds) {
+    long rss = get_peak_rss_kb();
+    #pragma omp critical (profile_phases)
+    {
+        unsigned int i = 0;
+        while (i < prof_phases.size() && strcmp(prof_phases[i].name, name) != 0) {
+            i++;
+        }
+        if (i == prof_phases.size()) {
+            PhaseStat p = {name, 0.0, 0, 0};
+            prof_phases.push_back(p);
+        }
+        prof_phases[i].seconds += seconds;
+        prof_phases[i].calls++;
+        if (rss > prof_phases[i].peak_rss_kb) {
+            prof_phases[i].peak_rss_kb = rss;
+        }
+    }
+}
+
+
+void profile_count (const ProfileCounter& counter, const uint64_t& n) {
+    #pragma omp atomic
+    prof_counters[counter] += n;
+}
@@ -0,0 +1,65 @@
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+/*
+ * lightweight instrumentation, switched on at run time by the --profile (or
+ * --profile=json) flag that all the tools take (log_call removes it from argv
+ * before the tool's own option parsing). phases are scoped timers that
+ * accumulate wall time and calls by name (nested phases overlap); counters
+ * are a fixed set of atomic totals. at exit a report goes to stderr: the phase
+ * breakdown, the counters, peak RSS (sampled at the end of each phase and at
+ * exit) and the bytes read/written by the process (Linux only). while off,
+ * each hook costs one branch, and building with -DPHYX_NO_PROFILE (make
+ * PROFILE=N) removes the hooks altogether
+ */
+
+enum ProfileCounter {
+    PROF_TREES_PARSED = 0, PROF_SEQS_READ, PROF_PMATRIX_COMPUTED, PROF_PMATRIX_CACHE_HITS,
+    PROF_NUM_COUNTERS
+};
+
+extern bool phyx_profiling;
+
+void profile_enable (const std::string& program, const bool& json);
+void profile_add_phase (const char * name, const double& seconds);
+void profile_count (const ProfileCounter& counter, const uint64_t& n);
+
+
+class ProfilePhase {
+private:
+    const char * name_;
+    bool on_;
+    std::chrono::steady_clock::time_point start_;
+
+public:
+    ProfilePhase (const char * name):name_(name), on_(phyx_profiling) {
+        if (on_) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+    ~ProfilePhase () {
+        if (on_) {
+            std::chrono::duration<double> d = std::chrono::steady_clock::now() - start_;
+            profile_add_phase(name_, d.count());
+        }
+    }
+};
+
+
+#ifdef PHYX_NO_PROFILE
+#define PX_PROFILE_PHASE(name)
+#define PX_PROFILE_COUNT(counter, n)
+#else
+#define PX_PROFILE_CONCAT2(a, b) a##b
+#define PX_PROFILE_CONCAT(a, b) PX_PROFILE_CONCAT2(a, b)
+// times the rest of the enclosing scope
+#define PX_PROFILE_PHASE(name) ProfilePhase PX_PROFILE_CONCAT(px_phase_, __LINE__)(name)
+#define PX_PROFILE_COUNT(counter, n) \
+    do { if (phyx_profiling) { profile_count(counter, n); } } while (0)
+#endif
+
+#endif /* _PROFILE_H_ */
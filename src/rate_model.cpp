@@ -3,6 +3,7 @@
 #include <map>
 
 #include "rate_model.h"
+#include "profile.h"
 
 #include <armadillo>
 
@@ -132,6 +133,7 @@ mat& RateModel::get_Q() {
 }
 
 cx_mat RateModel::setup_P(double bl, bool store_p_matrices) {
+    PX_PROFILE_COUNT(PROF_PMATRIX_COMPUTED, 1);
     //sameQ = false;
     eigvec.fill(0);
     eigval.fill(0);
@@ -157,6 +159,7 @@ cx_mat RateModel::setup_P(double bl, bool store_p_matrices) {
 }
 
 void RateModel::setup_P_simple(mat& p, double bl, bool store_p_matrices) {
+    PX_PROFILE_COUNT(PROF_PMATRIX_COMPUTED, 1);
 //    sameQ = false;
     eigvec_simple.fill(0);
     eigval_simple.fill(0);
@@ -1,21 +1,41 @@
 #include <iostream>
 #include <fstream>
+#include <string>
+#include <vector>
 #include <set>
+#include <regex>
+#include <cstdint>
 
 #include "relabel.h"
 #include "tree.h"
+#include "node.h"
 #include "utils.h"
 #include "sequence.h"
+#include "seq_reader.h"
 
 
-Relabel::Relabel (std::string& cnamesf, std::string nnamesf, const bool& verbose) {
-    store_name_lists (cnamesf, nnamesf);
-    verbose_ = verbose;
+// 64-bit FNV-1a
+static uint64_t hash_name (const char * name, const size_t& len) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)name[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+
+// either name file may be empty (""), when only rules are used
+Relabel::Relabel (const std::string& cnamesf, const std::string& nnamesf,
+    const bool& verbose):mask_(0), verbose_(verbose), use_regex_(false), use_prefix_(false) {
+    if (!cnamesf.empty()) {
+        store_name_lists(cnamesf, nnamesf);
+    }
+    build_table();
 }
 
 
-void Relabel::store_name_lists (std::string& cnamesf, std::string nnamesf) {
-    std::vector<std::string> terp;
+void Relabel::store_name_lists (const std::string& cnamesf, const std::string& nnamesf) {
     std::string line;
     int ccount = 0;
     int ncount = 0;
@@ -23,20 +43,18 @@ void Relabel::store_name_lists (std::string& cnamesf, std::string nnamesf) {
     std::ifstream ifc(cnamesf.c_str());
     while (getline (ifc, line)) {
         if (!line.empty()) {
+            NameEntry e;
+            e.old_start = pool_.size();
+            e.old_len = line.size();
+            e.new_start = 0;
+            e.new_len = 0;
+            e.hash = hash_name(line.data(), line.size());
+            pool_ += line;
+            entries_.push_back(e);
             ccount++;
-            terp.push_back(line);
         }
     }
     ifc.close();
-    old_names_ = terp;
-    terp.clear();
-    
-    // check all current names are unique (otherwise won't work with existing map)
-    std::set<std::string> orig(old_names_.begin(), old_names_.end());
-    if (orig.size() < old_names_.size()) {
-        std::cerr << "Error: the current name list contains duplicates. Exiting." << std::endl;
-        exit(0);
-    }
     
     // TODO: clean names to make them jointly newick/nexus compliant
     // should we 'correct' invalid names? or leave it to user?
@@ -47,96 +65,241 @@ void Relabel::store_name_lists (std::string& cnamesf, std::string nnamesf) {
     std::ifstream ifn(nnamesf.c_str());
     while (getline (ifn, line)) {
         if (!line.empty()) {
+            if (ncount < ccount) {
+                entries_[ncount].new_start = pool_.size();
+                entries_[ncount].new_len = line.size();
+                pool_ += line;
+            }
             ncount++;
-            terp.push_back(line);
         }
     }
     ifn.close();
-    new_names_ = terp;
     
     if (ccount != ncount) {
         std::cerr << "Error: the current (" << ccount << ") and new (" << ncount
             << ") lists differ in length. Exiting." << std::endl;
         exit(0);
-    } else {
-        num_taxa_ = (int)old_names_.size();
-        for (int i = 0; i < num_taxa_; i++) {
-            name_map_[old_names_[i]] = new_names_[i];
+    }
+}
+
+
+// current names must be unique (otherwise the mapping is ambiguous)
+void Relabel::build_table () {
+    size_t nslots = 16;
+    while (nslots < 2 * entries_.size()) {
+        nslots *= 2;
+    }
+    slots_.assign(nslots, -1);
+    mask_ = nslots - 1;
+    for (unsigned int i = 0; i < entries_.size(); i++) {
+        const NameEntry& e = entries_[i];
+        uint64_t s = e.hash & mask_;
+        while (slots_[s] != -1) {
+            const NameEntry& o = entries_[slots_[s]];
+            if (o.hash == e.hash && o.old_len == e.old_len
+                    && pool_.compare(o.old_start, o.old_len, pool_, e.old_start, e.old_len) == 0) {
+                std::cerr << "Error: the current name list contains duplicates. Exiting." << std::endl;
+                exit(0);
+            }
+            s = (s + 1) & mask_;
         }
+        slots_[s] = (int)i;
     }
-    /*
-    for(map<string, string>::const_iterator it = name_map_.begin(); it != name_map_.end(); ++it) {
-        std::cout << it->first << " " << it->second << std::endl;
+}
+
+
+// returns the entry index, or -1 if name is not in the current name list
+int Relabel::find_name (const char * name, const size_t& len) const {
+    uint64_t h = hash_name(name, len);
+    uint64_t s = h & mask_;
+    while (slots_[s] != -1) {
+        const NameEntry& e = entries_[slots_[s]];
+        if (e.hash == h && e.old_len == len && pool_.compare(e.old_start, len, name, len) == 0) {
+            return slots_[s];
+        }
+        s = (s + 1) & mask_;
+    }
+    return -1;
+}
+
+
+// replacement uses the std::regex_replace format ($1, $& etc.)
+void Relabel::set_regex_rule (const std::string& pattern, const std::string& replacement) {
+    try {
+        regex_ = std::regex(pattern);
+    } catch (std::regex_error& e) {
+        std::cerr << "Error: invalid regular expression '" << pattern << "'. Exiting." << std::endl;
+        exit(0);
     }
-    */
+    replacement_ = replacement;
+    use_regex_ = true;
 }
 
 
-// if verbose, will report the failed matches
-void Relabel::relabel_tree (Tree * tr) {
-    // keep track of matches
-    std::set<std::string> orig(old_names_.begin(), old_names_.end());
+// an empty old prefix prepends new_prefix to every label
+void Relabel::set_prefix_rule (const std::string& old_prefix, const std::string& new_prefix) {
+    old_prefix_ = old_prefix;
+    new_prefix_ = new_prefix;
+    use_prefix_ = true;
+}
+
+
+// returns whether name was changed
+bool Relabel::apply_rules (std::string& name) const {
+    bool changed = false;
+    if (use_regex_ && std::regex_search(name, regex_)) {
+        name = std::regex_replace(name, regex_, replacement_);
+        changed = true;
+    }
+    if (use_prefix_ && name.compare(0, old_prefix_.size(), old_prefix_) == 0) {
+        name.replace(0, old_prefix_.size(), new_prefix_);
+        changed = true;
+    }
+    return changed;
+}
+
+
+// look name up in the lists (then with any single quotes removed, if
+// strip_quotes), and failing that apply the rules (if rules). returns the
+// entry index of a list hit, -1 otherwise
+int Relabel::relabel_name (std::string& name, const bool& strip_quotes,
+        const bool& rules) const {
+    int entry = find_name(name.data(), name.size());
+    if (entry == -1 && strip_quotes && name.find('\'') != std::string::npos) {
+        // see if it is quotes that is messing us up
+        std::string str = name;
+        replace_all(str, "'", "");
+        entry = find_name(str.data(), str.size());
+    }
+    if (entry != -1) {
+        name.assign(pool_, entries_[entry].new_start, entries_[entry].new_len);
+    } else if (rules) {
+        apply_rules(name);
+    }
+    return entry;
+}
+
+
+void Relabel::report_missing (const std::vector<char>& found, const std::string& where) const {
+    if (!verbose_) {
+        return;
+    }
+    std::set<std::string> orig;
+    for (unsigned int i = 0; i < entries_.size(); i++) {
+        if (!found[i]) {
+            orig.insert(pool_.substr(entries_[i].old_start, entries_[i].old_len));
+        }
+    }
+    if (orig.size() > 0) {
+        std::string msg = "The following names to match were not found in the " + where + ":\n";
+        for (auto elem : orig) {
+            msg += elem + "\n";
+        }
+        #pragma omp critical (relabel_report)
+        std::cerr << msg << std::flush;
+    }
+}
+
+
+// if verbose, will report the failed matches. the rules are only applied to
+// tips (internal labels are more likely support values). only reads the
+// name map, so trees can be relabelled concurrently
+void Relabel::relabel_tree (Tree * tr) const {
+    std::vector<char> found;
+    if (verbose_) {
+        found.assign(entries_.size(), 0);
+    }
     for (int i=0; i < tr->getExternalNodeCount(); i++) {
-        std::string str = tr->getExternalNode(i)->getName();
-        if (name_map_.find(str) != name_map_.end()) {
-            //std::cout << "Tree label '" << str << "' found in name list!" << std::endl;
-            tr->getExternalNode(i)->setName(name_map_[str]);
-            orig.erase(str);
-        } else {
-            // see if it is quotes that is messing us up
-            replace_all(str, "'", "");
-            if (name_map_.find(str) != name_map_.end()) {
-                //std::cout << "Found it (" << str << ") this time!" << std::endl;
-                tr->getExternalNode(i)->setName(name_map_[str]);
-                orig.erase(str);
-            }
-        }  
+        Node * nd = tr->getExternalNode(i);
+        std::string str = nd->getName();
+        int entry = relabel_name(str, true, true);
+        if (entry != -1 || use_regex_ || use_prefix_) {
+            nd->setName(str);
+        }
+        if (entry != -1 && verbose_) {
+            found[entry] = 1;
+        }
     }
     // do internal labels as well. be quieter here (don't expect internal nodes to have labels)
     for (int i=0; i < tr->getInternalNodeCount(); i++) {
-        std::string str = tr->getInternalNode(i)->getName();
+        Node * nd = tr->getInternalNode(i);
+        std::string str = nd->getName();
         if (str == "") {
             continue;
         }
-        if (name_map_.find(str) != name_map_.end()) {
-            //std::cout << "Tree label '" << str << "' found in name list!" << std::endl;
-            tr->getInternalNode(i)->setName(name_map_[str]);
-        } else {
-            // see if it is quotes that is messing us up
-            replace_all(str, "'", "");
-            if (name_map_.find(str) != name_map_.end()) {
-                //std::cout << "Found it this time!" << std::endl;
-                tr->getInternalNode(i)->setName(name_map_[str]);
-                orig.erase(str);
+        int entry = relabel_name(str, true, false);
+        if (entry != -1) {
+            nd->setName(str);
+            if (verbose_) {
+                found[entry] = 1;
             }
-        }  
+        }
     }
-    
-    // report failed matches (if present)
-    if (orig.size() > 0) {
-        if (verbose_) {
-            std::cerr << "The following names to match were not found in the tree:" << std::endl;
-            for (auto elem : orig) {
-                std::cerr << elem << std::endl;
-            }
+    report_missing(found, "tree");
+}
+
+
+// relabel the first nseqs seqs (in parallel) and append them to out as fasta.
+// found marks the list entries hit
+void Relabel::relabel_sequences (std::vector<Sequence>& seqs, const int& nseqs,
+        std::string& out, std::vector<char>& found) const {
+    std::vector<int> hits(nseqs);
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < nseqs; i++) {
+        std::string str = seqs[i].get_id();
+        hits[i] = relabel_name(str, false, true);
+        if (hits[i] != -1 || use_regex_ || use_prefix_) {
+            seqs[i].set_id(str);
         }
     }
+    found.resize(entries_.size(), 0);
+    for (int i = 0; i < nseqs; i++) {
+        if (hits[i] != -1) {
+            found[hits[i]] = 1;
+        }
+        out += ">";
+        out += seqs[i].get_id();
+        out += "\n";
+        out += seqs[i].get_sequence();
+        out += "\n";
+    }
 }
 
 
-// now returns a boolean indicating success
-bool Relabel::relabel_sequence (Sequence& seq) {
-    std::string str = seq.get_id();
-    if (name_map_.find(str) != name_map_.end()) {
-        seq.set_id(name_map_[str]);
-        return true;
-    } else {
-        return false;
+// streamable formats (fasta, fastq, simple phylip, sequential nexus): records
+// are read serially in batches (reusing the same Sequence objects), relabelled
+// in parallel, and written in input order. retstring is as left by the file
+// type check (and header parsing, for nexus)
+void Relabel::relabel_stream (std::istream& pios, const int& ft, std::string& retstring,
+        std::ostream* poos, std::vector<char>& found) const {
+    const int batchsize = 16384;
+    std::vector<Sequence> seqs(batchsize);
+    std::string out;
+    bool going = true;
+    while (going) {
+        int nseqs = 0;
+        while (nseqs < batchsize) {
+            going = read_next_seq_from_stream(pios, ft, retstring, seqs[nseqs]);
+            if (going) {
+                nseqs++;
+            } else {
+                // fasta has a trailing one
+                if (ft == 2) {
+                    nseqs++;
+                }
+                break;
+            }
+        }
+        out.clear();
+        relabel_sequences(seqs, nseqs, out, found);
+        poos->write(out.data(), out.size());
     }
+    poos->flush();
 }
 
 
-std::set<std::string> Relabel::get_names_to_replace () {
-    std::set<std::string> orig(old_names_.begin(), old_names_.end());
-    return orig;
+void Relabel::report_missing_sequences (const std::vector<char>& found) const {
+    std::vector<char> f(found);
+    f.resize(entries_.size(), 0);
+    report_missing(f, "alignment");
 }
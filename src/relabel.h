@@ -1,28 +1,63 @@
 #ifndef _RELABEL_TREE_H_
 #define _RELABEL_TREE_H_
 
-#include <map>
+#include <string>
 #include <vector>
-#include <set>
+#include <regex>
+#include <iostream>
+#include <cstdint>
 
 class Tree; // forward declaration
 class Sequence; // forward declaration
 
+/*
+ * relabelling by ordered lists of current and new names, plus optional rules
+ * for labels not in the lists: a regex replacement and a prefix replacement
+ * (applied in that order). the names are interned into one buffer and looked
+ * up through an open-addressing hash table (linear probing, at most half
+ * full). everything is read-only after setup, so trees and sequences can be
+ * relabelled concurrently
+ */
 class Relabel {
 private:
-    int num_taxa_;
-    std::vector<std::string> old_names_;
-    std::vector<std::string> new_names_;
-    std::map<std::string, std::string> name_map_;
+    struct NameEntry {
+        uint64_t hash;
+        size_t old_start;
+        size_t old_len;
+        size_t new_start;
+        size_t new_len;
+    };
+    
+    std::string pool_; // all names, back to back
+    std::vector<NameEntry> entries_; // in list order
+    std::vector<int> slots_; // entry index, -1 if empty
+    uint64_t mask_;
     bool verbose_;
     
-    void store_name_lists (std::string& cnamesf, std::string nnamesf);
+    bool use_regex_;
+    std::regex regex_;
+    std::string replacement_;
+    bool use_prefix_;
+    std::string old_prefix_;
+    std::string new_prefix_;
     
+    void store_name_lists (const std::string& cnamesf, const std::string& nnamesf);
+    void build_table ();
+    int find_name (const char * name, const size_t& len) const;
+    bool apply_rules (std::string& name) const;
+    int relabel_name (std::string& name, const bool& strip_quotes, const bool& rules) const;
+    void report_missing (const std::vector<char>& found, const std::string& where) const;
+
 public:
-    Relabel (std::string& cnamesf, std::string nnamesf, const bool& verbose);
-    void relabel_tree (Tree * tr);
-    bool relabel_sequence (Sequence& seq);
-    std::set<std::string> get_names_to_replace ();
+    Relabel (const std::string& cnamesf, const std::string& nnamesf, const bool& verbose);
+    void set_regex_rule (const std::string& pattern, const std::string& replacement);
+    void set_prefix_rule (const std::string& old_prefix, const std::string& new_prefix);
+    void relabel_tree (Tree * tr) const;
+    void relabel_sequences (std::vector<Sequence>& seqs, const int& nseqs, std::string& out,
+        std::vector<char>& found) const;
+    void relabel_stream (std::istream& pios, const int& ft, std::string& retstring,
+        std::ostream* poos, std::vector<char>& found) const;
+    void report_missing_sequences (const std::vector<char>& found) const;
 };
 
 #endif /* _RELABEL_TREE_H_ */
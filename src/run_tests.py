@@ -26,8 +26,8 @@ def test_program(name):
         cm = "./pxbp -t TEST/test.tre"
         t = '1 trees \n3 unique clades found\nCLADE: TaxonA TaxonB 	FREQ:	1.	ICA:	1.	COUNT:	1	TREEFREQ:	1.\nCLADE: TaxonA TaxonB TaxonC 	FREQ:	1.	ICA:	1.	COUNT:	1	TREEFREQ:	1.\nCLADE: TaxonD TaxonE 	FREQ:	1.	ICA:	1.	COUNT:	1	TREEFREQ:	1.\nTSCA: 3\n'
     elif name == "pxbdfit":
-        cm = "./pxbdfit -t TEST/ultra_100.tre"
-        t = 'ntips: 10\nnspeciation: 8\ntreelength: 8.67581\nrootheight: 1.74148\nmodel: bd\nlikelihood: 4.18076\naic: -4.36152\naicc: -2.64723\nb: 1.05759\nd: 0.319273\nr (b-d): 0.738315\ne (d/b): 0.301888\n'
+        cm = "./pxbdfit -t TEST/ultra_100.tre; ./pxbdfit -t TEST/yule_100taxa.tre"
+        t = 'ntips: 10\nnspeciation: 8\ntreelength: 8.67581\nrootheight: 1.74148\nmodel: bd\nlikelihood: 4.18076\naic: -4.36152\naicc: -2.64723\nb: 1.05759\nd: 0.319273\nr (b-d): 0.738315\ne (d/b): 0.301888\nntips: 100\nnspeciation: 98\ntreelength: 97.2277\nrootheight: 5.0547\nmodel: bd\nlikelihood: 261.91\naic: -519.819\naicc: -519.695\nb: 1.00794\nd: 0\nr (b-d): 1.00794\ne (d/b): 0\n'
     elif name == "pxtscale":
         cm = "./pxtscale -t TEST/test.tre -s 10"
         t = '(((TaxonA:1,TaxonB:0.3):1.25,TaxonC:2.5):4,(TaxonD:2.3000000000000003,TaxonE:1.6000000000000001):3);\n'
@@ -69,7 +69,7 @@ def test_program(name):
         t = '#NEXUS\nBegin trees;\ntree tree0 = [&R] (((TaxonA:0.1,TaxonB:0.03)0.43:0.125,TaxonC:0.25)1.0:0.4,(TaxonD:0.23,TaxonE:0.16)0.94:0.3);\nend;\n'
     elif name == "pxbdsim":
         cm = "./pxbdsim -e 5 -x 1"
-        t = '((taxon_1:0.3085569342610965,taxon_2:0.3085569342610965):0.6313710462719906,(taxon_3:0.9385183995956337,(taxon_4:0.5397758496988591,taxon_5:0.5397758496988591):0.3987425498967747):0.0014095809374534);\n'
+        t = '((taxon_1:1.0970825638666497,(taxon_2:0.125474659434736,taxon_3:0.125474659434736):0.9716079044319137):0.2034782024631958,(taxon_4:0.5103801339799571,taxon_5:0.5103801339799571):0.7901806323498884);\n'
     elif name == "pxs2fa":
         cm = "./pxs2fa -s TEST/Concat_Sequence2.NEX"
         t = '>Sequence1\nAAATTTCCCTTTCCCTTTAAA\n>Sequence2\nGGGGGGGGGGCCCCCCCCCCA\n>Sequence3\nCCCCCCCCCCCCAAAAAAAAA\n>Sequence9\nAAATTTCCCTTTCCCTTTAAA\n>Sequence10\nGGGGGGGGGGCCCCCCCCCCA\n>Sequence11\nCCCCCCCCCCCCAAAAAAAAA\n>Sequence8\nTTTTTTTTCCCCCCCGGGGGA\n'
@@ -80,8 +80,8 @@ def test_program(name):
         cm = "./pxnj -s TEST/test.fa"
         t = '((((TaxonA:0.300000,TaxonC:0.300000):0.112500,TaxonB:0.437500):0.087500,TaxonD:0.250000):0.100000,TaxonE:0.100000);\n'
     elif name == "pxconsq":
-        cm = "./pxconsq -s TEST/test.fa"
-        t = '>consensus\nDHNYKNBBSNNYHMMDNHVV\n'
+        cm = "./pxconsq -s TEST/test.fa; ./pxconsq -s TEST/AA_missing.fa"
+        t = '>consensus\nDHNYKNBBSNNYHMMDNHVV\n>consensus\nMK?LBq*\n'
     elif name == "pxseqgen":
         cm = "./pxseqgen -t TEST/test.tre -x 1 -l 10"
         t = '>TaxonE\nCTGTAACTAG\n>TaxonD\nCTGTAACTAG\n>TaxonC\nGTCTAACAGG\n>TaxonB\nGTTTGACTGG\n>TaxonA\nTTTTGACTGG\n'
@@ -154,6 +154,12 @@ def test_program(name):
     elif name == "pxcomp":
         cm = "./pxcomp -s TEST/test.fa"
         t = 'Observed character counts:\n              A        C        G        T    Nchar\nTaxonA        5        6        1        8       20\nTaxonB        4        8        7        1       20\nTaxonC        7        7        2        4       20\nTaxonD        2        6        5        7       20\nTaxonE        2       10        3        5       20\nTotal        20       37       18       25      100\nchi-square test stat. = 18.458\ndf = 12\nprob = 0.102476\n'
+    elif name == "pxdist":
+        cm = "./pxdist -s TEST/test.fa"
+        t = '5\nTaxonA 0.000000 0.900000 0.600000 0.700000 0.700000\nTaxonB 0.900000 0.000000 0.800000 0.800000 0.700000\nTaxonC 0.600000 0.800000 0.000000 0.750000 0.750000\nTaxonD 0.700000 0.800000 0.750000 0.000000 0.450000\nTaxonE 0.700000 0.700000 0.750000 0.450000 0.000000\n'
+    elif name == "pxtcomb":
+        cm = "./pxtcomb -t TEST/test.tre -a TEST/tcomb_add.tre"
+        t = '(((((TaxonA:0,TaxonF:0.05):0,TaxonB:0.03):0.1,TaxonH:0.1):0.1,TaxonC:0.2):0.4,(TaxonD:0.23,(TaxonE:0.1,TaxonG:0.1):0.06):0.3);\n'
     else:
         return
     p = subprocess.Popen(cm,shell=True,stdout=subprocess.PIPE)
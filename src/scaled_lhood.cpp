@@ -0,0 +1,120 @@
+#include <vector>
+#include <cmath>
+
+#include "scaled_lhood.h"
+#include "superdouble.h"
+
+
+ScaledVector::ScaledVector (const int& n):values_(n, 0.0), exponent_(0) {}
+
+
+// take the largest exponent as the shared one. anything more than ~300 orders
+// of magnitude below that underflows to 0, which is well below double precision
+ScaledVector::ScaledVector (std::vector<Superdouble>& in):values_(in.size(), 0.0),
+    exponent_(0) {
+    bool found = false;
+    for (unsigned int i=0; i < in.size(); i++) {
+        if (in[i].getMantissa() != 0.0) {
+            if (!found || in[i].getExponent() > exponent_) {
+                exponent_ = in[i].getExponent();
+                found = true;
+            }
+        }
+    }
+    for (unsigned int i=0; i < in.size(); i++) {
+        double m = in[i].getMantissa();
+        if (m != 0.0) {
+            int diff = in[i].getExponent() - exponent_;
+            values_[i] = (diff == 0) ? m : m * std::pow(10.0, diff);
+        }
+    }
+}
+
+
+// keep the largest value near 1 so chains of kernels can neither overflow nor
+// underflow. only happens once a vector drifts well away from 1
+void ScaledVector::rescale () {
+    double mx = 0.0;
+    for (unsigned int i=0; i < values_.size(); i++) {
+        double a = std::fabs(values_[i]);
+        if (a > mx) {
+            mx = a;
+        }
+    }
+    if (mx == 0.0 || (mx > 1e-50 && mx < 1e50)) {
+        return;
+    }
+    int k = (int)std::floor(std::log10(mx));
+    double factor = std::pow(10.0, -k);
+    for (unsigned int i=0; i < values_.size(); i++) {
+        values_[i] *= factor;
+    }
+    exponent_ += k;
+}
+
+
+// this = P x (or x^T P if transpose), with P an n x n row-major matrix of
+// plain doubles (e.g., transition probabilities)
+void ScaledVector::set_mat_vec (const std::vector<double>& P, const ScaledVector& x,
+        const bool& transpose) {
+    const int n = x.size();
+    const double * xv = &x.values_[0];
+    std::vector<double> res(n, 0.0);
+    if (!transpose) {
+        for (int j=0; j < n; j++) {
+            const double * row = &P[(size_t)j * n];
+            double s = 0.0;
+            for (int k=0; k < n; k++) {
+                s += row[k] * xv[k];
+            }
+            res[j] = s;
+        }
+    } else {
+        for (int i=0; i < n; i++) {
+            const double * row = &P[(size_t)i * n];
+            const double xi = xv[i];
+            for (int j=0; j < n; j++) {
+                res[j] += xi * row[j];
+            }
+        }
+    }
+    exponent_ = x.exponent_;
+    values_.swap(res);
+    rescale();
+}
+
+
+// element-wise product
+void ScaledVector::multiply (const ScaledVector& x) {
+    for (unsigned int i=0; i < values_.size(); i++) {
+        values_[i] *= x.values_[i];
+    }
+    exponent_ += x.exponent_;
+    rescale();
+}
+
+
+Superdouble ScaledVector::sum () const {
+    double s = 0.0;
+    for (unsigned int i=0; i < values_.size(); i++) {
+        s += values_[i];
+    }
+    return Superdouble(s, exponent_);
+}
+
+
+Superdouble ScaledVector::dot (const ScaledVector& x) const {
+    double s = 0.0;
+    for (unsigned int i=0; i < values_.size(); i++) {
+        s += values_[i] * x.values_[i];
+    }
+    return Superdouble(s, exponent_ + x.exponent_);
+}
+
+
+void ScaledVector::to_superdouble (std::vector<Superdouble>& out) const {
+    out.resize(values_.size());
+    for (unsigned int i=0; i < values_.size(); i++) {
+        out[i] = Superdouble(values_[i], exponent_);
+    }
+}
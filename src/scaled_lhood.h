@@ -0,0 +1,36 @@
+#ifndef _SCALED_LHOOD_H_
+#define _SCALED_LHOOD_H_
+
+#include <vector>
+
+#include "superdouble.h"
+
+/*
+ * a vector of (likelihood) values sharing a single base 10 exponent:
+ *   x[i] = values_[i] * 10^exponent_
+ * the kernels work on plain doubles, so the loops can be vectorized, and only
+ * touch the exponent once per vector rather than renormalizing every element
+ * after every operation as Superdouble does. converts to/from Superdouble so
+ * it can be dropped into code that stores Superdouble vectors
+ */
+class ScaledVector {
+private:
+    std::vector<double> values_;
+    int exponent_;
+
+public:
+    ScaledVector (const int& n);
+    ScaledVector (std::vector<Superdouble>& in);
+    void rescale ();
+    void set_mat_vec (const std::vector<double>& P, const ScaledVector& x,
+        const bool& transpose);
+    void multiply (const ScaledVector& x);
+    Superdouble sum () const;
+    Superdouble dot (const ScaledVector& x) const;
+    void to_superdouble (std::vector<Superdouble>& out) const;
+    int size () const { return (int)values_.size(); };
+    int get_exponent () const { return exponent_; };
+    double get_value (const int& i) const { return values_[i]; };
+};
+
+#endif /* _SCALED_LHOOD_H_ */
@@ -0,0 +1,164 @@
+/*
+ * precision check of the ScaledVector kernels against the element-wise
+ * Superdouble arithmetic they replace (sums, P x / x^T P products, and a long
+ * pruning-style chain that drives likelihoods far below the double range).
+ * run with `make check-precision`. returns non-zero if any check fails
+ */
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+#include <cmath>
+
+#include "superdouble.h"
+#include "scaled_lhood.h"
+
+
+// |a/b - 1|, computed without leaving Superdouble (a and b may be tiny)
+double rel_error (Superdouble a, Superdouble b) {
+    if (b.getMantissa() == 0.0) {
+        return std::fabs(double(a));
+    }
+    Superdouble r = a / b;
+    return std::fabs(double(r) - 1.0);
+}
+
+
+double unif () {
+    return (double)rand() / ((double)RAND_MAX + 1.0);
+}
+
+
+// random positive values spread over maxorders orders of magnitude
+std::vector<Superdouble> random_vector (const int& n, const int& maxorders) {
+    std::vector<Superdouble> v(n);
+    for (int i=0; i < n; i++) {
+        v[i] = Superdouble(1.0 + 9.0 * unif(), -(int)(unif() * maxorders));
+    }
+    return v;
+}
+
+
+// row-stochastic n x n matrix, row-major
+std::vector<double> random_p (const int& n) {
+    std::vector<double> P(n * n);
+    for (int i=0; i < n; i++) {
+        double tot = 0.0;
+        for (int j=0; j < n; j++) {
+            P[i * n + j] = unif() + 1e-3;
+            tot += P[i * n + j];
+        }
+        for (int j=0; j < n; j++) {
+            P[i * n + j] /= tot;
+        }
+    }
+    return P;
+}
+
+
+// the previous (Superdouble) implementations. the sum is taken largest term
+// first: adding a term more than ~10^308 times the running total overflows
+// Superdouble::operator+= (pow(10, exponentdif)), which ScaledVector avoids
+Superdouble superdouble_sum (std::vector<Superdouble> in) {
+    std::sort(in.begin(), in.end(), std::greater<Superdouble>());
+    Superdouble sum = 0;
+    for (unsigned int i=0; i < in.size(); i++) {
+        sum += in[i];
+    }
+    return sum;
+}
+
+
+std::vector<Superdouble> superdouble_mat_vec (const std::vector<double>& P,
+        std::vector<Superdouble>& x, const bool& transpose) {
+    int n = (int)x.size();
+    std::vector<Superdouble> res(n, 0);
+    for (int j=0; j < n; j++) {
+        for (int k=0; k < n; k++) {
+            if (!transpose) {
+                res[j] += x[k] * P[j * n + k];
+            } else {
+                res[j] += x[k] * P[k * n + j];
+            }
+        }
+    }
+    return res;
+}
+
+
+bool report (const std::string& name, const double& err, const double& tol) {
+    bool pass = err <= tol;
+    std::cout << name << "\tmax rel error: " << err << "\t" << (pass ? "PASS" : "FAIL")
+        << std::endl;
+    return pass;
+}
+
+
+int main () {
+    srand(1234);
+    const double tol = 1e-10;
+    const int nreps = 2000;
+    bool good = true;
+    
+    double maxerr = 0.0;
+    for (int r=0; r < nreps; r++) {
+        int n = 2 + rand() % 30;
+        std::vector<Superdouble> v = random_vector(n, (r % 2 == 0) ? 10 : 400);
+        double err = rel_error(ScaledVector(v).sum(), superdouble_sum(v));
+        maxerr = std::max(maxerr, err);
+    }
+    good = report("sum", maxerr, tol) && good;
+    
+    for (int t=0; t < 2; t++) {
+        bool transpose = (t == 1);
+        maxerr = 0.0;
+        for (int r=0; r < nreps; r++) {
+            int n = 2 + rand() % 20;
+            std::vector<Superdouble> v = random_vector(n, (r % 2 == 0) ? 10 : 200);
+            std::vector<double> P = random_p(n);
+            std::vector<Superdouble> expect = superdouble_mat_vec(P, v, transpose);
+            ScaledVector res(n);
+            res.set_mat_vec(P, ScaledVector(v), transpose);
+            std::vector<Superdouble> got;
+            res.to_superdouble(got);
+            for (int i=0; i < n; i++) {
+                maxerr = std::max(maxerr, rel_error(got[i], expect[i]));
+            }
+        }
+        good = report(transpose ? "x^T P" : "P x", maxerr, tol) && good;
+    }
+    
+    // caterpillar pruning: conds = (P conds) * (P tip) over many tips, so the
+    // likelihood ends up thousands of orders of magnitude below 1
+    const int nstates = 4;
+    const int ntips = 5000;
+    std::vector<double> P = random_p(nstates);
+    std::vector<Superdouble> sdconds(nstates, 0);
+    sdconds[rand() % nstates] = 1.0;
+    ScaledVector conds(sdconds);
+    for (int i=0; i < ntips; i++) {
+        std::vector<Superdouble> tip(nstates, 0);
+        tip[rand() % nstates] = 1.0;
+        std::vector<Superdouble> a = superdouble_mat_vec(P, sdconds, false);
+        std::vector<Superdouble> b = superdouble_mat_vec(P, tip, false);
+        for (int j=0; j < nstates; j++) {
+            sdconds[j] = a[j] * b[j];
+        }
+        ScaledVector sa(nstates);
+        sa.set_mat_vec(P, conds, false);
+        ScaledVector sb(nstates);
+        sb.set_mat_vec(P, ScaledVector(tip), false);
+        sa.multiply(sb);
+        conds = sa;
+    }
+    double expect = double(superdouble_sum(sdconds).getLn());
+    double got = double(conds.sum().getLn());
+    std::cout << "lnL (" << ntips << " tips)\tsuperdouble: " << expect << "\tscaled: " << got
+        << std::endl;
+    good = report("lnL", std::fabs((got - expect) / expect), tol) && good;
+    
+    return good ? EXIT_SUCCESS : EXIT_FAILURE;
+}
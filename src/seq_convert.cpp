@@ -0,0 +1,408 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <cctype>
+
+#include "seq_convert.h"
+#include "sequence.h"
+#include "utils.h"
+#include "profile.h"
+
+
+// output is handed to the stream in pieces of about this size
+static const size_t out_chunk = 1 << 20;
+
+
+static bool is_trim_space (const char& c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+
+static void append_upper (std::string& out, const char * p, const size_t& n) {
+    size_t start = out.size();
+    out.append(p, n);
+    for (size_t i = start; i < out.size(); i++) {
+        out[i] = (char)toupper((unsigned char)out[i]);
+    }
+}
+
+
+SeqConverter::SeqConverter (const std::string& seqf, const int& ft,
+        const bool& uppercase):uppercase_(uppercase), seqs_(NULL), seen_(256, 0),
+        buf_(1 << 16) {
+    infile_.open(seqf.c_str(), std::ios::binary);
+    if (ft == 2) {
+        index_fasta();
+    } else {
+        index_fastq();
+    }
+    PX_PROFILE_COUNT(PROF_SEQS_READ, entries_.size());
+    // reads are now seeks followed by sized reads; buffering them only adds
+    // a copy (and a full buffer refill per seek)
+    infile_.close();
+    infile_.rdbuf()->pubsetbuf(NULL, 0);
+    infile_.open(seqf.c_str(), std::ios::binary);
+}
+
+
+SeqConverter::SeqConverter (std::vector<Sequence>& seqs,
+        const bool& uppercase):uppercase_(uppercase), seqs_(&seqs), seen_(256, 0) {
+    entries_.resize(seqs.size());
+    for (unsigned int i = 0; i < seqs.size(); i++) {
+        const std::string& str = seqs[i].get_sequence_ref();
+        entries_[i].id_off = 0;
+        entries_[i].id_len = 0;
+        entries_[i].seq_off = 0;
+        entries_[i].seq_len = str.size();
+        for (char c : str) {
+            seen_[(unsigned char)c] = 1;
+        }
+    }
+}
+
+
+// same reading as read_next_seq_from_stream: the id is the rest of the '>'
+// line, and the sequence is the following lines joined and trimmed of
+// whitespace at either end
+void SeqConverter::index_fasta () {
+    PX_PROFILE_PHASE("index sequences");
+    std::string line;
+    uint64_t pos = 0;
+    bool inrec = false;
+    bool started = false;
+    uint64_t run = 0; // characters since the first residue
+    std::vector<char> pending(256, 0); // whitespace kept only if followed by a residue
+    SeqEntry e = {0, 0, 0, 0};
+    while (getline(infile_, line)) {
+        if (!line.empty() && line[0] == '>') {
+            if (inrec) {
+                entries_.push_back(e);
+            }
+            e.id_off = pos + 1;
+            e.id_len = line.size() - 1;
+            e.seq_off = 0;
+            e.seq_len = 0;
+            inrec = true;
+            started = false;
+            run = 0;
+            pending[' '] = pending['\t'] = pending['\r'] = 0;
+        } else if (inrec) {
+            for (size_t k = 0; k < line.size(); k++) {
+                unsigned char c = line[k];
+                if (is_trim_space(c)) {
+                    if (started) {
+                        run++;
+                        pending[c] = 1;
+                    }
+                } else {
+                    if (!started) {
+                        started = true;
+                        e.seq_off = pos + k;
+                    }
+                    run++;
+                    e.seq_len = run;
+                    seen_[c] = 1;
+                    if (pending[' '] || pending['\t'] || pending['\r']) {
+                        seen_[' '] |= pending[' '];
+                        seen_['\t'] |= pending['\t'];
+                        seen_['\r'] |= pending['\r'];
+                        pending[' '] = pending['\t'] = pending['\r'] = 0;
+                    }
+                }
+            }
+        }
+        pos += line.size() + 1;
+    }
+    if (inrec) {
+        entries_.push_back(e);
+    }
+}
+
+
+// 4 lines a record; an incomplete one at the end is dropped
+void SeqConverter::index_fastq () {
+    PX_PROFILE_PHASE("index sequences");
+    std::string line;
+    uint64_t pos = 0;
+    int nline = 0;
+    SeqEntry e = {0, 0, 0, 0};
+    while (getline(infile_, line)) {
+        if (nline == 0) {
+            e.id_off = pos + 1;
+            e.id_len = line.empty() ? 0 : line.size() - 1;
+        } else if (nline == 1) {
+            e.seq_off = pos;
+            e.seq_len = line.size();
+            for (char c : line) {
+                seen_[(unsigned char)c] = 1;
+            }
+        } else if (nline == 3) {
+            entries_.push_back(e);
+        }
+        nline = (nline + 1) % 4;
+        pos += line.size() + 1;
+    }
+}
+
+
+void SeqConverter::check_aligned () const {
+    if (entries_.empty()) {
+        std::cerr << "Error: no sequences found. Exiting." << std::endl;
+        exit(0);
+    }
+    for (unsigned int i = 1; i < entries_.size(); i++) {
+        if (entries_[i].seq_len != entries_[0].seq_len) {
+            std::cerr << "Error: sequences are not aligned. Exiting." << std::endl;
+            exit(0);
+        }
+    }
+}
+
+
+void SeqConverter::get_id (const size_t& i, std::string& id) {
+    if (seqs_ != NULL) {
+        id = (*seqs_)[i].get_id();
+        return;
+    }
+    id.resize(entries_[i].id_len);
+    infile_.clear();
+    infile_.seekg(entries_[i].id_off);
+    infile_.read(&id[0], id.size());
+}
+
+
+// append n residues of sequence i, starting at cursor (a file offset, or a
+// position in the sequence), to out_. returns the cursor after them
+uint64_t SeqConverter::copy_residues (const size_t& i, uint64_t cursor, uint64_t n) {
+    if (seqs_ != NULL) {
+        const std::string& str = (*seqs_)[i].get_sequence_ref();
+        if (uppercase_) {
+            append_upper(out_, str.data() + cursor, n);
+        } else {
+            out_.append(str, cursor, n);
+        }
+        return cursor + n;
+    }
+    infile_.clear();
+    infile_.seekg(cursor);
+    while (n > 0) {
+        // allow for a few line breaks, so one read is usually enough
+        uint64_t want = std::min((uint64_t)buf_.size(), n + (n >> 4) + 2);
+        infile_.read(&buf_[0], want);
+        std::streamsize got = infile_.gcount();
+        if (got <= 0) {
+            std::cerr << "Error: sequence file ended unexpectedly. Exiting." << std::endl;
+            exit(0);
+        }
+        const char * p = &buf_[0];
+        const char * end = p + got;
+        while (p < end && n > 0) {
+            const char * nl = (const char *)memchr(p, '\n', end - p);
+            uint64_t span = (nl == NULL ? end : nl) - p;
+            if (span > n) {
+                span = n;
+            }
+            if (uppercase_) {
+                append_upper(out_, p, span);
+            } else {
+                out_.append(p, span);
+            }
+            n -= span;
+            p += span;
+            if (n > 0 && p < end && *p == '\n') {
+                p++;
+            }
+        }
+        cursor += p - &buf_[0];
+    }
+    return cursor;
+}
+
+
+// as write_nexus_alignment: the datatype is inferred from the first sequence
+void SeqConverter::get_datatype (std::string& datatype, std::string& symbols) {
+    if (seqs_ != NULL) {
+        datatype = (*seqs_)[0].get_alpha_name();
+    } else {
+        bool upper = uppercase_;
+        uppercase_ = false;
+        size_t start = out_.size();
+        copy_residues(0, entries_[0].seq_off, entries_[0].seq_len);
+        uppercase_ = upper;
+        Sequence first("", out_.substr(start), true);
+        out_.resize(start);
+        datatype = first.get_alpha_name();
+    }
+    symbols = "";
+    if (datatype == "AA") { // "AA" is not a valid Nexus datatype
+        datatype = "PROTEIN";
+    }
+    if (datatype == "BINARY") {
+        datatype = "STANDARD";
+        symbols = "01";
+    }
+    if (datatype == "MULTI") {
+        datatype = "STANDARD";
+        std::vector<char> present(256, 0);
+        for (int c = 0; c < 256; c++) {
+            if (seen_[c]) {
+                present[uppercase_ ? (unsigned char)toupper(c) : c] = 1;
+            }
+        }
+        // in char order, as get_alphabet_from_sequence sorts
+        for (int c = CHAR_MIN; c <= CHAR_MAX; c++) {
+            if (present[(unsigned char)c] && c != '-' && c != '?') {
+                symbols += (char)c;
+            }
+        }
+    }
+}
+
+
+void SeqConverter::flush_out (std::ostream* poos, const bool& force) {
+    if (force || out_.size() >= out_chunk) {
+        poos->write(out_.data(), out_.size());
+        out_.clear();
+    }
+}
+
+
+// width 0 (or not less than the alignment length) writes each sequence on one
+// line. otherwise blocks are separated by a blank line, and phylip names only
+// go in the first block
+void SeqConverter::write_matrix (std::ostream* poos, const int& width, const bool& nexus) {
+    PX_PROFILE_PHASE("write alignment");
+    uint64_t nchar = entries_[0].seq_len;
+    uint64_t w = (width > 0 && (uint64_t)width < nchar) ? (uint64_t)width : nchar;
+    std::vector<uint64_t> cursors(entries_.size());
+    for (unsigned int i = 0; i < entries_.size(); i++) {
+        cursors[i] = entries_[i].seq_off;
+    }
+    std::string id;
+    uint64_t done = 0;
+    do {
+        uint64_t n = std::min(w, nchar - done);
+        if (done > 0) {
+            out_ += "\n";
+        }
+        for (unsigned int i = 0; i < entries_.size(); i++) {
+            if (done == 0 || nexus) {
+                get_id(i, id);
+                // MrBayes is not Nexus-compliant, so using a "safe" version
+                out_ += nexus ? get_safe_taxon_label(id) : id;
+                out_ += "\t";
+            }
+            cursors[i] = copy_residues(i, cursors[i], n);
+            out_ += "\n";
+            flush_out(poos, false);
+        }
+        done += n;
+    } while (done < nchar);
+}
+
+
+void SeqConverter::write_phylip (std::ostream* poos, const int& width) {
+    check_aligned();
+    out_ = std::to_string(entries_.size()) + " " + std::to_string(entries_[0].seq_len) + "\n";
+    write_matrix(poos, width, false);
+    flush_out(poos, true);
+    poos->flush();
+}
+
+
+void SeqConverter::write_nexus (std::ostream* poos, const int& width) {
+    check_aligned();
+    std::string datatype;
+    std::string symbols;
+    get_datatype(datatype, symbols);
+    uint64_t nchar = entries_[0].seq_len;
+    bool interleave = width > 0 && (uint64_t)width < nchar;
+    out_ = "#NEXUS\nBEGIN DATA;\n\tDIMENSIONS NTAX=" + std::to_string(entries_.size())
+        + " NCHAR=" + std::to_string(nchar) + ";\n";
+    out_ += "\tFORMAT DATATYPE=" + datatype;
+    if (!symbols.empty()) {
+        out_ += " SYMBOLS=\"" + symbols + "\"";
+    }
+    out_ += interleave ? " INTERLEAVE=YES" : " INTERLEAVE=NO";
+    out_ += " GAP=- MISSING=?;\n\tMATRIX\n\n";
+    write_matrix(poos, width, true);
+    out_ += ";\nend;\n\n";
+    flush_out(poos, true);
+    poos->flush();
+}
+
+
+static void append_fasta (std::string& out, const std::string& id, const char * seq,
+        const size_t& len, const bool& uppercase) {
+    out += ">";
+    out += id;
+    out += "\n";
+    if (uppercase) {
+        append_upper(out, seq, len);
+    } else {
+        out.append(seq, len);
+    }
+    out += "\n";
+}
+
+
+// fasta or fastq to fasta for pxs2fa, without going through Sequence objects.
+// retstring is the first line, as left by the file type check
+void write_fasta_stream (std::istream& pios, const int& ft, std::string& retstring,
+        const bool& uppercase, std::ostream* poos) {
+    PX_PROFILE_PHASE("convert to fasta");
+    std::string out;
+    std::string line = retstring;
+    retstring = "";
+    if (ft == 2) {
+        std::string id = line.substr(1);
+        std::string curseq;
+        while (true) {
+            bool more = static_cast<bool>(getline(pios, line));
+            if (!more || (!line.empty() && line[0] == '>')) {
+                // trim as trim_spaces does
+                size_t start = curseq.find_first_not_of(" \t\r\n");
+                size_t len = 0;
+                if (start != std::string::npos) {
+                    len = curseq.find_last_not_of(" \t\r\n") - start + 1;
+                } else {
+                    start = 0;
+                }
+                append_fasta(out, id, curseq.data() + start, len, uppercase);
+                if (!more) {
+                    break;
+                }
+                id = line.substr(1);
+                curseq.clear();
+            } else {
+                curseq += line;
+            }
+            if (out.size() >= out_chunk) {
+                poos->write(out.data(), out.size());
+                out.clear();
+            }
+        }
+    } else {
+        std::string id;
+        std::string seq;
+        std::string plus;
+        std::string qual;
+        while (getline(pios, seq) && getline(pios, plus) && getline(pios, qual)) {
+            id = line.substr(1);
+            append_fasta(out, id, seq.data(), seq.size(), uppercase);
+            if (out.size() >= out_chunk) {
+                poos->write(out.data(), out.size());
+                out.clear();
+            }
+            if (!getline(pios, line)) {
+                break;
+            }
+        }
+    }
+    poos->write(out.data(), out.size());
+    poos->flush();
+}
@@ -0,0 +1,59 @@
+#ifndef _SEQ_CONVERT_H_
+#define _SEQ_CONVERT_H_
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <cstdint>
+
+class Sequence; // forward declaration
+
+
+/*
+ * phylip/nexus writer for pxs2phy and pxs2nex. a fasta or fastq file is not
+ * loaded: a first pass keeps only where each id and sequence starts and how
+ * long it is (plus which characters occur, for nexus SYMBOLS), and residues
+ * are then copied from the input to the output in chunks. this also allows
+ * interleaved output (blocks of width characters) of alignments larger than
+ * memory. other inputs (nexus, phylip, STDIN) are read into seqs beforehand
+ * and written through the same code
+ */
+class SeqConverter {
+private:
+    struct SeqEntry {
+        uint64_t id_off; // file offsets
+        uint64_t id_len;
+        uint64_t seq_off; // first residue
+        uint64_t seq_len; // residues, i.e. not counting newlines
+    };
+    
+    bool uppercase_;
+    std::vector<Sequence> * seqs_; // in-memory source, or NULL
+    std::ifstream infile_;
+    std::vector<SeqEntry> entries_;
+    std::vector<char> seen_; // characters present in the sequences
+    std::vector<char> buf_;
+    std::string out_;
+    
+    void index_fasta ();
+    void index_fastq ();
+    void check_aligned () const;
+    void get_id (const size_t& i, std::string& id);
+    uint64_t copy_residues (const size_t& i, uint64_t cursor, uint64_t n);
+    void get_datatype (std::string& datatype, std::string& symbols);
+    void write_matrix (std::ostream* poos, const int& width, const bool& nexus);
+    void flush_out (std::ostream* poos, const bool& force);
+
+public:
+    SeqConverter (const std::string& seqf, const int& ft, const bool& uppercase);
+    SeqConverter (std::vector<Sequence>& seqs, const bool& uppercase);
+    static bool can_index (const int& ft) { return ft == 2 || ft == 3; };
+    void write_phylip (std::ostream* poos, const int& width);
+    void write_nexus (std::ostream* poos, const int& width);
+};
+
+void write_fasta_stream (std::istream& pios, const int& ft, std::string& retstring,
+    const bool& uppercase, std::ostream* poos);
+
+#endif /* _SEQ_CONVERT_H_ */
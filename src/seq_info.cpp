@@ -11,54 +11,59 @@
 #include "seq_reader.h"
 
 
-// for each character in the alphabet 'seq_chars_'
-void SeqInfo::count_chars_indiv_seq (std::string& seq) {
-    seq = string_to_upper(seq);
-    total_.clear(); // probably unnecessary
+// byte histograms of every seq, computed once. all of the counting below
+// works off these, so the seqs are never concatenated or copied
+void SeqInfo::count_bytes () {
+    if (byte_counts_.empty() && !seqs_.empty()) {
+        get_byte_histograms(seqs_, byte_counts_);
+    }
+}
+
+
+// for each character in the alphabet 'seq_chars_', across the whole alignment
+// (case-insensitive). anything else (e.g., weird J characters) counts as missing
+void SeqInfo::count_chars_whole_alignment () {
+    count_bytes();
+    std::vector<double> all(256, 0.0);
+    for (unsigned int i = 0; i < byte_counts_.size(); i++) {
+        std::vector<int> counts = byte_counts_[i];
+        fold_byte_histogram(counts);
+        for (int b = 0; b < 256; b++) {
+            all[b] += counts[b];
+        }
+    }
+    total_.clear();
+    std::vector<bool> in_alphabet(256, false);
     for (unsigned int i = 0; i < seq_chars_.length(); i++) {
-        total_[seq_chars_[i]] = 0.0;
+        total_[seq_chars_[i]] = all[(unsigned char)seq_chars_[i]];
+        in_alphabet[(unsigned char)seq_chars_[i]] = true;
     }
-    for (unsigned int i = 0; i < seq.length(); i++) {
-        // Ensure there is no weird J or whatever characters (includes '?')
-        if (total_.find(seq[i]) == total_.end()) {
-            total_[missing_]++;
-        } else {
-            total_[seq[i]]++;
+    for (int b = 0; b < 256; b++) {
+        if (!in_alphabet[b]) {
+            total_[missing_] += all[b];
         }
     }
 }
 
 
-// alternate to above, accumulate char counts across seqs
-void SeqInfo::count_chars (std::string& seq) {
+// accumulate char counts across seqs, from the (case-folded) byte counts of
+// one seq
+void SeqInfo::count_chars (const std::vector<int>& counts, const int& length) {
     unsigned int sum = 0;
-    seq = string_to_upper(seq);
+    std::vector<int> icounts(seq_chars_.length(), 0);
+    for (unsigned int i = 0; i < seq_chars_.length(); i++) {
+        int num = counts[(unsigned char)seq_chars_[i]];
+        char_counts_[i] += num;
+        icounts[i] += num;
+        sum += num;
+    }
+    // add invalid char counts, add to missing char count
+    if ((int)sum < length) {
+        char_counts_[char_counts_.size() - 1] += (length - sum);
+        icounts[icounts.size() - 1] += (length - sum);
+    }
     if (output_indiv_) {
-        std::vector<int> icounts(seq_chars_.length(), 0);
-        for (unsigned int i = 0; i < seq_chars_.length(); i++) {
-            int num = std::count(seq.begin(), seq.end(), seq_chars_[i]);
-            char_counts_[i] += num;
-            icounts[i] += num;
-            sum += num;
-        }
-        // add invalid char counts, add to missing char count
-        if (sum < seq.length()) {
-            char_counts_[char_counts_.size() - 1] += (seq.length() - sum);
-            icounts[icounts.size() - 1] += (seq.length() - sum);
-        }
         indiv_char_counts_.push_back(icounts);
-        // this is cool, but unnecessary here
-        //std::transform(char_counts_.begin(), char_counts_.end(), icounts.begin(), char_counts_.begin(), std::plus<int>());
-    } else {
-        for (unsigned int i = 0; i < seq_chars_.length(); i++) {
-            int num = std::count(seq.begin(), seq.end(), seq_chars_[i]);
-            char_counts_[i] += num;
-            sum += num;
-        }
-        // add invalid char counts, add to missing char count
-        if (sum < seq.length()) {
-            char_counts_[char_counts_.size() - 1] += (seq.length() - sum);
-        }
     }
 }
 
@@ -126,9 +131,8 @@ void SeqInfo::read_in_alignment () {
     // now do the counting
     if (is_multi_ && !alpha_set_) {
         // grab all unique characters from the input string
-        // here, seqs from all individuals are concatenated, so represents all sampled characters
-        make_concatenated_sequence();
-        set_alphabet_from_sampled_seqs(concatenated_);
+        // here, counts from all individuals are pooled, so represents all sampled characters
+        set_alphabet_from_sampled_seqs();
     }
     if (file_ntax != 0) {
         if (file_ntax != (int)seqs_.size()) {
@@ -144,15 +148,14 @@ void SeqInfo::read_in_alignment () {
 
 // calculate character state frequencies
 void SeqInfo::calculate_freqs () {
-    Sequence seq;
-    std::string name = "";
+    count_bytes();
     for (unsigned int i = 0; i < seqs_.size(); i++) {
-        seq = seqs_[i];
-        temp_seq_ = seq.get_sequence();
-        name = seq.get_id();
-        seq_lengths_.push_back(temp_seq_.length());
-        count_chars(temp_seq_);
-        taxon_labels_.push_back(name);
+        int length = (int)seqs_[i].get_sequence_ref().length();
+        std::vector<int> counts = byte_counts_[i];
+        fold_byte_histogram(counts);
+        seq_lengths_.push_back(length);
+        count_chars(counts, length);
+        taxon_labels_.push_back(seqs_[i].get_id());
     }
 }
 
@@ -260,15 +263,6 @@ void SeqInfo::print_summary_table_whole_alignment (std::ostream* poos) {
 }
 
 
-void SeqInfo::make_concatenated_sequence () {
-    if (concatenated_.length() == 0) {
-        for (unsigned int i = 0; i < seqs_.size(); i++) {
-            concatenated_ += seqs_[i].get_sequence();
-        }
-    }
-}
-
-
 // just grab labels, disregard the rest
 void SeqInfo::collect_taxon_labels () {
     taxon_labels_ = collect_names(seqs_);
@@ -328,7 +322,7 @@ void SeqInfo::get_longest_taxon_label () {
 
 
 SeqInfo::SeqInfo (std::istream* pios, std::ostream* poos, bool& indiv,
-        const bool& force_protein):concatenated_(""), seq_chars_(""), output_indiv_(indiv), datatype_set_(false),
+        const bool& force_protein):seq_chars_(""), output_indiv_(indiv), datatype_set_(false),
         is_dna_(false), is_protein_(false), is_multi_(false), is_binary_(false),
         alpha_set_(false), alpha_name_(""), seq_type_(""), gap_('-'), missing_('?'),
         num_taxa_(0) {
@@ -433,26 +427,23 @@ void SeqInfo::set_alphabet () {
 }
 
 
-// TODO: get rid of the concatenated_ business
 void SeqInfo::summarize () {
-    // a concatenated seq (i.e., across all indiv) will be used for all stats
     calculate_freqs();
     
     if (output_indiv_) {
         // new one
         return_freq_table(poos_);
     } else {
-        // pass the seq concatenated across all individuals
-        // probably can skip a bunch fo the stuff above...
-        make_concatenated_sequence();
-        count_chars_indiv_seq(concatenated_);
+        // counts pooled across all individuals
+        count_chars_whole_alignment();
         print_summary_table_whole_alignment(poos_);
     }
 }
 
 
-void SeqInfo::set_alphabet_from_sampled_seqs (const std::string& seq) {
-    seq_chars_ = get_alphabet_from_sequence(seq);
+void SeqInfo::set_alphabet_from_sampled_seqs () {
+    count_bytes();
+    seq_chars_ = get_alphabet_from_histograms(byte_counts_);
     // expecting order: valid, gap, missing
     // remove gap and missing (if present)
     seq_chars_.erase(std::remove(seq_chars_.begin(), seq_chars_.end(), gap_), seq_chars_.end());
@@ -10,8 +10,6 @@
 
 class SeqInfo {
 private:
-    std::string concatenated_;
-    std::string temp_seq_;
     std::string seq_chars_; // the alphabet
     std::string file_type_; //"nexus", "phylip", "fasta", "fastq"
     bool output_indiv_; // report stats for each seq
@@ -37,6 +35,7 @@ private:
     std::vector<int> seq_lengths_;
     std::vector<int> char_counts_; // length seq_chars_ (i.e. the alphabet). accumulated across all seqs
     std::vector< std::vector<int> > indiv_char_counts_;
+    std::vector< std::vector<int> > byte_counts_; // per seq, 256 bins (as read)
     bool is_aligned_;
     int seq_length_;
     std::istream* pios_;
@@ -46,18 +45,18 @@ private:
     void read_in_alignment ();
     void collect_taxon_labels ();
     void check_is_aligned ();
-    void make_concatenated_sequence ();
+    void count_bytes ();
     void get_num_chars ();
     void set_alphabet ();
-    void count_chars_indiv_seq (std::string& seq);
-    void count_chars (std::string& seq);
+    void count_chars_whole_alignment ();
+    void count_chars (const std::vector<int>& counts, const int& length);
     void print_summary_table_whole_alignment (std::ostream* poos);
     void return_freq_table (std::ostream* poos);
     void get_longest_taxon_label ();
     void calculate_freqs ();
     void calc_missing ();
     void set_datatype ();
-    void set_alphabet_from_sampled_seqs (const std::string& seq);
+    void set_alphabet_from_sampled_seqs ();
 
 public:
     SeqInfo (std::istream* pios, std::ostream* poos, bool& indiv, const bool& force_protein);
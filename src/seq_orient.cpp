@@ -0,0 +1,118 @@
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "seq_orient.h"
+#include "sequence.h"
+#include "utils.h"
+#include "edlib.h"
+
+
+SeqOrienter::SeqOrienter (const std::string& refseq, const int& kmer):kmer_(kmer) {
+    // comparisons are case-insensitive: everything is uppercased
+    Sequence ref("reference", string_to_upper(refseq));
+    fwd_ = ref.get_sequence();
+    rev_ = ref.reverse_complement();
+    
+    if (kmer_ > 0) {
+        build_kmer_table(fwd_, fwd_kmers_);
+        build_kmer_table(rev_, rev_kmers_);
+    }
+}
+
+
+static inline int nuc_code (const char& c) {
+    switch (c) {
+        case 'A': return 0;
+        case 'C': return 1;
+        case 'G': return 2;
+        case 'T': case 'U': return 3;
+        default: return -1;
+    }
+}
+
+
+// 2-bit encoded kmers. runs containing anything other than ACGT are skipped
+void SeqOrienter::build_kmer_table (const std::string& seq, std::vector<unsigned char>& table) const {
+    size_t nkmers = (size_t)1 << (2 * kmer_);
+    size_t mask = nkmers - 1;
+    table.assign(nkmers, 0);
+    size_t code = 0;
+    int run = 0;
+    for (unsigned int i = 0; i < seq.size(); i++) {
+        int nc = nuc_code(seq[i]);
+        if (nc < 0) {
+            run = 0;
+            continue;
+        }
+        code = ((code << 2) | (size_t)nc) & mask;
+        run++;
+        if (run >= kmer_) {
+            table[code] = 1;
+        }
+    }
+}
+
+
+// 1: (clearly) reverse, -1: (clearly) forward, 0: ambiguous; let edlib decide
+int SeqOrienter::kmer_vote (const std::string& seq) const {
+    size_t mask = fwd_kmers_.size() - 1;
+    size_t code = 0;
+    int run = 0;
+    int nfwd = 0;
+    int nrev = 0;
+    for (unsigned int i = 0; i < seq.size(); i++) {
+        int nc = nuc_code(seq[i]);
+        if (nc < 0) {
+            run = 0;
+            continue;
+        }
+        code = ((code << 2) | (size_t)nc) & mask;
+        run++;
+        if (run >= kmer_) {
+            nfwd += fwd_kmers_[code];
+            nrev += rev_kmers_[code];
+        }
+    }
+    // require a reasonable number of hits and a 2-fold difference
+    const int minhits = 3;
+    if (nrev >= minhits && nrev >= 2 * nfwd) {
+        return 1;
+    }
+    if (nfwd >= minhits && nfwd >= 2 * nrev) {
+        return -1;
+    }
+    return 0;
+}
+
+
+// flip if the reverse complement is (strictly) closer to the reference.
+// seq is expected to be uppercase. as before, the sequence is the (infix, HW)
+// query and the reference the target. aligning the sequence against the
+// reverse complemented reference gives the same distance as aligning the
+// reverse complemented sequence against the reference, so the sequence is
+// profiled once and never flipped just to be tested
+bool SeqOrienter::edlib_vote (const std::string& seq) const {
+    EdlibQueryProfile* profile = edlibBuildQueryProfile(seq.c_str(), (int)seq.length());
+    int fwd = edlibProfileDistance(profile, fwd_.c_str(), (int)fwd_.length(), -1,
+        EDLIB_MODE_HW);
+    int rev = edlibProfileDistance(profile, rev_.c_str(), (int)rev_.length(), -1,
+        EDLIB_MODE_HW);
+    edlibFreeQueryProfile(profile);
+    return (rev >= 0 && (fwd < 0 || rev < fwd));
+}
+
+
+// orient a batch of sequences in place (in parallel)
+void SeqOrienter::orient (std::vector<Sequence>& seqs) {
+    int nseqs = (int)seqs.size();
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int i = 0; i < nseqs; i++) {
+        std::string upper = string_to_upper(seqs[i].get_sequence());
+        int vote = (kmer_ > 0) ? kmer_vote(upper) : 0;
+        bool flip = (vote != 0) ? (vote > 0) : edlib_vote(upper);
+        if (flip) {
+            seqs[i].perm_reverse_complement();
+        }
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef _SEQ_ORIENT_H_
+#define _SEQ_ORIENT_H_
+
+#include <string>
+#include <vector>
+
+class Sequence; // forward declaration
+
+// decide whether sequences need to be reverse complemented to match a single
+// reference. the reference (both orientations) and its kmer tables are built
+// once and shared (read-only) across threads
+class SeqOrienter {
+private:
+    int kmer_; // length of kmers for the prefilter. 0 = no prefilter
+    std::string fwd_; // reference (uppercase)
+    std::string rev_; // and its reverse complement
+    std::vector<unsigned char> fwd_kmers_; // presence tables, 4^k entries
+    std::vector<unsigned char> rev_kmers_;
+    
+    void build_kmer_table (const std::string& seq, std::vector<unsigned char>& table) const;
+    int kmer_vote (const std::string& seq) const;
+    bool edlib_vote (const std::string& seq) const;
+    
+public:
+    SeqOrienter (const std::string& refseq, const int& kmer);
+    void orient (std::vector<Sequence>& seqs);
+};
+
+#endif /* _SEQ_ORIENT_H_ */
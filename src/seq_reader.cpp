@@ -11,6 +11,7 @@
 #include "seq_reader.h"
 #include "seq_utils.h"
 #include "utils.h"
+#include "profile.h"
 
 
 // for printing purposes
@@ -106,6 +107,7 @@ bool read_next_seq_from_stream (std::istream & stri, int ftype, std::string& ret
             } else {
                 seq.set_id(tokens[0]);
                 seq.set_sequence(tokens[1]);
+                PX_PROFILE_COUNT(PROF_SEQS_READ, 1);
                 return true;
             }
         } else {
@@ -159,6 +161,7 @@ bool read_next_seq_from_stream (std::istream & stri, int ftype, std::string& ret
             }
             seq.set_sequence(tse);
         }
+        PX_PROFILE_COUNT(PROF_SEQS_READ, 1);
         return true;
     } else if (ftype == 2) { // fasta
         bool first = true;
@@ -172,6 +175,9 @@ bool read_next_seq_from_stream (std::istream & stri, int ftype, std::string& ret
                 if (!getline(stri, tline)) {
                     trim_spaces(curseq);
                     seq.set_sequence(curseq);
+                    if (!first) {
+                        PX_PROFILE_COUNT(PROF_SEQS_READ, 1);
+                    }
                     return false;
                 }
             }
@@ -185,6 +191,7 @@ bool read_next_seq_from_stream (std::istream & stri, int ftype, std::string& ret
                     trim_spaces(curseq);
                     seq.set_sequence(curseq);
                     retstring = tline;
+                    PX_PROFILE_COUNT(PROF_SEQS_READ, 1);
                     return true;
                 }
             } else {
@@ -211,6 +218,7 @@ bool read_next_seq_from_stream (std::istream & stri, int ftype, std::string& ret
         seq.set_id(line1.substr(1, line1.size()-1));
         seq.set_sequence(line2);
         seq.set_qualstr(line4, 33);
+        PX_PROFILE_COUNT(PROF_SEQS_READ, 1);
         return true;
     }
     return false;
@@ -1157,6 +1165,7 @@ std::vector<Sequence> read_phylip (std::istream& pios, const int& num_taxa, cons
 // returns vector of sequences and (by reference) alphabet name
 // all other properties are determined elsewhere
 std::vector<Sequence> ingest_alignment (std::istream* pios, std::string& alphaName) {
+    PX_PROFILE_PHASE("read alignment");
     std::vector<Sequence> seqs;
     Sequence seq;
     std::string retstring;
@@ -0,0 +1,455 @@
+#ifdef _OPENMP
+    #include <omp.h>
+#else
+    #define omp_get_max_threads() 1
+#endif
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <unistd.h>
+
+#include "seq_sort.h"
+#include "sequence.h"
+#include "profile.h"
+
+
+// sort keys. the first 4 are the pxssort -b values
+enum { KEY_ID = 1, KEY_ID_REV = 2, KEY_LENGTH = 3, KEY_LENGTH_REV = 4, KEY_SEQ = 5 };
+
+// the most run files merged at once, and the read buffer of each
+static const size_t max_fan_in = 64;
+static const size_t run_buffer_size = 1 << 18;
+
+
+// run files not yet merged (and removed). they are also removed at exit, as
+// errors leave through exit()
+static std::vector<std::string> temp_files;
+
+
+static void remove_temp_files () {
+    for (unsigned int i = 0; i < temp_files.size(); i++) {
+        std::remove(temp_files[i].c_str());
+    }
+    temp_files.clear();
+}
+
+
+static void remove_temp_file (const std::string& file) {
+    std::remove(file.c_str());
+    temp_files.erase(std::remove(temp_files.begin(), temp_files.end(), file), temp_files.end());
+}
+
+
+// a strict total order: ties on the key go by input position
+struct RecordCompare {
+    int key;
+    bool operator() (const SeqRecord& lhs, const SeqRecord& rhs) const {
+        switch (key) {
+            case KEY_ID: {
+                int c = lhs.id.compare(rhs.id);
+                if (c != 0) {
+                    return c < 0;
+                }
+                break;
+            }
+            case KEY_ID_REV: {
+                int c = lhs.id.compare(rhs.id);
+                if (c != 0) {
+                    return c > 0;
+                }
+                break;
+            }
+            case KEY_LENGTH:
+                if (lhs.seq.size() != rhs.seq.size()) {
+                    return lhs.seq.size() < rhs.seq.size();
+                }
+                break;
+            case KEY_LENGTH_REV:
+                if (lhs.seq.size() != rhs.seq.size()) {
+                    return lhs.seq.size() > rhs.seq.size();
+                }
+                break;
+            case KEY_SEQ: {
+                // hash first, so full sequences are only compared for (likely) copies
+                if (lhs.hash != rhs.hash) {
+                    return lhs.hash < rhs.hash;
+                }
+                int c = lhs.seq.compare(rhs.seq);
+                if (c != 0) {
+                    return c < 0;
+                }
+                break;
+            }
+        }
+        return lhs.index < rhs.index;
+    }
+};
+
+
+// whether 2 records are copies under the dedup key
+static bool same_key (const int& key, const SeqRecord& lhs, const SeqRecord& rhs) {
+    if (key == KEY_SEQ) {
+        return lhs.hash == rhs.hash && lhs.seq == rhs.seq;
+    }
+    return lhs.id == rhs.id;
+}
+
+
+/*
+ * run file record: index (8 bytes), hash (8), id length (4), sequence length
+ * (8), id, sequence. native byte order; the files never outlive the process
+ */
+static void write_record (std::ostream& out, const SeqRecord& rec) {
+    uint32_t idlen = (uint32_t)rec.id.size();
+    uint64_t seqlen = (uint64_t)rec.seq.size();
+    out.write((const char *)&rec.index, sizeof(rec.index));
+    out.write((const char *)&rec.hash, sizeof(rec.hash));
+    out.write((const char *)&idlen, sizeof(idlen));
+    out.write((const char *)&seqlen, sizeof(seqlen));
+    out.write(rec.id.data(), idlen);
+    out.write(rec.seq.data(), seqlen);
+}
+
+
+static bool read_record (std::istream& in, SeqRecord& rec) {
+    uint32_t idlen = 0;
+    uint64_t seqlen = 0;
+    if (!in.read((char *)&rec.index, sizeof(rec.index))) {
+        return false;
+    }
+    in.read((char *)&rec.hash, sizeof(rec.hash));
+    in.read((char *)&idlen, sizeof(idlen));
+    in.read((char *)&seqlen, sizeof(seqlen));
+    rec.id.resize(idlen);
+    rec.seq.resize(seqlen);
+    in.read(&rec.id[0], idlen);
+    in.read(&rec.seq[0], seqlen);
+    if (!in) {
+        std::cerr << "Error: temporary file is truncated. Exiting." << std::endl;
+        exit(0);
+    }
+    return true;
+}
+
+
+/*
+ * tournament tree over the heads of k sorted sources. the leaves are
+ * k..2k-1 and the internal nodes 1..k-1 keep the loser of the match played
+ * there, so replacing the winner's head only replays the matches on its path
+ * to the root (log k comparisons). exhausted sources lose every match
+ */
+class LoserTree {
+private:
+    int k_;
+    std::vector<int> tree_;
+    const std::vector<SeqRecord>& heads_;
+    const std::vector<char>& done_;
+    RecordCompare cmp_;
+    
+    bool beats (const int& a, const int& b) const {
+        if (done_[a]) {
+            return false;
+        }
+        if (done_[b]) {
+            return true;
+        }
+        return cmp_(heads_[a], heads_[b]);
+    }
+
+public:
+    LoserTree (const std::vector<SeqRecord>& heads, const std::vector<char>& done,
+        const int& key):k_((int)heads.size()), tree_(heads.size(), 0), heads_(heads),
+        done_(done) {
+        cmp_.key = key;
+        std::vector<int> winners(2 * k_, 0);
+        for (int i = 0; i < k_; i++) {
+            winners[k_ + i] = i;
+        }
+        for (int n = k_ - 1; n > 0; n--) {
+            int a = winners[2 * n];
+            int b = winners[2 * n + 1];
+            if (beats(b, a)) {
+                std::swap(a, b);
+            }
+            winners[n] = a;
+            tree_[n] = b;
+        }
+        tree_[0] = (k_ > 1) ? winners[1] : 0;
+    }
+    
+    int get_winner () const {
+        return tree_[0];
+    }
+    
+    // after the winner's head has been replaced (or its source is done)
+    void replay () {
+        int winner = tree_[0];
+        for (int n = (winner + k_) / 2; n > 0; n /= 2) {
+            if (beats(tree_[n], winner)) {
+                std::swap(tree_[n], winner);
+            }
+        }
+        tree_[0] = winner;
+    }
+};
+
+
+// a sorted run file, read through a large buffer
+class RunReader {
+private:
+    std::vector<char> buffer_;
+    std::ifstream in_;
+
+public:
+    RunReader (const std::string& file):buffer_(run_buffer_size) {
+        in_.rdbuf()->pubsetbuf(&buffer_[0], buffer_.size());
+        in_.open(file, std::ios::binary);
+        if (!in_.good()) {
+            std::cerr << "Error: could not read temporary file '" << file
+                << "'. Exiting." << std::endl;
+            exit(0);
+        }
+    }
+    
+    bool next (SeqRecord& rec) {
+        return read_record(in_, rec);
+    }
+};
+
+
+RecordSorter::RecordSorter (const int& key, const bool& dedup, const size_t& max_bytes,
+    const std::string& tmpdir):key_(key), dedup_(dedup), max_bytes_(max_bytes),
+    tmpdir_(tmpdir), run_bytes_(0), has_pending_(false) {}
+
+
+// spills the run first if it has reached the memory limit
+void RecordSorter::add (SeqRecord& rec) {
+    run_bytes_ += sizeof(SeqRecord) + rec.id.size() + rec.seq.size();
+    run_.push_back(std::move(rec));
+    if (run_bytes_ >= max_bytes_) {
+        spill_run();
+    }
+}
+
+
+// contiguous chunks are sorted in parallel, then merged pairwise in rounds
+void RecordSorter::sort_run () {
+    RecordCompare cmp;
+    cmp.key = key_;
+    int nchunks = omp_get_max_threads();
+    if (nchunks < 2 || run_.size() < 4096) {
+        std::sort(run_.begin(), run_.end(), cmp);
+        return;
+    }
+    std::vector<size_t> bounds(nchunks + 1);
+    for (int c = 0; c <= nchunks; c++) {
+        bounds[c] = run_.size() * c / nchunks;
+    }
+    #pragma omp parallel for schedule(static)
+    for (int c = 0; c < nchunks; c++) {
+        std::sort(run_.begin() + bounds[c], run_.begin() + bounds[c + 1], cmp);
+    }
+    for (int width = 1; width < nchunks; width *= 2) {
+        #pragma omp parallel for schedule(dynamic)
+        for (int c = 0; c < nchunks; c += 2 * width) {
+            if (c + width < nchunks) {
+                std::inplace_merge(run_.begin() + bounds[c], run_.begin() + bounds[c + width],
+                    run_.begin() + bounds[std::min(c + 2 * width, nchunks)], cmp);
+            }
+        }
+    }
+}
+
+
+std::string RecordSorter::get_temp_file () {
+    std::string name = tmpdir_ + "/pxssort.XXXXXX";
+    std::vector<char> templ(name.begin(), name.end());
+    templ.push_back('\0');
+    int fd = mkstemp(&templ[0]);
+    if (fd == -1) {
+        std::cerr << "Error: could not create a temporary file in '" << tmpdir_
+            << "'. Exiting." << std::endl;
+        exit(0);
+    }
+    close(fd);
+    static bool registered = false;
+    if (!registered) {
+        atexit(remove_temp_files);
+        registered = true;
+    }
+    temp_files.push_back(std::string(&templ[0]));
+    return temp_files.back();
+}
+
+
+void RecordSorter::spill_run () {
+    if (run_.empty()) {
+        return;
+    }
+    sort_run();
+    std::string file = get_temp_file();
+    std::ofstream out(file, std::ios::binary);
+    for (unsigned long i = 0; i < run_.size(); i++) {
+        write_record(out, run_[i]);
+    }
+    out.close();
+    if (!out) {
+        std::cerr << "Error: could not write temporary file '" << file
+            << "' (disk full?). Exiting." << std::endl;
+        exit(0);
+    }
+    run_files_.push_back(file);
+    // release the memory, not just the contents
+    std::vector<SeqRecord>().swap(run_);
+    run_bytes_ = 0;
+}
+
+
+void RecordSorter::merge_files (const std::vector<std::string>& files, const RecordEmit& emit) {
+    int k = (int)files.size();
+    std::vector<RunReader *> readers(k);
+    std::vector<SeqRecord> heads(k);
+    std::vector<char> done(k, 0);
+    for (int i = 0; i < k; i++) {
+        readers[i] = new RunReader(files[i]);
+        done[i] = !readers[i]->next(heads[i]);
+    }
+    LoserTree lt(heads, done, key_);
+    while (true) {
+        int w = lt.get_winner();
+        if (done[w]) {
+            break;
+        }
+        emit(heads[w]);
+        done[w] = !readers[w]->next(heads[w]);
+        lt.replay();
+    }
+    for (int i = 0; i < k; i++) {
+        delete readers[i];
+        remove_temp_file(files[i]);
+    }
+}
+
+
+// with dedup, a record is held back until the next one shows it is not a copy
+void RecordSorter::push_out (SeqRecord& rec, const RecordEmit& emit) {
+    if (!dedup_) {
+        emit(rec);
+        return;
+    }
+    if (has_pending_) {
+        if (same_key(key_, pending_, rec)) {
+            return;
+        }
+        emit(pending_);
+    }
+    pending_ = std::move(rec);
+    has_pending_ = true;
+}
+
+
+void RecordSorter::flush_out (const RecordEmit& emit) {
+    if (has_pending_) {
+        emit(pending_);
+        has_pending_ = false;
+    }
+}
+
+
+// records are handed to emit in sorted order. emit may move from them
+void RecordSorter::merge (const RecordEmit& emit) {
+    RecordEmit out = [&] (SeqRecord& rec) {
+        push_out(rec, emit);
+    };
+    if (run_files_.empty()) {
+        sort_run();
+        for (unsigned long i = 0; i < run_.size(); i++) {
+            out(run_[i]);
+        }
+        std::vector<SeqRecord>().swap(run_);
+    } else {
+        spill_run();
+        // too many runs to open at once: merge the oldest into a new run
+        while (run_files_.size() > max_fan_in) {
+            std::vector<std::string> files(run_files_.begin(), run_files_.begin() + max_fan_in);
+            run_files_.erase(run_files_.begin(), run_files_.begin() + max_fan_in);
+            std::string file = get_temp_file();
+            std::ofstream merged(file, std::ios::binary);
+            merge_files(files, [&] (SeqRecord& rec) {
+                write_record(merged, rec);
+            });
+            merged.close();
+            if (!merged) {
+                std::cerr << "Error: could not write temporary file '" << file
+                    << "' (disk full?). Exiting." << std::endl;
+                exit(0);
+            }
+            run_files_.push_back(file);
+        }
+        merge_files(run_files_, out);
+        run_files_.clear();
+    }
+    flush_out(emit);
+}
+
+
+SequenceSorter::SequenceSorter (const int& sortby, const int& dedup, const size_t& max_bytes,
+    const std::string& tmpdir):first_(get_first_key(sortby, dedup), dedup != 0, max_bytes,
+    tmpdir), second_(sortby, false, max_bytes, tmpdir),
+    two_pass_(get_first_key(sortby, dedup) != sortby), nseqs_(0) {}
+
+
+// copies of an id are adjacent when sorting by id either way round
+int SequenceSorter::get_first_key (const int& sortby, const int& dedup) {
+    if (dedup == 1 && sortby != KEY_ID && sortby != KEY_ID_REV) {
+        return KEY_ID;
+    } else if (dedup == 2) {
+        return KEY_SEQ;
+    }
+    return sortby;
+}
+
+
+void SequenceSorter::add (Sequence& seq) {
+    SeqRecord rec;
+    rec.index = nseqs_++;
+    rec.id = seq.get_id();
+    rec.seq = seq.get_sequence();
+    rec.hash = std::hash<std::string>()(rec.seq);
+    first_.add(rec);
+}
+
+
+void SequenceSorter::write (std::ostream* poos) {
+    PX_PROFILE_PHASE("merge and write");
+    std::string out;
+    RecordEmit write_fasta = [&] (SeqRecord& rec) {
+        out += ">";
+        out += rec.id;
+        out += "\n";
+        out += rec.seq;
+        out += "\n";
+        if (out.size() >= run_buffer_size) {
+            (*poos) << out;
+            out.clear();
+        }
+    };
+    if (two_pass_) {
+        first_.merge([&] (SeqRecord& rec) {
+            second_.add(rec);
+        });
+        second_.merge(write_fasta);
+    } else {
+        first_.merge(write_fasta);
+    }
+    (*poos) << out;
+    poos->flush();
+}
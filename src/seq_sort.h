@@ -0,0 +1,85 @@
+#ifndef _SEQ_SORT_H_
+#define _SEQ_SORT_H_
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+class Sequence; // forward declaration
+
+// what a run keeps of a sequence. index is its position in the input, so that
+// ties keep input order (and dedup keeps the first copy) across runs
+struct SeqRecord {
+    uint64_t index;
+    uint64_t hash; // of seq
+    std::string id;
+    std::string seq;
+};
+
+typedef std::function<void (SeqRecord& rec)> RecordEmit;
+
+
+/*
+ * one external merge sort pass. records are collected into a run until it
+ * reaches the memory limit; the run is then sorted (in chunks in parallel,
+ * which are then merged) and spilled to a temporary file of binary records.
+ * at the end the runs are merged k ways with a loser tree and streamed out,
+ * optionally dropping records whose key equals that of the one before. when
+ * everything fits in one run nothing is written to disk
+ */
+class RecordSorter {
+private:
+    int key_;
+    bool dedup_;
+    size_t max_bytes_;
+    std::string tmpdir_;
+    
+    std::vector<SeqRecord> run_;
+    size_t run_bytes_;
+    std::vector<std::string> run_files_;
+    
+    bool has_pending_;
+    SeqRecord pending_;
+    
+    void sort_run ();
+    void spill_run ();
+    std::string get_temp_file ();
+    void merge_files (const std::vector<std::string>& files, const RecordEmit& emit);
+    void push_out (SeqRecord& rec, const RecordEmit& emit);
+    void flush_out (const RecordEmit& emit);
+
+public:
+    RecordSorter (const int& key, const bool& dedup, const size_t& max_bytes,
+        const std::string& tmpdir);
+    void add (SeqRecord& rec);
+    void merge (const RecordEmit& emit);
+};
+
+
+/*
+ * pxssort: sort by id (1), id reversed (2), length (3) or length reversed (4),
+ * optionally dropping repeated ids (dedup 1) or sequences (dedup 2). copies
+ * are made adjacent by sorting on the dedup key; unless that is also the
+ * requested order (ids), the survivors are then sorted again
+ */
+class SequenceSorter {
+private:
+    RecordSorter first_;
+    RecordSorter second_;
+    bool two_pass_;
+    uint64_t nseqs_;
+    
+    static int get_first_key (const int& sortby, const int& dedup);
+
+public:
+    SequenceSorter (const int& sortby, const int& dedup, const size_t& max_bytes,
+        const std::string& tmpdir);
+    void add (Sequence& seq);
+    void write (std::ostream* poos);
+    uint64_t get_num_seqs () const { return nseqs_; };
+};
+
+#endif /* _SEQ_SORT_H_ */
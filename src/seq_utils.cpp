@@ -3,6 +3,8 @@
 #include <set>
 #include <map>
 #include <assert.h>
+#include <cstring>
+#include <climits>
 #include <iostream>
 #include <algorithm>
 
@@ -125,6 +127,36 @@ std::set<int> get_dna_pos (char inc) {
 }
 
 
+/**
+ * 4-bit equivalents of the two functions above (A=1, C=2, G=4, T=8), via lookup
+ * tables rather than sets. as above, gaps (and anything unrecognized) are 0, and
+ * an empty mask maps back to a gap
+ */
+static const char dna_from_mask[] = "-ACMGRSVTWYHKDBN";
+
+static std::vector<unsigned char> make_dna_mask_table () {
+    std::vector<unsigned char> table(256, 0);
+    for (unsigned int mask = 1; mask < 16; mask++) {
+        table[(unsigned char)dna_from_mask[mask]] = mask;
+        table[(unsigned char)tolower(dna_from_mask[mask])] = mask;
+    }
+    table['U'] = table['T'];
+    table['u'] = table['T'];
+    return table;
+}
+
+
+unsigned int get_dna_mask (const char& inc) {
+    static const std::vector<unsigned char> table = make_dna_mask_table();
+    return table[(unsigned char)inc];
+}
+
+
+char get_dna_from_mask (const unsigned int& mask) {
+    return dna_from_mask[mask & 15];
+}
+
+
 char get_prot_char (std::set<char> inc) {
     // if any is missing, consensus is missing
     if (inc.count('X') == 1 || inc.count('-') == 1) {
@@ -151,45 +183,282 @@ char get_prot_char (std::set<char> inc) {
 }
 
 
+/*
+ * consensus engine. columns are processed in blocks (in parallel across blocks);
+ * within a block each taxon's row is streamed once, so the reads are contiguous
+ * and the inner loops are plain table lookups and ORs/adds over the block.
+ *
+ * union (the default): OR the state masks of a column together. DNA uses the
+ *   4-bit masks above, amino acids a 32-bit mask (one bit per letter, plus one
+ *   for missing data: X, gaps, and anything unrecognized). any missing data in
+ *   an amino acid column gives X (but a column of a single character other than
+ *   a gap, e.g. all '?' or all 'm', keeps it); for DNA gaps are ignored if any
+ *   base is present
+ * majority: the most frequent state(s) of each column
+ * threshold: the smallest set of most frequent states whose combined frequency
+ *   is at least the threshold
+ * for the latter two, an ambiguous character splits its weight equally among the
+ * states it codes for (N = 1/4 each of ACGT; B = 1/2 each of D and N; etc.), and
+ * gaps/missing data count as a state (so they count in the denominator). ties are
+ * all kept. if missing data is selected alongside real states it is dropped, and
+ * the real states are mapped back to a (possibly ambiguous) character
+ */
+static const int consensus_block_size = 1024;
+static const int dna_gap_state = 4; // states 0-3 are ACGT
+static const int aa_missing_state = 26; // states 0-25 are A-Z
+static const int consensus_weight = 12; // divisible by 1-4 states, so counts are exact
+
+
+// single state per upper case letter (B and Z included), except X which is
+// missing data. as with get_prot_char, lower case letters only survive in a
+// column of their own (see keep_uniform_aa_columns), so they map to missing
+static std::vector<unsigned int> make_aa_mask_table () {
+    std::vector<unsigned int> table(256, 1u << aa_missing_state);
+    for (int i = 0; i < 26; i++) {
+        if (i != 'X' - 'A') {
+            table['A' + i] = 1u << i;
+        }
+    }
+    return table;
+}
+
+
+static char get_aa_from_mask (const unsigned int& mask) {
+    static const unsigned int bmask = (1u << ('D' - 'A')) | (1u << ('N' - 'A'))
+        | (1u << ('B' - 'A'));
+    static const unsigned int zmask = (1u << ('Q' - 'A')) | (1u << ('E' - 'A'))
+        | (1u << ('Z' - 'A'));
+    if (mask == 0 || (mask & (1u << aa_missing_state))) {
+        return 'X';
+    }
+    for (int i = 0; i < 26; i++) {
+        if (mask == (1u << i)) {
+            return (char)('A' + i);
+        }
+    }
+    if ((mask & ~bmask) == 0) {
+        return 'B';
+    }
+    if ((mask & ~zmask) == 0) {
+        return 'Z';
+    }
+    return 'X';
+}
+
+
+// the states a character counts towards in the frequency-based modes
+struct ConsensusChar {
+    int nstates;
+    int states[4];
+    int weight;
+};
+
+
+static std::vector<ConsensusChar> make_consensus_char_table (const bool& dna) {
+    std::vector<ConsensusChar> table(256);
+    for (int c = 0; c < 256; c++) {
+        ConsensusChar& cc = table[c];
+        cc.nstates = 0;
+        if (dna) {
+            unsigned int mask = get_dna_mask((char)c);
+            for (int i = 0; i < 4; i++) {
+                if (mask & (1u << i)) {
+                    cc.states[cc.nstates++] = i;
+                }
+            }
+            if (cc.nstates == 0) {
+                cc.states[cc.nstates++] = dna_gap_state;
+            }
+        } else {
+            char uc = (char)toupper(c);
+            if (uc == 'B') {
+                cc.states[cc.nstates++] = 'D' - 'A';
+                cc.states[cc.nstates++] = 'N' - 'A';
+            } else if (uc == 'Z') {
+                cc.states[cc.nstates++] = 'Q' - 'A';
+                cc.states[cc.nstates++] = 'E' - 'A';
+            } else if (uc >= 'A' && uc <= 'Z' && uc != 'X') {
+                cc.states[cc.nstates++] = uc - 'A';
+            } else {
+                cc.states[cc.nstates++] = aa_missing_state;
+            }
+        }
+        cc.weight = consensus_weight / cc.nstates;
+    }
+    return table;
+}
+
+
+// pick states from one column of counts, returned as a mask over the states
+static unsigned int select_consensus_states (const int * counts, const int& nstates,
+        const int& total, const consensusMode& mode, const double& threshold) {
+    unsigned int selected = 0;
+    if (mode == CONS_MAJORITY) {
+        int mx = 0;
+        for (int s = 0; s < nstates; s++) {
+            if (counts[s] > mx) {
+                mx = counts[s];
+                selected = 0;
+            }
+            if (counts[s] == mx && mx > 0) {
+                selected |= (1u << s);
+            }
+        }
+    } else {
+        // take states in decreasing order of frequency until the threshold is met
+        const double needed = threshold * (double)total - 1e-9;
+        int acc = 0;
+        while ((double)acc < needed) {
+            int mx = 0;
+            for (int s = 0; s < nstates; s++) {
+                if (!(selected & (1u << s)) && counts[s] > mx) {
+                    mx = counts[s];
+                }
+            }
+            if (mx == 0) {
+                break;
+            }
+            for (int s = 0; s < nstates; s++) {
+                if (!(selected & (1u << s)) && counts[s] == mx) {
+                    selected |= (1u << s);
+                    acc += mx;
+                }
+            }
+        }
+    }
+    return selected;
+}
+
+
+// as get_prot_char did, an amino acid column with the same character in every
+// row keeps it (e.g., '?', '*', lower case); only an all-gap column becomes X
+static void keep_uniform_aa_columns (const std::vector<const char *>& rows,
+        const size_t& start, const int& len, std::string& res) {
+    std::vector<char> same(len, 1);
+    const char * first = rows[0] + start;
+    for (unsigned int j = 1; j < rows.size(); j++) {
+        const char * row = rows[j] + start;
+        for (int c = 0; c < len; c++) {
+            same[c] &= (char)(row[c] == first[c]);
+        }
+    }
+    for (int c = 0; c < len; c++) {
+        if (same[c] && first[c] != '-') {
+            res[start + c] = first[c];
+        }
+    }
+}
+
+
+// consensus of columns [start, start+len) written into res
+static void consensus_block (const std::vector<const char *>& rows, const bool& dna,
+        const consensusMode& mode, const double& threshold, const size_t& start,
+        const int& len, std::string& res) {
+    static const std::vector<unsigned char> dnatable = make_dna_mask_table();
+    static const std::vector<unsigned int> aatable = make_aa_mask_table();
+    const int ntax = (int)rows.size();
+    if (mode == CONS_UNION) {
+        if (dna) {
+            std::vector<unsigned char> acc(len, 0);
+            const unsigned char * table = &dnatable[0];
+            for (int j = 0; j < ntax; j++) {
+                const unsigned char * row = (const unsigned char *)rows[j] + start;
+                for (int c = 0; c < len; c++) {
+                    acc[c] |= table[row[c]];
+                }
+            }
+            for (int c = 0; c < len; c++) {
+                res[start + c] = dna_from_mask[acc[c]];
+            }
+        } else {
+            std::vector<unsigned int> acc(len, 0);
+            const unsigned int * table = &aatable[0];
+            for (int j = 0; j < ntax; j++) {
+                const unsigned char * row = (const unsigned char *)rows[j] + start;
+                for (int c = 0; c < len; c++) {
+                    acc[c] |= table[row[c]];
+                }
+            }
+            for (int c = 0; c < len; c++) {
+                res[start + c] = get_aa_from_mask(acc[c]);
+            }
+            keep_uniform_aa_columns(rows, start, len, res);
+        }
+        return;
+    }
+    
+    static const std::vector<ConsensusChar> dnachars = make_consensus_char_table(true);
+    static const std::vector<ConsensusChar> aachars = make_consensus_char_table(false);
+    const ConsensusChar * table = dna ? &dnachars[0] : &aachars[0];
+    const int nstates = dna ? dna_gap_state + 1 : aa_missing_state + 1;
+    const int missing = dna ? dna_gap_state : aa_missing_state;
+    std::vector<int> counts((size_t)len * nstates, 0);
+    for (int j = 0; j < ntax; j++) {
+        const unsigned char * row = (const unsigned char *)rows[j] + start;
+        for (int c = 0; c < len; c++) {
+            const ConsensusChar& cc = table[row[c]];
+            int * cnt = &counts[(size_t)c * nstates];
+            for (int k = 0; k < cc.nstates; k++) {
+                cnt[cc.states[k]] += cc.weight;
+            }
+        }
+    }
+    const int total = ntax * consensus_weight;
+    for (int c = 0; c < len; c++) {
+        unsigned int selected = select_consensus_states(&counts[(size_t)c * nstates],
+            nstates, total, mode, threshold);
+        if (selected != (1u << missing)) {
+            selected &= ~(1u << missing);
+        }
+        if (dna) {
+            res[start + c] = (selected & (1u << missing)) ? '-' : dna_from_mask[selected];
+        } else {
+            res[start + c] = get_aa_from_mask(selected);
+        }
+    }
+    if (!dna) {
+        keep_uniform_aa_columns(rows, start, len, res);
+    }
+}
+
+
 /**
  * string alpha: either "DNA" or "AA"
 */
 std::string consensus_seq (std::vector<Sequence>& seqs, std::string& alpha) {
+    return consensus_seq(seqs, alpha, CONS_UNION, 1.0);
+}
+
+
+std::string consensus_seq (std::vector<Sequence>& seqs, std::string& alpha,
+        const consensusMode& mode, const double& threshold) {
     bool aligned = is_aligned(seqs);
     if (!aligned) {
         std::cerr << "Error: sequences are not aligned. Exiting." << std::endl;
         exit(0);
     }
-    int seqlength = seqs[0].get_length();
-    std::string retstring;
-    if (alpha == "DNA") {
-        for (int i=0; i < seqlength; i++) {
-            std::set<int> fullset;
-            for (unsigned int j=0; j < seqs.size(); j++) {
-                std::set<int> tset = get_dna_pos(seqs[j].get_sequence()[i]);
-                fullset.insert(tset.begin(), tset.end());
-            }
-            retstring += get_dna_from_pos(fullset);
-        }
-    } else if (alpha == "AA") {
-        for (int i=0; i < seqlength; i++) {
-            std::set<char> fullset;
-            //bool ambig = false; // doesn't do anything
-            for (unsigned int j=0; j < seqs.size(); j++) {
-                fullset.insert(seqs[j].get_sequence()[i]);
-                // break early if any ambiguous code is encountered
-                if (seqs[j].get_sequence()[i] == 'X' || seqs[j].get_sequence()[i] == '-') {
-                    //ambig = true;
-                    break;
-                }
-            }
-            retstring += get_prot_char(fullset);
-        }
-    } else {
+    if (alpha != "DNA" && alpha != "AA") {
         std::cerr << "Error: cannot make consensus of sequence type '" << alpha
                 << "'. Exiting." << std::endl;
         exit(0);
     }
+    if (seqs.empty()) {
+        return "";
+    }
+    const bool dna = (alpha == "DNA");
+    const size_t seqlength = seqs[0].get_sequence_ref().size();
+    std::vector<const char *> rows(seqs.size());
+    for (unsigned int j = 0; j < seqs.size(); j++) {
+        rows[j] = seqs[j].get_sequence_ref().c_str();
+    }
+    std::string retstring(seqlength, '-');
+    const long nblocks = (long)((seqlength + consensus_block_size - 1) / consensus_block_size);
+    #pragma omp parallel for schedule(dynamic)
+    for (long b = 0; b < nblocks; b++) {
+        size_t start = (size_t)b * consensus_block_size;
+        int len = (int)std::min((size_t)consensus_block_size, seqlength - start);
+        consensus_block(rows, dna, mode, threshold, start, len, retstring);
+    }
     return retstring;
 }
 
@@ -585,6 +854,89 @@ std::string get_alphabet_from_sequence (const std::string& instr) {
 }
 
 
+
+// add the bytes of str to a 256-bin histogram. counts go to 4 interleaved
+// sub-histograms so runs of the same byte do not serialize on one counter
+void add_byte_counts (const char * str, const size_t& n, int * hist) {
+    const unsigned char * p = (const unsigned char *)str;
+    int sub[4][256];
+    memset(sub, 0, sizeof(sub));
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        sub[0][p[i]]++;
+        sub[1][p[i+1]]++;
+        sub[2][p[i+2]]++;
+        sub[3][p[i+3]]++;
+    }
+    for (; i < n; i++) {
+        sub[0][p[i]]++;
+    }
+    for (int b = 0; b < 256; b++) {
+        hist[b] += sub[0][b] + sub[1][b] + sub[2][b] + sub[3][b];
+    }
+}
+
+
+// one 256-bin byte histogram per sequence (bins indexed by unsigned char).
+// work is split into fixed-size chunks, so a few very long sequences spread
+// across threads as well as many short ones do. each chunk is counted into
+// its own histogram and then merged into its sequence's
+void get_byte_histograms (const std::vector<Sequence>& seqs,
+        std::vector<std::vector<int> >& hists) {
+    const size_t chunksize = 1 << 20;
+    std::vector<std::pair<int, size_t> > chunks; // (sequence, start)
+    for (unsigned int i = 0; i < seqs.size(); i++) {
+        size_t len = seqs[i].get_sequence_ref().size();
+        for (size_t start = 0; start < len; start += chunksize) {
+            chunks.push_back(std::make_pair((int)i, start));
+        }
+    }
+    hists.assign(seqs.size(), std::vector<int>(256, 0));
+    #pragma omp parallel for schedule(dynamic)
+    for (int c = 0; c < (int)chunks.size(); c++) {
+        const std::string& str = seqs[chunks[c].first].get_sequence_ref();
+        size_t start = chunks[c].second;
+        size_t n = std::min(chunksize, str.size() - start);
+        int local[256] = {0};
+        add_byte_counts(str.data() + start, n, local);
+        std::vector<int>& hist = hists[chunks[c].first];
+        for (int b = 0; b < 256; b++) {
+            if (local[b] != 0) {
+                #pragma omp atomic
+                hist[b] += local[b];
+            }
+        }
+    }
+}
+
+
+// move lowercase counts onto uppercase, i.e. the histogram of string_to_upper
+void fold_byte_histogram (std::vector<int>& hist) {
+    for (int b = 0; b < 256; b++) {
+        int u = ::toupper(b);
+        if (u != b && hist[b] != 0) {
+            hist[u] += hist[b];
+            hist[b] = 0;
+        }
+    }
+}
+
+
+// same as get_alphabet_from_sequence on the concatenated sequences (sorted
+// as char), without building the concatenation
+std::string get_alphabet_from_histograms (const std::vector<std::vector<int> >& hists) {
+    std::string uniqueChars;
+    for (int c = CHAR_MIN; c <= CHAR_MAX; c++) {
+        for (unsigned int i = 0; i < hists.size(); i++) {
+            if (hists[i][(unsigned char)c] > 0) {
+                uniqueChars += (char)c;
+                break;
+            }
+        }
+    }
+    return uniqueChars;
+}
+
 bool is_dna_char (char& residue) {
     bool isDNA = false;
     std::size_t found = dnachars_with_ambiguous.find(residue);
@@ -619,16 +971,15 @@ int count_dna_chars (const std::string& str) {
 bool is_aligned (const std::vector<Sequence>& seqs) {
     bool aligned = true;
     bool first = true;
-    Sequence seq;
     int num_char = 0;
     for (unsigned int i = 0; i < seqs.size(); i++) {
-        seq = seqs[i];
+        int len = (int)seqs[i].get_sequence_ref().size();
         if (!first) {
-            if ((int)seq.get_length() != num_char) {
+            if (len != num_char) {
                 aligned = false;
             }
         } else {
-            num_char = seq.get_length();
+            num_char = len;
             first = false;
         }
     }
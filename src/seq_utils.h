@@ -9,11 +9,19 @@
 
 class Sequence; // forward declarations
 
+typedef enum {
+    CONS_UNION = 0, CONS_MAJORITY = 1, CONS_THRESHOLD = 2
+} consensusMode;
+
 
 std::string guess_alignment_type (std::string& sequence);
 char get_dna_from_pos (std::set<int> ins);
 std::set<int> get_dna_pos (char);
+unsigned int get_dna_mask (const char& inc);
+char get_dna_from_mask (const unsigned int& mask);
 std::string consensus_seq (std::vector<Sequence>&, std::string& alpha);
+std::string consensus_seq (std::vector<Sequence>& seqs, std::string& alpha,
+    const consensusMode& mode, const double& threshold);
 char single_dna_complement (char inc);
 void write_phylip_alignment (std::vector<Sequence>& seqs, const bool& uppercase, std::ostream * ostr);
 void write_nexus_alignment (std::vector<Sequence>& seqs, const bool& uppercase, std::ostream * ostr);
@@ -25,6 +33,11 @@ void create_vector_seq_codon_state_reconstructor (std::vector<Sequence>& origseq
     std::vector<Sequence>& sr_seqs, int site, std::map<std::string, std::vector<int> >& codon_pos);
 bool check_binary_sequence (const std::string& seq);
 std::string get_alphabet_from_sequence (const std::string& instr);
+void add_byte_counts (const char * str, const size_t& n, int * hist);
+void get_byte_histograms (const std::vector<Sequence>& seqs,
+    std::vector<std::vector<int> >& hists);
+void fold_byte_histogram (std::vector<int>& hist);
+std::string get_alphabet_from_histograms (const std::vector<std::vector<int> >& hists);
 bool is_dna_char (char& residue);
 bool is_prot_char (char& residue);
 int count_dna_chars (const std::string& str);
@@ -229,6 +229,7 @@ void Sequence::perm_reverse_complement () {
 
 void Sequence::set_qualstr (std::string& stri, int offset) {
     qualarr_.clear();
+    qualarr_.reserve(stri.size());
     qualstr_ = stri;
     for (unsigned int i=0; i < stri.size(); i++) {
         qualarr_.push_back(((int)stri[i])-offset);
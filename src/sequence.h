@@ -37,6 +37,7 @@ public:
     
     bool is_aligned ();
     std::string get_sequence ()const;
+    const std::string& get_sequence_ref () const { return seq_; };
     std::string get_id ()const;
     unsigned int get_length ();
     void add_cont_char (double num);
@@ -0,0 +1,45 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+#include "stat_summary.h"
+#include "utils.h"
+
+
+StatSummary::StatSummary (const std::vector<std::string>& names):names_(names),
+    values_(names.size()) {}
+
+
+// vals and na are in the order of the names
+void StatSummary::add (const std::vector<double>& vals, const std::vector<bool>& na) {
+    for (unsigned int i = 0; i < names_.size(); i++) {
+        if (!na[i]) {
+            values_[i].push_back(vals[i]);
+        }
+    }
+}
+
+
+// one line per stat. for boolean stats (as 0/1) the mean is the proportion true.
+// values are sorted first, so the result does not depend on the order trees
+// were added in
+void StatSummary::write (std::ostream* poos) {
+    (*poos) << "stat\tn\tmean\tmin\tq2.5\tmedian\tq97.5\tmax" << std::endl;
+    for (unsigned int i = 0; i < names_.size(); i++) {
+        std::vector<double>& v = values_[i];
+        (*poos) << names_[i] << "\t" << v.size();
+        if (v.empty()) {
+            (*poos) << "\tNA\tNA\tNA\tNA\tNA\tNA" << std::endl;
+            continue;
+        }
+        std::sort(v.begin(), v.end());
+        double sum = 0.0;
+        for (unsigned int j = 0; j < v.size(); j++) {
+            sum += v[j];
+        }
+        (*poos) << "\t" << (sum / (double)v.size()) << "\t" << v.front() << "\t"
+            << quantile(v, 0.025) << "\t" << quantile(v, 0.5) << "\t"
+            << quantile(v, 0.975) << "\t" << v.back() << std::endl;
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef _STAT_SUMMARY_H_
+#define _STAT_SUMMARY_H_
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+/*
+ * aggregates of named per-tree stats (e.g. table columns) across a tree set.
+ * values are added as they come (in any order), one double per stat per tree,
+ * so the quantiles are exact. NA values are left out of each stat
+ */
+class StatSummary {
+private:
+    std::vector<std::string> names_;
+    std::vector<std::vector<double> > values_;
+
+public:
+    StatSummary (const std::vector<std::string>& names);
+    void add (const std::vector<double>& vals, const std::vector<bool>& na);
+    void write (std::ostream* poos);
+};
+
+#endif /* _STAT_SUMMARY_H_ */
@@ -10,6 +10,8 @@
 #include "vector_node_object.h"
 #include "sequence.h"
 #include "superdouble.h"
+#include "scaled_lhood.h"
+#include "profile.h"
 
 #define verbose true
 
@@ -21,12 +23,20 @@ StateReconstructor::StateReconstructor (RateModel& _rm, std::vector<RateModel>&
     andc("anc_dist_conditionals"), store_p_matrices(false), use_stored_matrices(false), revB("revB"),
     rev(false), rev_exp_number("rev_exp_number"), rev_exp_time("rev_exp_time"),
     stochastic(false), stored_EN_matrices(std::map<Superdouble, mat >()),
-    stored_ER_matrices(std::map<Superdouble, mat >()), sp_alphas("sp_alphas"), alphas("alphas") {}
+    stored_ER_matrices(std::map<Superdouble, mat >()), sp_alphas("sp_alphas"), alphas("alphas"),
+    logstream(&std::cout) {}
 
 
 /**
  * need to do this before you do the set tree
 */
+// where verbose progress goes. lets concurrent reconstructions keep their
+// output separate
+void StateReconstructor::set_log_stream (std::ostream * los) {
+    logstream = los;
+}
+
+
 void StateReconstructor::set_periods (std::vector<double>& ps, std::vector<RateModel>& rms) {
     use_periods = true;
     periods = ps;
@@ -40,7 +50,7 @@ void StateReconstructor::set_periods (std::vector<double>& ps, std::vector<RateM
 void StateReconstructor::set_tree (Tree * tr) {
     tree = tr;
     if (verbose) {
-        std::cout << "initializing nodes..." << std::endl;
+        (*logstream) << "initializing nodes..." << std::endl;
     }
     for (int i=0; i < tree->getNodeCount(); i++) {
         if (tree->getNode(i)->getBL()<MINBL) {
@@ -57,7 +67,7 @@ void StateReconstructor::set_tree (Tree * tr) {
      * initialize the actual branch segments for each node
      */
     if (use_periods == true) {
-        std::cout << "initializing branch segments..." << std::endl;
+        (*logstream) << "initializing branch segments..." << std::endl;
         tree->setHeightFromTipToNodes();
         for (int i=0; i < tree->getNodeCount(); i++) {
             if (tree->getNode(i)->hasParent()) {
@@ -125,7 +135,7 @@ bool StateReconstructor::set_tip_conditionals (std::vector<Sequence>& data) {
         Sequence seq = data[i];
         Node * nd = tree->getExternalNode(seq.get_id());
         if (verbose) {
-            std::cout << nd->getName() << " ";
+            (*logstream) << nd->getName() << " ";
             }
         if (use_periods == false) {
             for (int j=0; j < nstates; j++) {
@@ -135,7 +145,7 @@ bool StateReconstructor::set_tip_conditionals (std::vector<Sequence>& data) {
                 (((VectorNodeObject<Superdouble>*) nd->getObject(dc)))->at(j) = 0.0;
                     }
             if (verbose) {
-                std::cout << seq.get_sequence().at(j);
+                (*logstream) << seq.get_sequence().at(j);
                     }
             }
         } else {
@@ -147,12 +157,12 @@ bool StateReconstructor::set_tip_conditionals (std::vector<Sequence>& data) {
                     tsegs->at(0).distconds->at(j) = 0.0;
                         }
                 if (verbose) {
-                    std::cout << seq.get_sequence().at(j);
+                    (*logstream) << seq.get_sequence().at(j);
                 }
             }
         }    
         if (verbose) {
-            std::cout << std::endl;
+            (*logstream) << std::endl;
             }
         if (testsame != seq.get_sequence()) {
             allsame = false;
@@ -176,13 +186,13 @@ bool StateReconstructor::set_tip_conditionals_already_given (std::vector<Sequenc
         trim_spaces(searchtokens[j]);
     }
     if (verbose) {
-        std::cout << nd->getName() << " ";
+        (*logstream) << nd->getName() << " ";
     }
     if (use_periods == false) {
         for (int j=0; j < nstates; j++) {
             (((VectorNodeObject<Superdouble>*) nd->getObject(dc)))->at(j) = atof(searchtokens[j].c_str());
             if (verbose) {
-                std::cout << searchtokens[j];
+                (*logstream) << searchtokens[j];
             }
         }
     } else {
@@ -190,40 +200,57 @@ bool StateReconstructor::set_tip_conditionals_already_given (std::vector<Sequenc
         for (int j=0; j < nstates; j++) {
         tsegs->at(0).distconds->at(j) = atof(searchtokens[j].c_str());
         if (verbose) {
-            std::cout << searchtokens[j];
+            (*logstream) << searchtokens[j];
                 }
         }
     }    
     if (verbose) {
-        std::cout << std::endl;
+        (*logstream) << std::endl;
         }
     }
     return allsame;
 }
 
 
+// plain row-major copies of (the real part of) matrices for the ScaledVector kernels
+void StateReconstructor::get_row_major (cx_mat& m, std::vector<double>& out) {
+    out.resize((size_t)nstates * nstates);
+    for (int i=0; i < nstates; i++) {
+        for (int j=0; j < nstates; j++) {
+            out[(size_t)i * nstates + j] = real(m(i, j));
+        }
+    }
+}
+
+
+void StateReconstructor::get_row_major (mat& m, std::vector<double>& out) {
+    out.resize((size_t)nstates * nstates);
+    for (int i=0; i < nstates; i++) {
+        for (int j=0; j < nstates; j++) {
+            out[(size_t)i * nstates + j] = m(i, j);
+        }
+    }
+}
+
+
 VectorNodeObject<Superdouble> StateReconstructor::conditionals (Node& node) {
     VectorNodeObject<Superdouble> distconds = *((VectorNodeObject<Superdouble>*) node.getObject(dc));
-    VectorNodeObject<Superdouble> * v = new VectorNodeObject<Superdouble> (nstates, 0);
     cx_mat p;
     if (use_stored_matrices == false) {
         p= rm.setup_P(node.getBL(), store_p_matrices);
     } else {
         p = rm.stored_p_matrices[node.getBL()];
+        PX_PROFILE_COUNT(PROF_PMATRIX_CACHE_HITS, 1);
     }
-    for (int j=0; j < nstates; j++) {
-        for (int k=0; k < nstates; k++) {
-            v->at(j) += (distconds.at(k)*real(p(j, k)));
-        }
-    }
-    for (unsigned int j=0; j < distconds.size(); j++) {
-        distconds[j] = v->at(j);
-    }
+    std::vector<double> preal;
+    get_row_major(p, preal);
+    ScaledVector v(nstates);
+    v.set_mat_vec(preal, ScaledVector(distconds), false);
+    v.to_superdouble(distconds);
     if (store_p_matrices == true) {
         node.assocObject(sp_alphas, distconds);
         node.assocObject(alphas, distconds);
     }
-    delete v;
     return distconds;
 }
 
@@ -237,7 +264,6 @@ VectorNodeObject<Superdouble> StateReconstructor::conditionals_periods (Node& no
             tsegs->at(i).distconds->at(j) = distconds.at(j);
         }
         RateModel * trm = tsegs->at(i).getModel();
-        std::vector<Superdouble> * v = new std::vector<Superdouble> (nstates, 0);
         //vector<vector<double > > p;
         cx_mat p;
         if (use_stored_matrices == false) {
@@ -246,20 +272,16 @@ VectorNodeObject<Superdouble> StateReconstructor::conditionals_periods (Node& no
         } else {
             //p = trm->stored_p_matrices[tsegs->at(i).getPeriod()][tsegs->at(i).getDuration()];
             p = trm->stored_p_matrices[tsegs->at(i).getDuration()];
+            PX_PROFILE_COUNT(PROF_PMATRIX_CACHE_HITS, 1);
         }
-        for (int j=0; j < nstates; j++) {
-            for (int k=0; k < nstates; k++) {
-            v->at(j) += (distconds.at(k)*real(p(j, k)));
-            }
-        }
-
-        for (int j=0; j < nstates; j++) {
-            distconds[j] = v->at(j);
-        }
+        std::vector<double> preal;
+        get_row_major(p, preal);
+        ScaledVector v(nstates);
+        v.set_mat_vec(preal, ScaledVector(distconds), false);
+        v.to_superdouble(distconds);
         if (store_p_matrices == true) {
             tsegs->at(i).seg_sp_alphas = distconds;
         }
-        delete v;
     }
     /*
      * if store is true we want to store the conditionals for each node
@@ -332,6 +354,7 @@ void StateReconstructor::ancdist_conditional_lh (Node& node) {
 
 
 double StateReconstructor::eval_likelihood () {
+    PX_PROFILE_PHASE("likelihood");
     ancdist_conditional_lh(*tree->getRoot());
     //return (-log(calculate_vector_double_sum(*
     //      (VectorNodeObject<Superdouble>*) tree->getRoot()->getObject(dc))));
@@ -381,35 +404,24 @@ void StateReconstructor::reverse (Node * node) {
         }
         //now calculate node B
         //VectorNodeObject<BranchSegment>* tsegs = ((VectorNodeObject<BranchSegment>*) node.getObject(seg));
-        for (int j=0; j < nstates; j++) {
-            revconds->at(j) = 0;
-        }
         //RateModel * rm = tsegs->at(ts).getModel();
         cx_mat * p = &rm.stored_p_matrices[node->getBL()];
-        mat * EN = NULL;
-        mat * ER = NULL;
         VectorNodeObject<Superdouble> tempmoveAer(tempA);
         VectorNodeObject<Superdouble> tempmoveAen(tempA);
+        // B_j = sum_i A_i P(i, j) (and the same over the expectation matrices)
+        ScaledVector sA(tempA);
+        std::vector<double> mrow;
+        get_row_major(*p, mrow);
+        ScaledVector sB(nstates);
+        sB.set_mat_vec(mrow, sA, true);
+        sB.to_superdouble(*revconds);
         if (stochastic == true) {
-            //initialize the segment B's
-            for (int j=0; j < nstates; j++) {
-                tempmoveAer[j] = 0;
-                tempmoveAen[j] = 0;
-            }
-            EN = &stored_EN_matrices[node->getBL()];
-            ER = &stored_ER_matrices[node->getBL()];
-        }
-        for (int j=0; j < nstates; j++) {
-            for (int i = 0; i < nstates; i++) {
-                revconds->at(j) += tempA[i]*real((*p)(i, j));//tempA needs to change each time
-                if (stochastic == true) {
-                    tempmoveAer[j] += tempA[i]*(((*ER)(i, j)));
-                    tempmoveAen[j] += tempA[i]*(((*EN)(i, j)));
-                }
-            }
-        }
-        for (int j=0; j < nstates; j++) {
-            tempA[j] = revconds->at(j);
+            get_row_major(stored_ER_matrices[node->getBL()], mrow);
+            sB.set_mat_vec(mrow, sA, true);
+            sB.to_superdouble(tempmoveAer);
+            get_row_major(stored_EN_matrices[node->getBL()], mrow);
+            sB.set_mat_vec(mrow, sA, true);
+            sB.to_superdouble(tempmoveAen);
         }
         if (stochastic == true) {
             node->seg_sp_stoch_map_revB_time = tempmoveAer;
@@ -464,6 +476,46 @@ std::vector<double> StateReconstructor::calculate_ancstate_reverse (Node& node)
 }
 
 
+/*
+ * the integrals I_ij(t) = int_0^t exp(d_i s) exp(d_j (t-s)) ds over the
+ * eigenvalues d of Q that underlie the expected number of changes and
+ * dwelling times along a branch of length t
+ */
+cx_mat StateReconstructor::stochmap_integrals (cx_mat& eigval, bool isImag, double dur) {
+    cx_mat Iij(nstates, nstates);
+    Iij.fill(0);
+    for (int i=0; i < nstates; i++) {
+        for (int j=0; j < nstates; j++) {
+            cx_double dij = (eigval(i, i)-eigval(j, j)) * dur;
+            cx_double Iijt = 0;
+            if (abs(dij) > 10) {
+                Iijt = (exp(eigval(i, i)*dur)-exp(eigval(j, j)*dur))/(eigval(i, i)-eigval(j, j));
+            } else if (abs(dij) < 10e-20) {
+                Iijt = dur*exp(eigval(j, j)*dur)*(1.+dij/2.+pow(dij, 2.)/6.+pow(dij, 3.)/24.);
+            } else {
+                if (eigval(i, i) == eigval(j, j)) {
+                    //WAS Iijt = dur*exp(eigval(j, j)*dur)*expm1(dij)/dij;
+                    if (isImag) {
+                        Iijt = dur*exp(eigval(j, j)*dur)*(exp(dij)-1.)/dij;
+                    } else {
+                        Iijt = dur*exp(eigval(j, j)*dur)*(expm1(real(dij)))/dij;
+                    }
+                } else {
+                    //WAS Iijt = -dur*exp(eigval(i, i)*dur)*expm1(-dij)/dij;
+                    if (isImag) {
+                        Iijt = -dur*exp(eigval(i, i)*dur)*(exp(-dij)-1.)/dij;
+                    } else {
+                        Iijt = -dur*exp(eigval(i, i)*dur)*(expm1(real(-dij)))/dij;
+                    }
+                }
+            }
+            Iij(i, j) = Iijt;
+        }
+    }
+    return Iij;
+}
+
+
 void StateReconstructor::prepare_stochmap_reverse_all_nodes (int from, int to) {
     stochastic = true;
     //calculate and store local expectation matrix for each branch length
@@ -472,6 +524,7 @@ void StateReconstructor::prepare_stochmap_reverse_all_nodes (int from, int to) {
         cx_mat eigvec(nstates, nstates); eigvec.fill(0);
         cx_mat eigval(nstates, nstates); eigval.fill(0);
         bool isImag = rm.get_eigenvec_eigenval_from_Q(&eigval, &eigvec);
+        cx_mat Iij = stochmap_integrals(eigval, isImag, dur);
         mat Ql(nstates, nstates);Ql.fill(0); Ql(from, to) = rm.get_Q()(from, to);
         mat W(nstates, nstates);W.fill(0); W(from, from) = 1;
         cx_mat summed(nstates, nstates); summed.fill(0);
@@ -481,32 +534,10 @@ void StateReconstructor::prepare_stochmap_reverse_all_nodes (int from, int to) {
             cx_mat Si(nstates, nstates);
             Si = eigvec * Ei * inv(eigvec);
             for (int j=0; j < nstates; j++) {
-                cx_double dij = (eigval(i, i)-eigval(j, j)) * dur;
                 mat Ej(nstates, nstates); Ej.fill(0); Ej(j, j)=1;
                 cx_mat Sj(nstates, nstates);
                 Sj = eigvec * Ej * inv(eigvec);
-                cx_double Iijt = 0;
-                if (abs(dij) > 10) {
-                    Iijt = (exp(eigval(i, i)*dur)-exp(eigval(j, j)*dur))/(eigval(i, i)-eigval(j, j));
-                } else if (abs(dij) < 10e-20) {
-                    Iijt = dur*exp(eigval(j, j)*dur)*(1.+dij/2.+pow(dij, 2.)/6.+pow(dij, 3.)/24.);
-                } else {
-                    if (eigval(i, i) == eigval(j, j)) {
-                        //WAS Iijt = dur*exp(eigval(j, j)*dur)*expm1(dij)/dij;
-                        if (isImag) {
-                            Iijt = dur*exp(eigval(j, j)*dur)*(exp(dij)-1.)/dij;
-                        } else {
-                            Iijt = dur*exp(eigval(j, j)*dur)*(expm1(real(dij)))/dij;
-                        }
-                    } else {
-                        //WAS Iijt = -dur*exp(eigval(i, i)*dur)*expm1(-dij)/dij;
-                        if (isImag) {
-                            Iijt = -dur*exp(eigval(i, i)*dur)*(exp(-dij)-1.)/dij;
-                        } else {
-                            Iijt = -dur*exp(eigval(i, i)*dur)*(expm1(real(-dij)))/dij;
-                        }
-                    }
-                }
+                cx_double Iijt = Iij(i, j);
                 summed += (Si  * Ql * Sj * Iijt);
                 summedR += (Si * W * Sj * Iijt);
             }
@@ -531,6 +562,7 @@ void StateReconstructor::prepare_stochmap_reverse_all_nodes_all_matrices () {
         cx_mat eigvec(nstates, nstates);eigvec.fill(0);
         cx_mat eigval(nstates, nstates);eigval.fill(0);
         bool isImag = rm.get_eigenvec_eigenval_from_Q(&eigval, &eigvec);
+        cx_mat Iij = stochmap_integrals(eigval, isImag, dur);
         mat Ql(nstates, nstates);
         Ql.fill(0);
         for (unsigned int i=0; i < Ql.n_rows; i++) {
@@ -548,32 +580,10 @@ void StateReconstructor::prepare_stochmap_reverse_all_nodes_all_matrices () {
             cx_mat Si(nstates, nstates);
             Si = eigvec * Ei * inv(eigvec);
             for (int j=0; j < nstates; j++) {
-                cx_double dij = (eigval(i, i)-eigval(j, j)) * dur;
                 mat Ej(nstates, nstates);Ej.fill(0);Ej(j, j)=1;
                 cx_mat Sj(nstates, nstates);
                 Sj = eigvec * Ej * inv(eigvec);
-                cx_double Iijt = 0;
-                if (abs(dij) > 10) {
-                    Iijt = (exp(eigval(i, i)*dur)-exp(eigval(j, j)*dur))/(eigval(i, i)-eigval(j, j));
-                } else if (abs(dij) < 10e-20) {
-                    Iijt = dur*exp(eigval(j, j)*dur)*(1.+dij/2.+pow(dij, 2.)/6.+pow(dij, 3.)/24.);
-                } else {
-                    if (eigval(i, i) == eigval(j, j)) {
-                        //WAS Iijt = dur*exp(eigval(j, j)*dur)*expm1(dij)/dij;
-                        if (isImag) {
-                            Iijt = dur*exp(eigval(j, j)*dur)*(exp(dij)-1.)/dij;
-                        } else {
-                            Iijt = dur*exp(eigval(j, j)*dur)*(expm1(real(dij)))/dij;
-                        }
-                    } else {
-                        //WAS Iijt = -dur*exp(eigval(i, i)*dur)*expm1(-dij)/dij;
-                        if (isImag) {
-                            Iijt = -dur*exp(eigval(i, i)*dur)*(exp(-dij)-1.)/dij;
-                        } else {
-                            Iijt = -dur*exp(eigval(i, i)*dur)*(expm1(real(-dij)))/dij;
-                        }
-                    }
-                }
+                cx_double Iijt = Iij(i, j);
                 summed += (Si  * Ql * Sj * Iijt);
                 summedR += (Si * W * Sj * Iijt);
             }
@@ -636,6 +646,120 @@ std::vector<double> StateReconstructor::calculate_reverse_stochmap (Node& node,
 }
 
 
+/*
+ * batched version of the above (prepare_stochmap_reverse_all_nodes* +
+ * prepare_ancstate_reverse + calculate_reverse_stochmap) for a set of
+ * (non-root) nodes. Q is decomposed once, a single reverse pass is made, and
+ * for the branch subtending each node the expectations for every from->to pair
+ * (numbers), any change (any) and the time in every state (times) are filled in
+ * together. as with calculate_reverse_stochmap the values are summed over
+ * states but not yet divided by the likelihood
+ */
+void StateReconstructor::calculate_stochmap_batch (std::vector<Node *>& nodes,
+        std::vector<mat>& numbers, std::vector<std::vector<double> >& times,
+        std::vector<double>& any) {
+    stochastic = false;
+    prepare_ancstate_reverse();
+    
+    cx_mat eigvec(nstates, nstates); eigvec.fill(0);
+    cx_mat eigval(nstates, nstates); eigval.fill(0);
+    bool isImag = rm.get_eigenvec_eigenval_from_Q(&eigval, &eigvec);
+    cx_mat ieigvec = inv(eigvec);
+    mat& Q = rm.get_Q();
+    
+    // S_i = eigvec * E_i * inv(eigvec). the matrix for the (from, to) pair is
+    // sum_ij S_i(:, from) S_j(to, :) I_ij = left[from] * right[to], where
+    // left[a](k, i) = S_i(k, a) does not depend on the branch
+    std::vector<cx_mat> left(nstates, cx_mat(nstates, nstates));
+    for (int a=0; a < nstates; a++) {
+        for (int k=0; k < nstates; k++) {
+            for (int i=0; i < nstates; i++) {
+                left[a](k, i) = eigvec(k, i) * ieigvec(i, a);
+            }
+        }
+    }
+    
+    mat zero(nstates, nstates);
+    zero.fill(0);
+    numbers.assign(nodes.size(), zero);
+    times.assign(nodes.size(), std::vector<double>(nstates, 0.0));
+    any.assign(nodes.size(), 0.0);
+    for (unsigned int n=0; n < nodes.size(); n++) {
+        Node * node = nodes[n];
+        if (node->hasParent() == false) {
+            continue;
+        }
+        double dur = node->getBL();
+        cx_mat Iij = stochmap_integrals(eigval, isImag, dur);
+        // right[b](i, l) = sum_j I_ij S_j(b, l)
+        std::vector<cx_mat> right(nstates);
+        for (int b=0; b < nstates; b++) {
+            cx_mat D(nstates, nstates);
+            for (int i=0; i < nstates; i++) {
+                for (int j=0; j < nstates; j++) {
+                    D(i, j) = Iij(i, j) * eigvec(b, j);
+                }
+            }
+            right[b] = D * ieigvec;
+        }
+        
+        // weights at the top (same as tempA in reverse) and bottom of the branch
+        std::vector<Superdouble> top(nstates, 0);
+        std::vector<Superdouble> bottom(nstates, 0);
+        VectorNodeObject<Superdouble> * parrev = ((VectorNodeObject<Superdouble>*)node->getParent()->getObject(revB));
+        Node * sis = (node->getParent()->getChild(0) != node) ? node->getParent()->getChild(0)
+            : node->getParent()->getChild(1);
+        VectorNodeObject<Superdouble> * sisdistconds = ((VectorNodeObject<Superdouble>*) sis->getObject(alphas));
+        for (int i=0; i < nstates; i++) {
+            top[i] = sisdistconds->at(i) * parrev->at(i);
+        }
+        if (node->isExternal() == false) {
+            VectorNodeObject<Superdouble> * v1 = ((VectorNodeObject<Superdouble>*) node->getChild(0)->getObject(alphas));
+            VectorNodeObject<Superdouble> * v2 = ((VectorNodeObject<Superdouble>*) node->getChild(1)->getObject(alphas));
+            for (int i=0; i < nstates; i++) {
+                bottom[i] = v1->at(i) * v2->at(i);
+            }
+        } else {
+            VectorNodeObject<Superdouble> * distconds = ((VectorNodeObject<Superdouble>*) node->getObject(dc));
+            for (int i=0; i < nstates; i++) {
+                bottom[i] = distconds->at(i);
+            }
+        }
+        
+        cx_mat summedany(nstates, nstates);
+        summedany.fill(0);
+        for (int a=0; a < nstates; a++) {
+            for (int b=0; b < nstates; b++) {
+                cx_mat summed = left[a] * right[b];
+                if (a == b) {
+                    mat ER = abs(real(summed));
+                    times[n][a] = stochmap_weighted_sum(ER, top, bottom);
+                } else {
+                    summed *= Q(a, b);
+                    summedany += summed;
+                    mat EN = abs(real(summed));
+                    numbers[n](a, b) = stochmap_weighted_sum(EN, top, bottom);
+                }
+            }
+        }
+        mat ENany = abs(real(summedany));
+        any[n] = stochmap_weighted_sum(ENany, top, bottom);
+    }
+}
+
+
+// sum over end states of the branch expectations E weighted by the reverse
+// conditionals at the top of the branch and the conditionals at the bottom
+double StateReconstructor::stochmap_weighted_sum (mat& E, std::vector<Superdouble>& top,
+        std::vector<Superdouble>& bottom) {
+    std::vector<double> erow;
+    get_row_major(E, erow);
+    ScaledVector Bs(nstates);
+    Bs.set_mat_vec(erow, ScaledVector(top), true);
+    return double(Bs.dot(ScaledVector(bottom)));
+}
+
+
 void StateReconstructor::set_store_p_matrices (bool i) {
     store_p_matrices = i;
 }
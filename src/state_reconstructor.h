@@ -4,6 +4,7 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <iostream>
 
 #include "rate_model.h"
 #include "superdouble.h"
@@ -43,13 +44,20 @@ private:
     //end mapping bits
     std::string sp_alphas;
     std::string alphas;
+    std::ostream * logstream; // verbose output
     
+    void get_row_major (cx_mat& m, std::vector<double>& out);
+    void get_row_major (mat& m, std::vector<double>& out);
     VectorNodeObject<Superdouble> conditionals (Node& node);
     VectorNodeObject<Superdouble> conditionals_periods (Node& node);
     void ancdist_conditional_lh (Node& node);
+    cx_mat stochmap_integrals (cx_mat& eigval, bool isImag, double dur);
+    double stochmap_weighted_sum (mat& E, std::vector<Superdouble>& top,
+        std::vector<Superdouble>& bottom);
     
 public:
     StateReconstructor (RateModel&, std::vector<RateModel>& _vrm);
+    void set_log_stream (std::ostream * los);
     void set_periods (std::vector<double>& ps, std::vector<RateModel>& rms);
     void set_tree (Tree *);
     double eval_likelihood ();
@@ -63,6 +71,8 @@ public:
     void prepare_stochmap_reverse_all_nodes (int, int);
     void prepare_stochmap_reverse_all_nodes_all_matrices ();
     std::vector<double> calculate_reverse_stochmap (Node&, bool);
+    void calculate_stochmap_batch (std::vector<Node *>& nodes, std::vector<mat>& numbers,
+        std::vector<std::vector<double> >& times, std::vector<double>& any);
     void set_store_p_matrices (bool i);
     void set_use_stored_matrices (bool i);
     ~StateReconstructor ();
@@ -0,0 +1,222 @@
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+
+#include "tcomb.h"
+#include "tree.h"
+#include "node.h"
+
+
+TreeGrafter::TreeGrafter (Tree * backbone):backbone_(backbone), root_(backbone->getRoot()),
+    edge_lengths_(backbone->hasEdgeLengths()), num_grafted_(0) {
+    for (int i = 0; i < backbone_->getExternalNodeCount(); i++) {
+        Node * nd = backbone_->getExternalNode(i);
+        tips_[nd->getName()] = nd;
+    }
+}
+
+
+// iterative Euler tour (each node listed on entry and after each child)
+void TreeGrafter::index_tree (Node * root) {
+    euler_.clear();
+    euler_depth_.clear();
+    first_visit_.clear();
+    std::vector<std::pair<Node *, int> > stack;
+    stack.push_back(std::make_pair(root, 0));
+    while (!stack.empty()) {
+        Node * nd = stack.back().first;
+        int next = stack.back().second;
+        int depth = (int)stack.size() - 1;
+        if (next == 0) {
+            first_visit_[nd] = (int)euler_.size();
+        }
+        euler_.push_back(nd);
+        euler_depth_.push_back(depth);
+        if (next < nd->getChildCount()) {
+            stack.back().second++;
+            stack.push_back(std::make_pair(nd->getChild(next), 0));
+        } else {
+            stack.pop_back();
+        }
+    }
+    // sparse_[k][i] = index of the shallowest entry in euler_[i, i + 2^k)
+    int n = (int)euler_.size();
+    sparse_.assign(1, std::vector<int>(n));
+    for (int i = 0; i < n; i++) {
+        sparse_[0][i] = i;
+    }
+    for (int k = 1; (1 << k) <= n; k++) {
+        sparse_.push_back(std::vector<int>(n - (1 << k) + 1));
+        const std::vector<int>& prev = sparse_[k - 1];
+        for (int i = 0; i + (1 << k) <= n; i++) {
+            int a = prev[i];
+            int b = prev[i + (1 << (k - 1))];
+            sparse_[k][i] = (euler_depth_[a] <= euler_depth_[b]) ? a : b;
+        }
+    }
+}
+
+
+Node * TreeGrafter::lca (Node * a, Node * b) const {
+    int i = first_visit_.at(a);
+    int j = first_visit_.at(b);
+    if (i > j) {
+        std::swap(i, j);
+    }
+    int k = 0;
+    while ((1 << (k + 1)) <= j - i + 1) {
+        k++;
+    }
+    int x = sparse_[k][i];
+    int y = sparse_[k][j - (1 << k) + 1];
+    return euler_[(euler_depth_[x] <= euler_depth_[y]) ? x : y];
+}
+
+
+// the nodes of addtree are moved into the backbone; addtree is left empty (so
+// deleting it frees nothing). returns false (and leaves addtree untouched) if
+// it shares no taxa with the backbone
+bool TreeGrafter::graft (Tree * addtree) {
+    Node * aroot = addtree->getRoot();
+    std::unordered_map<std::string, Node *> atips;
+    for (int i = 0; i < addtree->getExternalNodeCount(); i++) {
+        Node * nd = addtree->getExternalNode(i);
+        atips[nd->getName()] = nd;
+    }
+    
+    // mark the paths from the shared tips to the root. maps backbone node -> the
+    // corresponding node (LCA of the same shared taxa) on the added tree
+    std::unordered_map<Node *, Node *> marked;
+    int nshared = 0;
+    for (std::unordered_map<std::string, Node *>::iterator it = atips.begin();
+            it != atips.end(); ++it) {
+        std::unordered_map<std::string, Node *>::iterator bt = tips_.find(it->first);
+        if (bt == tips_.end()) {
+            continue;
+        }
+        nshared++;
+        Node * nd = bt->second;
+        marked[nd] = it->second;
+        nd = nd->getParent();
+        while (nd != NULL && marked.count(nd) == 0) {
+            marked[nd] = NULL;
+            nd = nd->getParent();
+        }
+    }
+    if (nshared == 0) {
+        return false;
+    }
+    
+    // anchor: walk down from the root while the marked paths have not split
+    Node * anchor = root_;
+    while (marked[anchor] == NULL) {
+        Node * next = NULL;
+        int nmarked = 0;
+        for (int i = 0; i < anchor->getChildCount(); i++) {
+            if (marked.count(anchor->getChild(i)) > 0) {
+                next = anchor->getChild(i);
+                nmarked++;
+            }
+        }
+        if (nmarked != 1) {
+            break;
+        }
+        anchor = next;
+    }
+    
+    index_tree(aroot);
+    
+    // post-order over the marked nodes of the anchor's clade: resolve each node's
+    // counterpart on the added tree, and collect the orphans hanging off it
+    std::vector<std::pair<Node *, Node *> > orphans; // (orphan, where to attach)
+    std::vector<Node *> replaced;
+    std::vector<std::pair<Node *, int> > stack;
+    stack.push_back(std::make_pair(anchor, 0));
+    while (!stack.empty()) {
+        Node * nd = stack.back().first;
+        int next = stack.back().second;
+        if (next < nd->getChildCount()) {
+            stack.back().second++;
+            Node * child = nd->getChild(next);
+            if (marked.count(child) > 0) {
+                stack.push_back(std::make_pair(child, 0));
+            }
+            continue;
+        }
+        stack.pop_back();
+        Node * counterpart = marked[nd];
+        for (int i = 0; i < nd->getChildCount(); i++) {
+            Node * child = nd->getChild(i);
+            std::unordered_map<Node *, Node *>::iterator mt = marked.find(child);
+            if (mt == marked.end()) {
+                continue;
+            }
+            counterpart = (counterpart == NULL) ? mt->second : lca(counterpart, mt->second);
+        }
+        marked[nd] = counterpart;
+        for (int i = 0; i < nd->getChildCount(); i++) {
+            Node * child = nd->getChild(i);
+            if (marked.count(child) == 0) {
+                orphans.push_back(std::make_pair(child, counterpart));
+            }
+        }
+        replaced.push_back(nd);
+    }
+    
+    // attach orphans. deeper ones come first (post-order), so each is placed
+    // above any already attached at the same spot. the new edge takes the old
+    // edge's length, keeping the added tree's root-to-tip distances
+    std::unordered_map<Node *, Node *> top;
+    for (unsigned int i = 0; i < orphans.size(); i++) {
+        Node * orphan = orphans[i].first;
+        Node * at = orphans[i].second;
+        std::unordered_map<Node *, Node *>::iterator tt = top.find(at);
+        if (tt != top.end()) {
+            at = tt->second;
+        }
+        Node * nn = new Node();
+        Node * par = at->getParent();
+        if (par != NULL) {
+            par->replaceChild(*at, *nn);
+        } else {
+            aroot = nn;
+        }
+        nn->setBL(at->getBL());
+        at->setBL(0.0);
+        nn->addChild(*at);
+        nn->addChild(*orphan);
+        top[orphans[i].second] = nn;
+    }
+    
+    // swap the anchor's clade for the added tree
+    Node * par = anchor->getParent();
+    if (par == NULL) {
+        root_ = aroot;
+    } else {
+        par->replaceChild(*anchor, *aroot);
+        aroot->setBL(anchor->getBL());
+    }
+    for (unsigned int i = 0; i < replaced.size(); i++) {
+        delete replaced[i];
+    }
+    for (std::unordered_map<std::string, Node *>::iterator it = atips.begin();
+            it != atips.end(); ++it) {
+        tips_[it->first] = it->second;
+    }
+    
+    edge_lengths_ = edge_lengths_ || addtree->hasEdgeLengths();
+    addtree->setRoot(NULL);
+    addtree->processRoot();
+    num_grafted_++;
+    return true;
+}
+
+
+// the combined tree. the grafter should not be used after this
+Tree * TreeGrafter::get_tree () {
+    backbone_->setRoot(root_);
+    backbone_->processRoot();
+    backbone_->setEdgeLengthsPresent(edge_lengths_);
+    return backbone_;
+}
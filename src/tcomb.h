@@ -0,0 +1,48 @@
+#ifndef _TCOMB_H_
+#define _TCOMB_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+class Tree; // forward declaration
+class Node; // forward declaration
+
+/*
+ * grafts trees onto a backbone, one after another. for each added tree:
+ * - the anchor is the LCA, on the backbone, of the taxa shared with the added
+ *   tree. the anchor's clade is replaced by the added tree
+ * - backbone clades below the anchor that contain none of the added taxa
+ *   ("orphans") are kept: each is attached next to the LCA, in the added tree,
+ *   of the shared taxa of the orphan's (backbone) parent
+ * - taxa only in the added tree come in with it
+ * the backbone is never traversed as a whole: shared tips are found through a
+ * name map that is updated after each graft, and only their paths to the root
+ * are visited. LCAs in the added tree are O(1) queries on its Euler tour, so a
+ * graft costs about the size of the added tree plus the depth of its anchor
+ */
+class TreeGrafter {
+private:
+    Tree * backbone_;
+    Node * root_;
+    std::unordered_map<std::string, Node *> tips_;
+    bool edge_lengths_;
+    int num_grafted_;
+    
+    // Euler tour of the tree being added, with a sparse table for LCA queries
+    std::vector<Node *> euler_;
+    std::vector<int> euler_depth_;
+    std::unordered_map<Node *, int> first_visit_;
+    std::vector<std::vector<int> > sparse_;
+    
+    void index_tree (Node * root);
+    Node * lca (Node * a, Node * b) const;
+
+public:
+    TreeGrafter (Tree * backbone);
+    bool graft (Tree * addtree);
+    int get_num_grafted () const { return num_grafted_; };
+    Tree * get_tree ();
+};
+
+#endif /* _TCOMB_H_ */
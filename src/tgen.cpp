@@ -2,9 +2,6 @@
 #include <vector>
 #include <iostream>
 #include <algorithm>
-//#include <ctime>
-//#include <random>
-#include <map>
 
 #include "utils.h"
 #include "tgen.h"
@@ -17,20 +14,18 @@ TopologyGenerator::TopologyGenerator(const int& num_taxa, const bool& rooted,
 }
 
 
-// generate starting star tree (edge matrix), set starting taxon and node
+// set up the edge array, then build the first topology (all insertion choices 0)
 void TopologyGenerator::initialize () {
-    std::vector< std::vector<int> > init_edges_;
     ntopos_ = get_num_possible_trees(num_taxa_, rooted_);
     nedges_ = get_num_edges(num_taxa_, rooted_);
-    if (!rooted_) {
-        init_edges_ = initialize_edge_matrix_unrooted(num_taxa_);
-        curtax_ = 4;
-    } else {
-        init_edges_ = initialize_edge_matrix_rooted (num_taxa_);
-        curtax_ = 3;
-    }
-    curnode_ = init_edges_[0][0] + 1; // increment largest initialized node
-    trees_.push_back(init_edges_);
+    first_tax_ = (rooted_) ? 3 : 4;
+    anc_.assign(nedges_, 0);
+    dec_.assign(nedges_, 0);
+    choices_.assign(num_taxa_ + 1, 0);
+    prev_anc_.assign(num_taxa_ + 1, 0);
+    num_kids_.assign(nedges_ + 2, 0);
+    kids_.assign(3 * (nedges_ + 2), 0);
+    unrank(0);
 }
 
 
@@ -42,168 +37,131 @@ int TopologyGenerator::get_num_edges (const int& num_taxa, const int& rooted) {
 }
 
 
-// trees are stored as edge matrices - avoids overhead of node objects
-// 2 columns: ancestor node index, descendant node index
-// 2n-3 rows (edges)
-// first 3 edges are initialized (i.e., star tree)
-std::vector< std::vector<int> > TopologyGenerator::initialize_edge_matrix_unrooted (const int& n) {
-    int num_edges = 2 * n - 3;
-    std::vector< std::vector<int> > edges(num_edges, std::vector<int>(2, 0));
-    edges[0][0] = edges[1][0] = edges[2][0] = n + 1;
-    // initialize 3 taxon star tree
-    for (int i = 0; i < 3; i++) {
-        edges[i][1] = i + 1;
-    }
-    return edges;
+// the number of edges present before taxon is added. these are the
+// attachment points, and also the row where the next edge is added:
+// 2(n-1)-3 unrooted, 2(n-1)-2 rooted
+int TopologyGenerator::get_num_attach (const int& taxon) const {
+    return 2 * (taxon - 1) - 3 + (int)rooted_;
 }
 
 
-// rooted version of above
-// 2 columns: ancestor node index, descendant node index
-// 2n-2 rows (edges)
-// first 2 edges are initialized
-std::vector< std::vector<int> > TopologyGenerator::initialize_edge_matrix_rooted (const int& n) {
-    int num_edges = 2 * n - 2;
-    std::vector< std::vector<int> > edges(num_edges, std::vector<int>(2, 0));
-    edges[0][0] = edges[1][0] = n + 1;
-    // initialize 2 taxon tree
-    for (int i = 0; i < 2; i++) {
-        edges[i][1] = i + 1;
-    }
-    return edges;
+// rooted trees also have the new taxon attached as sister to everything else
+int TopologyGenerator::get_num_choices (const int& taxon) const {
+    return get_num_attach(taxon) + (int)rooted_;
 }
 
 
-// add next taxon to existing edge matrices
-// for the nth taxon, there are 2(n-1)-3 possible attachment points
-// - i.e., the edges of the previous iteration
-std::vector< std::vector< std::vector<int> > > TopologyGenerator::add_taxon_unrooted (std::vector< std::vector< std::vector<int> > > edges,
-        const int& taxon, const int& new_node) {
-    std::vector< std::vector< std::vector<int> > > trees;
-    int num_attach = 2 * (taxon - 1) - 3; // also the row where next edge will be added
-    std::vector< std::vector<int> > edge;
-    for (unsigned int j = 0; j < edges.size(); j++) {
+// insert taxon (and its internal node) on edge number choice. the new internal
+// node is num_taxa+2 for the first added taxon and increments from there. for
+// rooted trees choice == num_attach is the 'flip': the new node replaces the
+// root (always num_taxa+1), which then sits above the new taxon and new node
+void TopologyGenerator::add_taxon (const int& taxon, const int& choice) {
+    int num_attach = get_num_attach(taxon);
+    int new_node = num_taxa_ + 2 + (taxon - first_tax_);
+    choices_[taxon] = choice;
+    if (choice < num_attach) {
+        prev_anc_[taxon] = anc_[choice];
+        anc_[choice] = new_node; // dec stays the same
+        // new edges
+        anc_[num_attach] = new_node;
+        dec_[num_attach] = taxon; // new tip
+        anc_[num_attach + 1] = prev_anc_[taxon];
+        dec_[num_attach + 1] = new_node;
+    } else {
+        int root = num_taxa_ + 1;
         for (int i = 0; i < num_attach; i++) {
-            edge = edges[j];
-            int prev_node = edge[i][0];
-            edge[i][0] = new_node; // dec stays the same
-            // new edges
-            edge[num_attach][0] = new_node;
-            edge[num_attach][1] = taxon; // new tip
-            
-            edge[num_attach + 1][0] = prev_node;
-            edge[num_attach + 1][1] = new_node;
-            
-            trees.push_back(edge);
+            if (anc_[i] == root) {
+                anc_[i] = new_node;
+            }
         }
+        anc_[num_attach] = root;
+        dec_[num_attach] = taxon;
+        anc_[num_attach + 1] = root;
+        dec_[num_attach + 1] = new_node;
     }
-    return trees;
 }
 
 
-// rooted version of above
-// add next taxon to existing edge matrices
-// for the nth taxon, there are 2(n-1)-2 possible attachment points
-// - i.e., the edges of the previous iteration
-// need to keep a copy of the first matrix for flipping in the last
-std::vector< std::vector< std::vector<int> > > TopologyGenerator::add_taxon_rooted (std::vector< std::vector< std::vector<int> > > edges,
-        const int& taxon, const int& new_node) {
-    std::vector< std::vector< std::vector<int> > > trees;
-    int num_attach = 2 * (taxon - 1) - 2; // also the row where next edge will be added
-    std::vector< std::vector<int> > edge;
-    
-    for (unsigned int j = 0; j < edges.size(); j++) {
-        for (int i = 0; i < num_attach; i++) {
-            edge = edges[j];
-            int prev_node = edge[i][0];
-            edge[i][0] = new_node; // dec stays the same
-            // new edges
-            edge[num_attach][0] = new_node;
-            edge[num_attach][1] = taxon; // new tip
-            
-            edge[num_attach + 1][0] = prev_node;
-            edge[num_attach + 1][1] = new_node;
-            
-            trees.push_back(edge);
-        }
-        // now for the flipped matrix
-        edge = edges[j];
-        // first, swap new node in for root node (always num_taxa+1)
+// undo add_taxon. taxa must be removed in the reverse order they were added.
+// the 2 new rows are left as is; they are overwritten by the next insertion
+void TopologyGenerator::remove_taxon (const int& taxon) {
+    int num_attach = get_num_attach(taxon);
+    int choice = choices_[taxon];
+    if (choice < num_attach) {
+        anc_[choice] = prev_anc_[taxon];
+    } else {
         int root = num_taxa_ + 1;
-        for (unsigned int i = 0; i < edge.size(); i++) {
-            if (edge[i][0] == root) {
-                edge[i][0] = new_node;
-            } else if (edge[i][0] == 0) {
-                // early break: if 0, then edge has yet to be generated
-                break;
+        int new_node = num_taxa_ + 2 + (taxon - first_tax_);
+        for (int i = 0; i < num_attach; i++) {
+            if (anc_[i] == new_node) {
+                anc_[i] = root;
             }
         }
-        // second, add original root back in, attching to new taxon
-        edge[num_attach][0] = root;
-        edge[num_attach][1] = taxon;
-        // finally, attach root above new node
-        edge[num_attach + 1][0] = root;
-        edge[num_attach + 1][1] = new_node;
-        // and add to the tree collection
-        trees.push_back(edge);
-        
     }
-    return trees;
 }
 
 
-void TopologyGenerator::generate_trees () {
-    while (curtax_ <= num_taxa_) {
-        //std::cout << "adding taxon: " << curtax_ << std::endl;
-        if (!rooted_) {
-            trees_ = add_taxon_unrooted (trees_, curtax_, curnode_);
-        } else {
-            trees_ = add_taxon_rooted (trees_, curtax_, curnode_);
-        }
-        curtax_++;
-        curnode_++;
+// build the k-th (0-based) topology from scratch: reset the starting tree
+// (3 taxon star unrooted, 2 taxon tree rooted) and insert the remaining taxa
+// with the digits of k
+void TopologyGenerator::unrank (unsigned long int k) {
+    for (int i = 0; i < first_tax_ - 1; i++) {
+        anc_[i] = num_taxa_ + 1;
+        dec_[i] = i + 1;
+    }
+    for (int t = num_taxa_; t >= first_tax_; t--) {
+        unsigned long int nchoices = (unsigned long int)get_num_choices(t);
+        choices_[t] = (int)(k % nchoices);
+        k /= nchoices;
+    }
+    for (int t = first_tax_; t <= num_taxa_; t++) {
+        add_taxon(t, choices_[t]);
     }
-    //std::cout << "done." << std::endl;
 }
 
 
-std::string TopologyGenerator::edge_matrix_to_newick (const std::vector< std::vector<int> >& edges) {
-    std::string tree = "";
-    //int num_edges = (int)edges.size();
-    //int num_taxa = (int)((num_edges + 3)/2);
-    int min_node = num_taxa_ + 1;
-    int max_node = nedges_ + 1;
-    
-    std::map<int, std::vector<int>> m;
-    
-    for (int i = min_node; i <= max_node; i++) {
-        std::vector<int> clade;
-        for (int j = 0; j < nedges_; j++) {
-            if (edges[j][0] == i) {
-                clade.push_back(edges[j][1]);
-            }
+unsigned long int TopologyGenerator::get_rank () const {
+    unsigned long int rank = 0;
+    for (int t = first_tax_; t <= num_taxa_; t++) {
+        rank = rank * (unsigned long int)get_num_choices(t) + (unsigned long int)choices_[t];
+    }
+    return rank;
+}
+
+
+// step to the next topology like an odometer: bump the last taxon's insertion
+// choice, carrying into earlier taxa as needed. returns false after the last
+// topology
+bool TopologyGenerator::next () {
+    int t = num_taxa_;
+    while (t >= first_tax_) {
+        int choice = choices_[t];
+        remove_taxon(t);
+        if (choice + 1 < get_num_choices(t)) {
+            add_taxon(t, choice + 1);
+            break;
         }
-        m[i] = clade;
+        t--;
+    }
+    if (t < first_tax_) {
+        return false;
     }
-    newick_from_tree_map(min_node, m, tree);
-    tree += ";";
-    return tree;
+    for (int s = t + 1; s <= num_taxa_; s++) {
+        add_taxon(s, 0);
+    }
+    return true;
 }
 
 
 // recursive, so newick string is passed by reference
-void TopologyGenerator::newick_from_tree_map (int node, std::map<int, std::vector<int>> m, std::string& tree) {
+// descendants are written in edge array order
+void TopologyGenerator::newick_from_edges (const int& node, std::string& tree) const {
     tree += "("; // every entrance to this function is a tree
-    
-    std::vector<int> decnodes = m[node];
-    int numdec = (int)decnodes.size();
-    
+    int numdec = num_kids_[node];
     for (int i = 0; i < numdec; i++) {
-        int curnode = decnodes[i];
-        // is curnode a clade (i.e., needs to be further processed)?
-        // could also use number of tips if things are labelled reasonably
-        if (m.count(curnode)) {
-            newick_from_tree_map(curnode, m, tree); // recursion, baby
+        int curnode = kids_[3 * node + i];
+        if (curnode > num_taxa_) {
+            newick_from_edges(curnode, tree); // recursion, baby
         } else {
             // terminal
             tree += lprefix_ + std::to_string(curnode);
@@ -216,13 +174,62 @@ void TopologyGenerator::newick_from_tree_map (int node, std::map<int, std::vecto
 }
 
 
-// this will send newick to poos
+void TopologyGenerator::append_newick (std::string& out) {
+    std::fill(num_kids_.begin(), num_kids_.end(), 0);
+    for (int j = 0; j < nedges_; j++) {
+        int a = anc_[j];
+        kids_[3 * a + num_kids_[a]] = dec_[j];
+        num_kids_[a]++;
+    }
+    newick_from_edges(num_taxa_ + 1, out);
+    out += ";";
+}
+
+
+// newicks for topologies [first, first+count), one per line
+void TopologyGenerator::write_range (const unsigned long int& first,
+        const unsigned long int& count, std::string& out) {
+    out.clear();
+    unrank(first);
+    for (unsigned long int i = 0; i < count; i++) {
+        append_newick(out);
+        out += "\n";
+        if (i + 1 < count) {
+            next();
+        }
+    }
+}
+
+
+// the k-th (0-based) topology
+std::string TopologyGenerator::get_newick (const unsigned long int& k) {
+    unrank(k);
+    std::string newick;
+    append_newick(newick);
+    return newick;
+}
+
+
+// this will send newick to poos. topologies are split into blocks of
+// consecutive ranks (i.e., sharing their leading insertion choices) which are
+// generated in parallel, each by its own copy of the generator, and written
+// in order
 void TopologyGenerator::get_newicks (std::ostream* poos) {
-    generate_trees();
-    std::vector< std::vector<int> > tree;
-    for (unsigned long int i = 0; i < ntopos_; i++) {
-        tree = trees_[i];
-        std::string newick = edge_matrix_to_newick(tree);
-        (*poos) << newick << std::endl;
+    const unsigned long int blocksize = 1024;
+    const int batchsize = 64;
+    unsigned long int nblocks = (ntopos_ + blocksize - 1) / blocksize;
+    std::vector<std::string> out(batchsize);
+    for (unsigned long int b0 = 0; b0 < nblocks; b0 += batchsize) {
+        int nb = (int)std::min((unsigned long int)batchsize, nblocks - b0);
+        #pragma omp parallel for schedule(dynamic)
+        for (int b = 0; b < nb; b++) {
+            TopologyGenerator tg(*this);
+            unsigned long int first = (b0 + b) * blocksize;
+            tg.write_range(first, std::min(blocksize, ntopos_ - first), out[b]);
+        }
+        for (int b = 0; b < nb; b++) {
+            (*poos) << out[b];
+        }
     }
+    poos->flush();
 }
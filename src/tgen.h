@@ -3,10 +3,14 @@
 
 #include <string>
 #include <vector>
-#include <map>
 #include <iostream>
 
 
+// trees are built by stepwise addition on a single edge array (2 columns:
+// ancestor node index, descendant node index) that is edited in place and
+// undone, so only one tree is ever held in memory. the i-th topology is the
+// mixed radix number whose digits are the insertion choices of the added taxa
+// (first added taxon most significant), which gives rank/unrank for free
 class TopologyGenerator {
 private:
     int num_taxa_;
@@ -15,28 +19,34 @@ private:
     
     unsigned long int ntopos_; // number of possible topologies for n taxa. depends on rootedness
     int nedges_; // the number of edges in the final trees. depends on rootedness
-    int curtax_; // the next taxon to add
-    int curnode_; // the next internal node to add
+    int first_tax_; // the first taxon added to the starting tree
     
-    std::vector< std::vector< std::vector<int> > > trees_;
-    std::vector<std::string> newicks_; // sweet, sweet results
+    std::vector<int> anc_; // edge array
+    std::vector<int> dec_;
+    std::vector<int> choices_; // current insertion choice for each taxon
+    std::vector<int> prev_anc_; // ancestor replaced by each insertion (for undo)
+    std::vector<int> num_kids_; // scratch for writing newicks
+    std::vector<int> kids_;
     
-    void initialize();
+    void initialize ();
     int get_num_edges (const int& num_taxa, const int& rooted);
-    std::vector< std::vector<int> > initialize_edge_matrix_unrooted (const int& n);
-    std::vector< std::vector<int> > initialize_edge_matrix_rooted (const int& n);
-    std::vector< std::vector< std::vector<int> > > add_taxon_unrooted (std::vector< std::vector< std::vector<int> > > edges,
-        const int& taxon, const int& new_node);
-    std::vector< std::vector< std::vector<int> > > add_taxon_rooted (std::vector< std::vector< std::vector<int> > > edges,
-        const int& taxon, const int& new_node);
-    void newick_from_tree_map (int node, std::map<int, std::vector<int> > m, std::string& tree);
-    std::string edge_matrix_to_newick (const std::vector< std::vector<int> >& edges);
-    void generate_trees ();
-    
+    int get_num_attach (const int& taxon) const;
+    int get_num_choices (const int& taxon) const;
+    void add_taxon (const int& taxon, const int& choice);
+    void remove_taxon (const int& taxon);
+    void unrank (unsigned long int k);
+    bool next ();
+    void newick_from_edges (const int& node, std::string& tree) const;
+    void append_newick (std::string& out);
+    void write_range (const unsigned long int& first, const unsigned long int& count,
+        std::string& out);
+
 public:
     TopologyGenerator (const int& num_taxa, const bool& rooted, const std::string& lprefix);
+    unsigned long int get_num_topologies () const { return ntopos_; };
+    unsigned long int get_rank () const;
+    std::string get_newick (const unsigned long int& k);
     void get_newicks (std::ostream* poos);
-    //~TopologyGenerator();
 };
 
 #endif /* _TGEN_H_ */
@@ -1,6 +1,7 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <sstream>
 #include <cmath>
 #include <algorithm>
 
@@ -8,11 +9,19 @@
 #include "tree.h"
 #include "node.h"
 #include "tree_utils.h"
+#include "utils.h"
+
+extern double EPSILON;
+
+// columns of the table/summary, in the order of get_values
+static const char * stat_names[] = {"rooted", "binary", "nterminal", "ninternal",
+    "treelength", "rttipvar", "ultrametric", "rootheight"};
+static const int num_stats = 8;
 
 
 TreeInfo::TreeInfo (Tree * intree) {
     tree_ = intree;
-    calc_stats();
+    calc_stats(false);
 }
 
 
@@ -21,44 +30,34 @@ TreeInfo::TreeInfo (Tree * intree, const bool& ultracheck, const bool& binaryche
         const bool& lengthcheck, const bool& namecheck, const bool& rtvarcheck,
         std::ostream* poos) {
     tree_ = intree;
+    calc_stats(namecheck);
     if (ultracheck) {
-        ultrametric_tree_ = is_ultrametric_paths(tree_);
         (*poos) << std::boolalpha << ultrametric_tree_ << std::endl;
     } else if (rtvarcheck) {
-        has_branchlengths_ = tree_->hasEdgeLengths();
         if (has_branchlengths_) {
-            rtvar_ = get_root_tip_var(tree_);
             (*poos) << rtvar_ << std::endl;
         } else {
             (*poos) << "NA" << std::endl;
         }
     } else if (binarycheck) {
-        binary_tree_ = is_binary(tree_);
         (*poos) << std::boolalpha << binary_tree_ << std::endl;
     } else if (agecheck) {
-        ultrametric_tree_ = is_ultrametric_paths(tree_);
         if (ultrametric_tree_) {
-            rootheight_ = tree_->getRoot()->getHeight();
             (*poos) << rootheight_ << std::endl;
         } else {
             (*poos) << "NA" << std::endl;
         }
     } else if (rootedcheck) {
-        rooted_tree_ = is_rooted(tree_);
         (*poos) << std::boolalpha << rooted_tree_ << std::endl;
     } else if (ntipcheck) {
-        ntips_ = tree_->getExternalNodeCount();
         (*poos) << ntips_ << std::endl;
     } else if (lengthcheck) {
-        has_branchlengths_ = tree_->hasEdgeLengths();
         if (has_branchlengths_) {
-            treelength_ = get_tree_length(tree_);
             (*poos) << treelength_ << std::endl;
         } else {
             (*poos) << "NA" << std::endl;
         }
     } else if (namecheck) {
-        tip_labels_ = get_tip_labels(tree_);
         for (unsigned int i = 0; i < tip_labels_.size(); i++) {
             (*poos) << tip_labels_[i] << std::endl;
         }
@@ -66,28 +65,58 @@ TreeInfo::TreeInfo (Tree * intree, const bool& ultracheck, const bool& binaryche
 }
 
 
-void TreeInfo::calc_stats () {
+// a single iterative pre-order pass fills every stat. root-to-tip distances
+// are carried down the stack rather than walked back up from each tip, and
+// give the variance, ultrametricity and root height. the first tip reached
+// (following first children) gives the root height, as set_node_heights does
+void TreeInfo::calc_stats (const bool& labels) {
     has_branchlengths_ = tree_->hasEdgeLengths();
-    if (has_branchlengths_) {
-        treelength_ = get_tree_length(tree_);
-    } else {
-        treelength_ = 0.0;
+    Node * root = tree_->getRoot();
+    rooted_tree_ = (root->getChildCount() == 2);
+    
+    int nint = 0;
+    int ntip = 0;
+    double length = 0.0;
+    std::vector<double> paths;
+    paths.reserve(tree_->getExternalNodeCount());
+    std::vector<std::pair<Node *, double> > stack;
+    stack.push_back(std::make_pair(root, 0.0));
+    while (!stack.empty()) {
+        Node * nd = stack.back().first;
+        double depth = stack.back().second;
+        stack.pop_back();
+        length += nd->getBL();
+        int nchildren = nd->getChildCount();
+        if (nchildren == 0) {
+            ntip++;
+            paths.push_back(depth);
+            if (labels) {
+                tip_labels_.push_back(nd->getName());
+            }
+            continue;
+        }
+        nint++;
+        for (int i = nchildren - 1; i >= 0; i--) {
+            Node * child = nd->getChild(i);
+            stack.push_back(std::make_pair(child, depth + child->getBL()));
+        }
     }
-    nintnodes_ = tree_->getInternalNodeCount();
-    ntips_ = tree_->getExternalNodeCount();
-    rooted_tree_ = is_rooted(tree_);
-    binary_tree_ = is_binary(tree_);
-    ultrametric_tree_ = is_ultrametric_paths(tree_);
-    if (rooted_tree_) {
-        rtvar_ = get_root_tip_var(tree_);
-    } else {
-        rtvar_ = 0.0;
+    if (labels) {
+        std::sort(tip_labels_.begin(), tip_labels_.end());
     }
-    if (ultrametric_tree_) {
-        rootheight_ = tree_->getRoot()->getHeight();
+    
+    ntips_ = ntip;
+    nintnodes_ = nint;
+    treelength_ = has_branchlengths_ ? length : 0.0;
+    if (rooted_tree_) {
+        binary_tree_ = (nint == ntip - 1);
     } else {
-        rootheight_ = 0.0;
+        binary_tree_ = (nint == ntip - 2);
     }
+    double var = variance(paths);
+    rtvar_ = var;
+    ultrametric_tree_ = rooted_tree_ && length != 0 && var < EPSILON;
+    rootheight_ = ultrametric_tree_ ? paths[0] : 0.0;
 }
 
 
@@ -116,3 +145,60 @@ void TreeInfo::get_stats (std::ostream* poos) {
         (*poos) << "rootheight: NA" << std::endl;
     }
 }
+
+
+std::string TreeInfo::get_table_header () {
+    std::string header = "tree";
+    for (int i = 0; i < num_stats; i++) {
+        header += "\t";
+        header += stat_names[i];
+    }
+    return header + "\n";
+}
+
+
+// one tab-separated line, with the same NA rules as get_stats
+void TreeInfo::get_table_row (const long& index, std::string& out) const {
+    std::vector<double> vals;
+    std::vector<bool> na;
+    get_values(vals, na);
+    std::ostringstream row;
+    row << index;
+    for (int i = 0; i < num_stats; i++) {
+        row << "\t";
+        if (na[i]) {
+            row << "NA";
+        } else if (i == 0 || i == 1 || i == 6) {
+            row << std::boolalpha << (vals[i] != 0.0);
+        } else {
+            row << vals[i];
+        }
+    }
+    row << "\n";
+    out += row.str();
+}
+
+
+// stats as numbers (booleans as 0/1). na flags where get_stats would print NA
+// (not NaN, which is unreliable under -ffast-math)
+void TreeInfo::get_values (std::vector<double>& vals, std::vector<bool>& na) const {
+    vals.resize(num_stats);
+    na.assign(num_stats, false);
+    vals[0] = rooted_tree_ ? 1.0 : 0.0;
+    vals[1] = binary_tree_ ? 1.0 : 0.0;
+    vals[2] = ntips_;
+    vals[3] = nintnodes_;
+    vals[4] = treelength_;
+    vals[5] = rtvar_;
+    vals[6] = ultrametric_tree_ ? 1.0 : 0.0;
+    vals[7] = rootheight_;
+    na[4] = !has_branchlengths_;
+    na[5] = !(has_branchlengths_ && rooted_tree_);
+    na[6] = !has_branchlengths_;
+    na[7] = !ultrametric_tree_;
+}
+
+
+std::vector<std::string> TreeInfo::get_stat_names () {
+    return std::vector<std::string>(stat_names, stat_names + num_stats);
+}
@@ -21,7 +21,7 @@ private:
     double rtvar_;
     std::vector<std::string> tip_labels_;
     
-    void calc_stats ();
+    void calc_stats (const bool& labels);
 
 public:
     TreeInfo (Tree * intree);
@@ -30,6 +30,10 @@ public:
         const bool& lengthcheck, const bool& namecheck, const bool& rtvarcheck,
         std::ostream* poos);
     void get_stats (std::ostream* poos);
+    static std::string get_table_header ();
+    static std::vector<std::string> get_stat_names ();
+    void get_table_row (const long& index, std::string& out) const;
+    void get_values (std::vector<double>& vals, std::vector<bool>& na) const;
 };
 
 #endif /* _LS_TR_H_ */
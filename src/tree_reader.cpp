@@ -11,6 +11,7 @@
 #include "tree.h"
 #include "tree_reader.h"
 #include "utils.h"
+#include "profile.h"
 
 
 TreeReader::TreeReader() {}
@@ -24,6 +25,7 @@ TreeReader::TreeReader() {}
 
 // TODO: record whether edge lengths are present, store as property
 Tree * TreeReader::readTree (std::string trees) {
+    PX_PROFILE_COUNT(PROF_TREES_PARSED, 1);
     Tree * tree = new Tree();
     std::string pb = trees;
     unsigned int x = 0;
@@ -401,6 +403,28 @@ bool check_nexus_comment (std::string line) {
 */
 Tree * read_next_tree_from_stream_nexus (std::istream& stri, std::string& retstring,
     bool ttexists, std::map<std::string, std::string> * trans, bool * going) {
+    std::string tstring;
+    if (!read_next_tree_string_nexus(stri, retstring, tstring)) {
+        (*going) = false;
+        return NULL;
+    }
+    Tree * tree;
+    //std::cout << tstring << std::endl;
+    TreeReader tr;
+    tree = tr.readTree(tstring);
+    if (ttexists) {
+        for (int i=0; i < tree->getExternalNodeCount(); i++) {
+            tree->getExternalNode(i)->setName((*trans)[tree->getExternalNode(i)->getName()]);
+        }
+    }
+    return tree;
+}
+
+
+// the text of the next tree in a nexus trees block (from the first '('), without
+// parsing it. returns false at the end of the block (or stream)
+bool read_next_tree_string_nexus (std::istream& stri, std::string& retstring,
+    std::string& tstring) {
     std::string tline;
     if (retstring.size() > 0) {
         tline = retstring;
@@ -422,8 +446,7 @@ Tree * read_next_tree_from_stream_nexus (std::istream& stri, std::string& retstr
         bool reading = true; // continue reading if lines are empty or comments
         while (reading) {
             if (!getline(stri, tline)) {
-                (*going) = false;
-                return NULL;
+                return false;
             }
             trim_spaces(tline); // important!
             if (!tline.empty()) {
@@ -440,8 +463,7 @@ Tree * read_next_tree_from_stream_nexus (std::istream& stri, std::string& retstr
     //std::cout << "Working on: " << tline << std::endl;
     std::string uc = string_to_upper(tline);
     if (uc.find("END;") != std::string::npos) {
-        (*going) = false;
-        return NULL;
+        return false;
     }
     //vector<string> tokens;
     //string del(" \t");
@@ -449,17 +471,8 @@ Tree * read_next_tree_from_stream_nexus (std::istream& stri, std::string& retstr
     //string tstring(tokens[tokens.size()-1]);
     
     size_t startpos = tline.find_first_of("(");
-    std::string tstring = tline.substr(startpos);
-    Tree * tree;
-    //std::cout << tstring << std::endl;
-    TreeReader tr;
-    tree = tr.readTree(tstring);
-    if (ttexists) {
-        for (int i=0; i < tree->getExternalNodeCount(); i++) {
-            tree->getExternalNode(i)->setName((*trans)[tree->getExternalNode(i)->getName()]);
-        }
-    }
-    return tree;
+    tstring = tline.substr(startpos);
+    return true;
 }
 
 
@@ -469,20 +482,29 @@ Tree * read_next_tree_from_stream_nexus (std::istream& stri, std::string& retstr
 // adding a simple check: if line is empty, assume we're done
 Tree * read_next_tree_from_stream_newick (std::istream& stri, std::string& retstring, bool * going) {
     std::string tline;
+    if (!read_next_tree_string_newick(stri, retstring, tline)) {
+        (*going) = false;
+        return NULL;
+    }
+    Tree * tree;
+    TreeReader tr;
+    tree = tr.readTree(tline);
+    return tree;
+}
+
+
+// as above, but just the line. returns false at the end of the trees
+bool read_next_tree_string_newick (std::istream& stri, std::string& retstring,
+    std::string& tline) {
     if (retstring.size() > 0) {
         tline = retstring;
         retstring = "";
     } else if (!getline(stri, tline)) {
-        (*going) = false;
-        return NULL;
+        return false;
     }
     if (tline.size() == 0) {
         //std::cout << "You've got yerself an empty line, there." << std::endl;
-        (*going) = false;
-        return NULL;
+        return false;
     }
-    Tree * tree;
-    TreeReader tr;
-    tree = tr.readTree(tline);
-    return tree;
+    return true;
 }
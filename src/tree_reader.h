@@ -25,5 +25,9 @@ Tree * read_next_tree_from_stream_nexus (std::istream& stri, std::string& retstr
         bool ttexists, std::map<std::string, std::string> * trans, bool * going);
 Tree * read_next_tree_from_stream_newick (std::istream& stri, std::string& retstring,
         bool * going);
+bool read_next_tree_string_nexus (std::istream& stri, std::string& retstring,
+        std::string& tstring);
+bool read_next_tree_string_newick (std::istream& stri, std::string& retstring,
+        std::string& tline);
 
 #endif /* _TREE_READER_H_ */
@@ -0,0 +1,170 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+
+#include "tree_stream.h"
+#include "tree_reader.h"
+#include "tree_writer.h"
+#include "tree.h"
+#include "node.h"
+#include "profile.h"
+
+
+// determines the file type (0 = nexus, 1 = newick; see test_tree_filetype_stream)
+// and reads any nexus translation table. tools check get_filetype() themselves
+TreeStream::TreeStream (std::istream * pios):pios_(pios), filetype_(-1), ttexists_(false),
+    going_(true), aborted_(false), batch_size_(512) {
+    filetype_ = test_tree_filetype_stream(*pios_, retstring_);
+    if (filetype_ == 0) {
+        ttexists_ = get_nexus_translation_table(*pios_, &translation_table_, &retstring_);
+    } else if (filetype_ != 1) {
+        going_ = false;
+    }
+}
+
+
+void TreeStream::set_batch_size (const int& n) {
+    batch_size_ = (n < 1) ? 1 : n;
+}
+
+
+bool TreeStream::read_tree_string (std::string& str) {
+    if (!going_) {
+        return false;
+    }
+    if (filetype_ == 0) {
+        going_ = read_next_tree_string_nexus(*pios_, retstring_, str);
+    } else {
+        going_ = read_next_tree_string_newick(*pios_, retstring_, str);
+    }
+    return going_;
+}
+
+
+void TreeStream::read_batch (std::vector<std::string>& batch) {
+    batch.resize(batch_size_);
+    int n = 0;
+    while (n < batch_size_ && read_tree_string(batch[n])) {
+        n++;
+    }
+    batch.resize(n);
+}
+
+
+// same as read_next_tree_from_stream_*. a label missing from the translation
+// table becomes empty, as it did there
+Tree * TreeStream::parse_tree (const std::string& str) const {
+    TreeReader tr;
+    Tree * tree = tr.readTree(str);
+    if (ttexists_) {
+        for (int i=0; i < tree->getExternalNodeCount(); i++) {
+            Node * nd = tree->getExternalNode(i);
+            std::map<std::string, std::string>::const_iterator it =
+                translation_table_.find(nd->getName());
+            nd->setName(it == translation_table_.end() ? std::string() : it->second);
+        }
+    }
+    return tree;
+}
+
+
+// returns the number of trees processed (up to and including the one whose
+// transform failed, if one did)
+long TreeStream::process (TreeWriter& tw, const TreeTransform& transform, const bool& ordered) {
+    PX_PROFILE_PHASE("process trees");
+    std::vector<std::string> curr;
+    std::vector<std::string> next;
+    std::vector<std::string> outs;
+    std::vector<std::string> prevouts;
+    std::vector<Tree *> trees;
+    std::vector<Tree *> prevtrees;
+    long start = 0;
+    long prevstart = 0;
+    long stop_at = -1; // index of the first failed transform
+    std::string out;
+    
+    // writer stage for the previous batch
+    auto write_prev = [&] () {
+        if (ordered) {
+            for (unsigned int i = 0; i < prevtrees.size(); i++) {
+                if (stop_at < 0) {
+                    out.clear();
+                    if (!transform(prevtrees[i], prevstart + i, out)) {
+                        stop_at = prevstart + i;
+                    }
+                    tw.write(out);
+                }
+                delete prevtrees[i];
+            }
+            prevtrees.clear();
+        } else {
+            for (unsigned int i = 0; i < prevouts.size(); i++) {
+                tw.write(prevouts[i]);
+            }
+            prevouts.clear();
+        }
+    };
+    
+    read_batch(curr);
+    while (!curr.empty()) {
+        const int n = (int)curr.size();
+        if (ordered) {
+            trees.assign(n, NULL);
+        } else {
+            outs.resize(n);
+        }
+        long failed = -1; // lowest failed index in this batch
+        #pragma omp parallel
+        {
+            #pragma omp single nowait
+            read_batch(next);
+            #pragma omp single nowait
+            write_prev();
+            #pragma omp for schedule(dynamic)
+            for (int i = 0; i < n; i++) {
+                Tree * tree = parse_tree(curr[i]);
+                if (ordered) {
+                    trees[i] = tree;
+                } else {
+                    outs[i].clear();
+                    if (!transform(tree, start + i, outs[i])) {
+                        #pragma omp critical (tree_stream_abort)
+                        if (failed < 0 || start + i < failed) {
+                            failed = start + i;
+                        }
+                    }
+                    delete tree;
+                }
+            }
+        }
+        if (failed >= 0) {
+            stop_at = failed;
+            outs.resize(failed - start + 1);
+        }
+        if (stop_at >= 0) {
+            // the previous batch is written, and everything before the failed
+            // tree in this one is ready
+            for (unsigned int i = 0; i < trees.size(); i++) {
+                delete trees[i];
+            }
+            trees.clear();
+            prevouts.swap(outs);
+            write_prev();
+            aborted_ = true;
+            going_ = false;
+            return stop_at + 1;
+        }
+        prevstart = start;
+        start += n;
+        prevouts.swap(outs);
+        prevtrees.swap(trees);
+        curr.swap(next);
+    }
+    write_prev();
+    if (stop_at >= 0) {
+        aborted_ = true;
+        return stop_at + 1;
+    }
+    return start;
+}
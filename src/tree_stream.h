@@ -0,0 +1,59 @@
+#ifndef _TREE_STREAM_H_
+#define _TREE_STREAM_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <iostream>
+
+#include "tree.h"
+#include "tree_writer.h"
+
+// per-tree work of a tool. may modify or replace the tree (it is deleted
+// afterwards), and appends whatever is to be written for it to out (e.g., via
+// append_tree). index is the (0-based) position of the tree in the stream.
+// returns false to stop the stream on an error, which the tool reports once
+// process returns (see aborted). transforms run on worker threads and must not
+// call exit(): output of earlier trees is still buffered, and other threads
+// are still running
+typedef std::function<bool (Tree *& tree, const long& index, std::string& out)> TreeTransform;
+
+
+/*
+ * the read/process/write loop shared by the tools that handle a set of trees
+ * one at a time (newick or nexus, incl. translation tables). runs as a three
+ * stage pipeline over batches of trees: while the batch in hand is parsed and
+ * transformed in parallel, one thread reads the raw text of the next batch and
+ * another writes the results of the previous one, so output is in input order.
+ * if the transform is not safe to run concurrently (e.g., it draws random
+ * numbers, or learns something from the first tree), pass ordered=true: trees
+ * are still parsed in parallel, but transformed and written in order by the
+ * writer stage. if a transform returns false, the output of every tree before
+ * it (and its own) is written in order and nothing after it; process returns
+ * and aborted() is true, so the tool can flush its TreeWriter and exit
+ */
+class TreeStream {
+private:
+    std::istream * pios_;
+    std::string retstring_;
+    int filetype_;
+    bool ttexists_;
+    std::map<std::string, std::string> translation_table_;
+    bool going_;
+    bool aborted_;
+    int batch_size_;
+    
+    bool read_tree_string (std::string& str);
+    void read_batch (std::vector<std::string>& batch);
+    Tree * parse_tree (const std::string& str) const;
+
+public:
+    TreeStream (std::istream * pios);
+    int get_filetype () const { return filetype_; };
+    void set_batch_size (const int& n);
+    long process (TreeWriter& tw, const TreeTransform& transform, const bool& ordered);
+    bool aborted () const { return aborted_; };
+};
+
+#endif /* _TREE_STREAM_H_ */
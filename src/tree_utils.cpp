@@ -1,17 +1,21 @@
 #include <string>
 #include <map>
+#include <set>
 #include <vector>
 #include <iterator>
 #include <functional>
 #include <iostream>
 #include <numeric>
 #include <algorithm>
+#include <cstdlib>
 
 #include "node.h"
 #include "tree.h"
 #include "tree_utils.h"
 #include "tree_reader.h"
+#include "tree_writer.h"
 #include "utils.h"
+#include "profile.h"
 
 extern double EPSILON;
 
@@ -672,8 +676,9 @@ void remove_knuckle (Node * node) {
 // 1. check presence of edge lengths
 // 2. includes semicolon in string
 std::string getNewickString (Tree * tree) {
-    bool bl = tree->hasEdgeLengths();
-    std::string phy = tree->getRoot()->getNewick(bl) + ";";
+    std::string phy;
+    append_newick(phy, tree->getRoot(), tree->hasEdgeLengths());
+    phy += ";";
     return phy;
 }
 
@@ -681,7 +686,9 @@ std::string getNewickString (Tree * tree) {
 // same as above but with objects
 std::string getNewickString (Tree * tree, std::string obj) {
     bool bl = tree->hasEdgeLengths();
-    std::string phy = tree->getRoot()->getNewick(bl, obj) + ";";
+    std::string phy;
+    append_newick(phy, tree->getRoot(), bl, obj);
+    phy += ";";
     return phy;
 }
 
@@ -700,18 +707,154 @@ bool has_root_edge (Tree * tr) {
 
 
 std::string double_to_str (double d) {
-    size_t len = snprintf(0, 0, "%.16f", d);
-    std::string s(len+1, 0);
-    snprintf(&s[0], len+1, "%.16f", d);
-    s.pop_back();
-    s.erase(s.find_last_not_of('0') + 1, std::string::npos);
-    if (s.back() == '.') {
-        s.pop_back();
-    }
+    std::string s;
+    append_double(s, d);
     return s;
 }
 
 
+// (2n-5)!! unrooted, (2n-3)!! rooted. computed here rather than with the int
+// doublefactorial, which overflows past 12 (unrooted) taxa
 unsigned long int get_num_possible_trees (const int& n, const bool& rooted) {
-    return doublefactorial(2 * (n + rooted) - 5);
+    unsigned long int ntrees = 1;
+    for (int i = 3; i <= 2 * (n + (int)rooted) - 5; i += 2) {
+        ntrees *= (unsigned long int)i;
+    }
+    return ntrees;
+}
+
+
+/*
+ * the bipartitions of a set of trees (as pxbp): each is the sorted indices of
+ * the names on one side, the other side, and the names missing from the tree,
+ * with the number of trees that have it. nodewise, or edgewise (a b | c d
+ * counted once) if all taxa are assumed present. internal nodes with a label
+ * below cutnum are skipped if cutoff
+ */
+void count_bipartitions (const std::vector<Tree *>& trees, std::map<std::string, int>& name_index,
+        const std::set<std::string>& names_s, const bool& cutoff, const double& cutnum,
+        const bool& edgewisealltaxa, std::vector<std::vector<int> >& biparts,
+        std::vector<std::vector<int> >& biparts2, std::vector<std::vector<int> >& not_included,
+        std::vector<double>& bp_count) {
+    PX_PROFILE_PHASE("count bipartitions");
+    for (unsigned int i=0; i < trees.size(); i++) {
+        //get the biparts
+        bool unrooted = false;
+        int numch = trees[i]->getRoot()->getChildCount();
+        if (numch > 2) {
+            unrooted = true;
+        }
+        std::vector<std::string> rt_nms = trees[i]->getRoot()->get_leave_names();
+        std::set<std::string> rt_nms_set;
+        copy(rt_nms.begin(), rt_nms.end(), inserter(rt_nms_set, rt_nms_set.begin()));
+        //get the ones that aren't in the tree at all
+        std::vector<std::string> not_included_nms(rt_nms_set.size());
+        std::vector<int> not_included_i;
+        std::vector<std::string>::iterator it2;
+        it2 = std::set_difference(names_s.begin(), names_s.end(), rt_nms_set.begin(),
+                rt_nms_set.end(), not_included_nms.begin());
+        not_included_nms.resize(it2-not_included_nms.begin());
+        for (unsigned int j=0; j < not_included_nms.size(); j++) {
+            std::cerr << " not included: "  << not_included_nms[j]<< std::endl;
+            not_included_i.push_back(name_index[not_included_nms[j]]);
+        }
+        std::vector<int> bp_count_tree; // for edgewise to make sure we don't double count
+        for (int j=0; j < trees[i]->getInternalNodeCount(); j++) {
+            std::vector<std::string> nms = trees[i]->getInternalNode(j)->get_leave_names();
+            //skip the root
+            if (nms.size() == rt_nms.size()) {
+                continue;
+            }
+            //if we are using a cutoff, skip the edge that is below the num
+            if (cutoff == true) {
+                if (trees[i]->getInternalNode(j)->getName().length() < 1) {
+                    continue;
+                }
+                char* pEnd;
+                double td = strtod(trees[i]->getInternalNode(j)->getName().c_str(),&pEnd) ;
+                if (td < cutnum) {
+                    continue;
+                }
+            }
+            //end using cutoffs
+            std::vector<int> nms_i;
+            std::set<std::string> nms_s;
+            copy(nms.begin(), nms.end(), inserter(nms_s, nms_s.begin()));
+            for (unsigned int k=0; k < nms.size(); k++) {
+                nms_i.push_back(name_index[nms[k]]);
+            }
+            sort(nms_i.begin(), nms_i.end());
+            //get the other side of the bipart
+            std::vector<int> nms_i2;
+            std::vector<std::string> nms_s2(rt_nms.size());
+            std::vector<std::string>::iterator it;
+            it = std::set_difference(rt_nms_set.begin(), rt_nms_set.end(), nms_s.begin(),
+                nms_s.end(), nms_s2.begin());
+            nms_s2.resize(it-nms_s2.begin());
+            for (unsigned int k=0; k < nms_s2.size(); k++) {
+                nms_i2.push_back(name_index[nms_s2[k]]);
+            }
+            sort(nms_i2.begin(), nms_i2.end());
+            //check to see if the bipart is new
+            if (edgewisealltaxa == false) {
+                //this is nodewise and we dont' assume we have all the taxa
+                if ((int)std::count(biparts.begin(), biparts.end(), nms_i) == 0 && 
+                (int)std::count(biparts2.begin(), biparts2.end(), nms_i2) == 0) {
+                    biparts.push_back(nms_i);
+                    biparts2.push_back(nms_i2);
+                    not_included.push_back(not_included_i);
+                    bp_count.push_back(1);
+                } else {
+                    //get index 
+                    size_t index = find(biparts.begin(), biparts.end(), nms_i)-biparts.begin();
+                    bp_count[index] += 1;
+                }
+                /*
+                 * do the otherside for unrooted
+                 */
+                if (unrooted==true && trees[i]->getInternalNode(j)->getParent()==trees[i]->getRoot()) {
+                    if ((int)std::count(biparts.begin(), biparts.end(), nms_i2) == 0 && 
+                        (int)std::count(biparts2.begin(), biparts2.end(), nms_i) == 0) {
+                        biparts.push_back(nms_i2);
+                        biparts2.push_back(nms_i);
+                        not_included.push_back(not_included_i);
+                        bp_count.push_back(1);
+                    } else {
+                        size_t index = find(biparts.begin(), biparts.end(), nms_i2)-biparts.begin();
+                        bp_count[index] += 1;
+                    }
+                }
+            } else {
+                //this is edgewise and we assume all the taxa 
+                //this is for reporting a b | c d instead of a b and c d separately
+                
+                //first check to make sure that both sides at least have two taxa
+                if (nms_i.size() < 2 || nms_i2.size() < 2) {
+                    continue;
+                }
+                if ((int)std::count(biparts.begin(), biparts.end(), nms_i) == 0 && 
+                    (int)std::count(biparts.begin(), biparts.end(), nms_i2) == 0) {
+                    biparts.push_back(nms_i);
+                    biparts2.push_back(nms_i2);
+                    not_included.push_back(not_included_i);
+                    bp_count.push_back(1);
+                    bp_count_tree.push_back(bp_count.size()-1);
+                } else {
+                    //get index 
+                    size_t index;
+                    if ((int)std::count(biparts.begin(), biparts.end(), nms_i) == 1) {
+                        index = find(biparts.begin(), biparts.end(), nms_i)-biparts.begin();
+                    } else {
+                        index = find(biparts.begin(), biparts.end(), nms_i2)-biparts.begin();
+                    }
+                    //need to accommodate that it can be reflected in the edgewise case
+                    if ((int)std::count(bp_count_tree.begin(), bp_count_tree.end(), index) == 0) {
+                        bp_count[index] += 1;
+                        bp_count_tree.push_back(index);
+                    }
+                }
+
+            }
+        }
+    }
 }
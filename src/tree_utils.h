@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
 
 class Tree; // forward declaration
 class Node; // forward declaration
@@ -49,4 +50,9 @@ std::string getNewickString (Tree * tree, std::string object);
 std::string double_to_str (double d);
 
 unsigned long int get_num_possible_trees (const int& n, const bool& rooted);
+void count_bipartitions (const std::vector<Tree *>& trees, std::map<std::string, int>& name_index,
+    const std::set<std::string>& names_s, const bool& cutoff, const double& cutnum,
+    const bool& edgewisealltaxa, std::vector<std::vector<int> >& biparts,
+    std::vector<std::vector<int> >& biparts2, std::vector<std::vector<int> >& not_included,
+    std::vector<double>& bp_count);
 #endif /* _TREE_UTILS_H_ */
@@ -0,0 +1,150 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdio>
+
+#include "tree_writer.h"
+#include "node.h"
+#include "tree.h"
+#include "string_node_object.h"
+
+
+TreeWriter::TreeWriter (std::ostream * poos):poos_(poos), flush_size_(1 << 20) {
+    buffer_.reserve(flush_size_ + (flush_size_ >> 2));
+}
+
+
+// anything not yet flushed by hand. the stream must still be open
+TreeWriter::~TreeWriter () {
+    if (!buffer_.empty()) {
+        flush();
+    }
+}
+
+
+void TreeWriter::check_flush () {
+    if (buffer_.size() >= flush_size_) {
+        flush();
+    }
+}
+
+
+void TreeWriter::flush () {
+    poos_->write(buffer_.data(), (std::streamsize)buffer_.size());
+    poos_->flush();
+    buffer_.clear();
+}
+
+
+void TreeWriter::write (const std::string& str) {
+    buffer_ += str;
+    check_flush();
+}
+
+
+// no terminating semicolon
+void TreeWriter::write_newick (Node * nd, const bool& bl) {
+    append_newick(buffer_, nd, bl);
+    check_flush();
+}
+
+
+void TreeWriter::write_tree (Tree * tree) {
+    append_tree(buffer_, tree);
+    check_flush();
+}
+
+
+// same string as getNewickString (i.e., edge lengths if the tree has them), plus newline
+void append_tree (std::string& out, Tree * tree) {
+    append_newick(out, tree->getRoot(), tree->hasEdgeLengths());
+    out += ";\n";
+}
+
+
+// same format as double_to_str (%.16f, trailing zeros removed), but written
+// straight onto the end of out
+void append_double (std::string& out, const double& d) {
+    char buf[64];
+    int len = snprintf(buf, sizeof(buf), "%.16f", d);
+    if (len < 0) {
+        return;
+    }
+    if (len >= (int)sizeof(buf)) {
+        // huge values; not worth a fast path
+        std::string s(len + 1, 0);
+        snprintf(&s[0], len + 1, "%.16f", d);
+        s.resize(len);
+        s.erase(s.find_last_not_of('0') + 1, std::string::npos);
+        if (s[s.size() - 1] == '.') {
+            s.resize(s.size() - 1);
+        }
+        out += s;
+        return;
+    }
+    while (len > 0 && buf[len - 1] == '0') {
+        len--;
+    }
+    if (len > 0 && buf[len - 1] == '.') {
+        len--;
+    }
+    out.append(buf, len);
+}
+
+
+// iterative (explicit stack) traversal, so each character is written exactly
+// once regardless of tree depth. the edge length of a node is written after the
+// node, when control returns to its parent. if obj is given, node objects of
+// that name are written as [&obj=value] with edge lengths in default stream
+// (%g) format, matching the old Node::getNewick(bl, obj)
+static void append_newick_nodes (std::string& out, Node * nd, const bool& bl,
+        const std::string * obj) {
+    std::vector<std::pair<Node *, int> > stack;
+    stack.push_back(std::make_pair(nd, 0));
+    char buf[32];
+    while (!stack.empty()) {
+        Node * cur = stack.back().first;
+        int next = stack.back().second;
+        if (next < cur->getChildCount()) {
+            if (next == 0) {
+                out += '(';
+            }
+            stack.back().second++;
+            stack.push_back(std::make_pair(cur->getChild(next), 0));
+            continue;
+        }
+        out += cur->getName();
+        if (obj != NULL && cur->getObject(*obj) != NULL) {
+            out += "[&";
+            out += *obj;
+            out += "=";
+            out += *((StringNodeObject*) (cur->getObject(*obj)));
+            out += "]";
+        }
+        stack.pop_back();
+        if (stack.empty()) {
+            break;
+        }
+        if (bl) {
+            out += ':';
+            if (obj == NULL) {
+                append_double(out, cur->getBL());
+            } else {
+                snprintf(buf, sizeof(buf), "%g", cur->getBL());
+                out += buf;
+            }
+        }
+        Node * par = stack.back().first;
+        out += (stack.back().second == par->getChildCount()) ? ')' : ',';
+    }
+}
+
+
+void append_newick (std::string& out, Node * nd, const bool& bl) {
+    append_newick_nodes(out, nd, bl, NULL);
+}
+
+
+void append_newick (std::string& out, Node * nd, const bool& bl, const std::string& obj) {
+    append_newick_nodes(out, nd, bl, &obj);
+}
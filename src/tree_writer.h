@@ -0,0 +1,39 @@
+#ifndef _TREE_WRITER_H_
+#define _TREE_WRITER_H_
+
+#include <string>
+#include <iostream>
+
+#include "node.h"
+#include "tree.h"
+
+
+/*
+ * newick serialization without the recursive string building of the old
+ * Node::getNewick. trees are written (iteratively) onto the end of a buffer
+ * that is reused from tree to tree and handed to the stream in large blocks.
+ * flush() must be called before the stream is closed
+ */
+class TreeWriter {
+private:
+    std::ostream * poos_;
+    std::string buffer_;
+    size_t flush_size_;
+    
+    void check_flush ();
+
+public:
+    TreeWriter (std::ostream * poos);
+    ~TreeWriter ();
+    void write (const std::string& str);
+    void write_newick (Node * nd, const bool& bl);
+    void write_tree (Tree * tree);
+    void flush ();
+};
+
+void append_tree (std::string& out, Tree * tree);
+void append_newick (std::string& out, Node * nd, const bool& bl);
+void append_newick (std::string& out, Node * nd, const bool& bl, const std::string& obj);
+void append_double (std::string& out, const double& d);
+
+#endif /* _TREE_WRITER_H_ */
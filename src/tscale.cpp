@@ -20,12 +20,14 @@ void TScale::set_rootheight (const double& rootheight) {
 }
 
 
-void TScale::rescale (Tree * tr) {
+// const (the per-tree factor is not stored) so trees can be rescaled concurrently
+void TScale::rescale (Tree * tr) const {
+    double scalef = scalef_;
     if (rootset_) {
         // need to figure out scaling factor from original and desired root ages
         // ultrametricity check is upstream
         double orig_rootheight = tr->getRoot()->getHeight();
-        scalef_ = rootheight_ / orig_rootheight;
+        scalef = rootheight_ / orig_rootheight;
     }
-    rescale_tree(tr, scalef_);
+    rescale_tree(tr, scalef);
 }
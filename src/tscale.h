@@ -13,7 +13,7 @@ public:
     TScale ();
     void set_scalef (const double& scalef);
     void set_rootheight (const double& rootheight);
-    void rescale (Tree * tr);
+    void rescale (Tree * tr) const;
 };
 
 #endif /* _TSCALE_H_ */
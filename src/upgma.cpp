@@ -12,11 +12,12 @@
 #include "node.h"
 #include "tree.h"
 #include "tree_utils.h"
+#include "profile.h"
 
 
-UPGMA::UPGMA (std::istream* pios):num_taxa_(0), num_char_(0), newickstring_("") {
-    std::string alphaName = ""; // not used, but required by reader
-    seqs_ = ingest_alignment(pios, alphaName);
+UPGMA::UPGMA (std::istream* pios, const distModel& model):num_taxa_(0), num_char_(0),
+        newickstring_(""), alpha_name_(""), model_(model) {
+    seqs_ = ingest_alignment(pios, alpha_name_);
     num_taxa_ = (int)seqs_.size();
     num_char_ = (int)seqs_[0].get_length();
     
@@ -30,41 +31,23 @@ UPGMA::UPGMA (std::istream* pios):num_taxa_(0), num_char_(0), newickstring_("")
 }
 
 
+// hamming distances are scaled by the number of sites (i.e., p-distances with
+// gaps counted as differences), as before. the other models are per-site already
 std::vector< std::vector<double> > UPGMA::build_matrix () {
-    // 1) skip self comparisons
-    // 2) only calculate one half of matrix (i.e., no duplicate calcs)
-    std::vector< std::vector<double> > distances(num_taxa_, std::vector<double>(num_taxa_, 0.0));
-    
-    double tempScore = 0.0;
-    for (int i = 0; i < num_taxa_; i++) {
-        std::string seq1 = seqs_[i].get_sequence();
-        for (int j = (i + 1); j < num_taxa_; j++) {
-            std::string seq2 = seqs_[j].get_sequence();
-            // get distance
-            tempScore = (double)calc_hamming_dist(seq1, seq2);
-            // put scale in terms of number of sites. original version did not do this
-            tempScore /= (double)num_char_;
-            // put in both top and bottom of matrix, even though only top is used
-            distances[i][j] = distances[j][i] = tempScore;
-        }
-    }
-    
-    // just for debugging
-    /*
-    std::cout << "\t";
-    for (unsigned int i = 0; i < names_.size(); i++) {
-        std::cout << names_[i] << "\t";
+    DistanceMatrix dm(seqs_, alpha_name_, model_, false);
+    if (dm.get_num_undefined() > 0) {
+        std::cerr << "Error: " << dm.get_num_undefined() << " pairwise distance(s) are "
+            << "undefined under this model (saturated or no comparable sites). Exiting." << std::endl;
+        exit(0);
     }
-    std::cout << std::endl;
-    for (int i = 0; i < num_taxa_; i++) {
-        std::cout << names_[i] << "\t";
-        for (int j = 0; j < num_taxa_; j++) {
-            std::cout << distances[i][j] << "\t";
+    std::vector< std::vector<double> > distances = dm.get_matrix();
+    if (model_ == DIST_HAMMING) {
+        for (int i = 0; i < num_taxa_; i++) {
+            for (int j = 0; j < num_taxa_; j++) {
+                distances[i][j] /= (double)num_char_;
+            }
         }
-        std::cout << std::endl;
     }
-    */
-    
     return distances;
 }
 
@@ -88,6 +71,7 @@ double UPGMA::get_smallest_distance (const std::vector< std::vector<double> >& d
 
 
 void UPGMA::construct_tree () {
+    PX_PROFILE_PHASE("upgma clustering");
     // location of minimum distance (top half)
     int ind1 = 0;
     int ind2 = 0;
@@ -6,6 +6,7 @@
 #include <iostream>
 
 #include "sequence.h"
+#include "dist_matrix.h"
 
 class Tree; // forward declaration
 
@@ -17,6 +18,8 @@ private:
     std::string newickstring_;
     std::vector<std::string> names_;
     std::vector<Sequence> seqs_;
+    std::string alpha_name_;
+    distModel model_;
     std::vector< std::vector<double> > full_distmatrix_;
     Tree* tree_;
     
@@ -28,7 +31,7 @@ private:
     void construct_tree ();
 
 public:
-    UPGMA (std::istream* pios);
+    UPGMA (std::istream* pios, const distModel& model);
     std::vector< std::vector<double> > get_matrix () const;
     std::string get_newick ();
 };
@@ -16,6 +16,7 @@
 
 #include "utils.h"
 #include "superdouble.h"
+#include "scaled_lhood.h"
 
 
 // TODO: use const where possible
@@ -65,6 +66,24 @@ int string_to_int (const std::string& in, const std::string& arg) {
 }
 
 
+// as above, for values that may not fit in an int (e.g., tree indices)
+long int string_to_long_int (const std::string& in, const std::string& arg) {
+    long int res = 0;
+    try {
+            res = stol(in);
+        }
+        catch (const std::invalid_argument& ia) {
+            std::cerr << "Error: invalid argument for " << arg << " (expecting int). Exiting." << std::endl;
+            exit(0);
+        }
+        catch (const std::out_of_range& oor) {
+            std::cerr << "Error: argument for " << arg << " is out of range. Exiting." << std::endl;
+            exit(0);
+        }
+    return res;
+}
+
+
 // catch exception (atof does not do this)
 float string_to_float (const std::string& in, const std::string& arg) {
     float res = 0;
@@ -356,6 +375,98 @@ double variance (std::vector<double>& in) {
 }
 
 
+// takes a copy, as the values need to be (partially) sorted
+double median (std::vector<double> in) {
+    size_t n = in.size();
+    if (n == 0) {
+        return 0.0;
+    }
+    std::nth_element(in.begin(), in.begin() + n / 2, in.end());
+    double med = in[n / 2];
+    if (n % 2 == 0) {
+        double lower = *std::max_element(in.begin(), in.begin() + n / 2);
+        med = 0.5 * (med + lower);
+    }
+    return med;
+}
+
+
+// linear interpolation between order statistics. v must be sorted (and not empty)
+double quantile (const std::vector<double>& v, const double& p) {
+    double h = p * (double)(v.size() - 1);
+    size_t lo = (size_t)std::floor(h);
+    size_t hi = std::min(lo + 1, v.size() - 1);
+    return v[lo] + (h - (double)lo) * (v[hi] - v[lo]);
+}
+
+
+// shortest interval containing (mass * n) of the sorted values. returns {lower, upper}
+std::vector<double> calc_hpd_interval (std::vector<double> in, const double& mass) {
+    std::vector<double> res(2, 0.0);
+    size_t n = in.size();
+    if (n == 0) {
+        return res;
+    }
+    std::sort(in.begin(), in.end());
+    size_t width = (size_t)std::ceil(mass * (double)n);
+    if (width < 1) {
+        width = 1;
+    } else if (width > n) {
+        width = n;
+    }
+    size_t best = 0;
+    double best_range = in[width - 1] - in[0];
+    for (size_t i = 1; i + width <= n; i++) {
+        double range = in[i + width - 1] - in[i];
+        if (range < best_range) {
+            best_range = range;
+            best = i;
+        }
+    }
+    res[0] = in[best];
+    res[1] = in[best + width - 1];
+    return res;
+}
+
+
+// effective sample size from the batch means estimate of the asymptotic variance.
+// uses floor(sqrt(n)) batches of equal size; capped at n
+double calc_ess_batch_means (std::vector<double>& in) {
+    size_t n = in.size();
+    if (n < 4) {
+        return (double)n;
+    }
+    size_t batchsize = (size_t)std::sqrt((double)n);
+    size_t nbatches = n / batchsize;
+    double var = variance(in) * (double)n / (double)(n - 1);
+    if (var <= 0.0 || nbatches < 2) {
+        return (double)n;
+    }
+    // grand mean of the batch means
+    double bmean = 0.0;
+    std::vector<double> bmeans(nbatches, 0.0);
+    for (size_t i = 0; i < nbatches; i++) {
+        double s = 0.0;
+        for (size_t j = i * batchsize; j < (i + 1) * batchsize; j++) {
+            s += in[j];
+        }
+        bmeans[i] = s / (double)batchsize;
+        bmean += bmeans[i];
+    }
+    bmean /= (double)nbatches;
+    double ss = 0.0;
+    for (size_t i = 0; i < nbatches; i++) {
+        ss += (bmeans[i] - bmean) * (bmeans[i] - bmean);
+    }
+    double sigma2 = (double)batchsize * ss / (double)(nbatches - 1);
+    if (sigma2 <= 0.0) {
+        return (double)n;
+    }
+    double ess = (double)n * var / sigma2;
+    return std::min(ess, (double)n);
+}
+
+
 double sum (std::vector<double>& in) {
     return std::accumulate(in.begin(), in.end(), 0.0);
 }
@@ -377,14 +488,9 @@ int count_zeros (std::vector<int>& in) {
 }
 
 
+// summed in plain doubles on a shared exponent (see ScaledVector)
 Superdouble calculate_vector_Superdouble_sum (std::vector<Superdouble>& in) {
-    Superdouble sum = 0;
-    for (unsigned int i=0; i < in.size(); i++) {
-        sum += in[i];
-        // std::cout << in[i] << " sum:" << sum << std::endl;
-    }
-    // std::cout << "endsum:" << sum << std::endl;
-    return sum;
+    return ScaledVector(in).sum();
 }
 
 
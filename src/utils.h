@@ -18,6 +18,7 @@
 void check_file_exists (const std::string& filename);
 void check_inout_streams_identical (char * in, char * out);
 int string_to_int (const std::string& in, const std::string& arg);
+long int string_to_long_int (const std::string& in, const std::string& arg);
 
 std::string string_to_upper (const std::string& str);
 std::string string_to_lower (const std::string& instr);
@@ -62,6 +63,10 @@ int count_zeros (std::vector<int>& in);
 Superdouble calculate_vector_Superdouble_sum (std::vector<Superdouble>& in);
 double mean (std::vector<double>& in);
 double variance (std::vector<double>& in);
+double median (std::vector<double> in);
+double quantile (const std::vector<double>& v, const double& p);
+std::vector<double> calc_hpd_interval (std::vector<double> in, const double& mass);
+double calc_ess_batch_means (std::vector<double>& in);
 std::vector<int> sum (std::vector<int>& vec1, std::vector<int>& vec2);
 
 template<typename T> std::vector<T> sum_vectors_elementwise (std::vector<T>& vec1, std::vector<T>& vec2) {
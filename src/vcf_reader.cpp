@@ -2,96 +2,310 @@
 #include <vector>
 #include <iostream>
 #include <algorithm>
+#include <cstring>
 
 #include "vcf_reader.h"
+#include "seq_utils.h"
 #include "utils.h"
 
 
-VcfReader::VcfReader(std::istream* pios) {
+VcfReader::VcfReader (std::istream* pios):num_taxa_(0), refcol_(0), altcol_(0),
+    taxstartcol_(0), biallelic_only_(false), max_missing_(1.0), min_maf_(0.0),
+    num_sites_read_(0), num_sites_kept_(0), num_sites_not_snp_(0) {
     read_vcf(pios);
 }
 
 
+VcfReader::VcfReader (std::istream* pios, const bool& biallelic, const double& maxmissing,
+    const double& maf):num_taxa_(0), refcol_(0), altcol_(0), taxstartcol_(0),
+    biallelic_only_(biallelic), max_missing_(maxmissing), min_maf_(maf),
+    num_sites_read_(0), num_sites_kept_(0), num_sites_not_snp_(0) {
+    read_vcf(pios);
+}
+
+
+// sites are read in blocks of lines. each block is parsed in parallel (one site
+// per line) into a site-major buffer (one char per taxon), which is then
+// transposed onto the end of the (taxon-major) sequences. only ever holds one
+// block of raw lines in memory
 void VcfReader::read_vcf (std::istream* pios) {
-    bool started = false;
-    bool first = true;
-    // these column numbers should be constant (i think?), but let's not leave anything to chance
-    int refcol = 0;
-    int altcol = 0;
-    int taxstartcol = 0;
-    int ncols = 0;
+    if (!read_header(pios)) {
+        std::cerr << "Error: no '#CHROM' header line found in vcf file. Exiting." << std::endl;
+        exit(0);
+    }
+    reserve_sites(pios);
     
+    const int blocksize = 4096;
+    std::vector<std::string> lines(blocksize);
+    std::vector<char> block((size_t)blocksize * num_taxa_);
+    std::vector<int> status(blocksize);
+    std::vector<int> kept;
+    
+    bool done = false;
+    while (!done) {
+        int nlines = 0;
+        while (nlines < blocksize) {
+            if (!getline(*pios, lines[nlines])) {
+                done = true;
+                break;
+            }
+            if (lines[nlines].find_first_not_of(" \t\r") == std::string::npos) {
+                continue; // blank
+            }
+            nlines++;
+        }
+        
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < nlines; i++) {
+            status[i] = process_site(lines[i], &block[(size_t)i * num_taxa_]);
+        }
+        
+        kept.clear();
+        for (int i = 0; i < nlines; i++) {
+            if (status[i] < 0) {
+                std::cerr << "Error: malformed vcf site line (site " << (num_sites_read_ + i + 1)
+                    << "). Exiting." << std::endl;
+                exit(0);
+            } else if (status[i] == 1) {
+                kept.push_back(i);
+            } else if (status[i] == 2) {
+                num_sites_not_snp_++;
+            }
+        }
+        num_sites_read_ += nlines;
+        append_sites(block, kept);
+    }
+    //std::cout << "Read in " << taxa_.size() << " taxa, each with " << seqs_[0].size()
+    //    << " characters." << std::endl;
+}
+
+
+// skip preceeding lines, then get column layout and taxon names from the '#CHROM' line
+bool VcfReader::read_header (std::istream* pios) {
     std::string line;
     while (getline(*pios, line)) {
+        if (line.compare(0, 6, "#CHROM") != 0) {
+            continue;
+        }
         std::vector<std::string> temp = tokenize(line);
-        if (started) {
-            // every line below the bottom header line should be site data
-            std::string refstate = temp[refcol];
-            std::string terp = temp[altcol];
-            std::vector<std::string> states = get_alts(terp);
-            // put all observed states in same vector
-            states.insert(states.begin(), refstate);
-            
-            if (!first) {
-                int counter = 0;
-                for (int i = taxstartcol; i < ncols; i++) {
-                    int idx = stoi(temp[i]);
-                    seqs_[counter] += states[idx];
-                    counter++;
-                }
+        bool read_taxa = false;
+        for (unsigned int i = 1; i < temp.size(); i++) {
+            if (read_taxa) {
+                taxa_.push_back(temp[i]);
             } else {
-                // construct result vector during first data row (site)
-                for (int i = taxstartcol; i < ncols; i++) {
-                    int idx = stoi(temp[i]);
-                    seqs_.push_back(states[idx]);
-                }
-                first = false;
-            }
-        } else {
-            // skip preceeding lines
-            if (temp[0] == "#CHROM") {
-                bool read_taxa = false;
-                ncols = temp.size();
-                for (unsigned int i = 1; i < temp.size(); i++) {
-                    if (read_taxa) {
-                        taxa_.push_back(temp[i]);    
-                        //std::cout << " " << temp[i];
-                    } else {
-                        if (temp[i] =="FORMAT") {
-                            // here assuming taxa cols directly follow this column
-                            read_taxa = true;
-                            taxstartcol = i+1;
-                            //std::cout << std::endl << "Taxa:";
-                        } else if (temp[i] =="REF") {
-                            refcol = i;
-                        } else if (temp[i] =="ALT") {
-                            altcol = i;
-                        }
-                    }
+                if (temp[i] == "FORMAT") {
+                    // here assuming taxa cols directly follow this column
+                    read_taxa = true;
+                    taxstartcol_ = i+1;
+                } else if (temp[i] == "REF") {
+                    refcol_ = i;
+                } else if (temp[i] == "ALT") {
+                    altcol_ = i;
                 }
-                //std::cout << std::endl;
-                started = true;
             }
         }
+        num_taxa_ = (int)taxa_.size();
+        seqs_.resize(num_taxa_);
+        return true;
+    }
+    return false;
+}
+
+
+// if the input is seekable (i.e., a file and not a pipe), a quick memchr pass over
+// the remaining bytes gives an upper bound on the number of sites, so the
+// sequences can be allocated once
+void VcfReader::reserve_sites (std::istream* pios) {
+    std::streampos start = pios->tellg();
+    if (start == std::streampos(-1)) {
+        return;
+    }
+    const std::streamsize bufsize = 1 << 22;
+    std::vector<char> buffer(bufsize);
+    size_t nlines = 0;
+    while (*pios) {
+        pios->read(&buffer[0], bufsize);
+        std::streamsize nread = pios->gcount();
+        const char * pos = &buffer[0];
+        const char * end = pos + nread;
+        while ((pos = static_cast<const char *>(memchr(pos, '\n', end - pos))) != NULL) {
+            nlines++;
+            pos++;
+        }
+    }
+    pios->clear();
+    pios->seekg(start);
+    for (int i = 0; i < num_taxa_; i++) {
+        seqs_[i].reserve(nlines + 1);
     }
-    //std::cout << "Read in " << taxa_.size() << " taxa, each with " << seqs_[0].size()
-    //    << " characters." << std::endl;
 }
 
 
+// parse a site line in place (no tokenizing/stoi). writes one character per taxon
+// into row. returns 1 if the site passes the filters, 0 if not, 2 if it is not a
+// SNP (i.e. REF/ALT are not all single characters: indels, MNPs), -1 if the line
+// is malformed
+int VcfReader::process_site (const std::string& line, char * row) const {
+    const char * pos = line.c_str();
+    const char * ref = NULL;
+    const char * alt = NULL;
+    size_t reflen = 0;
+    size_t altlen = 0;
+    
+    // walk to the first genotype column, noting REF and ALT
+    for (int col = 0; col < taxstartcol_; col++) {
+        while (*pos == ' ' || *pos == '\t') {
+            pos++;
+        }
+        if (*pos == '\0') {
+            return -1;
+        }
+        const char * field = pos;
+        while (*pos != '\0' && *pos != ' ' && *pos != '\t') {
+            pos++;
+        }
+        if (col == refcol_) {
+            ref = field;
+            reflen = pos - field;
+        } else if (col == altcol_) {
+            alt = field;
+            altlen = pos - field;
+        }
+    }
+    if (ref == NULL || alt == NULL) {
+        return -1;
+    }
+    
+    // observed states: ref then comma-separated alts ('.' means no alt)
+    char alleles[64];
+    int nalleles = 0;
+    if (reflen != 1) {
+        return 2;
+    }
+    alleles[nalleles++] = ref[0];
+    if (!(altlen == 1 && alt[0] == '.')) {
+        size_t start = 0;
+        for (size_t i = 0; i <= altlen; i++) {
+            if (i == altlen || alt[i] == ',') {
+                if (i - start != 1) {
+                    return 2;
+                }
+                if (nalleles == 64) {
+                    return 0;
+                }
+                alleles[nalleles++] = alt[start];
+                start = i + 1;
+            }
+        }
+    }
+    
+    int counts[64] = {0};
+    int nmissing = 0;
+    for (int t = 0; t < num_taxa_; t++) {
+        while (*pos == ' ' || *pos == '\t') {
+            pos++;
+        }
+        if (*pos == '\0' || *pos == '\r') {
+            return -1;
+        }
+        // GT is the leading subfield: haploid 'a' or diploid 'a/b', 'a|b'
+        int gt[2] = {-1, -1};
+        int ncalls = 0;
+        bool missing = false;
+        while (ncalls < 2) {
+            if (*pos == '.') {
+                missing = true;
+                pos++;
+            } else if (*pos >= '0' && *pos <= '9') {
+                int idx = 0;
+                while (*pos >= '0' && *pos <= '9') {
+                    idx = idx * 10 + (*pos - '0');
+                    pos++;
+                }
+                if (idx >= nalleles) {
+                    missing = true;
+                } else {
+                    gt[ncalls] = idx;
+                }
+            } else {
+                return -1;
+            }
+            ncalls++;
+            if (*pos == '/' || *pos == '|') {
+                pos++;
+            } else {
+                break;
+            }
+        }
+        // skip rest of field
+        while (*pos != '\0' && *pos != ' ' && *pos != '\t') {
+            pos++;
+        }
+        if (missing) {
+            row[t] = 'N';
+            nmissing++;
+        } else if (ncalls == 1 || gt[0] == gt[1]) {
+            row[t] = alleles[gt[0]];
+            counts[gt[0]] += ncalls;
+        } else {
+            // heterozygote: ambiguity code
+            unsigned int mask = get_dna_mask(alleles[gt[0]]) | get_dna_mask(alleles[gt[1]]);
+            row[t] = (mask == 0) ? 'N' : get_dna_from_mask(mask);
+            counts[gt[0]]++;
+            counts[gt[1]]++;
+        }
+    }
+    
+    if (biallelic_only_ && nalleles != 2) {
+        return 0;
+    }
+    if (num_taxa_ > 0 && (double)nmissing / (double)num_taxa_ > max_missing_) {
+        return 0;
+    }
+    if (min_maf_ > 0.0) {
+        int total = 0;
+        int first = 0;
+        int second = 0;
+        for (int i = 0; i < nalleles; i++) {
+            total += counts[i];
+            if (counts[i] > first) {
+                second = first;
+                first = counts[i];
+            } else if (counts[i] > second) {
+                second = counts[i];
+            }
+        }
+        if (total == 0 || (double)second / (double)total < min_maf_) {
+            return 0;
+        }
+    }
+    return 1;
+}
 
-// *** seems like a general function would be useful here 
 
-// split alt states on comma
-std::vector<std::string> VcfReader::get_alts (const std::string& str) {
-    std::vector<std::string> res;
-    std::stringstream ss(str);
-    while(ss.good()) {
-        std::string substr;
-        getline(ss, substr, ',');
-        res.push_back(substr);
+// transpose the retained rows of a site-major block onto the end of each
+// taxon's sequence. done in tiles of taxa so the reads stay in cache
+void VcfReader::append_sites (const std::vector<char>& block, const std::vector<int>& kept) {
+    int nkept = (int)kept.size();
+    if (nkept == 0) {
+        return;
+    }
+    size_t start = (size_t)num_sites_kept_;
+    for (int t = 0; t < num_taxa_; t++) {
+        seqs_[t].resize(start + nkept);
+    }
+    const int tile = 64;
+    #pragma omp parallel for schedule(static)
+    for (int t0 = 0; t0 < num_taxa_; t0 += tile) {
+        int t1 = std::min(t0 + tile, num_taxa_);
+        for (int r = 0; r < nkept; r++) {
+            const char * row = &block[(size_t)kept[r] * num_taxa_];
+            for (int t = t0; t < t1; t++) {
+                seqs_[t][start + r] = row[t];
+            }
+        }
     }
-    return res;
+    num_sites_kept_ += nkept;
 }
 
 
@@ -10,13 +10,36 @@ class VcfReader {
 private:
     std::vector<std::string> taxa_;
     std::vector<std::string> seqs_;
+    int num_taxa_;
     
-    std::vector<std::string> get_alts (const std::string& str);
+    // these column numbers should be constant (i think?), but let's not leave anything to chance
+    int refcol_;
+    int altcol_;
+    int taxstartcol_;
+    
+    // site filters
+    bool biallelic_only_;
+    double max_missing_; // maximum proportion of taxa with a missing genotype
+    double min_maf_; // minimum minor allele frequency
+    
+    int num_sites_read_;
+    int num_sites_kept_;
+    int num_sites_not_snp_; // indels and MNPs, which are skipped
+    
+    bool read_header (std::istream* pios);
+    void reserve_sites (std::istream* pios);
+    int process_site (const std::string& line, char * row) const;
+    void append_sites (const std::vector<char>& block, const std::vector<int>& kept);
     void read_vcf (std::istream* pios);
 
 public:
     VcfReader (std::istream* pios);
+    VcfReader (std::istream* pios, const bool& biallelic, const double& maxmissing,
+        const double& maf);
     void write_seqs (const bool& uppercase, std::ostream* poos);
+    int get_num_sites_read () const { return num_sites_read_; };
+    int get_num_sites_kept () const { return num_sites_kept_; };
+    int get_num_sites_not_snp () const { return num_sites_not_snp_; };
 };
 
 #endif /* _VCF_READER_H_ */